@@ -279,6 +279,7 @@ bool artdaq::BoardReaderCore::shutdown(uint64_t /*unused*/)
 	TLOG((verbose_ ? TLVL_INFO : TLVL_DEBUG + 32)) << "Starting Shutdown transition";
 	generator_ptr_->joinThreads();  // Cleanly shut down the CommandableFragmentGenerator
 	generator_ptr_.reset(nullptr);
+	MetricHandle::Shutdown();
 	metricMan->shutdown();
 	TLOG((verbose_ ? TLVL_INFO : TLVL_DEBUG + 32)) << "Completed Shutdown transition";
 	return true;
@@ -529,6 +530,7 @@ void artdaq::BoardReaderCore::send_fragments()
 			startTime = artdaq::MonitoredQuantity::getCurrentTime();
 			TLOG(TLVL_DEBUG + 36) << "send_fragments seq=" << sequence_id << " sendFragment start";
 			auto res = sender_ptr_->sendFragment(std::move(*fragPtr));
+			generator_ptr_->RecycleFragment(std::move(fragPtr));
 			if (sender_ptr_->GetSentSequenceIDCount(sequence_id) == targetFragCount)
 			{
 				sender_ptr_->RemoveRoutingTableEntry(sequence_id);
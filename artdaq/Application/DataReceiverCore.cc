@@ -89,6 +89,7 @@ bool artdaq::DataReceiverCore::initializeDataReceiver(fhicl::ParameterSet const&
 	TLOG(TLVL_DEBUG + 32) << "Resulting art_pset_: \"" << art_pset_.to_string() << "\".";
 
 	receiver_ptr_ = std::make_unique<artdaq::DataReceiverManager>(data_tmp, event_store_ptr_);
+	event_store_ptr_->PrestartArt();
 
 	return true;
 }
@@ -165,6 +166,7 @@ bool artdaq::DataReceiverCore::stop()
 		TLOG(TLVL_DEBUG + 32) << "Retrying EventStore::endOfData()";
 		endSucceeded = event_store_ptr_->endOfData();
 	}
+	event_store_ptr_->PrestartArt();
 
 	run_is_paused_.store(false);
 	TLOG((verbose_ ? TLVL_INFO : TLVL_DEBUG + 32)) << "Completed the Stop transition for run " << event_store_ptr_->runID();
@@ -218,6 +220,7 @@ bool artdaq::DataReceiverCore::shutdown()
 	event_store_ptr_.reset();
 
 	TLOG(TLVL_DEBUG + 32) << "shutdown: Shutting down MetricManager";
+	MetricHandle::Shutdown();
 	metricMan->shutdown();
 
 	TLOG(TLVL_DEBUG + 32) << "shutdown: Complete";
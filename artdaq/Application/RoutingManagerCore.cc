@@ -5,18 +5,23 @@
 #include "artdaq/Application/RoutingManagerCore.hh"
 
 #include "artdaq-core/Utilities/ExceptionHandler.hh"
+#include "artdaq/DAQdata/TCPConnect.hh"
 #include "artdaq/DAQdata/TCP_listen_fd.hh"
 #include "artdaq/RoutingPolicies/makeRoutingManagerPolicy.hh"
 
 #include "fhiclcpp/ParameterSet.h"
 
 #include <arpa/inet.h>
+#include <fcntl.h>
 #include <netdb.h>
 #include <pthread.h>
 #include <sched.h>
 #include <sys/time.h>
+#include <sys/timerfd.h>
 #include <sys/un.h>
 #include <algorithm>
+#include <array>
+#include <cstring>
 #include <memory>
 
 const std::string artdaq::RoutingManagerCore::
@@ -43,6 +48,14 @@ artdaq::RoutingManagerCore::~RoutingManagerCore()
 	TLOG(TLVL_DEBUG + 32) << "Destructor";
 	artdaq::StatisticsCollection::getInstance().requestStop();
 	token_receiver_->stopTokenReception(true);
+	if (table_timer_fd_ != -1)
+	{
+		close(table_timer_fd_);
+	}
+	if (table_multicast_socket_ != -1)
+	{
+		close(table_multicast_socket_);
+	}
 }
 
 bool artdaq::RoutingManagerCore::initialize(fhicl::ParameterSet const& pset, uint64_t /*unused*/, uint64_t /*unused*/)
@@ -156,6 +169,7 @@ bool artdaq::RoutingManagerCore::initialize(fhicl::ParameterSet const& pset, uin
 	current_table_interval_ms_ = max_table_update_interval_ms_;
 	table_update_high_fraction_ = daq_pset.get<double>("table_update_interval_high_frac", 0.75);
 	table_update_low_fraction_ = daq_pset.get<double>("table_update_interval_low_frac", 0.5);
+	table_update_min_routes_ = daq_pset.get<size_t>("table_update_min_routes", 0);
 
 	// fetch the monitoring parameters and create the MonitoredQuantity instances
 	statsHelperPtr_->createCollectors(daq_pset, 100, 30.0, 60.0, TABLE_UPDATES_STAT_KEY);
@@ -166,7 +180,33 @@ bool artdaq::RoutingManagerCore::initialize(fhicl::ParameterSet const& pset, uin
 	token_receiver_->startTokenReception();
 	token_receiver_->pauseTokenReception();
 
+	if (epoll_fd_ == -1)
+	{
+		epoll_fd_ = epoll_create1(0);
+	}
+	if (table_timer_fd_ == -1)
+	{
+		table_timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+		struct epoll_event ev;
+		ev.data.fd = table_timer_fd_;
+		ev.events = EPOLLIN;
+		epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, table_timer_fd_, &ev);
+	}
+	if (token_receiver_->getTokenEventFD() != -1)
+	{
+		// The previous TokenReceiver's eventfd (if any) left the epoll set when it was closed
+		struct epoll_event ev;
+		ev.data.fd = token_receiver_->getTokenEventFD();
+		ev.events = EPOLLIN;
+		epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, ev.data.fd, &ev);
+	}
+
 	table_listen_port_ = daq_pset.get<int>("table_update_port", 35556);
+	table_connection_max_queued_bytes_ = daq_pset.get<size_t>("table_connection_max_queued_bytes", 10485760);
+	if (!setup_table_multicast_(daq_pset))
+	{
+		return false;
+	}
 
 	shutdown_requested_.store(true);
 	if (listen_thread_ && listen_thread_->joinable())
@@ -243,6 +283,7 @@ bool artdaq::RoutingManagerCore::shutdown(uint64_t /*unused*/)
 	}
 	token_receiver_->stopTokenReception();
 	policy_.reset();
+	MetricHandle::Shutdown();
 	metricMan->shutdown();
 	return true;
 }
@@ -300,60 +341,78 @@ void artdaq::RoutingManagerCore::process_event_table()
 	// MPI_Barrier(local_group_comm_);
 
 	TLOG(TLVL_DEBUG + 32) << "Sending initial table.";
-	auto startTime = artdaq::MonitoredQuantity::getCurrentTime();
-	auto nextSendTime = startTime;
+	table_timer_expired_ = true;
+	tokens_arrived_ = false;
+	routes_since_table_ = 0;
+	double startTime;
 	double delta_time;
 	while (!stop_requested_ && !pause_requested_)
 	{
-		receive_();
+		// Wake at least every 100 ms so that stop and pause requests are noticed
+		receive_(table_timer_expired_ ? 0 : 100);
 		if (policy_->GetRoutingMode() == detail::RoutingManagerMode::EventBuilding || policy_->GetRoutingMode() == detail::RoutingManagerMode::RequestBasedEventBuilding)
 		{
-			startTime = artdaq::MonitoredQuantity::getCurrentTime();
+			bool enough_routes = false;
+			if (table_update_min_routes_ > 0 && (tokens_arrived_ || routes_since_table_ > 0))
+			{
+				auto new_routes = policy_->GetRoutingMode() == detail::RoutingManagerMode::EventBuilding ? policy_->GetHeldTokenCount() : routes_since_table_;
+				enough_routes = new_routes >= table_update_min_routes_;
+			}
+			tokens_arrived_ = false;  // Held tokens are only re-checked when more arrive
 
-			if (startTime >= nextSendTime)
+			if (!table_timer_expired_ && !enough_routes)
 			{
-				auto table = policy_->GetCurrentTable();
+				continue;
+			}
 
-				if (table.empty())
+			startTime = artdaq::MonitoredQuantity::getCurrentTime();
+			auto table = policy_->GetCurrentTable();
+
+			if (table.empty())
+			{
+				if (table_timer_expired_)
 				{
 					TLOG(TLVL_WARNING) << "Routing Policy generated Empty table for this routing interval (" << current_table_interval_ms_ << " ms)! This may indicate issues with the receivers, if it persists."
 					                   << " Next seqID=" << policy_->GetNextSequenceID() << ", Policy held tokens=" << policy_->GetHeldTokenCount();
 				}
 				else
 				{
-					send_event_table(table);
-					++table_update_count_;
-					delta_time = artdaq::MonitoredQuantity::getCurrentTime() - startTime;
-					statsHelperPtr_->addSample(TABLE_UPDATES_STAT_KEY, delta_time);
-					TLOG(TLVL_DEBUG + 34) << "process_fragments TABLE_UPDATES_STAT_KEY=" << delta_time;
-
-					bool readyToReport = statsHelperPtr_->readyToReport();
-					if (readyToReport)
-					{
-						std::string statString = buildStatisticsString_();
-						TLOG(TLVL_INFO) << statString;
-						sendMetrics_();
-					}
+					// The held tokens could not be used yet (e.g. not enough receivers for a round); wait for more or for the interval
+					continue;
 				}
-
-				auto max_tokens = policy_->GetMaxNumberOfTokens();
-				if (max_tokens > 0)
+			}
+			else
+			{
+				send_event_table(table);
+				routes_since_table_ = 0;
+				++table_update_count_;
+				delta_time = artdaq::MonitoredQuantity::getCurrentTime() - startTime;
+				statsHelperPtr_->addSample(TABLE_UPDATES_STAT_KEY, delta_time);
+				TLOG(TLVL_DEBUG + 34) << "process_fragments TABLE_UPDATES_STAT_KEY=" << delta_time;
+
+				bool readyToReport = statsHelperPtr_->readyToReport();
+				if (readyToReport)
 				{
-					auto frac = policy_->GetTokensUsedSinceLastUpdate() / static_cast<double>(max_tokens);
-					policy_->ResetTokensUsedSinceLastUpdate();
-					if (frac > table_update_high_fraction_) current_table_interval_ms_ = 9 * current_table_interval_ms_ / 10;
-					if (frac < table_update_low_fraction_) current_table_interval_ms_ = 11 * current_table_interval_ms_ / 10;
-					if (current_table_interval_ms_ > max_table_update_interval_ms_) current_table_interval_ms_ = max_table_update_interval_ms_;
-					if (current_table_interval_ms_ < 1) current_table_interval_ms_ = 1;
+					std::string statString = buildStatisticsString_();
+					TLOG(TLVL_INFO) << statString;
+					sendMetrics_();
 				}
-				nextSendTime = startTime + current_table_interval_ms_ / 1000.0;
-				TLOG(TLVL_DEBUG + 32) << "current_table_interval_ms is now " << current_table_interval_ms_;
-				statsHelperPtr_->addSample(CURRENT_TABLE_INTERVAL_STAT_KEY, current_table_interval_ms_ / 1000.0);
 			}
-			else
+
+			auto max_tokens = policy_->GetMaxNumberOfTokens();
+			if (max_tokens > 0)
 			{
-				usleep(current_table_interval_ms_ * 10);  // 1/100 of the table update interval
+				auto frac = policy_->GetTokensUsedSinceLastUpdate() / static_cast<double>(max_tokens);
+				policy_->ResetTokensUsedSinceLastUpdate();
+				if (frac > table_update_high_fraction_) current_table_interval_ms_ = 9 * current_table_interval_ms_ / 10;
+				if (frac < table_update_low_fraction_) current_table_interval_ms_ = 11 * current_table_interval_ms_ / 10;
+				if (current_table_interval_ms_ > max_table_update_interval_ms_) current_table_interval_ms_ = max_table_update_interval_ms_;
+				if (current_table_interval_ms_ < 1) current_table_interval_ms_ = 1;
 			}
+			table_timer_expired_ = false;
+			arm_table_timer_(current_table_interval_ms_);
+			TLOG(TLVL_DEBUG + 32) << "current_table_interval_ms is now " << current_table_interval_ms_;
+			statsHelperPtr_->addSample(CURRENT_TABLE_INTERVAL_STAT_KEY, current_table_interval_ms_ / 1000.0);
 		}
 	}
 
@@ -364,29 +423,145 @@ void artdaq::RoutingManagerCore::process_event_table()
 
 void artdaq::RoutingManagerCore::send_event_table(detail::RoutingPacket packet)
 {
+	auto ranges = detail::EncodeRoutingPacket(packet);
+	if (table_multicast_socket_ != -1)
+	{
+		publish_table_(ranges);
+		return;
+	}
+
+	auto header = detail::RoutingPacketHeader(packet.size(), ranges.size());
+
+	// Encode once; every connection's queue holds a reference to the same buffer
+	auto message = std::make_shared<std::vector<uint8_t>>(sizeof(header) + ranges.size() * sizeof(detail::RoutingPacketRange));
+	memcpy(message->data(), &header, sizeof(header));
+	memcpy(message->data() + sizeof(header), ranges.data(), ranges.size() * sizeof(detail::RoutingPacketRange));  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
 	std::lock_guard<std::mutex> lk(fd_mutex_);
-	for (auto& dest : connected_fds_)
+	TLOG(TLVL_DEBUG + 32) << "Sending table information for " << header.nEntries << " events in " << header.nRanges << " ranges to " << table_connections_.size() << " table receivers";
+	TRACE(16, "headerData:0x%016lx%016lx packetData:0x%016lx%016lx", ((unsigned long*)&header)[0], ((unsigned long*)&header)[1], ((unsigned long*)&ranges[0])[0], ((unsigned long*)&ranges[0])[1]);  // NOLINT
+
+	std::vector<int> fds;
+	fds.reserve(table_connections_.size());
+	for (auto& connection : table_connections_)
+	{
+		fds.push_back(connection.first);
+	}
+	size_t backlogged = 0;
+	for (auto fd : fds)
 	{
-		for (auto& connected_fd : dest.second)
+		if (queue_message_(fd, message) && table_connections_[fd].want_write)
 		{
-			auto header = detail::RoutingPacketHeader(packet.size());
-			TLOG(TLVL_DEBUG + 32) << "Sending table information for " << header.nEntries << " events to destination " << dest.first;
-			TRACE(16, "headerData:0x%016lx%016lx packetData:0x%016lx%016lx", ((unsigned long*)&header)[0], ((unsigned long*)&header)[1], ((unsigned long*)&packet[0])[0], ((unsigned long*)&packet[0])[1]);  // NOLINT
-			auto sts = write(connected_fd, &header, sizeof(header));
-			if (sts != sizeof(header))
-			{
-				TLOG(TLVL_ERROR) << "Error sending routing header to fd " << connected_fd << ", rank " << dest.first;
-			}
-			else
-			{
-				sts = write(connected_fd, &packet[0], packet.size() * sizeof(detail::RoutingPacketEntry));
-				if (sts != static_cast<ssize_t>(packet.size() * sizeof(detail::RoutingPacketEntry)))
-				{
-					TLOG(TLVL_ERROR) << "Error sending routing table. sts=" << sts << "/" << packet.size() * sizeof(detail::RoutingPacketEntry) << ", fd=" << connected_fd << ", rank=" << dest.first;
-				}
-			}
+			++backlogged;
 		}
 	}
+	if (backlogged > 0)
+	{
+		TLOG(TLVL_DEBUG + 32) << backlogged << " table receivers have not yet read all of their table updates";
+	}
+}
+
+void artdaq::RoutingManagerCore::publish_table_(std::vector<detail::RoutingPacketRange> const& ranges)
+{
+	// Each datagram is a complete update, so that one lost datagram only loses the ranges it contains
+	size_t max_ranges = 1;
+	auto overhead = sizeof(detail::RoutingTableUpdateHeader) + sizeof(detail::RoutingPacketHeader);
+	if (table_multicast_max_datagram_size_ > overhead + sizeof(detail::RoutingPacketRange))
+	{
+		max_ranges = (table_multicast_max_datagram_size_ - overhead) / sizeof(detail::RoutingPacketRange);
+	}
+
+	std::lock_guard<std::mutex> lk(fd_mutex_);
+	std::vector<uint8_t> datagram;
+	for (size_t first = 0; first < ranges.size(); first += max_ranges)
+	{
+		auto count = std::min(max_ranges, ranges.size() - first);
+		size_t entries = 0;
+		for (size_t ii = first; ii < first + count; ++ii)
+		{
+			entries += ranges[ii].count;
+		}
+		detail::RoutingPacketHeader header(entries, count);
+
+		// The update without its RoutingTableUpdateHeader is what a table receiver which missed it is sent over its table connection
+		auto message = std::make_shared<std::vector<uint8_t>>(sizeof(header) + count * sizeof(detail::RoutingPacketRange));
+		memcpy(message->data(), &header, sizeof(header));
+		memcpy(message->data() + sizeof(header), &ranges[first], count * sizeof(detail::RoutingPacketRange));  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+		detail::RoutingTableUpdateHeader update_header(++table_update_number_);
+		datagram.resize(sizeof(update_header) + message->size());
+		memcpy(datagram.data(), &update_header, sizeof(update_header));
+		memcpy(datagram.data() + sizeof(update_header), message->data(), message->size());  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+		TLOG(TLVL_DEBUG + 32) << "Publishing table update " << update_header.update_number << " for " << header.nEntries << " events in " << header.nRanges << " ranges";
+		auto sts = sendto(table_multicast_socket_, datagram.data(), datagram.size(), 0, reinterpret_cast<sockaddr*>(&table_multicast_addr_), sizeof(table_multicast_addr_));  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+		if (sts != static_cast<ssize_t>(datagram.size()))
+		{
+			// The socket does not block the main loop; table receivers will request the update when they see the gap
+			TLOG(TLVL_WARNING) << "Error publishing table update " << update_header.update_number << ", errno=" << errno << " (" << strerror(errno) << ")";
+		}
+
+		table_update_history_.emplace_back(update_header.update_number, message);
+		while (table_update_history_.size() > table_update_history_size_)
+		{
+			table_update_history_.pop_front();
+		}
+	}
+}
+
+bool artdaq::RoutingManagerCore::setup_table_multicast_(fhicl::ParameterSet const& daq_pset)
+{
+	if (table_multicast_socket_ != -1)
+	{
+		close(table_multicast_socket_);
+		table_multicast_socket_ = -1;
+	}
+	if (!daq_pset.get<bool>("table_update_multicast", false))
+	{
+		return true;
+	}
+
+	auto address = daq_pset.get<std::string>("table_update_multicast_address", portMan->GetRoutingTableGroupAddress());
+	auto port = daq_pset.get<int>("table_update_multicast_port", portMan->GetRoutingTablePort());
+	auto interface_address = daq_pset.get<std::string>("multicast_interface_ip", "0.0.0.0");
+	table_multicast_max_datagram_size_ = daq_pset.get<size_t>("table_update_multicast_max_datagram_size", 8192);
+	table_update_history_size_ = daq_pset.get<size_t>("table_update_multicast_history", 1000);
+	TLOG(TLVL_INFO) << "Publishing table updates on multicast group " << address << ":" << port << ", multicast interface=" << interface_address;
+
+	table_multicast_socket_ = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_UDP);
+	if (table_multicast_socket_ < 0)
+	{
+		TLOG(TLVL_ERROR) << "Error creating socket for publishing table updates! err=" << strerror(errno);
+		return false;
+	}
+	if (ResolveHost(address.c_str(), port, table_multicast_addr_) == -1)
+	{
+		TLOG(TLVL_ERROR) << "Unable to resolve table update multicast address " << address << ", err=" << strerror(errno);
+		return false;
+	}
+
+	// For 0.0.0.0, use system-specified IP_MULTICAST_IF
+	if (interface_address != "localhost" && interface_address != "0.0.0.0")
+	{
+		struct in_addr addr;
+		if (GetInterfaceForNetwork(interface_address.c_str(), addr) == -1)
+		{
+			TLOG(TLVL_ERROR) << "Unable to determine the multicast interface address for " << interface_address << ", err=" << strerror(errno);
+			return false;
+		}
+		if (setsockopt(table_multicast_socket_, IPPROTO_IP, IP_MULTICAST_IF, &addr, sizeof(addr)) == -1)
+		{
+			TLOG(TLVL_ERROR) << "Cannot set outgoing interface for table updates, err=" << strerror(errno);
+			return false;
+		}
+	}
+	int yes = 1;
+	if (setsockopt(table_multicast_socket_, IPPROTO_IP, IP_MULTICAST_LOOP, &yes, sizeof(yes)) < 0)
+	{
+		TLOG(TLVL_ERROR) << "Unable to enable multicast loopback on table update socket, err=" << strerror(errno);
+		return false;
+	}
+	return true;
 }
 
 std::string artdaq::RoutingManagerCore::report(std::string const& /*unused*/) const
@@ -477,10 +652,6 @@ void artdaq::RoutingManagerCore::sendMetrics_()
 
 void artdaq::RoutingManagerCore::listen_()
 {
-	if (epoll_fd_ == -1)
-	{
-		epoll_fd_ = epoll_create1(0);
-	}
 	int listen_fd = -1;
 	while (shutdown_requested_ == false)
 	{
@@ -537,9 +708,13 @@ void artdaq::RoutingManagerCore::listen_()
 				continue;
 			}
 
+			// Table updates and replies are queued and written as the socket allows, see flush_connection_
+			fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
 			// now add (new) connection
 			std::lock_guard<std::mutex> lk(fd_mutex_);
 			connected_fds_[rch.rank].insert(fd);
+			table_connections_[fd].rank = rch.rank;
 			struct epoll_event ev;
 			ev.data.fd = fd;
 			ev.events = EPOLLIN;
@@ -567,110 +742,244 @@ void artdaq::RoutingManagerCore::listen_()
 		}
 	}
 	connected_fds_.clear();
+	table_connections_.clear();
 
 }  // listen_
 
-void artdaq::RoutingManagerCore::receive_()
+void artdaq::RoutingManagerCore::arm_table_timer_(size_t interval_ms)
 {
-	if (epoll_fd_ == -1)
+	itimerspec timer_spec = {};
+	timer_spec.it_value.tv_sec = interval_ms / 1000;
+	timer_spec.it_value.tv_nsec = (interval_ms % 1000) * 1000000;
+	if (timerfd_settime(table_timer_fd_, 0, &timer_spec, nullptr) == -1)
 	{
-		epoll_fd_ = epoll_create1(0);
+		TLOG(TLVL_WARNING) << "Error arming table update timer, errno=" << errno << " (" << strerror(errno) << "). Sending table updates without waiting";
+		table_timer_expired_ = true;
 	}
-	std::vector<epoll_event> received_events(10);
+}
 
-	int nfds = 1;
-	while (nfds > 0)
+void artdaq::RoutingManagerCore::receive_(int timeout_ms)
+{
+	std::array<epoll_event, 64> received_events;
+
+	// Only the event processing needs the lock; the listen thread may add sockets while this thread waits
+	auto nfds = epoll_wait(epoll_fd_, received_events.data(), received_events.size(), timeout_ms);
+	if (nfds == -1)
 	{
-		std::lock_guard<std::mutex> lk(fd_mutex_);
-		nfds = epoll_wait(epoll_fd_, &received_events[0], received_events.size(), 1);
-		if (nfds == -1)
+		if (errno == EINTR)
+		{
+			return;
+		}
+		TLOG(TLVL_ERROR) << "Error status received from epoll_wait, exiting with code " << EXIT_FAILURE << ", errno=" << errno << " (" << strerror(errno) << ")";
+		perror("epoll_wait");
+		exit(EXIT_FAILURE);
+	}
+
+	if (nfds > 0)
+	{
+		TLOG(TLVL_DEBUG + 35) << "Received " << nfds << " events on table sockets";
+	}
+	std::lock_guard<std::mutex> lk(fd_mutex_);
+	for (auto n = 0; n < nfds; ++n)
+	{
+		auto fd = received_events[n].data.fd;  // NOLINT(cppcoreguidelines-pro-bounds-constant-array-index)
+		if (fd == table_timer_fd_ || fd == token_receiver_->getTokenEventFD())
+		{
+			uint64_t count;
+			if (read(fd, &count, sizeof(count)) == sizeof(count))
+			{
+				(fd == table_timer_fd_ ? table_timer_expired_ : tokens_arrived_) = true;
+			}
+			continue;
+		}
+
+		if (table_connections_.count(fd) == 0)
+		{
+			continue;  // Closed while handling an earlier event
+		}
+		auto events = received_events[n].events;  // NOLINT(cppcoreguidelines-pro-bounds-constant-array-index)
+		if ((events & EPOLLOUT) != 0 && !flush_connection_(fd))
 		{
-			TLOG(TLVL_ERROR) << "Error status received from epoll_wait, exiting with code " << EXIT_FAILURE << ", errno=" << errno << " (" << strerror(errno) << ")";
-			perror("epoll_wait");
-			exit(EXIT_FAILURE);
+			continue;
 		}
+		if ((events & (EPOLLIN | EPOLLHUP | EPOLLERR)) != 0)
+		{
+			read_requests_(fd);
+		}
+	}
+}
 
-		if (nfds > 0)
+bool artdaq::RoutingManagerCore::read_requests_(int fd)
+{
+	auto& connection = table_connections_[fd];
+	while (true)
+	{
+		auto sts = read(fd, reinterpret_cast<uint8_t*>(&connection.request) + connection.request_bytes, sizeof(detail::RoutingRequest) - connection.request_bytes);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		if (sts == 0)
 		{
-			TLOG(TLVL_DEBUG + 35) << "Received " << nfds << " events on table sockets";
+			// The peer has gone away; with a level-triggered epoll set the socket would otherwise be reported forever
+			close_connection_(fd, "Received 0-size request");
+			return false;
 		}
-		for (auto n = 0; n < nfds; ++n)
+		if (sts < 0)
 		{
-			bool reading = true;
-			int sts = 0;
-			while (reading)
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
 			{
-				if ((received_events[n].events & EPOLLIN) != 0)
+				TLOG(TLVL_DEBUG + 32) << "No more requests from this rank. Continuing poll loop.";
+				return true;
+			}
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			close_connection_(fd, std::string("Error reading from request socket: errno=") + std::to_string(errno) + " (" + strerror(errno) + ")");
+			return false;
+		}
+
+		connection.request_bytes += sts;
+		if (connection.request_bytes < sizeof(detail::RoutingRequest))
+		{
+			continue;
+		}
+		connection.request_bytes = 0;
+		auto& buff = connection.request;
+		if (buff.header != ROUTING_MAGIC)
+		{
+			TLOG(TLVL_ERROR) << "Received invalid request from " << connection.rank << ", header=" << std::hex << buff.header;
+			continue;
+		}
+
+		TLOG(TLVL_DEBUG + 33) << "Received request from " << buff.rank << " mode=" << detail::RoutingRequest::RequestModeToString(buff.mode);
+		detail::RoutingPacketEntry reply;
+		std::shared_ptr<std::vector<uint8_t>> message;
+		switch (buff.mode)
+		{
+			case detail::RoutingRequest::RequestMode::Disconnect:
+				close_connection_(fd, "Disconnect requested");
+				return false;
+
+			case detail::RoutingRequest::RequestMode::Request:
+				reply = policy_->GetRouteForSequenceID(buff.sequence_id, buff.rank);
+				if (reply.sequence_id == buff.sequence_id)
 				{
-					detail::RoutingRequest buff;
-					auto stss = read(received_events[n].data.fd, &buff, sizeof(detail::RoutingRequest) - sts);
-					sts += stss;
-					if (stss == 0)
-					{
-						TLOG(TLVL_INFO) << "Received 0-size request from " << find_fd_(received_events[n].data.fd);
-						reading = false;
-					}
-					else if (stss < 0 && errno == EAGAIN)
-					{
-						TLOG(TLVL_DEBUG + 32) << "No more requests from this rank. Continuing poll loop.";
-						reading = false;
-					}
-					else if (stss < 0)
-					{
-						TLOG(TLVL_ERROR) << "Error reading from request socket: sts=" << sts << ", errno=" << errno << " (" << strerror(errno) << ")";
-						close(received_events[n].data.fd);
-						epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, received_events[n].data.fd, nullptr);
-						reading = false;
-					}
-					else if (sts == sizeof(detail::RoutingRequest) && buff.header != ROUTING_MAGIC)
-					{
-						TLOG(TLVL_ERROR) << "Received invalid request from " << find_fd_(received_events[n].data.fd) << " sts=" << sts << ", header=" << std::hex << buff.header;
-						reading = false;
-					}
-					else if (sts == sizeof(detail::RoutingRequest))
+					TLOG(TLVL_DEBUG + 33) << "Reply to request from " << buff.rank << " with route to " << reply.destination_rank << " for sequence ID " << buff.sequence_id;
+					detail::RoutingPacketHeader hdr(1, 1);
+					detail::RoutingPacketRange range(reply.sequence_id, 1, reply.destination_rank);
+					message = std::make_shared<std::vector<uint8_t>>(sizeof(hdr) + sizeof(range));
+					memcpy(message->data(), &hdr, sizeof(hdr));
+					memcpy(message->data() + sizeof(hdr), &range, sizeof(range));  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+					++routes_since_table_;
+				}
+				else
+				{
+					TLOG(TLVL_DEBUG + 33) << "Unable to route request, replying with empty RoutingPacket";
+					detail::RoutingPacketHeader hdr(0, 0);
+					message = std::make_shared<std::vector<uint8_t>>(sizeof(hdr));
+					memcpy(message->data(), &hdr, sizeof(hdr));
+				}
+				// Replies go through the same queue as table updates, so that they are never interleaved with a partially-written table
+				if (!queue_message_(fd, message))
+				{
+					return false;
+				}
+				break;
+			case detail::RoutingRequest::RequestMode::Resend:
+				if (!table_update_history_.empty() && buff.sequence_id >= table_update_history_.front().first && buff.sequence_id <= table_update_history_.back().first)
+				{
+					TLOG(TLVL_DEBUG + 33) << "Resending table update " << buff.sequence_id << " to " << buff.rank;
+					if (!queue_message_(fd, table_update_history_[buff.sequence_id - table_update_history_.front().first].second))
 					{
-						reading = false;
-						sts = 0;
-						TLOG(TLVL_DEBUG + 33) << "Received request from " << buff.rank << " mode=" << detail::RoutingRequest::RequestModeToString(buff.mode);
-						detail::RoutingPacketEntry reply;
-
-						switch (buff.mode)
-						{
-							case detail::RoutingRequest::RequestMode::Disconnect:
-								connected_fds_[buff.rank].erase(received_events[n].data.fd);
-								close(received_events[n].data.fd);
-								epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, received_events[n].data.fd, nullptr);
-								break;
-
-							case detail::RoutingRequest::RequestMode::Request:
-								reply = policy_->GetRouteForSequenceID(buff.sequence_id, buff.rank);
-								if (reply.sequence_id == buff.sequence_id)
-								{
-									TLOG(TLVL_DEBUG + 33) << "Reply to request from " << buff.rank << " with route to " << reply.destination_rank << " for sequence ID " << buff.sequence_id;
-									detail::RoutingPacketHeader hdr(1);
-									write(received_events[n].data.fd, &hdr, sizeof(hdr));
-									write(received_events[n].data.fd, &reply, sizeof(detail::RoutingPacketEntry));
-								}
-								else
-								{
-									TLOG(TLVL_DEBUG + 33) << "Unable to route request, replying with empty RoutingPacket";
-									detail::RoutingPacketHeader hdr(0);
-									write(received_events[n].data.fd, &hdr, sizeof(hdr));
-								}
-								break;
-							default:
-								TLOG(TLVL_WARNING) << "Received request from " << buff.rank << " with invalid mode " << detail::RoutingRequest::RequestModeToString(buff.mode) << " (currently only expecting Disconnect or Request)";
-								break;
-						}
+						return false;
 					}
 				}
 				else
 				{
-					TLOG(TLVL_DEBUG + 32) << "Received event mask " << received_events[n].events << " from table socket rank " << find_fd_(received_events[n].data.fd);
+					// The table receiver will request the routes it needs by sequence ID
+					TLOG(TLVL_DEBUG + 33) << "Table update " << buff.sequence_id << " requested by " << buff.rank << " is no longer available";
 				}
+				break;
+			default:
+				TLOG(TLVL_WARNING) << "Received request from " << buff.rank << " with invalid mode " << detail::RoutingRequest::RequestModeToString(buff.mode) << " (currently only expecting Disconnect, Request or Resend)";
+				break;
+		}
+	}
+}
+
+bool artdaq::RoutingManagerCore::queue_message_(int fd, EncodedMessage const& message)
+{
+	auto& connection = table_connections_[fd];
+	if (connection.queued_bytes + message->size() > table_connection_max_queued_bytes_)
+	{
+		TLOG(TLVL_WARNING) << "Table receiver rank " << connection.rank << " has " << connection.queued_bytes << " bytes of table updates queued, more than table_connection_max_queued_bytes ("
+		                   << table_connection_max_queued_bytes_ << "). Disconnecting it; it will have to reconnect and request the routes it missed.";
+		close_connection_(fd, "Table receiver fell too far behind");
+		return false;
+	}
+	connection.send_queue.push_back(message);
+	connection.queued_bytes += message->size();
+	if (connection.want_write)
+	{
+		return true;  // The socket is known to be full; epoll will report when it can take more
+	}
+	return flush_connection_(fd);
+}
+
+bool artdaq::RoutingManagerCore::flush_connection_(int fd)
+{
+	auto& connection = table_connections_[fd];
+	while (!connection.send_queue.empty())
+	{
+		auto const& message = *connection.send_queue.front();
+		auto sts = send(fd, message.data() + connection.send_offset, message.size() - connection.send_offset, MSG_NOSIGNAL);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		if (sts < 0)
+		{
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+			{
+				break;
+			}
+			if (errno == EINTR)
+			{
+				continue;
 			}
+			close_connection_(fd, std::string("Error sending routing table: errno=") + std::to_string(errno) + " (" + strerror(errno) + ")");
+			return false;
+		}
+		connection.send_offset += sts;
+		if (connection.send_offset == message.size())
+		{
+			connection.queued_bytes -= message.size();
+			connection.send_queue.pop_front();
+			connection.send_offset = 0;
 		}
 	}
+
+	bool want_write = !connection.send_queue.empty();
+	if (want_write != connection.want_write)
+	{
+		struct epoll_event ev;
+		ev.data.fd = fd;
+		ev.events = want_write ? EPOLLIN | EPOLLOUT : EPOLLIN;
+		epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd, &ev);
+		connection.want_write = want_write;
+	}
+	return true;
+}
+
+void artdaq::RoutingManagerCore::close_connection_(int fd, std::string const& reason)
+{
+	auto it = table_connections_.find(fd);
+	auto rank = it != table_connections_.end() ? it->second.rank : find_fd_(fd);
+	TLOG(TLVL_INFO) << reason << ", closing table connection " << fd << " for rank " << rank;
+	if (it != table_connections_.end())
+	{
+		table_connections_.erase(it);
+	}
+	if (rank != -1)
+	{
+		connected_fds_[rank].erase(fd);
+	}
+	epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+	close(fd);
 }
 
 int artdaq::RoutingManagerCore::find_fd_(int fd) const
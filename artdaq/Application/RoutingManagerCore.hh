@@ -16,11 +16,14 @@
 #include <sys/epoll.h>
 
 #include <atomic>
+#include <deque>
 #include <map>
 #include <memory>
 #include <mutex>
 #include <set>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace artdaq {
 class RoutingManagerCore;
@@ -76,9 +79,20 @@ public:
 	 *   "table_update_interval_ms" (Default: 1000): Maximum amount of time between table updates
 	 *   "table_update_interval_high_frac" (Default: 0.75): Fraction of the maximum seen table size at which the interval should be reduced
 	 *   "table_update_interval_low_frac" (Default: 0.5): Fraction of the maximum seen table size at which the interval should be increased
+	 *   "table_update_min_routes" (Default: 0): Send a table update as soon as this many new routes are available (held tokens in EventBuilding mode,
+	 *     answered requests in RequestBasedEventBuilding mode), without waiting for the update interval. 0 sends updates only at the interval.
 	 *   "senders_send_by_send_count" (Default: false): If true, senders will use the current send count to lookup routing information in the table, instead of sequence ID.
 	 *   "table_ack_retry_count" (Default: 5): The number of times the table will be resent while waiting for acknowledements
 	 *   "table_update_port" (Default: 35556): The port on which to send table updates
+	 *   "table_connection_max_queued_bytes" (Default: 10485760): Table updates and replies which a table receiver has not read are queued
+	 *     for it, up to this many bytes. A table receiver which falls further behind is disconnected, and must reconnect and request the routes it missed.
+	 *   "table_update_multicast" (Default: false): Publish each table update once on a multicast group, instead of sending it on every
+	 *     table connection. Table receivers must be configured the same way; they use their table connection to request updates they missed.
+	 *   "table_update_multicast_address" (Default: PortManager routing table group): Multicast group to publish table updates on
+	 *   "table_update_multicast_port" (Default: PortManager routing table port): Port to publish table updates on
+	 *   "multicast_interface_ip" (Default: "0.0.0.0"): Address of the network to publish table updates on. 0.0.0.0 uses the system default interface
+	 *   "table_update_multicast_max_datagram_size" (Default: 8192): Larger table updates are split into several consecutively-numbered updates
+	 *   "table_update_multicast_history" (Default: 1000): Number of published table updates kept for table receivers which request them again
 	 *   "table_acknowledge_port" (Default: 35557): The port on which to listen for RoutingAckPacket datagrams
 	 *   "table_update_address" (Default: "227.128.12.28"): Multicast address to send table updates to
 	 *   "routing_manager_hostname" (Default: "localhost"): Hostname to send table updates from
@@ -139,18 +153,24 @@ public:
 	/**
 	 * \brief Main loop of the RoutingManagerCore. Determines when to send the next table update,
 	 * asks the RoutingManagerPolicy for the table to send, and sends it.
+	 *
+	 * The loop blocks in epoll_wait on the routing request sockets, the TokenReceiver's token eventfd and
+	 * a timerfd for the table update interval, so that table updates are sent when the interval expires
+	 * or when table_update_min_routes new routes are available, whichever comes first.
 	 */
 	void process_event_table();
 
 	/**
 	 * \brief Sends a detail::RoutingPacket to the table receivers
-	 * \param packet The detail::RoutingPacket to send
+	 * \param packet The detail::RoutingPacket to send, range-encoded using detail::EncodeRoutingPacket
+	 *
+	 * send_event_table encodes the table update once and queues the same buffer on every table
+	 * connection. Each connection's queue is written without blocking, as far as its socket allows;
+	 * the rest is written by the main loop when epoll reports the socket writable. A slow table
+	 * receiver therefore does not delay the others or the processing of tokens and requests.
 	 *
-	 * send_event_table checks the table update socket and the acknowledge socket before
-	 * sending the table update the first time. It then enters a loop where it sends the table
-	 * update, then waits for acknowledgement packets. It keeps track of which senders have sent
-	 * their acknowledgement packets, and discards duplicate acks. It leaves this loop once all
-	 * senders have sent a valid acknowledgement packet.
+	 * With table_update_multicast, the update is instead published once on the multicast group, and
+	 * kept so that table receivers can request it again if they missed it.
 	 */
 	void send_event_table(detail::RoutingPacket packet);
 
@@ -178,6 +198,7 @@ private:
 	std::atomic<size_t> current_table_interval_ms_;
 	double table_update_high_fraction_;
 	double table_update_low_fraction_;
+	size_t table_update_min_routes_;
 	std::atomic<size_t> table_update_count_;
 
 	std::shared_ptr<RoutingManagerPolicy> policy_;
@@ -191,7 +212,33 @@ private:
 	int table_listen_port_;
 
 	std::map<int, std::set<int>> connected_fds_;
+
+	using EncodedMessage = std::shared_ptr<std::vector<uint8_t> const>;
+	/// Per-connection state for a table receiver's socket
+	struct TableConnection
+	{
+		int rank{-1};                          ///< Rank of the table receiver
+		std::deque<EncodedMessage> send_queue;  ///< Messages not yet completely written; table updates are shared between connections
+		size_t send_offset{0};                 ///< Bytes of send_queue.front() already written
+		size_t queued_bytes{0};                ///< Bytes in send_queue not yet written
+		bool want_write{false};                ///< Whether EPOLLOUT is currently requested for this socket
+		detail::RoutingRequest request;        ///< Partially-received request
+		size_t request_bytes{0};               ///< Bytes of request received so far
+	};
+	std::unordered_map<int, TableConnection> table_connections_;
+	size_t table_connection_max_queued_bytes_;
 	int epoll_fd_{-1};
+	int table_timer_fd_{-1};
+	bool table_timer_expired_{false};  // Set by receive_ when table_timer_fd_ fires
+	bool tokens_arrived_{false};       // Set by receive_ when the TokenReceiver has added tokens to the policy
+	size_t routes_since_table_{0};     // Requests answered with a new route since the last table update
+
+	int table_multicast_socket_{-1};
+	sockaddr_in table_multicast_addr_;
+	size_t table_multicast_max_datagram_size_;
+	uint64_t table_update_number_{0};  // Number of the last table update published on the multicast group
+	std::deque<std::pair<uint64_t, EncodedMessage>> table_update_history_;
+	size_t table_update_history_size_;
 	mutable std::mutex fd_mutex_;
 
 	// attributes and methods for statistics gathering & reporting
@@ -202,8 +249,17 @@ private:
 	void sendMetrics_();
 
 	void listen_();
-	void receive_();
+	void receive_(int timeout_ms);
+	void arm_table_timer_(size_t interval_ms);
+	bool setup_table_multicast_(fhicl::ParameterSet const& daq_pset);
 	int find_fd_(int fd) const;
+
+	// These must be called with fd_mutex_ held. They return false if the connection was closed.
+	bool queue_message_(int fd, EncodedMessage const& message);
+	bool flush_connection_(int fd);
+	bool read_requests_(int fd);
+	void publish_table_(std::vector<detail::RoutingPacketRange> const& ranges);
+	void close_connection_(int fd, std::string const& reason);
 };
 
 #endif /* artdaq_Application_MPI2_RoutingManagerCore_hh */
@@ -3,6 +3,7 @@
 
 #include "artdaq/ArtModules/ArtdaqSharedMemoryServiceInterface.h"
 #include "artdaq/DAQdata/Globals.hh"
+#include "artdaq/DAQdata/ShmemWakeup.hh"
 
 #include "artdaq-core/Core/SharedMemoryEventReceiver.hh"
 #include "artdaq-core/Utilities/ExceptionHandler.hh"
@@ -14,6 +15,7 @@
 #include "fhiclcpp/types/ConfigurationTable.h"
 #include "fhiclcpp/types/Name.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <memory>
 
@@ -89,7 +91,15 @@ private:
 	ArtdaqSharedMemoryService& operator=(ArtdaqSharedMemoryService&&) = delete;
 
 private:
+	// Release the current buffer, and wake any receiver in the artdaq process waiting for a free buffer
+	void release_buffer_()
+	{
+		incoming_events_->ReleaseBuffer();
+		buffer_wakeup_->NotifySpace();
+	}
+
 	std::unique_ptr<artdaq::SharedMemoryEventReceiver> incoming_events_;
+	std::unique_ptr<artdaq::detail::ShmemWakeup> buffer_wakeup_;
 	std::shared_ptr<artdaq::detail::RawEventHeader> evtHeader_;
 	size_t read_timeout_;
 	bool resume_after_timeout_;
@@ -104,15 +114,18 @@ static fhicl::ParameterSet empty_pset;
 
 ArtdaqSharedMemoryService::ArtdaqSharedMemoryService(fhicl::ParameterSet const& pset, art::ActivityRegistry& /*unused*/)
     : incoming_events_(nullptr)
+    , buffer_wakeup_(nullptr)
     , evtHeader_(nullptr)
     , read_timeout_(pset.get<size_t>("read_timeout_us", static_cast<size_t>(pset.get<double>("waiting_time", 600.0) * 1000000)))
     , resume_after_timeout_(pset.get<bool>("resume_after_timeout", true))
 {
 	TLOG(TLVL_DEBUG + 33) << "ArtdaqSharedMemoryService CONSTRUCTOR";
 
+	auto shared_memory_key = pset.get<int>("shared_memory_key", build_key(0xEE000000));
 	incoming_events_ = std::make_unique<artdaq::SharedMemoryEventReceiver>(
-	    pset.get<int>("shared_memory_key", build_key(0xEE000000)),
+	    shared_memory_key,
 	    pset.get<int>("broadcast_shared_memory_key", build_key(0xBB000000)));
+	buffer_wakeup_ = std::make_unique<artdaq::detail::ShmemWakeup>(shared_memory_key, false);
 
 	char const* artapp_env = getenv("ARTDAQ_APPLICATION_NAME");
 	std::string artapp_str;
@@ -203,7 +216,7 @@ std::unordered_map<artdaq::Fragment::type_t, std::unique_ptr<artdaq::Fragments>>
 		auto hdrPtr = incoming_events_->ReadHeader(errflag);
 		if (errflag || hdrPtr == nullptr)
 		{  // Buffer was changed out from under reader!
-			incoming_events_->ReleaseBuffer();
+			release_buffer_();
 			continue;  // retry
 			           // return recvd_fragments;
 		}
@@ -212,35 +225,47 @@ std::unordered_map<artdaq::Fragment::type_t, std::unique_ptr<artdaq::Fragments>>
 		auto fragmentTypes = incoming_events_->GetFragmentTypes(errflag);
 		if (errflag)
 		{  // Buffer was changed out from under reader!
-			incoming_events_->ReleaseBuffer();
+			release_buffer_();
 			continue;  // retry
 			           // return recvd_fragments;
 		}
 		if (fragmentTypes.empty())
 		{
 			TLOG(TLVL_ERROR) << "Event has no Fragments! Aborting!";
-			incoming_events_->ReleaseBuffer();
+			release_buffer_();
 			return recvd_fragments;
 		}
 
+		// This is the only copy of the event data on the way into art: art products must own their data, and
+		// artdaq::Fragment cannot wrap external storage, so the Fragments are copied out of the shared memory
+		// buffer here. Everything downstream (the sort below, ShmemWrapper, ArtdaqInputHelper) moves them.
+		bool read_error = false;
 		for (auto const& type : fragmentTypes)
 		{
 			TLOG(TLVL_DEBUG + 33) << "ReceiveEvent: Getting all Fragments of type " << static_cast<int>(type);
-			recvd_fragments[type] = incoming_events_->GetFragmentsByType(errflag, type);
-			if (!recvd_fragments[type])
+			auto frags = incoming_events_->GetFragmentsByType(errflag, type);
+			if (!frags)
 			{
-				TLOG(TLVL_WARNING) << "Error retrieving Fragments from shared memory! (Most likely due to a buffer overwrite) Retrying...";
-				incoming_events_->ReleaseBuffer();
-				recvd_fragments.clear();
-				continue;
+				read_error = true;
+				break;
 			}
 			/* Events coming out of the EventStore are not sorted but need to be
 	   sorted by sequence ID before they can be passed to art.
 	*/
-			std::sort(recvd_fragments[type]->begin(), recvd_fragments[type]->end(), artdaq::fragmentSequenceIDCompare);
+			if (!std::is_sorted(frags->begin(), frags->end(), artdaq::fragmentSequenceIDCompare))
+			{
+				std::sort(frags->begin(), frags->end(), artdaq::fragmentSequenceIDCompare);
+			}
+			recvd_fragments.emplace(type, std::move(frags));
 		}
 		TLOG(TLVL_DEBUG + 33) << "ReceiveEvent: Releasing buffer";
-		incoming_events_->ReleaseBuffer();
+		release_buffer_();
+		if (read_error)
+		{
+			// Stop reading the buffer as soon as an error is seen, release it exactly once, and retry with the next event
+			TLOG(TLVL_WARNING) << "Error retrieving Fragments from shared memory! (Most likely due to a buffer overwrite) Retrying...";
+			recvd_fragments.clear();
+		}
 	}
 
 	TLOG(TLVL_DEBUG + 33) << "ReceiveEvent END";
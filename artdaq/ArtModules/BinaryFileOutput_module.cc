@@ -18,11 +18,10 @@
 #include "fhiclcpp/ParameterSet.h"
 
 #include "artdaq-core/Data/Fragment.hh"
+#include "artdaq/ArtModules/detail/BinaryFileWriter.hh"
 #include "artdaq/DAQdata/Globals.hh"
 
-#include <unistd.h>
 #include <cstdio>
-#include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <memory>
@@ -53,6 +52,9 @@ public:
 	 * BinaryFileOutput also expects the following Parameters:
 	 * "fileName" (REQUIRED): Name of the file to write
 	 * "directIO" (Default: false): Whether to use O_DIRECT (Ref. issue #24437)
+	 * "writeBufferSize" (Default: 16 MB): Size of each write buffer. Fragments are copied into a buffer, and full buffers are written by a background thread.
+	 * "writeBufferCount" (Default: 4): Number of write buffers. write() only waits for the disk when all of them are full.
+	 * "preallocateSize" (Default: 256 MB): Size of each fallocate(2) extension of the output file (0 to disable)
 	 */
 	explicit BinaryFileOutput(ParameterSet const& ps);
 
@@ -86,8 +88,10 @@ private:
 	std::string name_ = "BinaryFileOutput";
 	std::string file_name_ = "/tmp/artdaqdemo.binary";
 	bool do_direct_ = false;
-	int fd_ = -1;  // Used for direct IO
-	std::unique_ptr<std::ofstream> file_ptr_ = {nullptr};
+	size_t buffer_size_ = 0x1000000;
+	size_t buffer_count_ = 4;
+	size_t preallocate_size_ = 0x10000000;
+	std::unique_ptr<BinaryFileWriter> writer_ = {nullptr};
 	art::FileStatsCollector fstats_;
 };
 
@@ -118,30 +122,18 @@ void art::BinaryFileOutput::endJob()
 void art::BinaryFileOutput::initialize_FILE_()
 {
 	std::string file_name = PostCloseFileRenamer{fstats_}.applySubstitutions(file_name_);
-	if (do_direct_)
-	{
-		fd_ = open(file_name.c_str(), O_WRONLY | O_CREAT | O_DIRECT, 0660);  // O_DIRECT - ref. artdaq-core/Core/QuickVec.hh:#define QV_ALIGN 512 and artdaq issue #24437
-		TLOG(TLVL_DEBUG + 33) << "initialize_FILE_ fd_=" << fd_;
-	}
-	else
-	{
-		file_ptr_ = std::make_unique<std::ofstream>(file_name, std::ofstream::binary);
-		TLOG(TLVL_DEBUG + 33) << "BinaryFileOutput::initialize_FILE_ file_ptr_=" << static_cast<void*>(file_ptr_.get()) << " errno=" << errno;
-		// file_ptr_->rdbuf()->pubsetbuf(0, 0);
-	}
+	writer_ = std::make_unique<BinaryFileWriter>(file_name, do_direct_, buffer_size_, buffer_count_, preallocate_size_);
+	TLOG(TLVL_DEBUG + 33) << "BinaryFileOutput::initialize_FILE_ file_name=" << file_name << " direct=" << writer_->DirectIO();
 	fstats_.recordFileOpen();
 }
 
 void art::BinaryFileOutput::deinitialize_FILE_()
 {
-	if (do_direct_)
+	if (writer_)
 	{
-		close(fd_);
-		fd_ = -1;
-	}
-	else
-	{
-		file_ptr_.reset(nullptr);
+		// Close waits until every buffered Fragment has been written, so the file is complete when it is renamed
+		writer_->Close();
+		writer_.reset(nullptr);
 	}
 	fstats_.recordFileClose();
 }
@@ -162,15 +154,13 @@ bool art::BinaryFileOutput::readParameterSet_(fhicl::ParameterSet const& pset)
 		return false;
 	}
 	do_direct_ = pset.get<bool>("directIO", false);
+	buffer_size_ = pset.get<size_t>("writeBufferSize", buffer_size_);
+	buffer_count_ = pset.get<size_t>("writeBufferCount", buffer_count_);
+	preallocate_size_ = pset.get<size_t>("preallocateSize", preallocate_size_);
 	// determine the data sending parameters
 	return true;
 }
 
-#define USE_STATIC_BUFFER 0
-#if USE_STATIC_BUFFER == 1
-static unsigned char static_buffer[0xa00000];
-#endif
-
 void art::BinaryFileOutput::write(EventPrincipal& ep)
 {
 	using RawEvent = artdaq::Fragments;
@@ -201,21 +191,8 @@ void art::BinaryFileOutput::write(EventPrincipal& ep)
 			TLOG(TLVL_DEBUG + 33) << "BinaryFileOutput::write seq=" << sequence_id << " frag=" << fragid_id << " "
 			                      << reinterpret_cast<const void*>(fragment.headerBeginBytes()) << " bytes=0x" << std::hex  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
 			                      << fragment.sizeBytes() << " start";
-			if (do_direct_)
-			{
-				ssize_t sts = ::write(fd_, reinterpret_cast<const char*>(fragment.headerBeginBytes()), fragment.sizeBytes());  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
-				TLOG(TLVL_DEBUG + 34) << "BinaryFileOutput::write seq=" << sequence_id << " frag=" << fragid_id << " done sts=" << sts
-				                      << " errno=" << errno;
-			}
-			else
-			{
-#if USE_STATIC_BUFFER == 1
-				file_ptr_->write((char*)static_buffer, fragment.sizeBytes());
-#else
-				file_ptr_->write(reinterpret_cast<const char*>(fragment.headerBeginBytes()), fragment.sizeBytes());  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
-#endif
-				TLOG(TLVL_DEBUG + 34) << "BinaryFileOutput::write seq=" << sequence_id << " frag=" << fragid_id << " done errno=" << errno;
-			}
+			writer_->Write(fragment.headerBeginBytes(), fragment.sizeBytes());
+			TLOG(TLVL_DEBUG + 34) << "BinaryFileOutput::write seq=" << sequence_id << " frag=" << fragid_id << " buffered";
 		}
 	}
 	fstats_.recordEvent(ep.eventID());
@@ -0,0 +1,257 @@
+#include "TRACE/tracemf.h"
+#define TRACE_NAME "BinaryFileWriter"
+
+#include "artdaq/ArtModules/detail/BinaryFileWriter.hh"
+
+#include "cetlib_except/exception.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+constexpr size_t direct_io_alignment = 4096;  // Satisfies the O_DIRECT requirements of all common block devices
+
+size_t align_up(size_t bytes) { return (bytes + direct_io_alignment - 1) / direct_io_alignment * direct_io_alignment; }
+}  // namespace
+
+art::BinaryFileWriter::BinaryFileWriter(std::string const& file_name, bool direct_io, size_t buffer_size_bytes, size_t buffer_count, size_t preallocate_bytes)
+    : file_name_(file_name)
+    , direct_io_(direct_io)
+    , buffer_size_(align_up(std::max(buffer_size_bytes, direct_io_alignment)))
+    , preallocate_bytes_(preallocate_bytes)
+    , fd_(-1)
+    , current_(nullptr)
+    , bytes_written_(0)
+    , closing_(false)
+    , file_offset_(0)
+    , allocated_bytes_(0)
+    , error_(0)
+{
+	if (direct_io_)
+	{
+		fd_ = open(file_name_.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0660);  // NOLINT(cppcoreguidelines-pro-type-vararg)
+		if (fd_ == -1 && errno == EINVAL)
+		{
+			TLOG(TLVL_WARNING) << "Filesystem does not support O_DIRECT for " << file_name_ << ", using buffered IO";
+			direct_io_ = false;
+		}
+	}
+	if (!direct_io_)
+	{
+		fd_ = open(file_name_.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0660);  // NOLINT(cppcoreguidelines-pro-type-vararg)
+	}
+	if (fd_ == -1)
+	{
+		throw cet::exception("BinaryFileWriter") << "Could not open " << file_name_ << ": " << strerror(errno);  // NOLINT(cert-err60-cpp)
+	}
+
+	buffers_.reserve(std::max(buffer_count, static_cast<size_t>(2)));
+	for (size_t ii = 0; ii < buffers_.capacity(); ++ii)
+	{
+		auto data = static_cast<unsigned char*>(aligned_alloc(direct_io_alignment, buffer_size_));
+		if (data == nullptr)
+		{
+			close(fd_);
+			throw cet::exception("BinaryFileWriter") << "Could not allocate " << buffer_size_ << " byte write buffer";  // NOLINT(cert-err60-cpp)
+		}
+		buffers_.push_back(Buffer{std::unique_ptr<unsigned char, void (*)(void*)>(data, free), 0});
+	}
+	for (auto& buffer : buffers_)
+	{
+		free_buffers_.push_back(&buffer);
+	}
+
+	TLOG(TLVL_DEBUG + 32) << "Opened " << file_name_ << " fd=" << fd_ << " direct_io=" << direct_io_ << ", " << buffers_.size() << " buffers of " << buffer_size_ << " bytes";
+	writer_thread_ = std::thread([this] { writer_loop_(); });
+}
+
+art::BinaryFileWriter::~BinaryFileWriter()
+{
+	try
+	{
+		Close();
+	}
+	catch (cet::exception const& ex)
+	{
+		TLOG(TLVL_ERROR) << "Error closing " << file_name_ << ": " << ex.what();
+	}
+}
+
+void art::BinaryFileWriter::Write(void const* data, size_t bytes)
+{
+	if (fd_ == -1)
+	{
+		throw cet::exception("BinaryFileWriter") << "Write called after " << file_name_ << " was closed";  // NOLINT(cert-err60-cpp)
+	}
+	throw_if_failed_();
+
+	auto src = static_cast<unsigned char const*>(data);
+	auto remaining = bytes;
+	while (remaining > 0)
+	{
+		if (current_ == nullptr)
+		{
+			std::unique_lock<std::mutex> lk(mutex_);
+			if (free_buffers_.empty())
+			{
+				TLOG(TLVL_DEBUG + 34) << "Write: waiting for a free buffer";
+				free_cv_.wait(lk, [this] { return !free_buffers_.empty(); });
+			}
+			current_ = free_buffers_.front();
+			free_buffers_.pop_front();
+			current_->used = 0;
+		}
+
+		auto count = std::min(remaining, buffer_size_ - current_->used);
+		memcpy(current_->data.get() + current_->used, src, count);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		current_->used += count;
+		src += count;  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		remaining -= count;
+
+		if (current_->used == buffer_size_)
+		{
+			submit_current_();
+		}
+	}
+	bytes_written_ += bytes;
+}
+
+void art::BinaryFileWriter::Close()
+{
+	if (fd_ == -1)
+	{
+		return;
+	}
+
+	if (current_ != nullptr && current_->used > 0)
+	{
+		submit_current_();
+	}
+	{
+		std::lock_guard<std::mutex> lk(mutex_);
+		if (current_ != nullptr)
+		{
+			free_buffers_.push_back(current_);
+			current_ = nullptr;
+		}
+		closing_ = true;
+	}
+	full_cv_.notify_all();
+	if (writer_thread_.joinable())
+	{
+		writer_thread_.join();
+	}
+
+	// Remove the O_DIRECT padding of the last buffer, and any preallocated space beyond the data
+	if (ftruncate(fd_, bytes_written_) == -1)
+	{
+		int expected = 0;
+		error_.compare_exchange_strong(expected, errno);
+	}
+	close(fd_);
+	fd_ = -1;
+	TLOG(TLVL_DEBUG + 32) << "Closed " << file_name_ << " after writing " << bytes_written_ << " bytes";
+	throw_if_failed_();
+}
+
+void art::BinaryFileWriter::submit_current_()
+{
+	{
+		std::lock_guard<std::mutex> lk(mutex_);
+		full_buffers_.push_back(current_);
+		current_ = nullptr;
+	}
+	full_cv_.notify_one();
+}
+
+void art::BinaryFileWriter::throw_if_failed_()
+{
+	auto error = error_.load();
+	if (error != 0)
+	{
+		throw cet::exception("BinaryFileWriter") << "Error writing " << file_name_ << ": " << strerror(error);  // NOLINT(cert-err60-cpp)
+	}
+}
+
+void art::BinaryFileWriter::writer_loop_()
+{
+	std::unique_lock<std::mutex> lk(mutex_);
+	while (true)
+	{
+		full_cv_.wait(lk, [this] { return !full_buffers_.empty() || closing_; });
+		if (full_buffers_.empty())
+		{
+			break;  // Closing, and every submitted buffer has been written
+		}
+
+		auto buffer = full_buffers_.front();
+		full_buffers_.pop_front();
+		lk.unlock();
+
+		// After an error, keep recycling buffers so that Write and Close do not wait forever
+		if (error_.load() == 0)
+		{
+			write_buffer_(*buffer);
+		}
+
+		lk.lock();
+		free_buffers_.push_back(buffer);
+		free_cv_.notify_all();
+	}
+	TLOG(TLVL_DEBUG + 33) << "Writer thread for " << file_name_ << " exiting";
+}
+
+void art::BinaryFileWriter::write_buffer_(Buffer& buffer)
+{
+	auto length = buffer.used;
+	if (direct_io_)
+	{
+		// Only the last buffer can be partially filled; pad it, and Close will truncate the file afterwards
+		auto aligned = align_up(length);
+		memset(buffer.data.get() + length, 0, aligned - length);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		length = aligned;
+	}
+	preallocate_(file_offset_ + length);
+
+	size_t done = 0;
+	while (done < length)
+	{
+		auto sts = ::write(fd_, buffer.data.get() + done, length - done);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		if (sts == -1)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			auto err = errno;
+			TLOG(TLVL_ERROR) << "Error writing " << length << " bytes at offset " << file_offset_ + done << " of " << file_name_ << ": " << strerror(err);
+			int expected = 0;
+			error_.compare_exchange_strong(expected, err);
+			return;
+		}
+		done += sts;
+	}
+	TLOG(TLVL_DEBUG + 34) << "Wrote " << length << " bytes at offset " << file_offset_ << " of " << file_name_;
+	file_offset_ += length;
+}
+
+void art::BinaryFileWriter::preallocate_(size_t end_offset)
+{
+	if (preallocate_bytes_ == 0 || end_offset <= allocated_bytes_)
+	{
+		return;
+	}
+
+	auto length = std::max(preallocate_bytes_, end_offset - allocated_bytes_);
+	if (fallocate(fd_, FALLOC_FL_KEEP_SIZE, allocated_bytes_, length) == -1)
+	{
+		TLOG(TLVL_WARNING) << "fallocate failed for " << file_name_ << " (" << strerror(errno) << "), disabling preallocation";
+		preallocate_bytes_ = 0;
+		return;
+	}
+	allocated_bytes_ += length;
+}
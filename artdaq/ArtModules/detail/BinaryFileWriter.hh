@@ -0,0 +1,111 @@
+#ifndef artdaq_ArtModules_BinaryFileWriter_hh
+#define artdaq_ArtModules_BinaryFileWriter_hh
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace art {
+/**
+ * \brief Writes a stream of bytes to a file from a background thread, using a pool of large aligned buffers
+ *
+ * Write copies data into the current buffer; full buffers are handed to the writer thread, which issues one
+ * write(2) per buffer (aligned for O_DIRECT) and preallocates the file in large chunks with fallocate(2). Write only
+ * blocks when every buffer is waiting to be written. Close writes any partial buffer, waits for the writer thread to
+ * finish, and trims the file to the number of bytes written.
+ */
+class BinaryFileWriter
+{
+public:
+	/**
+	 * \brief BinaryFileWriter Constructor. Opens (and truncates) the file and starts the writer thread.
+	 * \param file_name Name of the file to write
+	 * \param direct_io Whether to open the file with O_DIRECT. Falls back to buffered IO if the filesystem does not support it.
+	 * \param buffer_size_bytes Size of each buffer; rounded up to the O_DIRECT alignment
+	 * \param buffer_count Number of buffers (at least 2)
+	 * \param preallocate_bytes Size of each fallocate(2) extension of the file; 0 disables preallocation
+	 */
+	BinaryFileWriter(std::string const& file_name, bool direct_io, size_t buffer_size_bytes, size_t buffer_count, size_t preallocate_bytes);
+
+	/**
+	 * \brief BinaryFileWriter Destructor. Calls Close, logging rather than throwing any error.
+	 */
+	~BinaryFileWriter();
+
+	/**
+	 * \brief Append data to the file
+	 * \param data Pointer to the data
+	 * \param bytes Number of bytes to append
+	 * \exception cet::exception if the file is closed, or a previous write failed
+	 */
+	void Write(void const* data, size_t bytes);
+
+	/**
+	 * \brief Write all buffered data, wait for it to reach the file, and close the file
+	 * \exception cet::exception if any write failed
+	 */
+	void Close();
+
+	/**
+	 * \brief Get the number of bytes passed to Write
+	 * \return The number of bytes passed to Write
+	 */
+	size_t BytesWritten() const { return bytes_written_; }
+
+	/**
+	 * \brief Whether the file is being written with O_DIRECT
+	 * \return True if O_DIRECT is in use
+	 */
+	bool DirectIO() const { return direct_io_; }
+
+private:
+	BinaryFileWriter(BinaryFileWriter const&) = delete;
+	BinaryFileWriter(BinaryFileWriter&&) = delete;
+	BinaryFileWriter& operator=(BinaryFileWriter const&) = delete;
+	BinaryFileWriter& operator=(BinaryFileWriter&&) = delete;
+
+	struct Buffer
+	{
+		std::unique_ptr<unsigned char, void (*)(void*)> data;
+		size_t used;
+	};
+
+	void writer_loop_();
+	void write_buffer_(Buffer& buffer);
+	void preallocate_(size_t end_offset);
+	void submit_current_();
+	void throw_if_failed_();
+
+	std::string file_name_;
+	bool direct_io_;
+	size_t buffer_size_;
+	size_t preallocate_bytes_;
+	int fd_;
+
+	std::vector<Buffer> buffers_;
+	Buffer* current_;
+	size_t bytes_written_;
+
+	std::mutex mutex_;
+	std::condition_variable free_cv_;
+	std::condition_variable full_cv_;
+	std::deque<Buffer*> free_buffers_;
+	std::deque<Buffer*> full_buffers_;
+	bool closing_;
+
+	// Only accessed by the writer thread
+	size_t file_offset_;
+	size_t allocated_bytes_;
+
+	std::atomic<int> error_;  // errno of the first failed write, or 0
+	std::thread writer_thread_;
+};
+}  // namespace art
+
+#endif  // artdaq_ArtModules_BinaryFileWriter_hh
@@ -5,6 +5,7 @@
 #define TRACE_DECLARE
 #endif
 #include "artdaq-utilities/Plugins/MetricManager.hh"
+#include "artdaq/DAQdata/MetricHandle.hh"
 #include "artdaq/DAQdata/PortManager.hh"
 
 #define my_rank artdaq::Globals::my_rank_
@@ -155,6 +156,7 @@ public:
 	 */
 	static void CleanUpGlobals()
 	{
+		MetricHandle::Shutdown();  // Its publisher thread sends to metricMan
 		metricMan_.reset(nullptr);
 		portMan_.reset(nullptr);
 	}
@@ -0,0 +1,501 @@
+#include "artdaq/DAQdata/Globals.hh"
+#define TRACE_NAME (app_name + "_MetricHandle").c_str()
+
+#include "artdaq/DAQdata/MetricHandle.hh"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace artdaq {
+namespace detail {
+/**
+ * \brief Description of a registered metric, plus the shared storage for its LastPoint value
+ */
+struct RegisteredMetric
+{
+	size_t index;
+	std::string name;
+	std::string unit;
+	int level;
+	uint32_t mode;
+	bool accumulates;  ///< Whether any mode other than LastPoint is set, i.e. whether per-thread accumulators are needed
+
+	std::atomic<double> last{0.0};
+	std::atomic<bool> last_updated{false};
+};
+}  // namespace detail
+}  // namespace artdaq
+
+namespace {
+constexpr uint32_t mode_bit(artdaq::MetricMode mode) { return static_cast<uint32_t>(mode); }
+
+constexpr size_t slots_per_chunk = 64;
+constexpr size_t max_chunks = 256;  // Up to 16384 metrics
+
+/**
+ * Accumulator for one metric in one thread. sum and count are only written by the owning thread, so they are
+ * updated with plain load/store; the publisher remembers what it has already forwarded. min and max are reset by
+ * the publisher, so they are updated with compare-and-swap.
+ */
+struct Slot
+{
+	std::atomic<double> sum{0.0};
+	std::atomic<uint64_t> count{0};
+	std::atomic<double> min{std::numeric_limits<double>::infinity()};
+	std::atomic<double> max{-std::numeric_limits<double>::infinity()};
+
+	// Only accessed by the publisher
+	double published_sum{0.0};
+	uint64_t published_count{0};
+};
+
+struct ThreadSlots
+{
+	ThreadSlots() = default;
+	~ThreadSlots()
+	{
+		for (auto& chunk : chunks)
+		{
+			delete[] chunk.load();
+		}
+	}
+	ThreadSlots(ThreadSlots const&) = delete;
+	ThreadSlots(ThreadSlots&&) = delete;
+	ThreadSlots& operator=(ThreadSlots const&) = delete;
+	ThreadSlots& operator=(ThreadSlots&&) = delete;
+
+	// Called by the owning thread only
+	Slot& get(size_t index)
+	{
+		auto& chunk = chunks[index / slots_per_chunk];
+		auto slots = chunk.load(std::memory_order_acquire);
+		if (slots == nullptr)
+		{
+			slots = new Slot[slots_per_chunk];
+			chunk.store(slots, std::memory_order_release);
+		}
+		return slots[index % slots_per_chunk];  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	}
+
+	// Called by the publisher; returns nullptr if the owning thread never recorded this metric
+	Slot* find(size_t index)
+	{
+		auto slots = chunks[index / slots_per_chunk].load(std::memory_order_acquire);
+		return slots == nullptr ? nullptr : &slots[index % slots_per_chunk];  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	}
+
+	std::array<std::atomic<Slot*>, max_chunks> chunks{};
+	std::atomic<bool> retired{false};
+};
+
+class MetricRegistry
+{
+public:
+	static MetricRegistry& instance()
+	{
+		static MetricRegistry registry;
+		return registry;
+	}
+
+	// metricMan may already be gone during static destruction, so nothing is sent from here. Shutdown should be
+	// called before metricMan is destroyed.
+	~MetricRegistry()
+	{
+		{
+			std::lock_guard<std::mutex> lk(mutex_);
+			stop_ = true;
+			exiting_ = true;
+		}
+		cv_.notify_all();
+		if (publisher_.joinable())
+		{
+			publisher_.join();
+		}
+	}
+
+	void shutdown()
+	{
+		std::thread publisher;
+		{
+			std::lock_guard<std::mutex> lk(mutex_);
+			stop_ = true;
+			publisher = std::move(publisher_);
+		}
+		cv_.notify_all();
+		if (publisher.joinable())
+		{
+			publisher.join();  // The publisher forwards what has been recorded since its last publish before exiting
+		}
+		std::lock_guard<std::mutex> lk(mutex_);
+		stop_ = false;
+	}
+
+	void publish()
+	{
+		std::unique_lock<std::mutex> lk(mutex_);
+		auto outgoing = collect_();
+		lk.unlock();
+		send_(outgoing);
+	}
+
+	void setSink(artdaq::MetricHandle::PublishCallback sink)
+	{
+		std::lock_guard<std::mutex> lk(mutex_);
+		sink_ = std::move(sink);
+	}
+
+	artdaq::detail::RegisteredMetric* add(std::string const& name, std::string const& unit, int level, artdaq::MetricMode mode)
+	{
+		std::lock_guard<std::mutex> lk(mutex_);
+		startPublisher_();  // Also restarts it after a shutdown
+		auto it = by_name_.find(name);
+		if (it != by_name_.end())
+		{
+			return it->second;
+		}
+		if (metrics_.size() >= slots_per_chunk * max_chunks)
+		{
+			TLOG(TLVL_WARNING) << "Too many metrics registered, " << name << " will not be reported";
+			return nullptr;
+		}
+
+		auto& metric = metrics_.emplace_back();
+		metric.index = metrics_.size() - 1;
+		metric.name = name;
+		metric.unit = unit;
+		metric.level = level;
+		metric.mode = mode_bit(mode);
+		metric.accumulates = (metric.mode & ~mode_bit(artdaq::MetricMode::LastPoint)) != 0;
+		by_name_[name] = &metric;
+		TLOG(TLVL_DEBUG + 35) << "Registered metric " << name << " with index " << metric.index;
+		return &metric;
+	}
+
+	void addConstant(std::string const& name, std::string const& value, int level)
+	{
+		std::lock_guard<std::mutex> lk(mutex_);
+		startPublisher_();
+		for (auto& constant : constants_)
+		{
+			if (constant.name == name)
+			{
+				constant.value = value;
+				constant.level = level;
+				return;
+			}
+		}
+		constants_.push_back({name, value, level});
+	}
+
+	void setInterval(double seconds)
+	{
+		std::lock_guard<std::mutex> lk(mutex_);
+		interval_ = std::chrono::duration<double>(seconds);
+		cv_.notify_all();
+	}
+
+	std::shared_ptr<ThreadSlots> addThread()
+	{
+		auto slots = std::make_shared<ThreadSlots>();
+		std::lock_guard<std::mutex> lk(mutex_);
+		threads_.push_back(slots);
+		return slots;
+	}
+
+private:
+	MetricRegistry() = default;
+	MetricRegistry(MetricRegistry const&) = delete;
+	MetricRegistry(MetricRegistry&&) = delete;
+	MetricRegistry& operator=(MetricRegistry const&) = delete;
+	MetricRegistry& operator=(MetricRegistry&&) = delete;
+
+	struct Constant
+	{
+		std::string name;
+		std::string value;
+		int level;
+	};
+
+	// A value to forward to metricMan once mutex_ has been released
+	struct Outgoing
+	{
+		std::string name;
+		double value;
+		std::string string_value;
+		bool is_string;
+		std::string unit;
+		int level;
+		artdaq::MetricMode mode;
+	};
+
+	// mutex_ must be held
+	void startPublisher_()
+	{
+		if (!publisher_.joinable() && !stop_)
+		{
+			publisher_ = std::thread([this] { publish_loop_(); });
+		}
+	}
+
+	void publish_loop_()
+	{
+		std::unique_lock<std::mutex> lk(mutex_);
+		while (!stop_)
+		{
+			cv_.wait_for(lk, interval_, [this] { return stop_; });
+			if (exiting_)
+			{
+				break;
+			}
+			auto outgoing = collect_();
+			lk.unlock();
+			send_(outgoing);
+			lk.lock();
+		}
+	}
+
+	// mutex_ must be held
+	std::vector<Outgoing> collect_()
+	{
+		std::vector<Outgoing> outgoing;
+
+		// A thread which was seen to have exited before its accumulators are read cannot record anything afterward, so
+		// it can be dropped once they have been folded in below. Threads which exit later are folded in once more on
+		// the next publish.
+		std::vector<ThreadSlots*> retired;
+		for (auto& thread : threads_)
+		{
+			if (thread->retired.load())
+			{
+				retired.push_back(thread.get());
+			}
+		}
+
+		for (auto& metric : metrics_)
+		{
+			if (metric.accumulates)
+			{
+				double sum = 0.0;
+				uint64_t count = 0;
+				double min = std::numeric_limits<double>::infinity();
+				double max = -std::numeric_limits<double>::infinity();
+				for (auto& thread : threads_)
+				{
+					auto slot = thread->find(metric.index);
+					if (slot == nullptr)
+					{
+						continue;
+					}
+					// The owner stores sum before count, so reading count first never sees more samples than sum contains
+					auto slot_count = slot->count.load(std::memory_order_acquire);
+					auto slot_sum = slot->sum.load(std::memory_order_relaxed);
+					count += slot_count - slot->published_count;
+					sum += slot_sum - slot->published_sum;
+					slot->published_count = slot_count;
+					slot->published_sum = slot_sum;
+					min = std::min(min, slot->min.exchange(std::numeric_limits<double>::infinity()));
+					max = std::max(max, slot->max.exchange(-std::numeric_limits<double>::infinity()));
+				}
+				if (count > 0)
+				{
+					collect_(outgoing, metric, sum, count, min, max);
+				}
+			}
+			if ((metric.mode & mode_bit(artdaq::MetricMode::LastPoint)) != 0 && metric.last_updated.exchange(false))
+			{
+				collect_(outgoing, metric, artdaq::MetricMode::LastPoint, " - Last", metric.last.load());
+			}
+		}
+
+		threads_.erase(std::remove_if(threads_.begin(), threads_.end(), [&](auto const& thread) { return std::find(retired.begin(), retired.end(), thread.get()) != retired.end(); }), threads_.end());
+
+		for (auto& constant : constants_)
+		{
+			outgoing.push_back({constant.name, 0.0, constant.value, true, "", constant.level, artdaq::MetricMode::LastPoint});
+		}
+		return outgoing;
+	}
+
+	// mutex_ must be held
+	void collect_(std::vector<Outgoing>& outgoing, artdaq::detail::RegisteredMetric const& metric, double sum, uint64_t count, double min, double max)
+	{
+		if ((metric.mode & mode_bit(artdaq::MetricMode::Accumulate)) != 0)
+		{
+			collect_(outgoing, metric, artdaq::MetricMode::Accumulate, " - Total", sum);
+		}
+		if ((metric.mode & mode_bit(artdaq::MetricMode::Rate)) != 0)
+		{
+			collect_(outgoing, metric, artdaq::MetricMode::Rate, " - Rate", sum);
+		}
+		if ((metric.mode & mode_bit(artdaq::MetricMode::Average)) != 0)
+		{
+			collect_(outgoing, metric, artdaq::MetricMode::Average, " - Average", sum / count);
+		}
+		if ((metric.mode & mode_bit(artdaq::MetricMode::Minimum)) != 0)
+		{
+			collect_(outgoing, metric, artdaq::MetricMode::Minimum, " - Min", min);
+		}
+		if ((metric.mode & mode_bit(artdaq::MetricMode::Maximum)) != 0)
+		{
+			collect_(outgoing, metric, artdaq::MetricMode::Maximum, " - Max", max);
+		}
+	}
+
+	// mutex_ must be held
+	static void collect_(std::vector<Outgoing>& outgoing, artdaq::detail::RegisteredMetric const& metric, artdaq::MetricMode mode, char const* suffix, double value)
+	{
+		auto statistics = metric.mode & ~mode_bit(artdaq::MetricMode::Persist);
+		bool single_mode = (statistics & (statistics - 1)) == 0;
+		outgoing.push_back({single_mode ? metric.name : metric.name + suffix, value, "", false, metric.unit, metric.level, mode});
+	}
+
+	// mutex_ must not be held, so that a slow metricMan does not block registration or thread startup
+	void send_(std::vector<Outgoing> const& outgoing)
+	{
+		artdaq::MetricHandle::PublishCallback sink;
+		{
+			std::lock_guard<std::mutex> lk(mutex_);
+			sink = sink_;
+		}
+		for (auto& out : outgoing)
+		{
+			if (sink)
+			{
+				if (!out.is_string)
+				{
+					sink(out.name, out.value, out.mode);
+				}
+			}
+			else if (metricMan)
+			{
+				if (out.is_string)
+				{
+					metricMan->sendMetric(out.name, out.string_value, out.unit, out.level, out.mode);
+				}
+				else
+				{
+					metricMan->sendMetric(out.name, out.value, out.unit, out.level, out.mode);
+				}
+			}
+		}
+	}
+
+	std::mutex mutex_;
+	std::condition_variable cv_;
+	std::deque<artdaq::detail::RegisteredMetric> metrics_;  // deque, so that handles stay valid as metrics are added
+	std::unordered_map<std::string, artdaq::detail::RegisteredMetric*> by_name_;
+	std::vector<Constant> constants_;
+	std::vector<std::shared_ptr<ThreadSlots>> threads_;
+	std::chrono::duration<double> interval_{1.0};
+	bool stop_{false};
+	bool exiting_{false};
+	artdaq::MetricHandle::PublishCallback sink_;
+	std::thread publisher_;
+};
+
+/**
+ * Owns the calling thread's accumulators. The registry keeps its own reference, so that the values recorded by a
+ * thread are still published after the thread exits.
+ */
+struct LocalSlots
+{
+	~LocalSlots()
+	{
+		if (slots)
+		{
+			slots->retired = true;
+		}
+	}
+
+	ThreadSlots& get()
+	{
+		if (!slots)
+		{
+			slots = MetricRegistry::instance().addThread();
+		}
+		return *slots;
+	}
+
+	std::shared_ptr<ThreadSlots> slots;
+};
+
+thread_local LocalSlots local_slots;
+}  // namespace
+
+artdaq::MetricHandle artdaq::MetricHandle::Register(std::string const& name, std::string const& unit, int level, MetricMode mode)
+{
+	return MetricHandle(MetricRegistry::instance().add(name, unit, level, mode));
+}
+
+void artdaq::MetricHandle::RegisterConstant(std::string const& name, std::string const& value, int level)
+{
+	MetricRegistry::instance().addConstant(name, value, level);
+}
+
+void artdaq::MetricHandle::SetPublishInterval(double seconds)
+{
+	MetricRegistry::instance().setInterval(seconds);
+}
+
+void artdaq::MetricHandle::Publish()
+{
+	MetricRegistry::instance().publish();
+}
+
+void artdaq::MetricHandle::Shutdown()
+{
+	MetricRegistry::instance().shutdown();
+}
+
+void artdaq::MetricHandle::SetPublishCallback(PublishCallback callback)
+{
+	MetricRegistry::instance().setSink(std::move(callback));
+}
+
+void artdaq::MetricHandle::Record(double value) const
+{
+	if (metric_ == nullptr)
+	{
+		return;
+	}
+
+	if ((metric_->mode & mode_bit(MetricMode::LastPoint)) != 0)
+	{
+		metric_->last.store(value, std::memory_order_relaxed);
+		metric_->last_updated.store(true, std::memory_order_release);
+	}
+	if (!metric_->accumulates)
+	{
+		return;
+	}
+
+	auto& slot = local_slots.get().get(metric_->index);
+	slot.sum.store(slot.sum.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+	slot.count.store(slot.count.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+
+	if ((metric_->mode & mode_bit(MetricMode::Minimum)) != 0)
+	{
+		auto current = slot.min.load(std::memory_order_relaxed);
+		while (value < current && !slot.min.compare_exchange_weak(current, value, std::memory_order_relaxed))
+		{
+		}
+	}
+	if ((metric_->mode & mode_bit(MetricMode::Maximum)) != 0)
+	{
+		auto current = slot.max.load(std::memory_order_relaxed);
+		while (value > current && !slot.max.compare_exchange_weak(current, value, std::memory_order_relaxed))
+		{
+		}
+	}
+}
@@ -0,0 +1,102 @@
+#ifndef artdaq_DAQdata_MetricHandle_hh
+#define artdaq_DAQdata_MetricHandle_hh
+
+#include "artdaq-utilities/Plugins/MetricManager.hh"
+
+#include <functional>
+#include <string>
+
+namespace artdaq {
+namespace detail {
+struct RegisteredMetric;
+}
+
+/**
+ * \brief A pre-registered metric, which can be recorded on hot paths without building names or queueing
+ *
+ * MetricHandle::Register is called once, at initialization, and returns a handle to the named metric. Record then
+ * folds values into an accumulator owned by the calling thread, using only relaxed stores and compare-and-swap on
+ * words which no other writer touches. A background thread combines the accumulators of all threads and forwards
+ * one value per statistic to metricMan once per publish interval.
+ *
+ * Metrics registered with more than one MetricMode are published as one metric per statistic, with
+ * " - Total", " - Rate", " - Average", " - Min", " - Max" or " - Last" appended to the name. Averages are
+ * forwarded as one sample per publish interval.
+ */
+class MetricHandle
+{
+public:
+	/**
+	 * \brief Construct an invalid MetricHandle. Recording through it does nothing.
+	 */
+	MetricHandle() = default;
+
+	/**
+	 * \brief Register a metric, or look up a metric which has already been registered with the same name
+	 * \param name Name of the metric
+	 * \param unit Units of the metric
+	 * \param level Metric level
+	 * \param mode Statistics to compute for the metric
+	 * \return A handle to the metric
+	 */
+	static MetricHandle Register(std::string const& name, std::string const& unit, int level, MetricMode mode);
+
+	/**
+	 * \brief Register a string metric which does not change, such as "Rank" or "App Name". It is sent once per publish interval.
+	 * \param name Name of the metric
+	 * \param value Value of the metric
+	 * \param level Metric level
+	 */
+	static void RegisterConstant(std::string const& name, std::string const& value, int level);
+
+	/**
+	 * \brief Set how often the accumulated values are forwarded to metricMan
+	 * \param seconds Publish interval, in seconds (default 1 s)
+	 */
+	static void SetPublishInterval(double seconds);
+
+	/**
+	 * \brief Combine the values recorded by all threads and forward them now, instead of at the next publish interval
+	 */
+	static void Publish();
+
+	/**
+	 * \brief Forward the values recorded since the last publish, then stop and join the publisher thread
+	 *
+	 * Must be called before metricMan is shut down or destroyed; Globals::CleanUpGlobals does so. Registering a
+	 * metric afterward starts the publisher again.
+	 */
+	static void Shutdown();
+
+	/**
+	 * \brief Function which receives each published numeric value, in place of metricMan
+	 */
+	using PublishCallback = std::function<void(std::string const& name, double value, MetricMode mode)>;
+
+	/**
+	 * \brief Forward published values to a callback instead of metricMan. Used for testing.
+	 * \param callback Function to call for each published value, or an empty function to use metricMan again
+	 */
+	static void SetPublishCallback(PublishCallback callback);
+
+	/**
+	 * \brief Record a value for this metric
+	 * \param value Value to record
+	 */
+	void Record(double value) const;
+
+	/**
+	 * \brief Whether this handle refers to a registered metric
+	 * \return True if Record will have an effect
+	 */
+	bool IsValid() const { return metric_ != nullptr; }
+
+private:
+	explicit MetricHandle(detail::RegisteredMetric* metric)
+	    : metric_(metric) {}
+
+	detail::RegisteredMetric* metric_{nullptr};
+};
+}  // namespace artdaq
+
+#endif  // artdaq_DAQdata_MetricHandle_hh
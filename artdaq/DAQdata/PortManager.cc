@@ -381,7 +381,7 @@ in_addr artdaq::PortManager::GetMulticastOutputAddress(const std::string& interf
 std::string artdaq::PortManager::parse_pattern_(const std::string& pattern, int subsystemID, int rank)
 {
 	std::istringstream f(pattern);
-	std::vector<int> address(4);
+	std::vector<int> address;
 	std::string s;
 
 	while (getline(f, s, '.'))
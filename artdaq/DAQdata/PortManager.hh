@@ -186,6 +186,14 @@ private:
 	std::string routing_table_group_pattern_;
 	std::string multicast_transfer_group_pattern_;
 
+	/**
+	 * \brief Build a multicast group address from a pattern
+	 * \param pattern Four dot-separated fields, each a number or PPP, SSS or RRR
+	 * \param subsystemID Value of SSS
+	 * \param rank Value of RRR
+	 * \return The group address, with multicast_group_offset added to the last field. For example, "227.128.PPP.SSS"
+	 * gives 227.128.1.128 in partition 1, subsystem 0, with the default offset.
+	 */
 	std::string parse_pattern_(const std::string& pattern, int subsystemID = 0, int rank = 0);
 };
 }  // namespace artdaq
@@ -0,0 +1,247 @@
+#include "artdaq/DAQdata/Globals.hh"
+#define TRACE_NAME (app_name + "_ShmemWakeup").c_str()
+
+#include "artdaq/DAQdata/ShmemWakeup.hh"
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+// Without a registered writer, nobody will call NotifyData, so fall back to the old 1 ms polling interval
+constexpr size_t unattended_sleep_usec = 1000;
+// Upper bound on any single sleep, so that conditions changed without a notification (e.g. End of Data) are noticed
+constexpr size_t max_sleep_usec = 100000;
+}  // namespace
+
+artdaq::detail::ShmemWakeup::ShmemWakeup(uint32_t key, bool owner)
+    : owner_(owner)
+    , writer_attached_(false)
+    , region_(nullptr)
+{
+	std::ostringstream name;
+	name << "/artdaq_shmem_wakeup_" << std::hex << std::setw(8) << std::setfill('0') << key;
+	name_ = name.str();
+
+	attach_();
+}
+
+artdaq::detail::ShmemWakeup::~ShmemWakeup()
+{
+	if (owner_ && region_ != nullptr)
+	{
+		markStale_(region_);
+	}
+	detach_();
+	if (owner_)
+	{
+		shm_unlink(name_.c_str());
+	}
+}
+
+void artdaq::detail::ShmemWakeup::attach_()
+{
+	last_attach_time_ = std::chrono::steady_clock::now();
+
+	int fd = -1;
+	if (owner_)
+	{
+		// Tell anyone still attached to a region left over from a previous owner to move to the new one
+		fd = shm_open(name_.c_str(), O_RDWR, 0666);
+		if (fd != -1)
+		{
+			struct stat st = {};
+			if (fstat(fd, &st) == 0 && st.st_size >= static_cast<off_t>(sizeof(Region)))
+			{
+				auto old = mmap(nullptr, sizeof(Region), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+				if (old != MAP_FAILED)  // NOLINT(cppcoreguidelines-pro-type-cstyle-cast)
+				{
+					markStale_(static_cast<Region*>(old));
+					munmap(old, sizeof(Region));
+				}
+			}
+			close(fd);
+		}
+		shm_unlink(name_.c_str());
+		fd = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0666);
+		if (fd != -1 && ftruncate(fd, sizeof(Region)) == -1)
+		{
+			close(fd);
+			fd = -1;
+		}
+	}
+	else
+	{
+		fd = shm_open(name_.c_str(), O_RDWR, 0666);
+		struct stat st = {};
+		if (fd != -1 && (fstat(fd, &st) == -1 || st.st_size < static_cast<off_t>(sizeof(Region))))
+		{
+			// The owner has created the region but not sized it yet; touching it now would raise SIGBUS
+			close(fd);
+			fd = -1;
+			errno = EAGAIN;
+		}
+	}
+	if (fd == -1)
+	{
+		TLOG(owner_ ? TLVL_WARNING : TLVL_DEBUG + 33) << "Could not open wakeup region " << name_ << ", errno=" << errno << " (" << strerror(errno) << ")";
+		return;
+	}
+
+	auto ptr = mmap(nullptr, sizeof(Region), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (ptr == MAP_FAILED)  // NOLINT(cppcoreguidelines-pro-type-cstyle-cast)
+	{
+		TLOG(TLVL_WARNING) << "Could not map wakeup region " << name_ << ", errno=" << errno << " (" << strerror(errno) << ")";
+		return;
+	}
+	region_ = static_cast<Region*>(ptr);  // New regions are zero-filled by ftruncate
+	if (writer_attached_)
+	{
+		region_->writers.fetch_add(1);
+	}
+	TLOG(TLVL_DEBUG + 32) << "Attached to wakeup region " << name_ << (owner_ ? " (owner)" : "");
+}
+
+void artdaq::detail::ShmemWakeup::detach_()
+{
+	if (region_ != nullptr)
+	{
+		munmap(region_, sizeof(Region));
+		region_ = nullptr;
+	}
+}
+
+bool artdaq::detail::ShmemWakeup::checkRegion_()
+{
+	if (region_ != nullptr && region_->stale.load() == 0)
+	{
+		return true;
+	}
+	if (owner_)
+	{
+		return region_ != nullptr;
+	}
+	if (region_ != nullptr)
+	{
+		TLOG(TLVL_DEBUG + 32) << "Wakeup region " << name_ << " was replaced by its owner, re-attaching";
+		detach_();
+		attach_();
+	}
+	else if (std::chrono::steady_clock::now() - last_attach_time_ > std::chrono::seconds(1))
+	{
+		attach_();  // The owner may not have existed when this instance was constructed
+	}
+	return region_ != nullptr;
+}
+
+void artdaq::detail::ShmemWakeup::markStale_(Region* region)
+{
+	region->stale.store(1);
+	// Wake all sleepers so that they notice right away
+	region->data_seq.fetch_add(1);
+	region->space_seq.fetch_add(1);
+	syscall(SYS_futex, reinterpret_cast<uint32_t*>(&region->data_seq), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);   // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-type-vararg)
+	syscall(SYS_futex, reinterpret_cast<uint32_t*>(&region->space_seq), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-type-vararg)
+}
+
+void artdaq::detail::ShmemWakeup::SetWriterAttached(bool attached)
+{
+	if (attached == writer_attached_)
+	{
+		return;
+	}
+	writer_attached_ = attached;
+	if (!checkRegion_())
+	{
+		return;  // attach_ registers the writer once the region exists
+	}
+	if (attached)
+	{
+		region_->writers.fetch_add(1);
+	}
+	else
+	{
+		region_->writers.fetch_sub(1);
+		NotifyData();  // Let the reader see End of Data right away
+	}
+}
+
+void artdaq::detail::ShmemWakeup::NotifyData()
+{
+	if (checkRegion_())
+	{
+		notify_(region_->data_seq, region_->data_waiters);
+	}
+}
+
+void artdaq::detail::ShmemWakeup::NotifySpace()
+{
+	if (checkRegion_())
+	{
+		notify_(region_->space_seq, region_->space_waiters);
+	}
+}
+
+bool artdaq::detail::ShmemWakeup::WaitForData(std::function<bool()> const& ready, size_t timeout_usec)
+{
+	return wait_(&Region::data_seq, &Region::data_waiters, ready, timeout_usec, true);
+}
+
+bool artdaq::detail::ShmemWakeup::WaitForSpace(std::function<bool()> const& ready, size_t timeout_usec)
+{
+	return wait_(&Region::space_seq, &Region::space_waiters, ready, timeout_usec, false);
+}
+
+void artdaq::detail::ShmemWakeup::notify_(std::atomic<uint32_t>& seq, std::atomic<uint32_t>& waiters)
+{
+	seq.fetch_add(1);
+	if (waiters.load() > 0)
+	{
+		syscall(SYS_futex, reinterpret_cast<uint32_t*>(&seq), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-type-vararg)
+	}
+}
+
+bool artdaq::detail::ShmemWakeup::wait_(std::atomic<uint32_t> Region::*seq, std::atomic<uint32_t> Region::*waiters, std::function<bool()> const& ready, size_t timeout_usec, bool data)
+{
+	auto start = std::chrono::steady_clock::now();
+	while (!ready())
+	{
+		auto elapsed = static_cast<size_t>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+		if (elapsed >= timeout_usec)
+		{
+			return false;
+		}
+		if (!checkRegion_())
+		{
+			return ready();
+		}
+		// Without a registered writer, nobody will call NotifyData
+		auto sleep_limit_usec = data && region_->writers.load() == 0 ? unattended_sleep_usec : max_sleep_usec;
+
+		// Read the sequence before announcing ourselves and re-checking, so that a notification between the check
+		// and the sleep changes the word and makes FUTEX_WAIT return immediately.
+		auto& word = region_->*seq;
+		auto& count = region_->*waiters;
+		auto current = word.load();
+		count.fetch_add(1);
+		if (!ready())
+		{
+			auto sleep_usec = std::min(timeout_usec - elapsed, sleep_limit_usec);
+			timespec ts = {static_cast<time_t>(sleep_usec / 1000000), static_cast<long>((sleep_usec % 1000000) * 1000)};  // NOLINT(google-runtime-int)
+			syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, current, &ts, nullptr, 0);                  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-type-vararg)
+		}
+		count.fetch_sub(1);
+	}
+	return true;
+}
@@ -0,0 +1,112 @@
+#ifndef artdaq_DAQdata_ShmemWakeup_hh
+#define artdaq_DAQdata_ShmemWakeup_hh
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace artdaq {
+namespace detail {
+/**
+ * \brief A small process-shared region, next to a shared memory segment, holding futex words.
+ *
+ * Used by ShmemTransfer, and by SharedMemoryEventManager and its art readers. Writers bump the data sequence after
+ * committing a buffer and readers bump the space sequence after releasing one; the other side sleeps in the kernel
+ * on the corresponding word instead of polling the buffer states. The FUTEX_WAKE system call is only made if someone
+ * is actually waiting.
+ *
+ * The owner marks its region stale before removing it, including a region left behind by a previous owner which
+ * exited without cleaning up. Attached instances check for this on every call and re-attach to the new region, so
+ * a restarted receiver does not lose its wakeups. Re-attaching is not thread-safe, so an attached (non-owner)
+ * instance must only be used from one thread at a time.
+ */
+class ShmemWakeup
+{
+public:
+	/**
+	 * \brief ShmemWakeup Constructor
+	 * \param key Key of the shared memory segment which this region accompanies
+	 * \param owner Whether to create the region (the receiver) or attach to an existing one (the sender). If the
+	 * region does not exist yet, attaching is retried at most once per second by later calls.
+	 */
+	ShmemWakeup(uint32_t key, bool owner);
+
+	/**
+	 * \brief ShmemWakeup Destructor. Detaches from the region, and removes it if this is the owner
+	 */
+	~ShmemWakeup();
+
+	/**
+	 * \brief Whether the region was created or attached successfully
+	 * \return True if the region is usable
+	 */
+	bool IsValid() const { return region_ != nullptr && region_->stale.load() == 0; }
+
+	/**
+	 * \brief Register or unregister a writer. Readers only sleep for long periods while a writer is registered.
+	 * \param attached True to register, false to unregister
+	 */
+	void SetWriterAttached(bool attached);
+
+	/**
+	 * \brief Wake any reader waiting for data. Call after a buffer has been committed.
+	 */
+	void NotifyData();
+
+	/**
+	 * \brief Wake any writer waiting for space. Call after a buffer has been released.
+	 */
+	void NotifySpace();
+
+	/**
+	 * \brief Wait until ready() returns true, sleeping until a writer calls NotifyData
+	 * \param ready Condition to wait for
+	 * \param timeout_usec Maximum time to wait, in microseconds
+	 * \return The last value of ready()
+	 */
+	bool WaitForData(std::function<bool()> const& ready, size_t timeout_usec);
+
+	/**
+	 * \brief Wait until ready() returns true, sleeping until a reader calls NotifySpace
+	 * \param ready Condition to wait for
+	 * \param timeout_usec Maximum time to wait, in microseconds
+	 * \return The last value of ready()
+	 */
+	bool WaitForSpace(std::function<bool()> const& ready, size_t timeout_usec);
+
+private:
+	ShmemWakeup(ShmemWakeup const&) = delete;
+	ShmemWakeup(ShmemWakeup&&) = delete;
+	ShmemWakeup& operator=(ShmemWakeup const&) = delete;
+	ShmemWakeup& operator=(ShmemWakeup&&) = delete;
+
+	struct Region
+	{
+		std::atomic<uint32_t> data_seq;
+		std::atomic<uint32_t> data_waiters;
+		std::atomic<uint32_t> space_seq;
+		std::atomic<uint32_t> space_waiters;
+		std::atomic<uint32_t> writers;
+		std::atomic<uint32_t> stale;  // Set by the owner before the region is removed
+	};
+	static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t) && std::atomic<uint32_t>::is_always_lock_free, "futex words must be plain 32-bit integers");
+
+	void attach_();
+	void detach_();
+	bool checkRegion_();
+	static void markStale_(Region* region);
+	static void notify_(std::atomic<uint32_t>& seq, std::atomic<uint32_t>& waiters);
+	bool wait_(std::atomic<uint32_t> Region::*seq, std::atomic<uint32_t> Region::*waiters, std::function<bool()> const& ready, size_t timeout_usec, bool data);
+
+	std::string name_;
+	bool owner_;
+	bool writer_attached_;
+	Region* region_;
+	std::chrono::steady_clock::time_point last_attach_time_;
+};
+}  // namespace detail
+}  // namespace artdaq
+
+#endif  // artdaq_DAQdata_ShmemWakeup_hh
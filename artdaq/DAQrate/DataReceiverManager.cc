@@ -12,11 +12,29 @@
 #include <boost/exception/all.hpp>
 #include <boost/thread.hpp>
 
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <algorithm>
 #include <chrono>
+#include <cstring>
 #include <iomanip>
+#include <limits>
 #include <thread>
+#include <unordered_map>
 #include <utility>
 
+namespace {
+size_t receiverSleepTime(size_t receive_timeout)
+{
+	auto sleep_time = receive_timeout / 100 > 100000 ? 100000 : receive_timeout / 100;
+	if (sleep_time < 5000)
+	{
+		sleep_time = 5000;
+	}
+	return sleep_time;
+}
+}  // namespace
+
 artdaq::DataReceiverManager::DataReceiverManager(const fhicl::ParameterSet& pset, std::shared_ptr<SharedMemoryEventManager> shm)
     : stop_requested_(false)
     , stop_requested_time_(0)
@@ -25,6 +43,7 @@ artdaq::DataReceiverManager::DataReceiverManager(const fhicl::ParameterSet& pset
     , recv_seq_count_()
     , receive_timeout_(pset.get<size_t>("receive_timeout_usec", 100000))
     , stop_timeout_ms_(pset.get<size_t>("stop_timeout_ms", 1500))
+    , receiver_thread_count_(pset.get<size_t>("receiver_thread_count", 0))
     , shm_manager_(std::move(std::move(shm)))
     , non_reliable_mode_enabled_(pset.get<bool>("non_reliable_mode", false))
     , non_reliable_mode_retry_count_(pset.get<size_t>("non_reliable_mode_retry_count", -1))
@@ -98,6 +117,7 @@ artdaq::DataReceiverManager::DataReceiverManager(const fhicl::ParameterSet& pset
 			}
 			running_sources_[source_rank] = false;
 			source_plugins_[source_rank] = std::move(transfer);
+			registerReceiveMetrics_(source_rank);
 		}
 		catch (const cet::exception& ex)
 		{
@@ -116,6 +136,8 @@ artdaq::DataReceiverManager::DataReceiverManager(const fhicl::ParameterSet& pset
 	{
 		TLOG(TLVL_ERROR) << "No sources configured!";
 	}
+	MetricHandle::RegisterConstant("Rank", std::to_string(my_rank), 3);
+	MetricHandle::RegisterConstant("App Name", app_name, 3);
 }
 
 artdaq::DataReceiverManager::~DataReceiverManager()
@@ -133,6 +155,8 @@ void artdaq::DataReceiverManager::start_threads()
 	{
 		shm_manager_->setRequestMode(artdaq::detail::RequestMessageMode::Normal);
 	}
+	std::vector<std::vector<int>> pool_ranks(receiver_thread_count_);
+	size_t pool_index = 0;
 	for (auto& source : source_plugins_)
 	{
 		auto& rank = source.first;
@@ -143,6 +167,11 @@ void artdaq::DataReceiverManager::start_threads()
 			recv_seq_count_.setSlot(rank, 0);
 
 			running_sources_[rank] = true;
+			if (receiver_thread_count_ > 0)
+			{
+				pool_ranks[pool_index++ % receiver_thread_count_].push_back(rank);
+				continue;
+			}
 			boost::thread::attributes attrs;
 			attrs.set_stack_size(4096 * 2000);  // 2000 KB
 			try
@@ -162,6 +191,32 @@ void artdaq::DataReceiverManager::start_threads()
 			}
 		}
 	}
+
+	for (size_t ii = 0; ii < pool_ranks.size(); ++ii)
+	{
+		if (pool_ranks[ii].empty())
+		{
+			continue;
+		}
+		TLOG(TLVL_DEBUG + 32) << "start_threads: Starting receiver pool thread " << ii << " for " << pool_ranks[ii].size() << " sources";
+		boost::thread::attributes attrs;
+		attrs.set_stack_size(4096 * 2000);  // 2000 KB
+		try
+		{
+			pool_threads_.emplace_back(attrs, boost::bind(&DataReceiverManager::runReceiverPool_, this, ii, pool_ranks[ii]));
+			char tname[16];                                                         // Size 16 - see man page pthread_setname_np(3) and/or prctl(2)
+			snprintf(tname, sizeof(tname) - 1, "%d-RECVPOOL%zu", my_rank, ii);  // NOLINT
+			tname[sizeof(tname) - 1] = '\0';                                        // assure term. snprintf is not too evil :)
+			auto handle = pool_threads_.back().native_handle();
+			pthread_setname_np(handle, tname);
+		}
+		catch (const boost::exception& e)
+		{
+			TLOG(TLVL_ERROR) << "Caught boost::exception starting Receiver pool thread " << ii << ": " << boost::diagnostic_information(e) << ", errno=" << errno;
+			std::cerr << "Caught boost::exception starting Receiver pool thread " << ii << ": " << boost::diagnostic_information(e) << ", errno=" << errno << std::endl;
+			exit(5);
+		}
+	}
 }
 
 void artdaq::DataReceiverManager::stop_threads()
@@ -213,6 +268,23 @@ void artdaq::DataReceiverManager::stop_threads()
 	}
 	source_threads_.clear();  // To prevent error messages from shutdown-after-stop
 
+	TLOG(TLVL_DEBUG + 33) << "stop_threads: Joining " << pool_threads_.size() << " receiver pool threads";
+	for (auto& pool_thread : pool_threads_)
+	{
+		try
+		{
+			if (pool_thread.joinable())
+			{
+				pool_thread.join();
+			}
+		}
+		catch (...)
+		{
+			// IGNORED
+		}
+	}
+	pool_threads_.clear();
+
 	TLOG(TLVL_DEBUG + 33) << "stop_threads: END";
 }
 
@@ -242,47 +314,28 @@ std::set<int> artdaq::DataReceiverManager::running_sources() const
 	return output;
 }
 
+bool artdaq::DataReceiverManager::receiverShouldRun_(int source_rank) const
+{
+	return !(stop_requested_ && TimeUtils::gettimeofday_us() - stop_requested_time_ > stop_timeout_ms_ * 1000) && (enabled_sources_.count(source_rank) != 0u);
+}
+
 void artdaq::DataReceiverManager::runReceiver_(int source_rank)
 {
-	std::chrono::steady_clock::time_point start_time, after_header, before_body, after_body, end_time = std::chrono::steady_clock::now();
-	int ret;
-	detail::RawFragmentHeader header;
-	size_t endOfDataCount = -1;
-	auto sleep_time = receive_timeout_ / 100 > 100000 ? 100000 : receive_timeout_ / 100;
-	if (sleep_time < 5000)
-	{
-		sleep_time = 5000;
-	}
-	auto max_retries = non_reliable_mode_retry_count_ * ceil(receive_timeout_ / sleep_time);
+	ReceiverState state;
+	auto sleep_time = receiverSleepTime(receive_timeout_);
 
-	while (!(stop_requested_ && TimeUtils::gettimeofday_us() - stop_requested_time_ > stop_timeout_ms_ * 1000) && (enabled_sources_.count(source_rank) != 0u))
+	while (receiverShouldRun_(source_rank))
 	{
 		TLOG(TLVL_DEBUG + 35) << "runReceiver_: Begin loop stop_requested_=" << stop_requested_ << ", stop_timeout_ms_=" << stop_timeout_ms_ << ", enabled_sources_.count(source_rank)=" << enabled_sources_.count(source_rank) << ", now - stop_requested_time_=" << (TimeUtils::gettimeofday_us() - stop_requested_time_);
 		std::this_thread::yield();
 
-		// Don't stop receiving until we haven't received anything for 1 second
-		if (endOfDataCount <= recv_frag_count_.slotCount(source_rank) && !source_plugins_[source_rank]->isRunning())
+		auto sts = receiveFragment_(source_rank, state, receive_timeout_);
+		if (sts == ReceiveStatus::Ended)
 		{
-			TLOG(TLVL_DEBUG + 32) << "runReceiver_: End of Data conditions met, ending runReceiver loop";
 			break;
 		}
-
-		start_time = std::chrono::steady_clock::now();
-
-		TLOG(TLVL_DEBUG + 35) << "runReceiver_: Calling receiveFragmentHeader tmo=" << receive_timeout_;
-		ret = source_plugins_[source_rank]->receiveFragmentHeader(header, receive_timeout_);
-		TLOG(TLVL_DEBUG + 35) << "runReceiver_: Done with receiveFragmentHeader, ret=" << ret << " (should be " << source_rank << ")";
-		if (ret != source_rank)
+		if (sts == ReceiveStatus::Timeout)
 		{
-			if (ret >= 0)
-			{
-				TLOG(TLVL_WARNING) << "Received Fragment from rank " << ret << ", but was expecting one from rank " << source_rank << "!";
-			}
-			else if (ret == TransferInterface::DATA_END)
-			{
-				TLOG(TLVL_ERROR) << "Transfer Plugin returned DATA_END, ending receive loop!";
-				break;
-			}
 			if (*running_sources().begin() == source_rank)  // Only do this for the first sender in the running_sources_ map
 			{
 				TLOG(TLVL_DEBUG + 34) << "Calling SMEM::CheckPendingBuffers from DRM receiver thread for " << source_rank << " to make sure that things aren't stuck";
@@ -290,184 +343,498 @@ void artdaq::DataReceiverManager::runReceiver_(int source_rank)
 			}
 
 			usleep(sleep_time);
-			continue;  // Receive timeout or other oddness
 		}
+	}
 
-		after_header = std::chrono::steady_clock::now();
+	finishReceiver_(source_rank);
+}
+
+void artdaq::DataReceiverManager::runReceiverPool_(size_t thread_index, std::vector<int> source_ranks)
+{
+	struct PoolSource
+	{
+		ReceiverState state;
+		bool ended{false};
+		bool has_fds{false};
+		bool synced{false};
+		size_t fds_version{0};
+		std::vector<int> fds;
+	};
+	std::map<int, PoolSource> sources;
+	for (auto& rank : source_ranks)
+	{
+		sources[rank];
+	}
+
+	int epoll_fd = epoll_create1(0);
+	if (epoll_fd == -1)
+	{
+		TLOG(TLVL_WARNING) << "runReceiverPool_: Could not create epoll instance, errno=" << errno << " (" << strerror(errno) << "). All sources will be polled.";
+	}
+	std::unordered_map<int, int> fd_ranks;
+	std::vector<epoll_event> events(64);
+	std::set<int> ready_ranks;
 
-		if (Fragment::isUserFragmentType(header.type) || header.type == Fragment::DataFragmentType || header.type == Fragment::EmptyFragmentType || header.type == Fragment::ContainerFragmentType)
+	auto unregister_fds = [&](PoolSource& src) {
+		for (auto& fd : src.fds)
 		{
-			TLOG(TLVL_DEBUG + 33) << "Received Fragment Header from rank " << source_rank << ", sequence ID " << header.sequence_id << ", timestamp " << header.timestamp;
-			RawDataType* loc = nullptr;
-			size_t retries = 0;
-			auto latency_s = header.getLatency(true);
-			auto latency = latency_s.tv_sec + (latency_s.tv_nsec / 1000000000.0);
-			while (loc == nullptr)  //&& TimeUtils::GetElapsedTimeMicroseconds(after_header)) < receive_timeout_)
+			epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);  // fd may already be closed, which removes it automatically
+			fd_ranks.erase(fd);
+		}
+		src.fds.clear();
+	};
+
+	auto last_pending_check_time = std::chrono::steady_clock::now();
+
+	while (!sources.empty())
+	{
+		std::this_thread::yield();
+
+		for (auto it = sources.begin(); it != sources.end();)
+		{
+			auto rank = it->first;
+			auto& src = it->second;
+			// Same conditions as runReceiver_, which also checks End of Data before each receive
+			if (src.ended || !receiverShouldRun_(rank) ||
+			    (src.state.endOfDataCount <= recv_frag_count_.slotCount(rank) && !source_plugins_[rank]->isRunning()))
 			{
-				loc = shm_manager_->WriteFragmentHeader(header);
+				TLOG(TLVL_DEBUG + 32) << "runReceiverPool_: Receiver pool thread " << thread_index << " done with source " << rank;
+				unregister_fds(src);
+				finishReceiver_(rank);
+				it = sources.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
+		if (sources.empty())
+		{
+			break;
+		}
 
-				// Break here and outside of the loop to go to the cleanup steps at the end of runReceiver_
-				if (loc == nullptr && stop_requested_)
+		// A source whose Fragment is waiting for a shared memory buffer is parked: its file descriptors are out of the
+		// epoll set, so that the other sources keep being served, and the write is retried here
+		bool received = false;
+		size_t parked_count = 0;
+		Fragment::sequence_id_t parked_sequence_id = 0;
+		for (auto& src : sources)
+		{
+			if (!src.second.state.header_pending)
+			{
+				continue;
+			}
+			auto sts = receiveFragment_(src.first, src.second.state, 0, false);
+			src.second.ended = sts == ReceiveStatus::Ended;
+			received = received || sts == ReceiveStatus::Received;
+			if (sts == ReceiveStatus::Blocked)
+			{
+				if (parked_count++ == 0)
 				{
-					break;
+					parked_sequence_id = src.second.state.header.sequence_id;
 				}
+			}
+			else
+			{
+				TLOG(TLVL_DEBUG + 35) << "runReceiverPool_: Source " << src.first << " is no longer waiting for a buffer";
+				src.second.synced = false;
+			}
+		}
+
+		auto park = [&](int rank, PoolSource& src) {
+			TLOG(TLVL_DEBUG + 35) << "runReceiverPool_: Source " << rank << " is waiting for a buffer for sequence ID " << src.state.header.sequence_id << ", parking it";
+			unregister_fds(src);
+			src.synced = false;
+			if (parked_count++ == 0)
+			{
+				parked_sequence_id = src.state.header.sequence_id;
+			}
+		};
 
-				if (loc == nullptr)
+		// Only ask a plugin for its file descriptors again when it reports that they have changed
+		for (auto& src : sources)
+		{
+			if (src.second.state.header_pending)
+			{
+				continue;
+			}
+			auto version = source_plugins_[src.first]->getReceiveFDsVersion();
+			if (!src.second.synced || version != src.second.fds_version)
+			{
+				std::vector<int> fds;
+				src.second.has_fds = epoll_fd != -1 && source_plugins_[src.first]->getReceiveFDs(fds);
+				std::sort(fds.begin(), fds.end());
+				for (auto& fd : src.second.fds)
 				{
-					usleep(sleep_time);
+					if (!std::binary_search(fds.begin(), fds.end(), fd))
+					{
+						epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+						fd_ranks.erase(fd);
+					}
 				}
-				retries++;
-				if (non_reliable_mode_enabled_ && retries > max_retries)
+				for (auto& fd : fds)
 				{
-					loc = shm_manager_->WriteFragmentHeader(header, true);
+					epoll_event ev{};
+					ev.events = EPOLLIN | EPOLLPRI;
+					ev.data.fd = fd;
+					if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1 && errno != EEXIST)
+					{
+						TLOG(TLVL_WARNING) << "runReceiverPool_: Could not add fd " << fd << " for source " << src.first << " to epoll set, errno=" << errno << " (" << strerror(errno) << ")";
+					}
+					fd_ranks[fd] = src.first;
 				}
+				src.second.fds = std::move(fds);
+				src.second.fds_version = version;
+				src.second.synced = true;
 			}
-			// Break here to go to cleanup at the end of runReceiver_
-			if (loc == nullptr && stop_requested_)
+		}
+
+		size_t polled_count = 0;
+		for (auto& src : sources)
+		{
+			if (!src.second.has_fds && !src.second.state.header_pending)
 			{
-				break;
+				++polled_count;
 			}
-			if (loc == nullptr)
+		}
+
+		int wait_ms = polled_count > 0 ? 0 : std::max(1, static_cast<int>(receive_timeout_ / 1000));
+		if (parked_count > 0)
+		{
+			wait_ms = std::min(wait_ms, 1);
+		}
+		int nfds = 0;
+		if (parked_count == sources.size())
+		{
+			// Woken as soon as an art process releases a buffer
+			shm_manager_->WaitForBuffer(parked_sequence_id, receiverSleepTime(receive_timeout_));
+		}
+		else if (epoll_fd != -1)
+		{
+			nfds = epoll_wait(epoll_fd, &events[0], events.size(), wait_ms);
+			if (nfds == -1)
+			{
+				if (errno != EINTR)
+				{
+					TLOG(TLVL_WARNING) << "runReceiverPool_: epoll_wait failed, errno=" << errno << " (" << strerror(errno) << ")";
+				}
+				nfds = 0;
+			}
+		}
+
+		ready_ranks.clear();
+		for (int ii = 0; ii < nfds; ++ii)
+		{
+			auto rank_it = fd_ranks.find(events[ii].data.fd);
+			if (rank_it != fd_ranks.end())
+			{
+				ready_ranks.insert(rank_it->second);
+			}
+		}
+
+		for (auto& rank : ready_ranks)
+		{
+			auto src_it = sources.find(rank);
+			if (src_it == sources.end() || src_it->second.state.header_pending)
 			{
-				// Could not enqueue event!
-				TLOG(TLVL_ERROR) << "runReceiver_: Could not get data location for event " << header.sequence_id;
 				continue;
 			}
-			before_body = std::chrono::steady_clock::now();
+			auto sts = receiveFragment_(rank, src_it->second.state, receive_timeout_, false);
+			src_it->second.ended = sts == ReceiveStatus::Ended;
+			received = received || sts == ReceiveStatus::Received;
+			if (sts == ReceiveStatus::Blocked)
+			{
+				park(rank, src_it->second);
+			}
+		}
 
-			TLOG(TLVL_DEBUG + 35) << "runReceiver_: Calling receiveFragmentData from rank " << source_rank << ", sequence ID " << header.sequence_id << ", timestamp " << header.timestamp;
-			auto ret2 = source_plugins_[source_rank]->receiveFragmentData(loc, header.word_count - header.num_words());
-			TLOG(TLVL_DEBUG + 35) << "runReceiver_: Done with receiveFragmentData, ret2=" << ret2 << " (should be " << source_rank << ")";
+		// Plugins without file descriptors share the receive timeout; keep it short if sockets also need service
+		size_t polled_timeout = sources.size() > polled_count || polled_count == 0 ? 1000 : std::max(static_cast<size_t>(1000), receive_timeout_ / polled_count);
+		for (auto& src : sources)
+		{
+			if (src.second.has_fds || src.second.state.header_pending)
+			{
+				continue;
+			}
+			auto sts = receiveFragment_(src.first, src.second.state, polled_timeout, false);
+			src.second.ended = sts == ReceiveStatus::Ended;
+			received = received || sts == ReceiveStatus::Received;
+			if (sts == ReceiveStatus::Blocked)
+			{
+				park(src.first, src.second);
+			}
+		}
 
-			if (ret != ret2)
+		if (!received)
+		{
+			if (thread_index == 0 && TimeUtils::GetElapsedTimeMicroseconds(last_pending_check_time) > receive_timeout_)
 			{
-				TLOG(TLVL_ERROR) << "Unexpected return code from receiveFragmentData after receiveFragmentHeader! (Expected: " << ret << ", Got: " << ret2 << ")";
-				TLOG(TLVL_ERROR) << "Error receiving data from rank " << source_rank << ", data has been lost! Event " << header.sequence_id << " will most likely be Incomplete!";
+				TLOG(TLVL_DEBUG + 34) << "Calling SMEM::CheckPendingBuffers from DRM receiver pool thread to make sure that things aren't stuck";
+				shm_manager_->CheckPendingBuffers();
+				last_pending_check_time = std::chrono::steady_clock::now();
+			}
+		}
+	}
 
-				// Mark the Fragment as invalid
-				header.valid = false;
-				header.complete = false;
+	if (epoll_fd != -1)
+	{
+		close(epoll_fd);
+	}
+	TLOG(TLVL_DEBUG + 32) << "runReceiverPool_: Receiver pool thread " << thread_index << " exiting";
+}
 
-				shm_manager_->DoneWritingFragment(header);
-				// throw cet::exception("DataReceiverManager") << "Unexpected return code from receiveFragmentData after receiveFragmentHeader! (Expected: " << ret << ", Got: " << ret2 << ")";
-				continue;
+artdaq::DataReceiverManager::ReceiveStatus artdaq::DataReceiverManager::receiveFragment_(int source_rank, ReceiverState& state, size_t timeout_usec, bool wait_for_buffer)
+{
+	std::chrono::steady_clock::time_point before_body, after_body;
+	auto& start_time = state.start_time;
+	auto& after_header = state.after_header;
+	auto& header = state.header;
+	auto sleep_time = receiverSleepTime(receive_timeout_);
+	// How long to wait for a buffer before dropping the Fragment in non-reliable mode
+	auto max_wait_us = receive_timeout_ == 0 || non_reliable_mode_retry_count_ < std::numeric_limits<size_t>::max() / receive_timeout_
+	                       ? non_reliable_mode_retry_count_ * receive_timeout_
+	                       : std::numeric_limits<size_t>::max();
+
+	// A header which is still waiting for a buffer is retried before anything else is received from this source
+	if (!state.header_pending)
+	{
+		// Don't stop receiving until we haven't received anything for 1 second
+		if (state.endOfDataCount <= recv_frag_count_.slotCount(source_rank) && !source_plugins_[source_rank]->isRunning())
+		{
+			TLOG(TLVL_DEBUG + 32) << "receiveFragment_: End of Data conditions met, ending receive loop for rank " << source_rank;
+			return ReceiveStatus::Ended;
+		}
+
+		start_time = std::chrono::steady_clock::now();
+
+		TLOG(TLVL_DEBUG + 35) << "receiveFragment_: Calling receiveFragmentHeader tmo=" << timeout_usec;
+		auto ret = source_plugins_[source_rank]->receiveFragmentHeader(header, timeout_usec);
+		TLOG(TLVL_DEBUG + 35) << "receiveFragment_: Done with receiveFragmentHeader, ret=" << ret << " (should be " << source_rank << ")";
+		if (ret != source_rank)
+		{
+			if (ret >= 0)
+			{
+				TLOG(TLVL_WARNING) << "Received Fragment from rank " << ret << ", but was expecting one from rank " << source_rank << "!";
 			}
+			else if (ret == TransferInterface::DATA_END)
+			{
+				TLOG(TLVL_ERROR) << "Transfer Plugin returned DATA_END, ending receive loop!";
+				return ReceiveStatus::Ended;
+			}
+			return ReceiveStatus::Timeout;  // Receive timeout or other oddness
+		}
 
-			shm_manager_->DoneWritingFragment(header);
-			TLOG(TLVL_DEBUG + 33) << "Done receiving fragment with sequence ID " << header.sequence_id << " from rank " << source_rank;
+		after_header = std::chrono::steady_clock::now();
+	}
+
+	if (Fragment::isUserFragmentType(header.type) || header.type == Fragment::DataFragmentType || header.type == Fragment::EmptyFragmentType || header.type == Fragment::ContainerFragmentType)
+	{
+		TLOG(TLVL_DEBUG + 33) << "Received Fragment Header from rank " << source_rank << ", sequence ID " << header.sequence_id << ", timestamp " << header.timestamp;
+		RawDataType* loc = nullptr;
+		auto latency_s = header.getLatency(true);
+		auto latency = latency_s.tv_sec + (latency_s.tv_nsec / 1000000000.0);
+		while (loc == nullptr)  //&& TimeUtils::GetElapsedTimeMicroseconds(after_header)) < receive_timeout_)
+		{
+			loc = shm_manager_->WriteFragmentHeader(header);
 
-			recv_frag_count_.incSlot(source_rank);
-			recv_frag_size_.incSlot(source_rank, header.word_count * sizeof(RawDataType));
-			recv_seq_count_.setSlot(source_rank, header.sequence_id);
-			if (endOfDataCount != static_cast<size_t>(-1))
+			// Break here and outside of the loop to go to the cleanup steps at the end of the receive loop
+			if (loc == nullptr && stop_requested_)
 			{
-				TLOG(TLVL_DEBUG + 32) << "Received fragment " << header.sequence_id << " from rank " << source_rank
-				                      << " (" << recv_frag_count_.slotCount(source_rank) << "/" << endOfDataCount << ")";
+				break;
 			}
 
-			after_body = std::chrono::steady_clock::now();
+			if (loc == nullptr && non_reliable_mode_enabled_ && TimeUtils::GetElapsedTimeMicroseconds(after_header) > max_wait_us)
+			{
+				loc = shm_manager_->WriteFragmentHeader(header, true);
+			}
+			if (loc == nullptr)
+			{
+				// The receiver pool keeps serving its other sources, and calls again once a buffer may be free
+				if (!wait_for_buffer)
+				{
+					state.header_pending = true;
+					return ReceiveStatus::Blocked;
+				}
+				// Woken as soon as an art process releases a buffer
+				shm_manager_->WaitForBuffer(header.sequence_id, sleep_time);
+			}
+		}
+		state.header_pending = false;
+		// Return here to go to cleanup at the end of the receive loop
+		if (loc == nullptr && stop_requested_)
+		{
+			return ReceiveStatus::Ended;
+		}
+		if (loc == nullptr)
+		{
+			// Could not enqueue event!
+			TLOG(TLVL_ERROR) << "receiveFragment_: Could not get data location for event " << header.sequence_id;
+			return ReceiveStatus::Received;
+		}
+		before_body = std::chrono::steady_clock::now();
 
-			auto hdr_delta_t = TimeUtils::GetElapsedTime(start_time, after_header);
-			auto store_delta_t = TimeUtils::GetElapsedTime(after_header, before_body);
-			auto data_delta_t = TimeUtils::GetElapsedTime(before_body, after_body);
-			auto delta_t = TimeUtils::GetElapsedTime(start_time, after_body);
-			auto dead_t = TimeUtils::GetElapsedTime(end_time, start_time);
-			auto recv_wait_t = hdr_delta_t - latency;
+		TLOG(TLVL_DEBUG + 35) << "receiveFragment_: Calling receiveFragmentData from rank " << source_rank << ", sequence ID " << header.sequence_id << ", timestamp " << header.timestamp;
+		auto ret2 = source_plugins_[source_rank]->receiveFragmentData(loc, header.word_count - header.num_words());
+		TLOG(TLVL_DEBUG + 35) << "receiveFragment_: Done with receiveFragmentData, ret2=" << ret2 << " (should be " << source_rank << ")";
 
-			uint64_t data_size = header.word_count * sizeof(RawDataType);
-			auto header_size = header.num_words() * sizeof(RawDataType);
+		if (ret2 != source_rank)
+		{
+			TLOG(TLVL_ERROR) << "Unexpected return code from receiveFragmentData after receiveFragmentHeader! (Expected: " << source_rank << ", Got: " << ret2 << ")";
+			TLOG(TLVL_ERROR) << "Error receiving data from rank " << source_rank << ", data has been lost! Event " << header.sequence_id << " will most likely be Incomplete!";
 
-			if (metricMan)
-			{  //&& recv_frag_count_.slotCount(source_rank) % 100 == 0) {
-				TLOG(TLVL_DEBUG + 34) << "runReceiver_: Sending receive stats for rank " << source_rank;
-				metricMan->sendMetric("Total Receive Time From Rank " + std::to_string(source_rank), delta_t, "s", 5, MetricMode::Accumulate);
-				metricMan->sendMetric("Total Receive Size From Rank " + std::to_string(source_rank), data_size, "B", 5, MetricMode::Accumulate);
-				metricMan->sendMetric("Total Receive Rate From Rank " + std::to_string(source_rank), data_size / delta_t, "B/s", 5, MetricMode::Average);
+			// Mark the Fragment as invalid
+			header.valid = false;
+			header.complete = false;
 
-				metricMan->sendMetric("Header Receive Time From Rank " + std::to_string(source_rank), hdr_delta_t, "s", 5, MetricMode::Accumulate);
-				metricMan->sendMetric("Header Receive Size From Rank " + std::to_string(source_rank), header_size, "B", 5, MetricMode::Accumulate);
-				metricMan->sendMetric("Header Receive Rate From Rank " + std::to_string(source_rank), header_size / hdr_delta_t, "B/s", 5, MetricMode::Average);
+			shm_manager_->DoneWritingFragment(header);
+			// throw cet::exception("DataReceiverManager") << "Unexpected return code from receiveFragmentData after receiveFragmentHeader! (Expected: " << source_rank << ", Got: " << ret2 << ")";
+			return ReceiveStatus::Received;
+		}
 
-				auto payloadSize = data_size - header_size;
-				metricMan->sendMetric("Data Receive Time From Rank " + std::to_string(source_rank), data_delta_t, "s", 5, MetricMode::Accumulate);
-				metricMan->sendMetric("Data Receive Size From Rank " + std::to_string(source_rank), payloadSize, "B", 5, MetricMode::Accumulate);
-				metricMan->sendMetric("Data Receive Rate From Rank " + std::to_string(source_rank), payloadSize / data_delta_t, "B/s", 5, MetricMode::Average);
+		shm_manager_->DoneWritingFragment(header);
+		TLOG(TLVL_DEBUG + 33) << "Done receiving fragment with sequence ID " << header.sequence_id << " from rank " << source_rank;
 
-				metricMan->sendMetric("Data Receive Count From Rank " + std::to_string(source_rank), recv_frag_count_.slotCount(source_rank), "fragments", 3, MetricMode::LastPoint);
+		recv_frag_count_.incSlot(source_rank);
+		recv_frag_size_.incSlot(source_rank, header.word_count * sizeof(RawDataType));
+		recv_seq_count_.setSlot(source_rank, header.sequence_id);
+		if (state.endOfDataCount != static_cast<size_t>(-1))
+		{
+			TLOG(TLVL_DEBUG + 32) << "Received fragment " << header.sequence_id << " from rank " << source_rank
+			                      << " (" << recv_frag_count_.slotCount(source_rank) << "/" << state.endOfDataCount << ")";
+		}
 
-				metricMan->sendMetric("Total Shared Memory Wait Time From Rank " + std::to_string(source_rank), store_delta_t, "s", 3, MetricMode::Accumulate);
-				metricMan->sendMetric("Avg Shared Memory Wait Time From Rank " + std::to_string(source_rank), store_delta_t, "s", 3, MetricMode::Average);
-				metricMan->sendMetric("Avg Fragment Wait Time From Rank " + std::to_string(source_rank), dead_t, "s", 3, MetricMode::Average);
+		after_body = std::chrono::steady_clock::now();
 
-				metricMan->sendMetric("Rank", std::to_string(my_rank), "", 3, MetricMode::LastPoint);
-				metricMan->sendMetric("App Name", app_name, "", 3, MetricMode::LastPoint);
-				metricMan->sendMetric("Fragment Latency at Receive From Rank " + std::to_string(source_rank), latency, "s", 4, MetricMode::Average | MetricMode::Maximum);
-				metricMan->sendMetric("Header Receive Wait Time From Rank" + std::to_string(source_rank), recv_wait_t, "s", 4, MetricMode::Average | MetricMode::Maximum | MetricMode::Minimum);
+		auto hdr_delta_t = TimeUtils::GetElapsedTime(start_time, after_header);
+		auto store_delta_t = TimeUtils::GetElapsedTime(after_header, before_body);
+		auto data_delta_t = TimeUtils::GetElapsedTime(before_body, after_body);
+		auto delta_t = TimeUtils::GetElapsedTime(start_time, after_body);
+		auto dead_t = TimeUtils::GetElapsedTime(state.end_time, start_time);
+		auto recv_wait_t = hdr_delta_t - latency;
 
-				TLOG(TLVL_DEBUG + 34) << "runReceiver_: Done sending receive stats for rank " << source_rank;
-			}
+		uint64_t data_size = header.word_count * sizeof(RawDataType);
+		auto header_size = header.num_words() * sizeof(RawDataType);
+
+		if (metricMan)
+		{  //&& recv_frag_count_.slotCount(source_rank) % 100 == 0) {
+			TLOG(TLVL_DEBUG + 34) << "receiveFragment_: Recording receive stats for rank " << source_rank;
+			auto& metrics = receive_metrics_.at(source_rank);
+			metrics.total_time.Record(delta_t);
+			metrics.total_size.Record(data_size);
+			metrics.total_rate.Record(data_size / delta_t);
+
+			metrics.header_time.Record(hdr_delta_t);
+			metrics.header_size.Record(header_size);
+			metrics.header_rate.Record(header_size / hdr_delta_t);
+
+			auto payloadSize = data_size - header_size;
+			metrics.data_time.Record(data_delta_t);
+			metrics.data_size.Record(payloadSize);
+			metrics.data_rate.Record(payloadSize / data_delta_t);
+
+			metrics.count.Record(recv_frag_count_.slotCount(source_rank));
+
+			metrics.shm_wait_total.Record(store_delta_t);
+			metrics.shm_wait_average.Record(store_delta_t);
+			metrics.fragment_wait.Record(dead_t);
+
+			metrics.latency.Record(latency);
+			metrics.header_wait.Record(recv_wait_t);
 
-			end_time = std::chrono::steady_clock::now();
+			TLOG(TLVL_DEBUG + 34) << "receiveFragment_: Done recording receive stats for rank " << source_rank;
 		}
-		else if (header.type == Fragment::EndOfDataFragmentType || header.type == Fragment::InitFragmentType || header.type == Fragment::EndOfRunFragmentType || header.type == Fragment::EndOfSubrunFragmentType || header.type == Fragment::ShutdownFragmentType)
-		{
-			TLOG(TLVL_DEBUG + 32) << "Received System Fragment from rank " << source_rank << " of type " << detail::RawFragmentHeader::SystemTypeToString(header.type) << ".";
 
-			FragmentPtr frag(new Fragment(header.word_count - header.num_words()));
-			memcpy(frag->headerAddress(), &header, header.num_words() * sizeof(RawDataType));
-			auto ret3 = source_plugins_[source_rank]->receiveFragmentData(frag->headerAddress() + header.num_words(), header.word_count - header.num_words());  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-			if (ret3 != source_rank)
-			{
-				TLOG(TLVL_ERROR) << "Unexpected return code from receiveFragmentData after receiveFragmentHeader while receiving System Fragment! (Expected: " << source_rank << ", Got: " << ret3 << ")";
-				throw cet::exception("DataReceiverManager") << "Unexpected return code from receiveFragmentData after receiveFragmentHeader while receiving System Fragment! (Expected: " << source_rank << ", Got: " << ret3 << ")";  // NOLINT(cert-err60-cpp)
-			}
+		state.end_time = std::chrono::steady_clock::now();
+	}
+	else if (header.type == Fragment::EndOfDataFragmentType || header.type == Fragment::InitFragmentType || header.type == Fragment::EndOfRunFragmentType || header.type == Fragment::EndOfSubrunFragmentType || header.type == Fragment::ShutdownFragmentType)
+	{
+		TLOG(TLVL_DEBUG + 32) << "Received System Fragment from rank " << source_rank << " of type " << detail::RawFragmentHeader::SystemTypeToString(header.type) << ".";
 
-			switch (header.type)
-			{
-				case Fragment::EndOfDataFragmentType:
-					shm_manager_->setRequestMode(detail::RequestMessageMode::EndOfRun);
-					if (endOfDataCount == static_cast<size_t>(-1))
-					{
-						endOfDataCount = *(frag->dataBegin());
-					}
-					else
-					{
-						endOfDataCount += *(frag->dataBegin());
-					}
-					TLOG(TLVL_DEBUG + 32) << "EndOfData Fragment indicates that " << endOfDataCount << " fragments are expected from rank " << source_rank
-					                      << " (recvd " << recv_frag_count_.slotCount(source_rank) << ").";
-					break;
-				case Fragment::InitFragmentType:
-					TLOG(TLVL_DEBUG + 32) << "Received Init Fragment from rank " << source_rank << ".";
-					shm_manager_->setRequestMode(detail::RequestMessageMode::Normal);
-					shm_manager_->AddInitFragment(frag);
-					break;
-				case Fragment::EndOfRunFragmentType:
-					shm_manager_->setRequestMode(detail::RequestMessageMode::EndOfRun);
-					// shm_manager_->endRun();
-					break;
-				case Fragment::EndOfSubrunFragmentType:
-					// shm_manager_->setRequestMode(detail::RequestMessageMode::EndOfRun);
-					TLOG(TLVL_DEBUG + 32) << "Received EndOfSubrun Fragment from rank " << source_rank
-					                      << " with sequence_id " << header.sequence_id << ".";
-					if (header.sequence_id != Fragment::InvalidSequenceID)
-					{
-						shm_manager_->rolloverSubrun(header.sequence_id, header.timestamp);
-					}
-					else
-					{
-						shm_manager_->rolloverSubrun(recv_seq_count_.slotCount(source_rank), header.timestamp);
-					}
-					break;
-				case Fragment::ShutdownFragmentType:
-					shm_manager_->setRequestMode(detail::RequestMessageMode::EndOfRun);
-					break;
-				default:
-					break;
-			}
+		FragmentPtr frag(new Fragment(header.word_count - header.num_words()));
+		memcpy(frag->headerAddress(), &header, header.num_words() * sizeof(RawDataType));
+		auto ret3 = source_plugins_[source_rank]->receiveFragmentData(frag->headerAddress() + header.num_words(), header.word_count - header.num_words());  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		if (ret3 != source_rank)
+		{
+			TLOG(TLVL_ERROR) << "Unexpected return code from receiveFragmentData after receiveFragmentHeader while receiving System Fragment! (Expected: " << source_rank << ", Got: " << ret3 << ")";
+			throw cet::exception("DataReceiverManager") << "Unexpected return code from receiveFragmentData after receiveFragmentHeader while receiving System Fragment! (Expected: " << source_rank << ", Got: " << ret3 << ")";  // NOLINT(cert-err60-cpp)
+		}
+
+		switch (header.type)
+		{
+			case Fragment::EndOfDataFragmentType:
+				shm_manager_->setRequestMode(detail::RequestMessageMode::EndOfRun);
+				if (state.endOfDataCount == static_cast<size_t>(-1))
+				{
+					state.endOfDataCount = *(frag->dataBegin());
+				}
+				else
+				{
+					state.endOfDataCount += *(frag->dataBegin());
+				}
+				TLOG(TLVL_DEBUG + 32) << "EndOfData Fragment indicates that " << state.endOfDataCount << " fragments are expected from rank " << source_rank
+				                      << " (recvd " << recv_frag_count_.slotCount(source_rank) << ").";
+				break;
+			case Fragment::InitFragmentType:
+				TLOG(TLVL_DEBUG + 32) << "Received Init Fragment from rank " << source_rank << ".";
+				shm_manager_->setRequestMode(detail::RequestMessageMode::Normal);
+				shm_manager_->AddInitFragment(frag);
+				break;
+			case Fragment::EndOfRunFragmentType:
+				shm_manager_->setRequestMode(detail::RequestMessageMode::EndOfRun);
+				// shm_manager_->endRun();
+				break;
+			case Fragment::EndOfSubrunFragmentType:
+				// shm_manager_->setRequestMode(detail::RequestMessageMode::EndOfRun);
+				TLOG(TLVL_DEBUG + 32) << "Received EndOfSubrun Fragment from rank " << source_rank
+				                      << " with sequence_id " << header.sequence_id << ".";
+				if (header.sequence_id != Fragment::InvalidSequenceID)
+				{
+					shm_manager_->rolloverSubrun(header.sequence_id, header.timestamp);
+				}
+				else
+				{
+					shm_manager_->rolloverSubrun(recv_seq_count_.slotCount(source_rank), header.timestamp);
+				}
+				break;
+			case Fragment::ShutdownFragmentType:
+				shm_manager_->setRequestMode(detail::RequestMessageMode::EndOfRun);
+				break;
+			default:
+				break;
 		}
 	}
 
+	return ReceiveStatus::Received;
+}
+
+void artdaq::DataReceiverManager::registerReceiveMetrics_(int source_rank)
+{
+	auto rank = std::to_string(source_rank);
+	auto& metrics = receive_metrics_[source_rank];
+	metrics.total_time = MetricHandle::Register("Total Receive Time From Rank " + rank, "s", 5, MetricMode::Accumulate);
+	metrics.total_size = MetricHandle::Register("Total Receive Size From Rank " + rank, "B", 5, MetricMode::Accumulate);
+	metrics.total_rate = MetricHandle::Register("Total Receive Rate From Rank " + rank, "B/s", 5, MetricMode::Average);
+
+	metrics.header_time = MetricHandle::Register("Header Receive Time From Rank " + rank, "s", 5, MetricMode::Accumulate);
+	metrics.header_size = MetricHandle::Register("Header Receive Size From Rank " + rank, "B", 5, MetricMode::Accumulate);
+	metrics.header_rate = MetricHandle::Register("Header Receive Rate From Rank " + rank, "B/s", 5, MetricMode::Average);
+
+	metrics.data_time = MetricHandle::Register("Data Receive Time From Rank " + rank, "s", 5, MetricMode::Accumulate);
+	metrics.data_size = MetricHandle::Register("Data Receive Size From Rank " + rank, "B", 5, MetricMode::Accumulate);
+	metrics.data_rate = MetricHandle::Register("Data Receive Rate From Rank " + rank, "B/s", 5, MetricMode::Average);
+
+	metrics.count = MetricHandle::Register("Data Receive Count From Rank " + rank, "fragments", 3, MetricMode::LastPoint);
+
+	metrics.shm_wait_total = MetricHandle::Register("Total Shared Memory Wait Time From Rank " + rank, "s", 3, MetricMode::Accumulate);
+	metrics.shm_wait_average = MetricHandle::Register("Avg Shared Memory Wait Time From Rank " + rank, "s", 3, MetricMode::Average);
+	metrics.fragment_wait = MetricHandle::Register("Avg Fragment Wait Time From Rank " + rank, "s", 3, MetricMode::Average);
+
+	metrics.latency = MetricHandle::Register("Fragment Latency at Receive From Rank " + rank, "s", 4, MetricMode::Average | MetricMode::Maximum);
+	metrics.header_wait = MetricHandle::Register("Header Receive Wait Time From Rank" + rank, "s", 4, MetricMode::Average | MetricMode::Maximum | MetricMode::Minimum);
+}
+
+void artdaq::DataReceiverManager::finishReceiver_(int source_rank)
+{
 	source_plugins_[source_rank]->flush_buffers();
 
 	TLOG(TLVL_DEBUG + 32) << "runReceiver_ " << source_rank << " receive loop exited";
@@ -4,11 +4,14 @@
 #include "TRACE/tracemf.h"  // Pre-empt TRACE/trace.h from Fragment.hh.
 #include "artdaq-core/Data/Fragment.hh"
 
+#include <chrono>
 #include <condition_variable>
 #include <map>
 #include <memory>
 #include <set>
+#include <vector>
 
+#include "artdaq/DAQdata/MetricHandle.hh"
 #include "artdaq/DAQrate/SharedMemoryEventManager.hh"
 #include "artdaq/DAQrate/detail/FragCounter.hh"
 #include "artdaq/TransferPlugins/TransferInterface.hh"
@@ -24,7 +27,8 @@ class DataReceiverManager;
 /**
  * \brief Receives Fragment objects from one or more DataSenderManager instances using TransferInterface plugins
  * DataReceiverMaanger runs a reception thread for each source, and can automatically suppress reception from
- * sources which are going faster than the others.
+ * sources which are going faster than the others. Alternatively, a fixed-size pool of threads can service all
+ * sources, waiting on socket readiness for plugins which support it.
  */
 class artdaq::DataReceiverManager
 {
@@ -39,6 +43,12 @@ public:
 	 * "auto_suppression_enabled" (Default: true): Whether to suppress a source that gets too far ahead
 	 * "max_receive_difference" (Default: 50): Threshold (in sequence ID) for suppressing a source
 	 * "receive_timeout_usec" (Default: 100000): The timeout for receive operations
+	 * "receiver_thread_count" (Default: 0): Number of threads used to receive from all sources. If 0, one thread is
+	 *   started per source. Otherwise, sources are divided among this many threads, which wait on the sockets of
+	 *   plugins that provide them (TransferInterface::getReceiveFDs) and poll the rest. A source whose Fragment is
+	 *   waiting for a free shared memory buffer is set aside until one is available, and the other sources keep being
+	 *   served. A pool thread still receives one Fragment at a time, so a source which is slow to deliver the rest of
+	 *   a Fragment stalls the other sources on that thread. Use 0 if sources must be isolated.
 	 * "enabled_sources" (OPTIONAL): List of sources which are enabled. If not specified, all sources are assumed enabled
 	 * "sources" (Default: blank table): FHiCL table containing TransferInterface configurations for each source.
 	 *   NOTE: "source_rank" MUST be specified (and unique) for each source!
@@ -104,12 +114,38 @@ private:
 	DataReceiverManager& operator=(DataReceiverManager const&) = delete;
 	DataReceiverManager& operator=(DataReceiverManager&&) = delete;
 
+	enum class ReceiveStatus
+	{
+		Received,
+		Timeout,
+		Blocked,  // The header was received, but there is no shared memory buffer for it yet. Call again to retry
+		Ended
+	};
+
+	struct ReceiverState
+	{
+		size_t endOfDataCount{static_cast<size_t>(-1)};
+		std::chrono::steady_clock::time_point end_time{std::chrono::steady_clock::now()};
+
+		// Fragment waiting for a shared memory buffer, see ReceiveStatus::Blocked
+		bool header_pending{false};
+		detail::RawFragmentHeader header;
+		std::chrono::steady_clock::time_point start_time;
+		std::chrono::steady_clock::time_point after_header;
+	};
+
 	void runReceiver_(int);
+	void runReceiverPool_(size_t thread_index, std::vector<int> source_ranks);
+	bool receiverShouldRun_(int source_rank) const;
+	ReceiveStatus receiveFragment_(int source_rank, ReceiverState& state, size_t timeout_usec, bool wait_for_buffer = true);
+	void finishReceiver_(int source_rank);
+	void registerReceiveMetrics_(int source_rank);
 
 	std::atomic<bool> stop_requested_;
 	std::atomic<size_t> stop_requested_time_;
 
 	std::map<int, boost::thread> source_threads_;
+	std::vector<boost::thread> pool_threads_;
 	std::map<int, std::unique_ptr<TransferInterface>> source_plugins_;
 
 	std::unordered_map<int, std::atomic<bool>> enabled_sources_;
@@ -121,10 +157,31 @@ private:
 
 	size_t receive_timeout_;
 	size_t stop_timeout_ms_;
+	size_t receiver_thread_count_;
 	std::shared_ptr<SharedMemoryEventManager> shm_manager_;
 
 	bool non_reliable_mode_enabled_;
 	size_t non_reliable_mode_retry_count_;
+
+	struct ReceiveMetrics
+	{
+		MetricHandle total_time;
+		MetricHandle total_size;
+		MetricHandle total_rate;
+		MetricHandle header_time;
+		MetricHandle header_size;
+		MetricHandle header_rate;
+		MetricHandle data_time;
+		MetricHandle data_size;
+		MetricHandle data_rate;
+		MetricHandle count;
+		MetricHandle shm_wait_total;
+		MetricHandle shm_wait_average;
+		MetricHandle fragment_wait;
+		MetricHandle latency;
+		MetricHandle header_wait;
+	};
+	std::map<int, ReceiveMetrics> receive_metrics_;  // Registered once per source, so receiveFragment_ does not build metric names
 };
 
 inline size_t
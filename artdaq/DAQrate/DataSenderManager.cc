@@ -21,6 +21,8 @@ artdaq::DataSenderManager::DataSenderManager(const fhicl::ParameterSet& pset)
     , send_retry_count_(pset.get<size_t>("send_retry_count", 2))
     , should_stop_(false)
     , highest_sequence_id_routed_(0)
+    , broadcasts_pending_(0)
+    , stop_broadcast_workers_(false)
 {
 	TLOG(TLVL_DEBUG + 32) << "Received pset: " << pset.to_string();
 
@@ -84,6 +86,19 @@ artdaq::DataSenderManager::DataSenderManager(const fhicl::ParameterSet& pset)
 			TLOG(TLVL_WARNING) << "Non-cet exception while setting up TransferPlugin: " << d << ".";
 		}
 	}
+	for (auto& d : destinations_)
+	{
+		auto rank = std::to_string(d.first);
+		auto& metrics = send_metrics_[d.first];
+		metrics.time = MetricHandle::Register("Data Send Time to Rank " + rank, "s", 5, MetricMode::Accumulate);
+		metrics.size = MetricHandle::Register("Data Send Size to Rank " + rank, "B", 5, MetricMode::Accumulate | MetricMode::Maximum);
+		metrics.rate = MetricHandle::Register("Data Send Rate to Rank " + rank, "B/s", 5, MetricMode::Average);
+		metrics.count = MetricHandle::Register("Data Send Count to Rank " + rank, "fragments", 3, MetricMode::LastPoint);
+	}
+	send_latency_metric_ = MetricHandle::Register("Fragment Latency at Send", "s", 4, MetricMode::Average | MetricMode::Maximum);
+	MetricHandle::RegisterConstant("Rank", std::to_string(my_rank), 3);
+	MetricHandle::RegisterConstant("App Name", app_name, 3);
+
 	if (destinations_.empty())
 	{
 		TLOG(TLVL_ERROR) << "No destinations specified!";
@@ -107,22 +122,67 @@ artdaq::DataSenderManager::DataSenderManager(const fhicl::ParameterSet& pset)
 			}
 		}
 	}
+
+	// With a single destination, broadcasts are sent from the calling thread
+	std::set<int> broadcast_dests;
+	for (auto& dest : enabled_destinations_)
+	{
+		if (destinations_.count(dest) != 0u)
+		{
+			broadcast_dests.insert(dest);
+		}
+	}
+	if (broadcast_dests.size() > 1)
+	{
+		for (auto& dest : broadcast_dests)
+		{
+			broadcast_workers_[dest];
+		}
+		for (auto& worker : broadcast_workers_)
+		{
+			auto dest = worker.first;
+			worker.second.thread = std::thread([this, dest] { broadcastWorkerLoop_(dest); });
+		}
+	}
 }
 
 artdaq::DataSenderManager::~DataSenderManager()
 {
 	TLOG(TLVL_DEBUG + 32) << "Shutting down DataSenderManager BEGIN";
 	should_stop_ = true;
+	std::map<int, std::shared_ptr<Fragment const>> eod_fragments;
 	for (auto& dest : enabled_destinations_)
 	{
 		if (destinations_.count(dest) != 0u)
 		{
-			auto sts = destinations_[dest]->transfer_fragment_reliable_mode(std::move(*Fragment::eodFrag(sent_frag_count_.slotCount(dest))));
-			if (sts != TransferInterface::CopyStatus::kSuccess)
+			eod_fragments[dest] = Fragment::eodFrag(sent_frag_count_.slotCount(dest));
+		}
+	}
+	try
+	{
+		for (auto& result : broadcast_(eod_fragments, true))
+		{
+			if (result.second != TransferInterface::CopyStatus::kSuccess)
 			{
-				TLOG(TLVL_ERROR) << "Error sending EOD Fragment to sender rank " << dest;
+				TLOG(TLVL_ERROR) << "Error sending EOD Fragment to sender rank " << result.first;
 			}
-			//  sendFragTo(std::move(*Fragment::eodFrag(nFragments)), dest, true);
+		}
+	}
+	catch (cet::exception const& ex)
+	{
+		TLOG(TLVL_ERROR) << "Exception sending EOD Fragments: " << ex.what();
+	}
+
+	{
+		std::lock_guard<std::mutex> lk(broadcast_worker_mutex_);
+		stop_broadcast_workers_ = true;
+	}
+	broadcast_cv_.notify_all();
+	for (auto& worker : broadcast_workers_)
+	{
+		if (worker.second.thread.joinable())
+		{
+			worker.second.thread.join();
 		}
 	}
 	TLOG(TLVL_DEBUG + 32) << "Shutting down DataSenderManager END. Sent " << count() << " fragments.";
@@ -212,29 +272,25 @@ std::pair<int, artdaq::TransferInterface::CopyStatus> artdaq::DataSenderManager:
 	auto outsts = TransferInterface::CopyStatus::kSuccess;
 	if (broadcast_sends_ || isSystemBroadcast)
 	{
+		// Every destination sends from the same Fragment, so that a slow destination does not hold up the others.
+		// broadcast_ returns once every destination is done with it, so the Fragment stays with the caller.
+		std::shared_ptr<Fragment const> shared_frag(&frag, [](Fragment const* /*unused*/) {});
+		std::map<int, std::shared_ptr<Fragment const>> fragments;
 		for (auto& bdest : enabled_destinations_)
 		{
-			TLOG(TLVL_DEBUG + 33) << "sendFragment: Sending fragment with seqId " << seqID << " to destination " << bdest << " (broadcast)";
-			// Gross, we have to copy.
-			auto sts = TransferInterface::CopyStatus::kTimeout;
-			size_t retries = 0;  // Have NOT yet tried, so retries <= send_retry_count_ will have it RETRY send_retry_count_ times
-			while (sts == TransferInterface::CopyStatus::kTimeout && retries <= send_retry_count_)
+			if (destinations_.count(bdest) != 0u)
 			{
-				if (!non_blocking_mode_)
-				{
-					sts = destinations_[bdest]->transfer_fragment_reliable_mode(Fragment(frag));
-				}
-				else
-				{
-					sts = destinations_[bdest]->transfer_fragment_min_blocking_mode(frag, send_timeout_us_);
-				}
-				++retries;
+				fragments[bdest] = shared_frag;
 			}
-			if (sts != TransferInterface::CopyStatus::kSuccess)
+		}
+		TLOG(TLVL_DEBUG + 33) << "sendFragment: Sending fragment with seqId " << seqID << " to " << fragments.size() << " destinations (broadcast)";
+		for (auto& result : broadcast_(fragments, !non_blocking_mode_))
+		{
+			if (result.second != TransferInterface::CopyStatus::kSuccess)
 			{
-				outsts = sts;
+				outsts = result.second;
 			}
-			sent_frag_count_.incSlot(bdest);
+			sent_frag_count_.incSlot(result.first);
 		}
 	}
 	else if (non_blocking_mode_)
@@ -319,18 +375,121 @@ std::pair<int, artdaq::TransferInterface::CopyStatus> artdaq::DataSenderManager:
 
 	if (metricMan)
 	{
-		TLOG(TLVL_DEBUG + 34) << "sendFragment: sending metrics";
-		metricMan->sendMetric("Data Send Time to Rank " + std::to_string(dest), delta_t, "s", 5, MetricMode::Accumulate);
-		metricMan->sendMetric("Data Send Size to Rank " + std::to_string(dest), fragSize, "B", 5, MetricMode::Accumulate | MetricMode::Maximum);
-		metricMan->sendMetric("Data Send Rate to Rank " + std::to_string(dest), fragSize / delta_t, "B/s", 5, MetricMode::Average);
-		metricMan->sendMetric("Data Send Count to Rank " + std::to_string(dest), sent_frag_count_.slotCount(dest), "fragments", 3, MetricMode::LastPoint);
-
-		metricMan->sendMetric("Rank", std::to_string(my_rank), "", 3, MetricMode::LastPoint);
-		metricMan->sendMetric("App Name", app_name, "", 3, MetricMode::LastPoint);
-
-		metricMan->sendMetric("Fragment Latency at Send", latency, "s", 4, MetricMode::Average | MetricMode::Maximum);
+		TLOG(TLVL_DEBUG + 34) << "sendFragment: recording metrics";
+		auto metrics = send_metrics_.find(dest);
+		if (metrics != send_metrics_.end())
+		{
+			metrics->second.time.Record(delta_t);
+			metrics->second.size.Record(fragSize);
+			metrics->second.rate.Record(fragSize / delta_t);
+			metrics->second.count.Record(sent_frag_count_.slotCount(dest));
+		}
+		send_latency_metric_.Record(latency);
 	}
 
 	TLOG(TLVL_DEBUG + 34) << "sendFragment: Done sending fragment " << seqID << " to dest=" << dest;
 	return std::make_pair(dest, outsts);
 }  // artdaq::DataSenderManager::sendFragment
+
+std::map<int, artdaq::TransferInterface::CopyStatus> artdaq::DataSenderManager::broadcast_(std::map<int, std::shared_ptr<Fragment const>> const& fragments, bool reliable)
+{
+	std::map<int, TransferInterface::CopyStatus> results;
+	if (broadcast_workers_.empty())
+	{
+		for (auto& fragment : fragments)
+		{
+			results[fragment.first] = sendBroadcastFragment_(fragment.first, *fragment.second, reliable);
+		}
+		return results;
+	}
+
+	std::lock_guard<std::mutex> broadcast_lk(broadcast_mutex_);
+	std::unique_lock<std::mutex> lk(broadcast_worker_mutex_);
+	for (auto& fragment : fragments)
+	{
+		auto& worker = broadcast_workers_.at(fragment.first);
+		worker.fragment = fragment.second;
+		worker.reliable = reliable;
+		worker.error = nullptr;
+		++broadcasts_pending_;
+	}
+	broadcast_cv_.notify_all();
+	broadcast_done_cv_.wait(lk, [this] { return broadcasts_pending_ == 0; });
+
+	std::exception_ptr error;
+	for (auto& fragment : fragments)
+	{
+		auto& worker = broadcast_workers_.at(fragment.first);
+		results[fragment.first] = worker.status;
+		if (worker.error && !error)
+		{
+			error = worker.error;
+		}
+	}
+	if (error)
+	{
+		std::rethrow_exception(error);
+	}
+	return results;
+}
+
+artdaq::TransferInterface::CopyStatus artdaq::DataSenderManager::sendBroadcastFragment_(int dest, Fragment const& frag, bool reliable)
+{
+	auto& transfer = destinations_.at(dest);
+	auto sts = TransferInterface::CopyStatus::kTimeout;
+	size_t retries = 0;  // Have NOT yet tried, so retries <= send_retry_count_ will have it RETRY send_retry_count_ times
+	while (sts == TransferInterface::CopyStatus::kTimeout && retries <= send_retry_count_)
+	{
+		if (reliable)
+		{
+			// A transfer plugin may keep a reliable-mode Fragment (e.g. for a zero-copy send), so each destination needs its own copy
+			sts = transfer->transfer_fragment_reliable_mode(Fragment(frag));
+		}
+		else
+		{
+			sts = transfer->transfer_fragment_min_blocking_mode(frag, send_timeout_us_);
+		}
+		++retries;
+	}
+	return sts;
+}
+
+void artdaq::DataSenderManager::broadcastWorkerLoop_(int dest)
+{
+	auto& worker = broadcast_workers_.at(dest);
+	std::unique_lock<std::mutex> lk(broadcast_worker_mutex_);
+	while (true)
+	{
+		broadcast_cv_.wait(lk, [&] { return worker.fragment != nullptr || stop_broadcast_workers_; });
+		if (worker.fragment == nullptr)
+		{
+			break;
+		}
+		auto fragment = worker.fragment;
+		auto reliable = worker.reliable;
+		lk.unlock();
+
+		TLOG(TLVL_DEBUG + 33) << "Sending fragment with seqId " << fragment->sequenceID() << " to destination " << dest << " (broadcast)";
+		auto sts = TransferInterface::CopyStatus::kErrorNotRequiringException;
+		std::exception_ptr error;
+		try
+		{
+			sts = sendBroadcastFragment_(dest, *fragment, reliable);
+		}
+		catch (...)
+		{
+			error = std::current_exception();
+		}
+		fragment.reset();
+
+		lk.lock();
+		worker.status = sts;
+		worker.error = error;
+		worker.fragment.reset();
+		if (--broadcasts_pending_ == 0)
+		{
+			broadcast_done_cv_.notify_one();
+		}
+	}
+	TLOG(TLVL_DEBUG + 33) << "Broadcast worker for destination " << dest << " exiting";
+}
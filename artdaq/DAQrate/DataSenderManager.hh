@@ -7,6 +7,7 @@
 #include "artdaq-core/Data/Fragment.hh"
 
 #include "artdaq/DAQdata/HostMap.hh"
+#include "artdaq/DAQdata/MetricHandle.hh"
 #include "artdaq/DAQrate/detail/FragCounter.hh"
 #include "artdaq/DAQrate/detail/TableReceiver.hh"
 #include "artdaq/TransferPlugins/TransferInterface.hh"
@@ -20,9 +21,13 @@
 
 #include <netinet/in.h>
 #include <atomic>
+#include <condition_variable>
+#include <exception>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <set>
+#include <thread>
 
 namespace artdaq {
 class DataSenderManager;
@@ -82,7 +87,8 @@ public:
 
 	/**
 	 * \brief Send the given Fragment. Return the rank of the destination to which the Fragment was sent.
-	 * \param frag Fragment to sent
+	 * \param frag Fragment to sent. Unless a transfer plugin has to keep it (e.g. TCPSocket zero-copy sends), it still
+	 * holds its buffer afterward, so that the buffer can be reused.
 	 * \return Pair containing Rank of destination for Fragment and the CopyStatus from the send call
 	 */
 	std::pair<int, TransferInterface::CopyStatus> sendFragment(Fragment&& frag);
@@ -150,6 +156,11 @@ private:
 	// Calculate where the fragment with this sequenceID should go.
 	int calcDest_(Fragment::sequence_id_t) const;
 
+	// Send each Fragment to its destination concurrently, returning the status of each send
+	std::map<int, TransferInterface::CopyStatus> broadcast_(std::map<int, std::shared_ptr<Fragment const>> const& fragments, bool reliable);
+	TransferInterface::CopyStatus sendBroadcastFragment_(int dest, Fragment const& frag, bool reliable);
+	void broadcastWorkerLoop_(int dest);
+
 private:
 	std::map<int, std::unique_ptr<artdaq::TransferInterface>> destinations_;
 	std::set<int> enabled_destinations_;
@@ -168,6 +179,32 @@ private:
 	mutable std::mutex sent_sequence_id_mutex_;
 
 	mutable std::atomic<uint64_t> highest_sequence_id_routed_;
+
+	struct SendMetrics
+	{
+		MetricHandle time;
+		MetricHandle size;
+		MetricHandle rate;
+		MetricHandle count;
+	};
+	std::map<int, SendMetrics> send_metrics_;  // Registered once per destination, so sendFragment does not build metric names
+	MetricHandle send_latency_metric_;
+
+	struct BroadcastWorker
+	{
+		std::thread thread;
+		std::shared_ptr<Fragment const> fragment;  // Set by broadcast_, cleared by the worker once it has been sent
+		bool reliable{false};
+		TransferInterface::CopyStatus status{TransferInterface::CopyStatus::kSuccess};
+		std::exception_ptr error;
+	};
+	std::map<int, BroadcastWorker> broadcast_workers_;  // One per enabled destination, if there is more than one
+	std::mutex broadcast_mutex_;                        // Serializes broadcast_ calls
+	std::mutex broadcast_worker_mutex_;                 // Protects the BroadcastWorker members and the counters below
+	std::condition_variable broadcast_cv_;
+	std::condition_variable broadcast_done_cv_;
+	size_t broadcasts_pending_;
+	bool stop_broadcast_workers_;
 };
 
 inline size_t
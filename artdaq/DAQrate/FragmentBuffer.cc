@@ -52,6 +52,8 @@ artdaq::FragmentBuffer::FragmentBuffer(const fhicl::ParameterSet& ps)
     , window_close_timeout_us_(ps.get<size_t>("window_close_timeout_us", 2000000))
     , error_on_empty_(ps.get<bool>("error_on_empty_fragment", false))
     , circularDataBufferMode_(ps.get<bool>("circular_buffer_mode", false))
+    , dataUpdates_(0)
+    , dataUpdatesSeen_(0)
     , maxDataBufferDepthFragments_(ps.get<int>("data_buffer_depth_fragments", 1000))
     , maxDataBufferDepthBytes_(ps.get<size_t>("data_buffer_depth_mb", 1000) * 1024 * 1024)
     , systemFragmentCount_(0)
@@ -111,15 +113,114 @@ artdaq::FragmentBuffer::FragmentBuffer(const fhicl::ParameterSet& ps)
 		TLOG(TLVL_WARNING) << "Request Mode was requested as " << modeString << ", but is being set to Ignored because \"receive_requests\" was not set to true";
 		mode_ = RequestMode::Ignored;
 	}
+	for (auto& id : dataBuffers_)
+	{
+		id.second->Indexed = mode_ == RequestMode::Window || mode_ == RequestMode::SequenceID;
+	}
 	TLOG(TLVL_DEBUG + 32) << "Request mode is " << printMode_();
+
+	depth_fragments_metric_ = MetricHandle::Register("Buffer Depth Fragments", "fragments", 1, MetricMode::LastPoint);
+	depth_bytes_metric_ = MetricHandle::Register("Buffer Depth Bytes", "bytes", 1, MetricMode::LastPoint);
+	full_fragments_metric_ = MetricHandle::Register("Fragment Buffer Full %Fragments", "%", 3, MetricMode::LastPoint);
+	full_bytes_metric_ = MetricHandle::Register("Fragment Buffer Full %Bytes", "%", 3, MetricMode::LastPoint);
+	full_metric_ = MetricHandle::Register("Fragment Buffer Full %", "%", 1, MetricMode::LastPoint);
 }
 
 artdaq::FragmentBuffer::~FragmentBuffer()
 {
 	TLOG(TLVL_INFO) << "Fragment Buffer Destructor; Clearing data buffers";
+	if (requestBuffer_ != nullptr)
+	{
+		requestBuffer_->SetUpdateCallback(nullptr);
+	}
 	Reset(true);
 }
 
+void artdaq::FragmentBuffer::SetRequestBuffer(std::shared_ptr<RequestBuffer> buffer)
+{
+	if (requestBuffer_ != nullptr)
+	{
+		requestBuffer_->SetUpdateCallback(nullptr);
+	}
+	requestBuffer_ = buffer;
+	if (requestBuffer_ != nullptr)
+	{
+		requestBuffer_->SetUpdateCallback([this]() { notifyDataUpdate_(); });
+	}
+}
+
+void artdaq::FragmentBuffer::notifyDataUpdate_()
+{
+	std::lock_guard<std::mutex> lk(dataConditionMutex_);
+	++dataUpdates_;
+	dataCondition_.notify_all();
+}
+
+void artdaq::FragmentBuffer::notifyDataBufferDrained_()
+{
+	// Taking the mutex makes sure that a waiter which has just found the buffer full is already waiting
+	std::lock_guard<std::mutex> lk(dataConditionMutex_);
+	dataCondition_.notify_all();
+}
+
+void artdaq::FragmentBuffer::DataBuffer::Append(FragmentPtr&& frag)
+{
+	DataBufferDepthBytes += frag->sizeBytes();
+	auto it = DataBuffer.insert(DataBuffer.end(), std::move(frag));
+	if (Indexed)
+	{
+		// Hinting at the end keeps Fragments with equal timestamps in arrival order
+		TimestampIndex.emplace_hint(TimestampIndex.end(), (*it)->timestamp(), it);
+		SequenceIDIndex[(*it)->sequenceID()].push_back(it);
+	}
+	DataBufferDepthFragments = DataBuffer.size();
+}
+
+artdaq::FragmentPtrs::iterator artdaq::FragmentBuffer::DataBuffer::Remove(FragmentPtrs::iterator it, FragmentPtrs* output)
+{
+	if (Indexed)
+	{
+		auto range = TimestampIndex.equal_range((*it)->timestamp());
+		for (auto idx = range.first; idx != range.second; ++idx)
+		{
+			if (idx->second == it)
+			{
+				TimestampIndex.erase(idx);
+				break;
+			}
+		}
+
+		auto seq = SequenceIDIndex.find((*it)->sequenceID());
+		if (seq != SequenceIDIndex.end())
+		{
+			auto& positions = seq->second;
+			positions.erase(std::remove(positions.begin(), positions.end(), it), positions.end());
+			if (positions.empty())
+			{
+				SequenceIDIndex.erase(seq);
+			}
+		}
+	}
+
+	DataBufferDepthBytes -= (*it)->sizeBytes();
+	if (output != nullptr)
+	{
+		output->emplace_back(std::move(*it));
+	}
+	auto next = DataBuffer.erase(it);
+	DataBufferDepthFragments = DataBuffer.size();
+	return next;
+}
+
+void artdaq::FragmentBuffer::DataBuffer::Clear()
+{
+	TimestampIndex.clear();
+	SequenceIDIndex.clear();
+	DataBuffer.clear();
+	DataBufferDepthBytes = 0;
+	DataBufferDepthFragments = 0;
+}
+
 void artdaq::FragmentBuffer::Reset(bool stop)
 {
 	should_stop_ = stop;
@@ -127,10 +228,8 @@ void artdaq::FragmentBuffer::Reset(bool stop)
 	for (auto& id : dataBuffers_)
 	{
 		std::lock_guard<std::mutex> dlk(id.second->DataBufferMutex);
-		id.second->DataBufferDepthBytes = 0;
-		id.second->DataBufferDepthFragments = 0;
+		id.second->Clear();
 		id.second->BufferFragmentKept = false;
-		id.second->DataBuffer.clear();
 	}
 
 	{
@@ -138,6 +237,7 @@ void artdaq::FragmentBuffer::Reset(bool stop)
 		systemFragments_.clear();
 		systemFragmentCount_ = 0;
 	}
+	notifyDataBufferDrained_();
 }
 
 void artdaq::FragmentBuffer::AddFragmentsToBuffer(FragmentPtrs frags)
@@ -196,17 +296,15 @@ void artdaq::FragmentBuffer::AddFragmentsToBuffer(FragmentPtrs frags)
 					auto dataIter = type_it->second.begin();
 					TLOG(TLVL_ADDFRAGMENT) << "Adding Fragment with Fragment ID " << frag_id << ", Sequence ID " << (*dataIter)->sequenceID() << ", and Timestamp " << (*dataIter)->timestamp() << " to buffer";
 
-					dataBuffer->DataBufferDepthBytes += (*dataIter)->sizeBytes();
-					dataBuffer->DataBuffer.emplace_back(std::move(*dataIter));
+					dataBuffer->Append(std::move(*dataIter));
 					type_it->second.erase(dataIter);
 				}
-				dataBuffer->DataBufferDepthFragments = dataBuffer->DataBuffer.size();
 				break;
 		}
 		getDataBufferStats(frag_id);
 		++type_it;
 	}
-	dataCondition_.notify_all();
+	notifyDataUpdate_();
 }
 
 bool artdaq::FragmentBuffer::check_stop()
@@ -279,12 +377,11 @@ bool artdaq::FragmentBuffer::waitForDataBufferReady(Fragment::fragment_id_t id)
 			{
 				TLOG(TLVL_DEBUG + 32) << "Run ended while waiting for buffer to shrink!";
 				getDataBufferStats(id);
-				dataCondition_.notify_all();
 				return false;
 			}
 			auto waittime = TimeUtils::GetElapsedTimeMilliseconds(startwait);
 
-			if (first || (waittime != lastwaittime && waittime % 1000 == 0))
+			if (first || waittime / 1000 != lastwaittime / 1000)
 			{
 				std::lock_guard<std::mutex> lk(dataBuffer->DataBufferMutex);
 				if (dataBufferIsTooLarge(id))
@@ -308,7 +405,10 @@ bool artdaq::FragmentBuffer::waitForDataBufferReady(Fragment::fragment_id_t id)
 				TLOG(TLVL_WAITFORBUFFERREADY) << "getDataLoop: Data Retreival paused for " << waittime << " ms waiting for data buffer to drain";
 			}
 			lastwaittime = waittime;
-			usleep(1000);
+
+			// applyRequests and Reset notify dataCondition_ after removing Fragments; wake periodically to report status
+			std::unique_lock<std::mutex> lk(dataConditionMutex_);
+			dataCondition_.wait_for(lk, std::chrono::milliseconds(100), [this, id]() { return !dataBufferIsTooLarge(id) || should_stop_.load(); });
 		}
 		else
 		{
@@ -325,9 +425,7 @@ bool artdaq::FragmentBuffer::waitForDataBufferReady(Fragment::fragment_id_t id)
 				{
 					TLOG(TLVL_WAITFORBUFFERREADY) << "waitForDataBufferReady: Dropping Fragment with timestamp " << (*begin)->timestamp() << " from data buffer (Buffer over-size, circular data buffer mode)";
 
-					dataBuffer->DataBufferDepthBytes -= (*begin)->sizeBytes();
-					dataBuffer->DataBuffer.erase(begin);
-					dataBuffer->DataBufferDepthFragments = dataBuffer->DataBuffer.size();
+					dataBuffer->Remove(begin);
 					dataBuffer->BufferFragmentKept = false;  // If any Fragments are removed from data buffer, then we know we don't have to ignore the first one anymore
 				}
 			}
@@ -361,15 +459,15 @@ void artdaq::FragmentBuffer::getDataBufferStats(Fragment::fragment_id_t id)
 
 	if (metricMan)
 	{
-		TLOG(TLVL_GETBUFFERSTATS) << "getDataBufferStats: Sending Metrics";
-		metricMan->sendMetric("Buffer Depth Fragments", dataBuffer->DataBufferDepthFragments.load(), "fragments", 1, MetricMode::LastPoint);
-		metricMan->sendMetric("Buffer Depth Bytes", dataBuffer->DataBufferDepthBytes.load(), "bytes", 1, MetricMode::LastPoint);
+		TLOG(TLVL_GETBUFFERSTATS) << "getDataBufferStats: Recording Metrics";
+		depth_fragments_metric_.Record(dataBuffer->DataBufferDepthFragments.load());
+		depth_bytes_metric_.Record(dataBuffer->DataBufferDepthBytes.load());
 
 		auto bufferDepthFragmentsPercent = dataBuffer->DataBufferDepthFragments.load() * 100 / static_cast<double>(maxDataBufferDepthFragments_);
 		auto bufferDepthBytesPercent = dataBuffer->DataBufferDepthBytes.load() * 100 / static_cast<double>(maxDataBufferDepthBytes_);
-		metricMan->sendMetric("Fragment Buffer Full %Fragments", bufferDepthFragmentsPercent, "%", 3, MetricMode::LastPoint);
-		metricMan->sendMetric("Fragment Buffer Full %Bytes", bufferDepthBytesPercent, "%", 3, MetricMode::LastPoint);
-		metricMan->sendMetric("Fragment Buffer Full %", bufferDepthFragmentsPercent > bufferDepthBytesPercent ? bufferDepthFragmentsPercent : bufferDepthBytesPercent, "%", 1, MetricMode::LastPoint);
+		full_fragments_metric_.Record(bufferDepthFragmentsPercent);
+		full_bytes_metric_.Record(bufferDepthBytesPercent);
+		full_metric_.Record(bufferDepthFragmentsPercent > bufferDepthBytesPercent ? bufferDepthFragmentsPercent : bufferDepthBytesPercent);
 	}
 	TLOG(TLVL_GETBUFFERSTATS) << "getDataBufferStats: frags=" << dataBuffer->DataBufferDepthFragments.load() << "/" << maxDataBufferDepthFragments_
 	                          << ", sz=" << dataBuffer->DataBufferDepthBytes.load() << "/" << maxDataBufferDepthBytes_;
@@ -394,9 +492,7 @@ void artdaq::FragmentBuffer::checkDataBuffer(Fragment::fragment_id_t id)
 		{
 			auto begin = dataBuffer->DataBuffer.begin();
 			TLOG(TLVL_CHECKDATABUFFER) << "checkDataBuffer: Dropping Fragment with timestamp " << (*begin)->timestamp() << " from data buffer (Buffer over-size)";
-			dataBuffer->DataBufferDepthBytes -= (*begin)->sizeBytes();
-			dataBuffer->DataBuffer.erase(begin);
-			dataBuffer->DataBufferDepthFragments = dataBuffer->DataBuffer.size();
+			dataBuffer->Remove(begin);
 			dataBuffer->BufferFragmentKept = false;  // If any Fragments are removed from data buffer, then we know we don't have to ignore the first one anymore
 		}
 
@@ -411,10 +507,8 @@ void artdaq::FragmentBuffer::checkDataBuffer(Fragment::fragment_id_t id)
 				if ((*it)->timestamp() < min)
 				{
 					TLOG(TLVL_CHECKDATABUFFER) << "checkDataBuffer: Dropping Fragment with timestamp " << (*it)->timestamp() << " from data buffer (timeout=" << staleTimeout_ << ", min=" << min << ")";
-					dataBuffer->DataBufferDepthBytes -= (*it)->sizeBytes();
 					dataBuffer->BufferFragmentKept = false;  // If any Fragments are removed from data buffer, then we know we don't have to ignore the first one anymore
-					it = dataBuffer->DataBuffer.erase(it);
-					dataBuffer->DataBufferDepthFragments = dataBuffer->DataBuffer.size();
+					it = dataBuffer->Remove(it);
 				}
 				else
 				{
@@ -610,48 +704,31 @@ void artdaq::FragmentBuffer::applyRequestsWindowMode_CheckAndFillDataBuffer(artd
 			cfl.set_missing_data(true);
 		}
 
-		auto it = dataBuffer->DataBuffer.begin();
-		// Likely that it will be closer to the end...
-		if (windowTimeout)
-		{
-			it = dataBuffer->DataBuffer.end();
-			--it;
-			while (it != dataBuffer->DataBuffer.begin())
-			{
-				if ((*it)->timestamp() < min)
-				{
-					break;
-				}
-				--it;
-			}
-		}
+		// The timestamp index gives the request window directly, instead of walking the buffer from one end
+		auto first = dataBuffer->TimestampIndex.lower_bound(min);
+		auto last = windowWidth_ > 0 ? dataBuffer->TimestampIndex.lower_bound(max) : dataBuffer->TimestampIndex.upper_bound(max);
 
 		FragmentPtrs fragsToAdd;
-		// Do a little bit more work to decide which fragments to send for a given request
-		for (; it != dataBuffer->DataBuffer.end();)
+		if (uniqueWindows_)
 		{
-			Fragment::timestamp_t fragT = (*it)->timestamp();
-			if (fragT < min)
-			{
-				++it;
-				continue;
-			}
-			if (fragT > max || (fragT == max && windowWidth_ > 0))
+			// Remove() erases index entries, so collect the matching buffer positions first
+			std::vector<FragmentPtrs::iterator> matches;
+			for (auto idx = first; idx != last; ++idx)
 			{
-				break;
+				matches.push_back(idx->second);
 			}
-
-			TLOG(TLVL_APPLYREQUESTS_VERBOSE) << "applyRequestsWindowMode_CheckAndFillDataBuffer: Adding Fragment with timestamp " << (*it)->timestamp() << " to Container (SeqID " << seq << ")";
-			if (uniqueWindows_)
+			for (auto& it : matches)
 			{
-				dataBuffer->DataBufferDepthBytes -= (*it)->sizeBytes();
-				fragsToAdd.emplace_back(std::move(*it));
-				it = dataBuffer->DataBuffer.erase(it);
+				TLOG(TLVL_APPLYREQUESTS_VERBOSE) << "applyRequestsWindowMode_CheckAndFillDataBuffer: Adding Fragment with timestamp " << (*it)->timestamp() << " to Container (SeqID " << seq << ")";
+				dataBuffer->Remove(it, &fragsToAdd);
 			}
-			else
+		}
+		else
+		{
+			for (auto idx = first; idx != last; ++idx)
 			{
-				fragsToAdd.emplace_back(it->get());
-				++it;
+				TLOG(TLVL_APPLYREQUESTS_VERBOSE) << "applyRequestsWindowMode_CheckAndFillDataBuffer: Adding Fragment with timestamp " << idx->first << " to Container (SeqID " << seq << ")";
+				fragsToAdd.emplace_back(idx->second->get());
 			}
 		}
 
@@ -675,7 +752,6 @@ void artdaq::FragmentBuffer::applyRequestsWindowMode_CheckAndFillDataBuffer(artd
 			TLOG(error_on_empty_ ? TLVL_ERROR : TLVL_APPLYREQUESTS) << "applyRequestsWindowMode_CheckAndFillDataBuffer: No Fragments match request (SeqID " << seq << ", window " << min << " - " << max << ")";
 		}
 
-		dataBuffer->DataBufferDepthFragments = dataBuffer->DataBuffer.size();
 		dataBuffer->WindowsSent[seq] = std::chrono::steady_clock::now();
 		if (seq > dataBuffer->HighestRequestSeen) dataBuffer->HighestRequestSeen = seq;
 	}
@@ -753,22 +829,16 @@ void artdaq::FragmentBuffer::applyRequestsSequenceIDMode(artdaq::FragmentPtrs& f
 			if (!id.second->WindowsSent.count(req->first))
 			{
 				TLOG(TLVL_APPLYREQUESTS_VERBOSE) << "Searching id " << id.first << " for Fragments with Sequence ID " << req->first;
-				for (auto it = id.second->DataBuffer.begin(); it != id.second->DataBuffer.end();)
+				auto match = id.second->SequenceIDIndex.find(req->first);
+				if (match != id.second->SequenceIDIndex.end())
 				{
-					auto seq = (*it)->sequenceID();
-					TLOG(TLVL_APPLYREQUESTS_VERBOSE) << "applyRequestsSequenceIDMode: Fragment SeqID " << seq << ", request ID " << req->first;
-					if (seq == req->first)
-					{
-						TLOG(TLVL_APPLYREQUESTS_VERBOSE) << "applyRequestsSequenceIDMode: Adding Fragment to output";
-						id.second->WindowsSent[req->first] = std::chrono::steady_clock::now();
-						id.second->DataBufferDepthBytes -= (*it)->sizeBytes();
-						frags.push_back(std::move(*it));
-						it = id.second->DataBuffer.erase(it);
-						id.second->DataBufferDepthFragments = id.second->DataBuffer.size();
-					}
-					else
+					// Remove() erases the index entry, so take a copy of the buffer positions
+					auto matches = match->second;
+					TLOG(TLVL_APPLYREQUESTS_VERBOSE) << "applyRequestsSequenceIDMode: Adding " << matches.size() << " Fragments with SeqID " << req->first << " to output";
+					id.second->WindowsSent[req->first] = std::chrono::steady_clock::now();
+					for (auto& it : matches)
 					{
-						++it;
+						id.second->Remove(it, &frags);
 					}
 				}
 			}
@@ -804,13 +874,9 @@ bool artdaq::FragmentBuffer::applyRequests(artdaq::FragmentPtrs& frags)
 	// Wait for data, if in ignored mode, or a request otherwise
 	if (mode_ == RequestMode::Ignored)
 	{
-		auto start_time = std::chrono::steady_clock::now();
-		while (dataBufferFragmentCount_() == 0 && TimeUtils::GetElapsedTime(start_time) < 1.0)
-		{
-			if (check_stop()) return false;
-			std::unique_lock<std::mutex> lock(dataConditionMutex_);
-			dataCondition_.wait_for(lock, std::chrono::milliseconds(10), [this]() { return dataBufferFragmentCount_() > 0; });
-		}
+		std::unique_lock<std::mutex> lock(dataConditionMutex_);
+		dataCondition_.wait_for(lock, std::chrono::seconds(1), [this]() { return dataBufferFragmentCount_() > 0 || should_stop_.load(); });
+		if (dataBufferFragmentCount_() == 0 && check_stop()) return false;
 	}
 	else if (requestBuffer_ == nullptr)
 	{
@@ -821,23 +887,19 @@ bool artdaq::FragmentBuffer::applyRequests(artdaq::FragmentPtrs& frags)
 	{
 		if ((check_stop() && requestBuffer_->size() == 0)) return false;
 
-		std::unique_lock<std::mutex> lock(dataConditionMutex_);
-		dataCondition_.wait_for(lock, std::chrono::milliseconds(10));
-
 		checkDataBuffers();
 
-		// Wait up to 1000 ms for a request...
-		auto counter = 0;
-
-		while (requestBuffer_->size() == 0 && counter < 100)
+		// Wait for new data or a new request. Pending requests may be waiting for data to close their windows, or for a
+		// timeout to expire, so only wait long enough to check them again. Otherwise, wait up to 1000 ms for a request.
+		auto timeout = requestBuffer_->size() > 0 ? std::chrono::milliseconds(10) : std::chrono::milliseconds(1000);
 		{
-			if (check_stop()) return false;
-
-			checkDataBuffers();
-
-			requestBuffer_->WaitForRequests(10);  // milliseconds
-			counter++;
+			std::unique_lock<std::mutex> lock(dataConditionMutex_);
+			dataCondition_.wait_for(lock, timeout, [this]() { return dataUpdates_ != dataUpdatesSeen_; });
+			dataUpdatesSeen_ = dataUpdates_;
 		}
+		if (requestBuffer_->size() == 0 && check_stop()) return false;
+
+		checkDataBuffers();
 	}
 
 	if (systemFragmentCount_.load() > 0)
@@ -871,6 +933,7 @@ bool artdaq::FragmentBuffer::applyRequests(artdaq::FragmentPtrs& frags)
 	}
 
 	getDataBuffersStats();
+	notifyDataBufferDrained_();
 
 	if (frags.size() > 0)
 		TLOG(TLVL_APPLYREQUESTS) << "Finished Processing requests, returning " << frags.size() << " fragments, current ev_counter is " << next_sequence_id_;
@@ -6,6 +6,7 @@
 #include "TRACE/tracemf.h"  // Pre-empt TRACE/trace.h from Fragment.hh.
 #include "artdaq-core/Data/Fragment.hh"
 
+#include "artdaq/DAQdata/MetricHandle.hh"
 #include "artdaq/DAQrate/RequestBuffer.hh"
 
 namespace fhicl {
@@ -28,8 +29,11 @@ class ParameterSet;
 #include <chrono>
 #include <condition_variable>
 #include <list>
+#include <map>
 #include <mutex>
 #include <queue>
+#include <unordered_map>
+#include <vector>
 
 namespace artdaq {
 /**
@@ -171,7 +175,11 @@ public:
 	/**
 	 * @brief Inform the FragmentBuffer that it should stop
 	 */
-	void Stop() { should_stop_ = true; }
+	void Stop()
+	{
+		should_stop_ = true;
+		notifyDataUpdate_();
+	}
 
 	/**
 	 * @brief Reset the FragmentBuffer (flushes all Fragments from buffers)
@@ -355,8 +363,10 @@ public:
 	/**
 	 * @brief Set the pointer to the RequestBuffer used to retrieve requests
 	 * @param buffer Pointer to the RequestBuffer
+	 *
+	 * applyRequests is woken by the RequestBuffer when a request arrives
 	 */
-	void SetRequestBuffer(std::shared_ptr<RequestBuffer> buffer) { requestBuffer_ = buffer; }
+	void SetRequestBuffer(std::shared_ptr<RequestBuffer> buffer);
 
 	/**
 	 * @brief Get the next sequence ID expected by this FragmentBuffer. This is used to track sent windows and missed requests
@@ -403,6 +413,16 @@ protected:
 	size_t dataBufferFragmentCount_();
 
 private:
+	/**
+	 * \brief Wake applyRequests because new data, a new request, or a stop has arrived
+	 */
+	void notifyDataUpdate_();
+
+	/**
+	 * \brief Wake waitForDataBufferReady because Fragments have been removed from the data buffers
+	 */
+	void notifyDataBufferDrained_();
+
 	// FHiCL-configurable variables. Note that the C++ variable names
 	// are the FHiCL variable names with a "_" appended
 
@@ -426,6 +446,8 @@ private:
 
 	std::mutex dataConditionMutex_;
 	std::condition_variable dataCondition_;
+	uint64_t dataUpdates_;      // Protected by dataConditionMutex_
+	uint64_t dataUpdatesSeen_;  // Protected by dataConditionMutex_, the value of dataUpdates_ when applyRequests last woke
 	int maxDataBufferDepthFragments_;
 	size_t maxDataBufferDepthBytes_;
 
@@ -438,6 +460,35 @@ private:
 		Fragment::sequence_id_t HighestRequestSeen;
 		FragmentPtrs DataBuffer;
 		std::mutex DataBufferMutex;
+
+		// Window and SequenceID modes look Fragments up by timestamp or sequence ID instead of scanning DataBuffer.
+		// The indices hold iterators into DataBuffer, which stay valid until the Fragment is removed.
+		bool Indexed{false};
+		std::multimap<Fragment::timestamp_t, FragmentPtrs::iterator> TimestampIndex;
+		std::unordered_map<Fragment::sequence_id_t, std::vector<FragmentPtrs::iterator>> SequenceIDIndex;
+
+		/**
+		 * \brief Add a Fragment to the end of the buffer, updating the depth counters and indices
+		 * \param frag Fragment to add
+		 *
+		 * DataBufferMutex must be held
+		 */
+		void Append(FragmentPtr&& frag);
+		/**
+		 * \brief Remove a Fragment from the buffer, updating the depth counters and indices
+		 * \param it Iterator to the Fragment to remove
+		 * \param output If not nullptr, the Fragment is moved to the end of this list instead of being destroyed
+		 * \return Iterator to the Fragment following the removed one
+		 *
+		 * DataBufferMutex must be held
+		 */
+		FragmentPtrs::iterator Remove(FragmentPtrs::iterator it, FragmentPtrs* output = nullptr);
+		/**
+		 * \brief Remove all Fragments from the buffer
+		 *
+		 * DataBufferMutex must be held
+		 */
+		void Clear();
 	};
 
 	std::mutex systemFragmentMutex_;
@@ -447,6 +498,12 @@ private:
 	std::unordered_map<artdaq::Fragment::fragment_id_t, std::shared_ptr<DataBuffer>> dataBuffers_;
 
 	std::atomic<bool> should_stop_;
+
+	MetricHandle depth_fragments_metric_;
+	MetricHandle depth_bytes_metric_;
+	MetricHandle full_fragments_metric_;
+	MetricHandle full_bytes_metric_;
+	MetricHandle full_metric_;
 };
 }  // namespace artdaq
 
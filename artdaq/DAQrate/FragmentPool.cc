@@ -0,0 +1,156 @@
+#include "artdaq/DAQdata/Globals.hh"
+#define TRACE_NAME (app_name + "_FragmentPool").c_str()  // include these 2 first -
+
+#include "artdaq/DAQrate/FragmentPool.hh"
+
+#include "fhiclcpp/ParameterSet.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+constexpr size_t max_tracked_fragments = 65536;  // Fragments from Get which are never recycled leave stale entries behind
+
+size_t floor_log2(size_t n)
+{
+	size_t result = 0;
+	while (n >>= 1)
+	{
+		++result;
+	}
+	return result;
+}
+
+size_t ceil_log2(size_t n) { return n <= 1 ? 0 : floor_log2(n - 1) + 1; }
+}  // namespace
+
+artdaq::FragmentPool::FragmentPool(fhicl::ParameterSet const& ps)
+    : FragmentPool(ps.get<size_t>("fragment_pool_max_fragments_per_size", 64), ps.get<size_t>("fragment_pool_max_mb", 256) * 1024 * 1024)
+{}
+
+artdaq::FragmentPool::FragmentPool(size_t max_fragments_per_size, size_t max_bytes)
+    : max_fragments_per_size_(max_fragments_per_size)
+    , max_bytes_(max_bytes)
+    , idle_bytes_(0)
+    , hits_(0)
+    , misses_(0)
+    , header_template_()
+{
+	TLOG(TLVL_DEBUG + 32) << "FragmentPool CONSTRUCTOR: max_fragments_per_size=" << max_fragments_per_size_ << ", max_bytes=" << max_bytes_;
+}
+
+artdaq::FragmentPtr artdaq::FragmentPool::Get(size_t payload_words, Fragment::sequence_id_t sequence_id, Fragment::fragment_id_t fragment_id,
+                                              Fragment::type_t type, Fragment::timestamp_t timestamp)
+{
+	auto header_words = detail::RawFragmentHeader::num_words();
+	auto size_class = ceil_log2(payload_words + header_words);
+	if (size_class < min_size_class_ || size_class >= size_class_count_)
+	{
+		auto frag = std::make_unique<Fragment>(sequence_id, fragment_id, type, timestamp);
+		frag->resize(payload_words);
+		return frag;
+	}
+	auto capacity = static_cast<size_t>(1) << size_class;
+
+	FragmentPtr frag;
+	{
+		std::lock_guard<std::mutex> lk(mutex_);
+		auto& idle = idle_[size_class];
+		if (!idle.empty())
+		{
+			frag = std::move(idle.back());
+			idle.pop_back();
+			idle_bytes_ -= capacity * sizeof(RawDataType);
+			capacities_[frag.get()] = capacity;
+		}
+	}
+
+	if (frag != nullptr)
+	{
+		++hits_;
+		// Resetting the header also drops any metadata, so that resize sizes the payload only
+		memcpy(frag->headerAddress(), header_template_.headerAddress(), header_words * sizeof(RawDataType));
+		frag->resize(payload_words);
+		frag->setSequenceID(sequence_id);
+		frag->setFragmentID(fragment_id);
+		if (Fragment::isUserFragmentType(type))
+		{
+			frag->setUserType(type);
+		}
+		else
+		{
+			frag->setSystemType(type);
+		}
+		frag->setTimestamp(timestamp);
+		frag->touch();
+		return frag;
+	}
+
+	++misses_;
+	TLOG(TLVL_DEBUG + 33) << "Get: Allocating new Fragment of " << capacity << " words for payload of " << payload_words << " words";
+	frag = std::make_unique<Fragment>(sequence_id, fragment_id, type, timestamp);
+	frag->resize(capacity - header_words, 0);  // Fault in the whole size class now, instead of while the generator fills it
+	frag->resize(payload_words);
+
+	std::lock_guard<std::mutex> lk(mutex_);
+	if (capacities_.size() >= max_tracked_fragments)
+	{
+		TLOG(TLVL_DEBUG + 33) << "Get: " << capacities_.size() << " Fragments handed out and not recycled, forgetting their sizes";
+		capacities_.clear();
+	}
+	capacities_[frag.get()] = capacity;
+	return frag;
+}
+
+void artdaq::FragmentPool::Recycle(FragmentPtr frag)
+{
+	if (frag == nullptr)
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lk(mutex_);
+	size_t capacity = frag->size();
+	auto it = capacities_.find(frag.get());
+	if (it != capacities_.end())
+	{
+		capacity = std::max(capacity, it->second);
+		capacities_.erase(it);
+	}
+	if (frag->headerAddress() == nullptr)
+	{
+		return;  // Moved from, e.g. by a transfer plugin which had to keep the buffer
+	}
+
+	// A Fragment goes in the largest size class that its capacity fills, so that Get can always reuse it without growing it
+	auto size_class = floor_log2(capacity);
+	if (size_class < min_size_class_ || size_class >= size_class_count_)
+	{
+		return;
+	}
+	auto bytes = (static_cast<size_t>(1) << size_class) * sizeof(RawDataType);
+	if (idle_[size_class].size() >= max_fragments_per_size_ || idle_bytes_ + bytes > max_bytes_)
+	{
+		TLOG(TLVL_DEBUG + 34) << "Recycle: Pool is full, freeing Fragment of " << capacity << " words";
+		return;  // frag is freed after the lock is released
+	}
+	idle_bytes_ += bytes;
+	idle_[size_class].push_back(std::move(frag));
+}
+
+size_t artdaq::FragmentPool::IdleCount() const
+{
+	std::lock_guard<std::mutex> lk(mutex_);
+	size_t count = 0;
+	for (auto& idle : idle_)
+	{
+		count += idle.size();
+	}
+	return count;
+}
+
+size_t artdaq::FragmentPool::IdleBytes() const
+{
+	std::lock_guard<std::mutex> lk(mutex_);
+	return idle_bytes_;
+}
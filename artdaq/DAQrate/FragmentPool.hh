@@ -0,0 +1,130 @@
+#ifndef artdaq_DAQrate_FragmentPool_hh
+#define artdaq_DAQrate_FragmentPool_hh
+
+#include "TRACE/tracemf.h"  // Pre-empt TRACE/trace.h from Fragment.hh.
+#include "artdaq-core/Data/Fragment.hh"
+
+#include "fhiclcpp/types/Atom.h"
+#include "fhiclcpp/types/Comment.h"
+#include "fhiclcpp/types/ConfigurationTable.h"
+#include "fhiclcpp/types/Name.h"
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace fhicl {
+class ParameterSet;
+}
+
+namespace artdaq {
+/**
+ * \brief A bounded pool of Fragments, sorted into power-of-two size classes, whose memory is reused instead of freed
+ *
+ * Get returns a Fragment with the requested payload size, reusing an idle Fragment of the same size class if there
+ * is one. Fragments allocated by the pool are grown to the full size of their class and zero-filled once, so that
+ * their pages are already faulted in when the generator fills them. Recycle hands a Fragment back once its contents
+ * are no longer needed; it is freed instead if its size class, or the pool as a whole, is full.
+ *
+ * The payload of a reused Fragment is not cleared. Fragments smaller than one page are not pooled.
+ */
+class FragmentPool
+{
+public:
+	/// <summary>
+	/// Configuration of the FragmentPool. May be used for parameter validation
+	/// </summary>
+	struct Config
+	{
+		/// "fragment_pool_max_fragments_per_size" (Default: 64) : Maximum number of idle Fragments kept in each power-of-two size class
+		fhicl::Atom<size_t> max_fragments_per_size{fhicl::Name{"fragment_pool_max_fragments_per_size"}, fhicl::Comment{"Maximum number of idle Fragments kept in each power-of-two size class"}, 64};
+		/// "fragment_pool_max_mb" (Default: 256) : Maximum total size of the idle Fragments kept by the pool, in MB
+		fhicl::Atom<size_t> max_mb{fhicl::Name{"fragment_pool_max_mb"}, fhicl::Comment{"Maximum total size of the idle Fragments kept by the pool, in MB"}, 256};
+	};
+	/// Used for ParameterSet validation (if desired)
+	using Parameters = fhicl::WrappedTable<Config>;
+
+	/**
+	 * \brief FragmentPool Constructor
+	 * \param ps ParameterSet used to configure the FragmentPool. See artdaq::FragmentPool::Config
+	 */
+	explicit FragmentPool(fhicl::ParameterSet const& ps);
+
+	/**
+	 * \brief FragmentPool Constructor
+	 * \param max_fragments_per_size Maximum number of idle Fragments kept in each size class
+	 * \param max_bytes Maximum total size of the idle Fragments kept by the pool
+	 */
+	FragmentPool(size_t max_fragments_per_size, size_t max_bytes);
+
+	/**
+	 * \brief Get a Fragment with the given header fields and payload size
+	 * \param payload_words Size of the payload, in RawDataType words
+	 * \param sequence_id Sequence ID of the Fragment
+	 * \param fragment_id Fragment ID of the Fragment
+	 * \param type Type of the Fragment
+	 * \param timestamp Timestamp of the Fragment
+	 * \return A Fragment without metadata, whose payload contents are unspecified
+	 */
+	FragmentPtr Get(size_t payload_words, Fragment::sequence_id_t sequence_id, Fragment::fragment_id_t fragment_id,
+	                Fragment::type_t type = Fragment::DataFragmentType, Fragment::timestamp_t timestamp = Fragment::InvalidTimestamp);
+
+	/**
+	 * \brief Return a Fragment to the pool. Fragments which did not come from Get may also be recycled.
+	 * \param frag Fragment to recycle. Fragments which have been moved from are discarded.
+	 */
+	void Recycle(FragmentPtr frag);
+
+	/**
+	 * \brief Get the number of idle Fragments in the pool
+	 * \return The number of idle Fragments in the pool
+	 */
+	size_t IdleCount() const;
+
+	/**
+	 * \brief Get the total size of the idle Fragments in the pool
+	 * \return The total size of the idle Fragments in the pool, in bytes
+	 */
+	size_t IdleBytes() const;
+
+	/**
+	 * \brief Get the number of calls to Get which reused an idle Fragment
+	 * \return The number of calls to Get which reused an idle Fragment
+	 */
+	size_t HitCount() const { return hits_.load(); }
+
+	/**
+	 * \brief Get the number of calls to Get which allocated a new Fragment
+	 * \return The number of calls to Get which allocated a new Fragment
+	 */
+	size_t MissCount() const { return misses_.load(); }
+
+private:
+	FragmentPool(FragmentPool const&) = delete;
+	FragmentPool(FragmentPool&&) = delete;
+	FragmentPool& operator=(FragmentPool const&) = delete;
+	FragmentPool& operator=(FragmentPool&&) = delete;
+
+	static constexpr size_t min_size_class_ = 9;     // 512 words (one 4 KiB page)
+	static constexpr size_t size_class_count_ = 40;  // Up to 2^39 words
+
+	size_t max_fragments_per_size_;
+	size_t max_bytes_;
+
+	mutable std::mutex mutex_;
+	std::array<std::vector<FragmentPtr>, size_class_count_> idle_;
+	size_t idle_bytes_;
+	// Capacity, in words, of the Fragments handed out by Get. Fragment does not report its capacity, and its size
+	// when it is recycled may be well below the size class it was allocated for.
+	std::unordered_map<Fragment const*, size_t> capacities_;
+
+	std::atomic<size_t> hits_;
+	std::atomic<size_t> misses_;
+
+	Fragment header_template_;  // Copied over the header of reused Fragments
+};
+}  // namespace artdaq
+
+#endif  // artdaq_DAQrate_FragmentPool_hh
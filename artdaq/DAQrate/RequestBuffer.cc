@@ -19,30 +19,33 @@ artdaq::RequestBuffer::~RequestBuffer() {}
 
 void artdaq::RequestBuffer::push(artdaq::Fragment::sequence_id_t seq, artdaq::Fragment::timestamp_t ts)
 {
-	std::lock_guard<std::mutex> tlk(request_mutex_);
-	if (requests_.count(seq) && requests_[seq] != ts)
-	{
-		TLOG(TLVL_ERROR) << "Received conflicting request for SeqID "
-		                 << seq << "!"
-		                 << " Old ts=" << requests_[seq]
-		                 << ", new ts=" << ts << ". Keeping OLD!";
-	}
-	else if (!requests_.count(seq))
 	{
-		int delta = seq - highest_seen_request_;
-		TLOG(TLVL_DEBUG + 36) << "Received request for sequence ID " << seq
-		                      << " and timestamp " << ts << " (delta: " << delta << ")";
-		if (delta <= 0 || out_of_order_requests_.count(seq))
+		std::lock_guard<std::mutex> tlk(request_mutex_);
+		if (requests_.count(seq) && requests_[seq] != ts)
 		{
-			TLOG(TLVL_DEBUG + 36) << "Already serviced this request ( sequence ID " << seq << ")! Ignoring...";
+			TLOG(TLVL_ERROR) << "Received conflicting request for SeqID "
+			                 << seq << "!"
+			                 << " Old ts=" << requests_[seq]
+			                 << ", new ts=" << ts << ". Keeping OLD!";
 		}
-		else
+		else if (!requests_.count(seq))
 		{
-			requests_[seq] = ts;
-			request_timing_[seq] = std::chrono::steady_clock::now();
+			int delta = seq - highest_seen_request_;
+			TLOG(TLVL_DEBUG + 36) << "Received request for sequence ID " << seq
+			                      << " and timestamp " << ts << " (delta: " << delta << ")";
+			if (delta <= 0 || out_of_order_requests_.count(seq))
+			{
+				TLOG(TLVL_DEBUG + 36) << "Already serviced this request ( sequence ID " << seq << ")! Ignoring...";
+			}
+			else
+			{
+				requests_[seq] = ts;
+				request_timing_[seq] = std::chrono::steady_clock::now();
+			}
 		}
+		request_cv_.notify_all();
 	}
-	request_cv_.notify_all();
+	notify_update_();
 }
 
 void artdaq::RequestBuffer::reset()
@@ -194,3 +197,24 @@ std::chrono::steady_clock::time_point artdaq::RequestBuffer::GetRequestTime(artd
 	std::lock_guard<std::mutex> lk(request_mutex_);
 	return request_timing_.count(reqID) ? request_timing_[reqID] : std::chrono::steady_clock::now();
 }
+
+void artdaq::RequestBuffer::setRunning(bool running)
+{
+	receiver_running_ = running;
+	notify_update_();
+}
+
+void artdaq::RequestBuffer::SetUpdateCallback(std::function<void()> callback)
+{
+	std::lock_guard<std::mutex> lk(callback_mutex_);
+	update_callback_ = std::move(callback);
+}
+
+void artdaq::RequestBuffer::notify_update_()
+{
+	std::lock_guard<std::mutex> lk(callback_mutex_);
+	if (update_callback_)
+	{
+		update_callback_();
+	}
+}
@@ -5,7 +5,9 @@
 #include "artdaq-core/Data/Fragment.hh"
 
 #include <condition_variable>
+#include <functional>
 #include <map>
+#include <mutex>
 #include <set>
 
 namespace artdaq {
@@ -96,9 +98,20 @@ public:
 	 * @brief Set whether the RequestBuffer is active
 	 * @param running Whether the RequestBuffer is active
 	 */
-	void setRunning(bool running) { receiver_running_ = running; }
+	void setRunning(bool running);
+
+	/**
+	 * @brief Set a function to be called whenever a request is added or the running state changes
+	 * @param callback Function to call, or nullptr to remove the current callback
+	 *
+	 * The callback is called without request_mutex_ held, so it may call back into the RequestBuffer.
+	 * SetUpdateCallback does not return while the previous callback is being called.
+	 */
+	void SetUpdateCallback(std::function<void()> callback);
 
 private:
+	void notify_update_();
+
 	std::map<artdaq::Fragment::sequence_id_t, artdaq::Fragment::timestamp_t> requests_;
 	std::map<artdaq::Fragment::sequence_id_t, std::chrono::steady_clock::time_point> request_timing_;
 	std::atomic<artdaq::Fragment::sequence_id_t> highest_seen_request_;
@@ -109,6 +122,9 @@ private:
 	std::condition_variable request_cv_;
 
 	std::atomic<bool> receiver_running_;
+
+	std::mutex callback_mutex_;
+	std::function<void()> update_callback_;
 };
 }  // namespace artdaq
 
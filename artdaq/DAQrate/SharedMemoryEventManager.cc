@@ -2,6 +2,7 @@
 #include "artdaq/DAQrate/SharedMemoryEventManager.hh"
 #include <sys/wait.h>
 
+#include <algorithm>
 #include <memory>
 #include <numeric>
 
@@ -15,7 +16,6 @@
 
 #define build_key(seed) ((seed) + ((GetPartitionNumber() + 1) << 16) + (getpid() & 0xFFFF))
 
-std::mutex artdaq::SharedMemoryEventManager::sequence_id_mutex_;
 std::mutex artdaq::SharedMemoryEventManager::subrun_event_map_mutex_;
 const std::string artdaq::SharedMemoryEventManager::
     FRAGMENTS_RECEIVED_STAT_KEY("SharedMemoryEventManagerFragmentsReceived");
@@ -40,6 +40,15 @@ artdaq::SharedMemoryEventManager::SharedMemoryEventManager(const fhicl::Paramete
     , init_fragment_count_(pset.get<size_t>("init_fragment_count", pset.get<bool>("send_init_fragments", true) ? 1 : 0))
     , running_(false)
     , buffer_writes_pending_()
+    , stale_buffer_timeout_usec_(pset.get<size_t>("stale_buffer_timeout_usec", pset.get<size_t>("event_queue_wait_time", 5) * 1000000))
+    , buffer_touch_times_(pset.get<size_t>("buffer_count"))
+    , stale_buffer_deadlines_(pset.get<size_t>("buffer_count"), 0)
+    , metric_update_interval_ms_(pset.get<size_t>("metric_update_interval_ms", 1000))
+    , last_metric_update_time_(std::chrono::steady_clock::now())
+    , metric_event_count_(0)
+    , metric_event_size_(0.0)
+    , metric_event_time_(0.0)
+    , recent_event_time_s_(0.0)
     , open_event_report_interval_ms_(pset.get<int>("open_event_report_interval_ms", pset.get<int>("incomplete_event_report_interval_ms", -1)))
     , last_open_event_report_time_(std::chrono::steady_clock::now())
     , last_backpressure_report_time_(std::chrono::steady_clock::now())
@@ -60,6 +69,9 @@ artdaq::SharedMemoryEventManager::SharedMemoryEventManager(const fhicl::Paramete
     , art_process_index_offset_(pset.get<size_t>("art_index_offset", 0))
     , minimum_art_lifetime_s_(pset.get<double>("minimum_art_lifetime_s", 2.0))
     , art_event_processing_time_us_(pset.get<size_t>("expected_art_event_processing_time_us", 1000000))
+    , prestart_art_(pset.get<bool>("prestart_art_processes", false))
+    , art_prestarted_(false)
+    , prestarted_art_count_(0)
     , requests_(nullptr)
     , tokens_(nullptr)
     , data_pset_(pset)
@@ -108,6 +120,7 @@ artdaq::SharedMemoryEventManager::SharedMemoryEventManager(const fhicl::Paramete
 	{
 		throw cet::exception(app_name + "_SharedMemoryEventManager") << "Unable to attach to Shared Memory!";  // NOLINT(cert-err60-cpp)
 	}
+	buffer_wakeup_ = std::make_unique<detail::ShmemWakeup>(GetKey(), true);
 
 	TLOG(TLVL_DEBUG + 33) << "Setting Writer rank to " << my_rank;
 	SetRank(my_rank);
@@ -125,7 +138,7 @@ artdaq::SharedMemoryEventManager::SharedMemoryEventManager(const fhicl::Paramete
 artdaq::SharedMemoryEventManager::~SharedMemoryEventManager()
 {
 	TLOG(TLVL_DEBUG + 33) << "DESTRUCTOR";
-	if (running_)
+	if (running_ || art_prestarted_)
 	{
 		try
 		{
@@ -166,6 +179,7 @@ bool artdaq::SharedMemoryEventManager::AddFragment(detail::RawFragmentHeader fra
 
 	TLOG(TLVL_DEBUG + 33) << "AddFragment before Write calls";
 	Write(buffer, dataPtr, frag.word_count * sizeof(RawDataType));
+	touch_buffer_(buffer);
 
 	TLOG(TLVL_DEBUG + 33) << "Checking for complete event";
 	auto fragmentCount = GetFragmentCount(frag.sequence_id);
@@ -266,6 +280,7 @@ artdaq::RawDataType* artdaq::SharedMemoryEventManager::WriteFragmentHeader(detai
 
 	auto hdrpos = reinterpret_cast<RawDataType*>(GetWritePos(buffer));  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
 	Write(buffer, &frag, frag.num_words() * sizeof(RawDataType));
+	touch_buffer_(buffer);
 
 	auto pos = reinterpret_cast<RawDataType*>(GetWritePos(buffer));  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
 	if (frag.word_count - frag.num_words() > 0)
@@ -342,6 +357,7 @@ void artdaq::SharedMemoryEventManager::DoneWritingFragment(detail::RawFragmentHe
 
 		TLOG(TLVL_DEBUG + 33) << "DoneWritingFragment: Updating buffer touch time";
 		TouchBuffer(buffer);
+		touch_buffer_(buffer);
 
 		if (buffer_writes_pending_[buffer] > 1)
 		{
@@ -379,6 +395,20 @@ void artdaq::SharedMemoryEventManager::DoneWritingFragment(detail::RawFragmentHe
 	TLOG(TLVL_DEBUG + 33) << "DoneWritingFragment END";
 }
 
+bool artdaq::SharedMemoryEventManager::WaitForBuffer(Fragment::sequence_id_t seqID, size_t timeout_usec)
+{
+	return buffer_wakeup_->WaitForSpace(
+	    [this, seqID] {
+		    if (WriteReadyCount(overwrite_mode_) > 0)
+		    {
+			    return true;
+		    }
+		    std::lock_guard<std::mutex> lk(sequence_id_mutex_);
+		    return sequence_id_buffers_.count(seqID) != 0u;
+	    },
+	    timeout_usec);
+}
+
 size_t artdaq::SharedMemoryEventManager::GetFragmentCount(Fragment::sequence_id_t seqID, Fragment::type_t type)
 {
 	return GetFragmentCountInBuffer(getBufferForSequenceID_(seqID, false), type);
@@ -793,9 +823,82 @@ void artdaq::SharedMemoryEventManager::ReconfigureArt(fhicl::ParameterSet art_ps
 	TLOG(TLVL_DEBUG + 32) << "ReconfigureArt END";
 }
 
+void artdaq::SharedMemoryEventManager::PrestartArt()
+{
+	if (!prestart_art_ || manual_art_ || num_art_processes_ == 0 || running_ || art_prestarted_)
+	{
+		return;
+	}
+	if (get_art_process_count_() > 0)
+	{
+		TLOG(TLVL_WARNING) << "PrestartArt: " << get_art_process_count_() << " art processes are still running, not starting the art processes for the next run";
+		return;
+	}
+
+	TLOG(TLVL_INFO) << "Starting " << num_art_processes_ << " art processes ahead of the next run";
+	// The EndOfData Fragment of the last run would make the new processes exit immediately
+	for (size_t ii = 0; ii < broadcasts_.size(); ++ii)
+	{
+		broadcasts_.MarkBufferEmpty(ii, true);
+	}
+	restart_art_ = always_restart_art_;
+	prestarted_art_pset_ = current_art_pset_;
+	prestarted_art_count_ = num_art_processes_;
+	art_prestart_time_ = std::chrono::steady_clock::now();
+	for (size_t ii = 0; ii < num_art_processes_; ++ii)
+	{
+		// Unlike StartArtProcess, do not wait for the process to attach; that is the time being saved
+		std::shared_ptr<std::atomic<pid_t>> pid(new std::atomic<pid_t>(-1));
+		boost::thread thread([this, ii, pid] { RunArt(ii, pid); });
+		thread.detach();
+	}
+	art_prestarted_ = true;
+}
+
+bool artdaq::SharedMemoryEventManager::use_prestarted_art_()
+{
+	if (!art_prestarted_.exchange(false))
+	{
+		return false;
+	}
+
+	std::string reason;
+	if (current_art_pset_ != prestarted_art_pset_)
+	{
+		reason = "the art configuration has changed";
+	}
+	else if (num_art_processes_ != prestarted_art_count_)
+	{
+		reason = "the number of art processes has changed";
+	}
+	else if (get_art_process_count_() != prestarted_art_count_)
+	{
+		reason = "only " + std::to_string(get_art_process_count_()) + " of them are running";
+	}
+
+	if (reason.empty())
+	{
+		TLOG(TLVL_INFO) << "Using " << prestarted_art_count_ << " art processes started " << std::setprecision(2) << std::fixed
+		                << TimeUtils::GetElapsedTime(art_prestart_time_) << " seconds before the run";
+		return true;
+	}
+
+	TLOG(TLVL_INFO) << "Not using the pre-started art processes because " << reason << ", starting new ones";
+	FragmentPtrs broadcast;
+	broadcast.emplace_back(Fragment::eodFrag(0));
+	broadcastFragments_(broadcast);
+	while (get_art_process_count_() > 0)
+	{
+		ShutdownArtProcesses(art_processes_);
+	}
+	ResetAttachedCount();
+	return false;
+}
+
 bool artdaq::SharedMemoryEventManager::endOfData()
 {
 	running_ = false;
+	art_prestarted_ = false;
 	init_fragments_.clear();
 	received_init_frags_.clear();
 	TLOG(TLVL_DEBUG + 32) << "SharedMemoryEventManager::endOfData";
@@ -874,9 +977,18 @@ bool artdaq::SharedMemoryEventManager::endOfData()
 	ResetAttachedCount();
 
 	TLOG(TLVL_DEBUG + 32) << "endOfData: Clearing buffers";
-	for (size_t ii = 0; ii < size(); ++ii)
 	{
-		MarkBufferEmpty(ii, true);
+		std::unique_lock<std::mutex> lk(sequence_id_mutex_);
+		for (size_t ii = 0; ii < size(); ++ii)
+		{
+			MarkBufferEmpty(ii, true);
+		}
+		buffer_wakeup_->NotifySpace();
+		sequence_id_buffers_.clear();
+		active_buffers_.clear();
+		pending_buffers_ = decltype(pending_buffers_)();
+		stale_buffer_timers_.clear();
+		std::fill(stale_buffer_deadlines_.begin(), stale_buffer_deadlines_.end(), 0);
 	}
 	// ELF 06/04/2018: Cannot clear broadcasts here, we want the EndOfDataFragment to persist until it's time to start art again...
 	// TLOG(TLVL_DEBUG + 33) << "endOfData: Clearing broadcast buffers";
@@ -898,14 +1010,22 @@ void artdaq::SharedMemoryEventManager::startRun(run_id_t runID)
 	init_fragments_.clear();
 	received_init_frags_.clear();
 	statsHelper_.resetStatistics();
-	TLOG(TLVL_DEBUG + 33) << "startRun: Clearing broadcast buffers";
-	for (size_t ii = 0; ii < broadcasts_.size(); ++ii)
+	// Pre-started art processes may not have read the broadcasts sent when they were started yet
+	auto art_prestarted = use_prestarted_art_();
+	if (!art_prestarted)
 	{
-		broadcasts_.MarkBufferEmpty(ii, true);
+		TLOG(TLVL_DEBUG + 33) << "startRun: Clearing broadcast buffers";
+		for (size_t ii = 0; ii < broadcasts_.size(); ++ii)
+		{
+			broadcasts_.MarkBufferEmpty(ii, true);
+		}
 	}
 	released_events_.clear();
 	released_incomplete_events_.clear();
-	StartArt();
+	if (!art_prestarted)
+	{
+		StartArt();
+	}
 	run_id_ = runID;
 	{
 		std::unique_lock<std::mutex> lk(subrun_event_map_mutex_);
@@ -926,6 +1046,7 @@ void artdaq::SharedMemoryEventManager::startRun(run_id_t runID)
 		{
 			tokens_ = std::make_unique<TokenSender>(rmPset);
 			tokens_->SetRunNumber(static_cast<uint32_t>(run_id_));
+			tokens_->SetLoad(queue_size_, ReadReadyCount(), 0);
 			tokens_->SendRoutingToken(queue_size_, run_id_);
 		}
 	}
@@ -1127,15 +1248,18 @@ int artdaq::SharedMemoryEventManager::getBufferForSequenceID_(Fragment::sequence
 
 	TLOG(TLVL_DEBUG + 34) << "getBufferForSequenceID obtained sequence_id_mutex for seqid=" << seqID;
 
-	auto buffers = GetBuffersOwnedByManager();
-	for (auto& buf : buffers)
+	auto buffer_it = sequence_id_buffers_.find(seqID);
+	if (buffer_it != sequence_id_buffers_.end())
 	{
-		auto hdr = getEventHeader_(buf);
-		if (hdr->sequence_id == seqID)
+		auto buf = buffer_it->second;
+		if (getEventHeader_(buf)->sequence_id == seqID)
 		{
 			TLOG(TLVL_DEBUG + 34) << "getBufferForSequenceID " << seqID << " returning " << buf;
 			return buf;
 		}
+		// Buffer has been reused without going through the release path, drop the stale entry
+		TLOG(TLVL_WARNING) << "getBufferForSequenceID: Buffer " << buf << " no longer contains sequence ID " << seqID << ", removing it from the index";
+		sequence_id_buffers_.erase(buffer_it);
 	}
 
 #if !ART_SUPPORTS_DUPLICATE_EVENTS
@@ -1173,6 +1297,8 @@ int artdaq::SharedMemoryEventManager::getBufferForSequenceID_(Fragment::sequence
 	TLOG(TLVL_BUFLCK) << "getBufferForSequenceID_: obtained buffer_mutexes lock for buffer " << new_buffer;
 
 	event_timing_[new_buffer] = std::chrono::steady_clock::now();
+	touch_buffer_(new_buffer);
+	arm_stale_buffer_timer_(new_buffer, buffer_touch_times_[new_buffer] + stale_buffer_timeout_usec_);
 
 	auto hdr = getEventHeader_(new_buffer);
 	hdr->is_complete = false;
@@ -1187,6 +1313,8 @@ int artdaq::SharedMemoryEventManager::getBufferForSequenceID_(Fragment::sequence
 
 	TLOG(TLVL_BUFFER) << "getBufferForSequenceID placing " << new_buffer << " to active.";
 	active_buffers_.insert(new_buffer);
+	sequence_id_buffers_[seqID] = new_buffer;
+	buffer_wakeup_->NotifySpace();  // Receivers waiting to write Fragments of this event can proceed
 	TLOG(TLVL_BUFFER) << "Buffer occupancy now (total,full,reading,empty,pending,active)=("
 	                  << size() << ","
 	                  << ReadReadyCount() << ","
@@ -1231,8 +1359,11 @@ void artdaq::SharedMemoryEventManager::complete_buffer_(int buffer)
 			TLOG(TLVL_BUFLCK) << "complete_buffer_: obtaining sequence_id_mutex lock for seqid=" << hdr->sequence_id;
 			std::unique_lock<std::mutex> lk(sequence_id_mutex_);
 			TLOG(TLVL_BUFLCK) << "complete_buffer_: obtained sequence_id_mutex lock for seqid=" << hdr->sequence_id;
-			active_buffers_.erase(buffer);
-			pending_buffers_.insert(buffer);
+			if (active_buffers_.erase(buffer) != 0u)
+			{
+				disarm_stale_buffer_timer_(buffer);
+				pending_buffers_.emplace(hdr->sequence_id, buffer);
+			}
 			released_events_.insert(hdr->sequence_id);
 			while (released_events_.size() > max_event_list_length_)
 			{
@@ -1272,60 +1403,15 @@ void artdaq::SharedMemoryEventManager::check_pending_buffers_(std::unique_lock<s
 {
 	TLOG(TLVL_DEBUG + 34) << "check_pending_buffers_ BEGIN Locked=" << std::boolalpha << lock.owns_lock();
 
-	auto buffers = GetBuffersOwnedByManager();
-	for (auto buf : buffers)
-	{
-		if (ResetBuffer(buf) && (pending_buffers_.count(buf) == 0u))
-		{
-			TLOG(TLVL_DEBUG + 36) << "check_pending_buffers_ Incomplete buffer detected, buf=" << buf << " active_bufers_.count(buf)=" << active_buffers_.count(buf) << " buffer_writes_pending_[buf]=" << buffer_writes_pending_[buf].load();
-			auto hdr = getEventHeader_(buf);
-			if ((active_buffers_.count(buf) != 0u) && buffer_writes_pending_[buf].load() == 0)
-			{
-				if (requests_)
-				{
-					requests_->RemoveRequest(hdr->sequence_id);
-				}
-				TLOG(TLVL_BUFFER) << "check_pending_buffers_ moving buffer " << buf << " from active to pending";
-				active_buffers_.erase(buf);
-				pending_buffers_.insert(buf);
-				TLOG(TLVL_BUFFER) << "Buffer occupancy now (total,full,reading,empty,pending,active)=("
-				                  << size() << ","
-				                  << ReadReadyCount() << ","
-				                  << WriteReadyCount(true) - WriteReadyCount(false) - ReadReadyCount() << ","
-				                  << WriteReadyCount(false) << ","
-				                  << pending_buffers_.size() << ","
-				                  << active_buffers_.size() << ")";
-
-				run_incomplete_event_count_++;
-				if (metricMan)
-				{
-					metricMan->sendMetric("Incomplete Event Rate", 1, "events/s", 3, MetricMode::Rate);
-				}
-				if (released_incomplete_events_.count(hdr->sequence_id) == 0u)
-				{
-					released_incomplete_events_[hdr->sequence_id] = num_fragments_per_event_ - GetFragmentCountInBuffer(buf);
-				}
-				else
-				{
-					released_incomplete_events_[hdr->sequence_id] -= GetFragmentCountInBuffer(buf);
-				}
-
-				TLOG(TLVL_WARNING) << "Event " << hdr->sequence_id
-				                   << " was opened " << TimeUtils::GetElapsedTime(event_timing_[buf]) << " s ago"
-				                   << " and has timed out (missing " << released_incomplete_events_[hdr->sequence_id] << " Fragments)."
-				                   << "Scheduling release to art.";
-			}
-		}
-	}
-
-	std::list<int> sorted_buffers(pending_buffers_.begin(), pending_buffers_.end());
-	sorted_buffers.sort([this](int a, int b) { return bufferComparator(a, b); });
+	check_stale_buffers_();
 
-	auto counter = 0;
-	double eventSize = 0;
-	double eventTime = 0;
-	for (auto buf : sorted_buffers)
+	// In overwrite mode, Full buffers can be written
+	auto notify_writers = overwrite_mode_ && !pending_buffers_.empty();
+	while (!pending_buffers_.empty())
 	{
+		auto buf = pending_buffers_.top().second;
+		pending_buffers_.pop();
+
 		auto hdr = getEventHeader_(buf);
 		auto thisEventSize = BufferDataSize(buf);
 
@@ -1334,12 +1420,14 @@ void artdaq::SharedMemoryEventManager::check_pending_buffers_(std::unique_lock<s
 		statsHelper_.addSample(EVENTS_RELEASED_STAT_KEY, thisEventSize);
 
 		TLOG(TLVL_BUFFER) << "check_pending_buffers_ removing buffer " << buf << " moving from pending to full";
+		sequence_id_buffers_.erase(hdr->sequence_id);
 		MarkBufferFull(buf);
 		run_event_count_++;
-		counter++;
-		eventSize += thisEventSize;
-		eventTime += TimeUtils::GetElapsedTime(event_timing_[buf]);
-		pending_buffers_.erase(buf);
+		metric_event_count_++;
+		metric_event_size_ += thisEventSize;
+		auto event_time = TimeUtils::GetElapsedTime(event_timing_[buf]);
+		metric_event_time_ += event_time;
+		recent_event_time_s_ += (event_time - recent_event_time_s_) / 16.0;
 		TLOG(TLVL_BUFFER) << "Buffer occupancy now (total,full,reading,empty,pending,active)=("
 		                  << size() << ","
 		                  << ReadReadyCount() << ","
@@ -1348,6 +1436,10 @@ void artdaq::SharedMemoryEventManager::check_pending_buffers_(std::unique_lock<s
 		                  << pending_buffers_.size() << ","
 		                  << active_buffers_.size() << ")";
 	}
+	if (notify_writers)
+	{
+		buffer_wakeup_->NotifySpace();
+	}
 
 	if (tokens_ && tokens_->RoutingTokenSendsEnabled())
 	{
@@ -1362,12 +1454,12 @@ void artdaq::SharedMemoryEventManager::check_pending_buffers_(std::unique_lock<s
 		{
 			auto tokens_to_send = available_buffers - outstanding_tokens;
 
-			while (tokens_to_send > 0)
+			TLOG(TLVL_DEBUG + 35) << "check_pending_buffers_: Sending Routing Token for " << tokens_to_send << " slots";
+			if (tokens_->LoadReportsEnabled())
 			{
-				TLOG(35) << "check_pending_buffers_: Sending a Routing Token";
-				tokens_->SendRoutingToken(1, run_id_);
-				tokens_to_send--;
+				tokens_->SetLoad(available_buffers, ReadReadyCount(), static_cast<unsigned>(recent_event_time_s_ * 1000000));
 			}
+			tokens_->SendRoutingToken(tokens_to_send, run_id_);
 		}
 	}
 
@@ -1377,58 +1469,151 @@ void artdaq::SharedMemoryEventManager::check_pending_buffers_(std::unique_lock<s
 		TLOG(TLVL_INFO) << statString;
 	}
 
-	if (metricMan)
+	if (metricMan && TimeUtils::GetElapsedTimeMilliseconds(last_metric_update_time_) >= metric_update_interval_ms_)
 	{
-		TLOG(TLVL_DEBUG + 34) << "check_pending_buffers_: Sending Metrics";
-		metricMan->sendMetric("Event Rate", counter, "Events", 1, MetricMode::Rate);
-		metricMan->sendMetric("Data Rate", eventSize, "Bytes", 1, MetricMode::Rate);
-		if (counter > 0)
+		send_buffer_metrics_();
+	}
+	TLOG(TLVL_DEBUG + 34) << "check_pending_buffers_ END";
+}
+
+void artdaq::SharedMemoryEventManager::check_stale_buffers_()
+{
+	// Only buffers whose stale timer has expired are examined; the timer set is ordered by deadline
+	auto now = TimeUtils::gettimeofday_us();
+	while (!stale_buffer_timers_.empty() && stale_buffer_timers_.begin()->first <= now)
+	{
+		auto buf = stale_buffer_timers_.begin()->second;
+
+		auto deadline = buffer_touch_times_[buf] + stale_buffer_timeout_usec_;
+		if (deadline > now)
 		{
-			metricMan->sendMetric("Average Event Size", eventSize / counter, "Bytes", 1, MetricMode::Average);
-			metricMan->sendMetric("Average Event Building Time", eventTime / counter, "s", 1, MetricMode::Average);
+			TLOG(TLVL_DEBUG + 36) << "check_stale_buffers_ buffer " << buf << " was touched since its timer was armed, re-arming";
+			arm_stale_buffer_timer_(buf, deadline);
+			continue;
 		}
 
-		metricMan->sendMetric("Events Released to art this run", run_event_count_, "Events", 1, MetricMode::LastPoint);
-		metricMan->sendMetric("Incomplete Events Released to art this run", run_incomplete_event_count_, "Events", 1, MetricMode::LastPoint);
-		if (tokens_ && tokens_->RoutingTokenSendsEnabled())
+		TLOG(TLVL_DEBUG + 36) << "check_stale_buffers_ Incomplete buffer detected, buf=" << buf << " buffer_writes_pending_[buf]=" << buffer_writes_pending_[buf].load();
+		if (!ResetBuffer(buf) || buffer_writes_pending_[buf].load() != 0)
 		{
-			metricMan->sendMetric("Tokens sent", tokens_->GetSentTokenCount(), "Tokens", 2, MetricMode::LastPoint);
+			// Either a write is in progress, or SharedMemoryManager does not yet consider the buffer stale. Check again shortly.
+			arm_stale_buffer_timer_(buf, now + 1000);
+			continue;
 		}
 
-		auto bufferReport = GetBufferReport();
-		int full = 0, empty = 0, writing = 0, reading = 0;
-		for (auto& buf : bufferReport)
+		auto hdr = getEventHeader_(buf);
+		if (requests_)
 		{
-			switch (buf.second)
-			{
-				case BufferSemaphoreFlags::Full:
-					full++;
-					break;
-				case BufferSemaphoreFlags::Empty:
-					empty++;
-					break;
-				case BufferSemaphoreFlags::Writing:
-					writing++;
-					break;
-				case BufferSemaphoreFlags::Reading:
-					reading++;
-					break;
-			}
+			requests_->RemoveRequest(hdr->sequence_id);
 		}
-		auto total = size();
-		TLOG(TLVL_DEBUG + 36) << "Buffer usage: full=" << full << ", empty=" << empty << ", writing=" << writing << ", reading=" << reading << ", total=" << total;
-
-		metricMan->sendMetric("Shared Memory Full Buffers", full, "buffers", 2, MetricMode::LastPoint);
-		metricMan->sendMetric("Shared Memory Available Buffers", empty, "buffers", 2, MetricMode::LastPoint);
-		metricMan->sendMetric("Shared Memory Pending Buffers", writing, "buffers", 2, MetricMode::LastPoint);
-		metricMan->sendMetric("Shared Memory Reading Buffers", reading, "buffers", 2, MetricMode::LastPoint);
-		if (total > 0)
+		TLOG(TLVL_BUFFER) << "check_stale_buffers_ moving buffer " << buf << " from active to pending";
+		disarm_stale_buffer_timer_(buf);
+		active_buffers_.erase(buf);
+		pending_buffers_.emplace(hdr->sequence_id, buf);
+		TLOG(TLVL_BUFFER) << "Buffer occupancy now (total,full,reading,empty,pending,active)=("
+		                  << size() << ","
+		                  << ReadReadyCount() << ","
+		                  << WriteReadyCount(true) - WriteReadyCount(false) - ReadReadyCount() << ","
+		                  << WriteReadyCount(false) << ","
+		                  << pending_buffers_.size() << ","
+		                  << active_buffers_.size() << ")";
+
+		run_incomplete_event_count_++;
+		if (metricMan)
 		{
-			metricMan->sendMetric("Shared Memory Full %", full * 100 / static_cast<double>(total), "%", 2, MetricMode::LastPoint);
-			metricMan->sendMetric("Shared Memory Available %", empty * 100 / static_cast<double>(total), "%", 2, MetricMode::LastPoint);
+			metricMan->sendMetric("Incomplete Event Rate", 1, "events/s", 3, MetricMode::Rate);
 		}
+		if (released_incomplete_events_.count(hdr->sequence_id) == 0u)
+		{
+			released_incomplete_events_[hdr->sequence_id] = num_fragments_per_event_ - GetFragmentCountInBuffer(buf);
+		}
+		else
+		{
+			released_incomplete_events_[hdr->sequence_id] -= GetFragmentCountInBuffer(buf);
+		}
+
+		TLOG(TLVL_WARNING) << "Event " << hdr->sequence_id
+		                   << " was opened " << TimeUtils::GetElapsedTime(event_timing_[buf]) << " s ago"
+		                   << " and has timed out (missing " << released_incomplete_events_[hdr->sequence_id] << " Fragments)."
+		                   << "Scheduling release to art.";
+	}
+}
+
+void artdaq::SharedMemoryEventManager::send_buffer_metrics_()
+{
+	TLOG(TLVL_DEBUG + 34) << "send_buffer_metrics_: Sending Metrics";
+	last_metric_update_time_ = std::chrono::steady_clock::now();
+
+	metricMan->sendMetric("Event Rate", metric_event_count_, "Events", 1, MetricMode::Rate);
+	metricMan->sendMetric("Data Rate", metric_event_size_, "Bytes", 1, MetricMode::Rate);
+	if (metric_event_count_ > 0)
+	{
+		metricMan->sendMetric("Average Event Size", metric_event_size_ / metric_event_count_, "Bytes", 1, MetricMode::Average);
+		metricMan->sendMetric("Average Event Building Time", metric_event_time_ / metric_event_count_, "s", 1, MetricMode::Average);
+	}
+	metric_event_count_ = 0;
+	metric_event_size_ = 0.0;
+	metric_event_time_ = 0.0;
+
+	metricMan->sendMetric("Events Released to art this run", run_event_count_, "Events", 1, MetricMode::LastPoint);
+	metricMan->sendMetric("Incomplete Events Released to art this run", run_incomplete_event_count_, "Events", 1, MetricMode::LastPoint);
+	if (tokens_ && tokens_->RoutingTokenSendsEnabled())
+	{
+		metricMan->sendMetric("Tokens sent", tokens_->GetSentTokenCount(), "Tokens", 2, MetricMode::LastPoint);
+	}
+
+	auto bufferReport = GetBufferReport();
+	int full = 0, empty = 0, writing = 0, reading = 0;
+	for (auto& buf : bufferReport)
+	{
+		switch (buf.second)
+		{
+			case BufferSemaphoreFlags::Full:
+				full++;
+				break;
+			case BufferSemaphoreFlags::Empty:
+				empty++;
+				break;
+			case BufferSemaphoreFlags::Writing:
+				writing++;
+				break;
+			case BufferSemaphoreFlags::Reading:
+				reading++;
+				break;
+		}
+	}
+	auto total = size();
+	TLOG(TLVL_DEBUG + 36) << "Buffer usage: full=" << full << ", empty=" << empty << ", writing=" << writing << ", reading=" << reading << ", total=" << total;
+
+	metricMan->sendMetric("Shared Memory Full Buffers", full, "buffers", 2, MetricMode::LastPoint);
+	metricMan->sendMetric("Shared Memory Available Buffers", empty, "buffers", 2, MetricMode::LastPoint);
+	metricMan->sendMetric("Shared Memory Pending Buffers", writing, "buffers", 2, MetricMode::LastPoint);
+	metricMan->sendMetric("Shared Memory Reading Buffers", reading, "buffers", 2, MetricMode::LastPoint);
+	if (total > 0)
+	{
+		metricMan->sendMetric("Shared Memory Full %", full * 100 / static_cast<double>(total), "%", 2, MetricMode::LastPoint);
+		metricMan->sendMetric("Shared Memory Available %", empty * 100 / static_cast<double>(total), "%", 2, MetricMode::LastPoint);
+	}
+}
+
+void artdaq::SharedMemoryEventManager::touch_buffer_(int buffer)
+{
+	buffer_touch_times_[buffer] = TimeUtils::gettimeofday_us();
+}
+
+void artdaq::SharedMemoryEventManager::arm_stale_buffer_timer_(int buffer, uint64_t deadline_us)
+{
+	disarm_stale_buffer_timer_(buffer);
+	stale_buffer_deadlines_[buffer] = deadline_us;
+	stale_buffer_timers_.emplace(deadline_us, buffer);
+}
+
+void artdaq::SharedMemoryEventManager::disarm_stale_buffer_timer_(int buffer)
+{
+	if (stale_buffer_deadlines_[buffer] != 0)
+	{
+		stale_buffer_timers_.erase(std::make_pair(stale_buffer_deadlines_[buffer], buffer));
+		stale_buffer_deadlines_[buffer] = 0;
 	}
-	TLOG(TLVL_DEBUG + 34) << "check_pending_buffers_ END";
 }
 
 std::vector<char*> artdaq::SharedMemoryEventManager::parse_art_command_line_(const std::shared_ptr<art_config_file>& config_file, size_t process_index)
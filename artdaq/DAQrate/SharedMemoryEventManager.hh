@@ -7,6 +7,7 @@
 #include "artdaq-core/Core/SharedMemoryManager.hh"
 #include "artdaq-core/Data/RawEvent.hh"
 #include "artdaq-core/Utilities/configureMessageFacility.hh"
+#include "artdaq/DAQdata/ShmemWakeup.hh"
 #include "artdaq/DAQrate/StatisticsHelper.hh"
 #include "artdaq/DAQrate/detail/RequestSender.hh"
 #include "artdaq/DAQrate/detail/TokenSender.hh"
@@ -22,7 +23,9 @@
 #include <sys/stat.h>
 #include <deque>
 #include <fstream>
+#include <functional>
 #include <iomanip>
+#include <queue>
 #include <set>
 
 namespace artdaq {
@@ -150,6 +153,8 @@ public:
 		fhicl::Atom<size_t> max_event_list_length{fhicl::Name{"max_event_list_length"}, fhicl::Comment{" The maximum number of entries to store in the released events list"}, 100};
 		/// "send_init_fragments" (Default: true): Whether Init Fragments are expected to be sent to art. If true, a Warning message is printed when an Init Fragment is requested but none are available.
 		fhicl::Atom<bool> send_init_fragments{fhicl::Name{"send_init_fragments"}, fhicl::Comment{"Whether Init Fragments are expected to be sent to art. If true, a Warning message is printed when an Init Fragment is requested but none are available."}, true};
+		/// "metric_update_interval_ms" (Default: 1000): Minimum interval between updates of the event-building and buffer occupancy metrics
+		fhicl::Atom<size_t> metric_update_interval_ms{fhicl::Name{"metric_update_interval_ms"}, fhicl::Comment{"Minimum interval between updates of the event-building and buffer occupancy metrics"}, 1000};
 		/// "open_event_report_interval_ms" (Default: -1): Interval at which an open event report should be written
 		fhicl::Atom<int> open_event_report_interval_ms{fhicl::Name{"open_event_report_interval_ms"}, fhicl::Comment{"Interval at which an open event report should be written"}, -1};
 		/// "fragment_broadcast_timeout_ms" (Default: 3000): Amount of time broadcast fragments should live in the broadcast shared memory segment
@@ -174,6 +179,8 @@ public:
 		fhicl::Atom<bool> use_art{fhicl::Name{"use_art"}, fhicl::Comment{"Whether to start and manage art threads (Sets art_analyzer count to 0 and overwrite_mode to true when false)"}, true};
 		/// "manual_art" (Default: false): Prints the startup command line for the art process so that the user may (for example) run it in GDB or valgrind
 		fhicl::Atom<bool> manual_art{fhicl::Name{"manual_art"}, fhicl::Comment{"Prints the startup command line for the art process so that the user may (for example) run it in GDB or valgrind"}, false};
+		/// "prestart_art_processes" (Default: false): Whether to start the art processes for the next run at configure and at the end of each run, so that art initialization overlaps the time between runs. The pre-started processes are replaced if the art configuration or process count has changed when the run starts.
+		fhicl::Atom<bool> prestart_art_processes{fhicl::Name{"prestart_art_processes"}, fhicl::Comment{"Whether to start the art processes for the next run at configure and at the end of each run, so that art initialization overlaps the time between runs. The pre-started processes are replaced if the art configuration or process count has changed when the run starts."}, false};
 		/// Configuration of the RequestSender. See artdaq::RequestSender::Config
 		fhicl::TableFragment<artdaq::RequestSender::Config> requestSenderConfig;
 		/// Configuration of the TokenSender. See artdaq::TokenSender::Config
@@ -226,6 +233,16 @@ public:
 	 */
 	void DoneWritingFragment(detail::RawFragmentHeader frag);
 
+	/**
+	 * \brief Wait until WriteFragmentHeader can get a buffer for the given Sequence ID, or the timeout expires
+	 * \param seqID Sequence ID of the Fragment waiting to be written
+	 * \param timeout_usec Maximum time to wait, in microseconds
+	 * \return Whether a buffer is available
+	 *
+	 * Woken when an art process releases a buffer, and when this process frees a buffer or opens one for a new event.
+	 */
+	bool WaitForBuffer(Fragment::sequence_id_t seqID, size_t timeout_usec);
+
 	/**
 	 * \brief Returns the number of buffers which contain data but are not yet complete
 	 * \return The number of buffers which contain data but are not yet complete
@@ -299,6 +316,14 @@ public:
 	 */
 	void ReconfigureArt(fhicl::ParameterSet art_pset, run_id_t newRun = 0, int n_art_processes = -1);
 
+	/**
+	 * \brief Start the art processes for the next run ahead of time, if prestart_art_processes is set
+	 *
+	 * The new processes load their configuration and attach to shared memory while no run is in progress. startRun uses
+	 * them if the art configuration and process count are unchanged, and otherwise shuts them down and starts new ones.
+	 */
+	void PrestartArt();
+
 	/**
 	 * \brief Indicate that the end of input has been reached to the art processes.
 	 * \return True if the end proceeded correctly
@@ -441,8 +466,10 @@ private:
 	size_t max_subrun_event_map_length_;
 	static std::mutex subrun_event_map_mutex_;
 
+	typedef std::pair<Fragment::sequence_id_t, int> pending_buffer_t;
+
 	std::set<int> active_buffers_;
-	std::set<int> pending_buffers_;
+	std::priority_queue<pending_buffer_t, std::vector<pending_buffer_t>, std::greater<pending_buffer_t>> pending_buffers_;  // Min-heap on Sequence ID, for in-order release
 	std::unordered_map<Fragment::sequence_id_t, size_t> released_incomplete_events_;
 	std::set<Fragment::sequence_id_t> released_events_;
 	size_t max_event_list_length_;
@@ -455,7 +482,20 @@ private:
 
 	std::unordered_map<int, std::atomic<int>> buffer_writes_pending_;
 	std::unordered_map<int, std::mutex> buffer_mutexes_;
-	static std::mutex sequence_id_mutex_;
+	std::mutex sequence_id_mutex_;
+	std::unordered_map<Fragment::sequence_id_t, int> sequence_id_buffers_;  // Buffers owned by this manager, by Sequence ID. Protected by sequence_id_mutex_
+
+	size_t stale_buffer_timeout_usec_;
+	std::vector<std::atomic<uint64_t>> buffer_touch_times_;  // Last write to each buffer (TimeUtils::gettimeofday_us)
+	std::set<std::pair<uint64_t, int>> stale_buffer_timers_;  // (deadline, buffer) for each active buffer. Protected by sequence_id_mutex_
+	std::vector<uint64_t> stale_buffer_deadlines_;           // Armed deadline of each buffer, 0 if none. Protected by sequence_id_mutex_
+
+	size_t metric_update_interval_ms_;
+	std::chrono::steady_clock::time_point last_metric_update_time_;
+	size_t metric_event_count_;
+	double metric_event_size_;
+	double metric_event_time_;
+	double recent_event_time_s_;  // Moving average of the event building time, reported to the RoutingManager with tokens
 
 	int open_event_report_interval_ms_;
 	std::chrono::steady_clock::time_point last_open_event_report_time_;
@@ -485,6 +525,11 @@ private:
 	size_t art_process_index_offset_;
 	double minimum_art_lifetime_s_;
 	size_t art_event_processing_time_us_;
+	bool prestart_art_;
+	std::atomic<bool> art_prestarted_;
+	fhicl::ParameterSet prestarted_art_pset_;
+	size_t prestarted_art_count_;
+	std::chrono::steady_clock::time_point art_prestart_time_;
 
 	std::unique_ptr<RequestSender> requests_;
 	std::unique_ptr<TokenSender> tokens_;
@@ -503,10 +548,17 @@ private:
 	void complete_buffer_(int buffer);
 	bool bufferComparator(int bufA, int bufB);
 	void check_pending_buffers_(std::unique_lock<std::mutex> const& lock);
+	void check_stale_buffers_();
+	void send_buffer_metrics_();
+	void touch_buffer_(int buffer);
+	void arm_stale_buffer_timer_(int buffer, uint64_t deadline_us);
+	void disarm_stale_buffer_timer_(int buffer);
+	bool use_prestarted_art_();
 	std::vector<char*> parse_art_command_line_(const std::shared_ptr<art_config_file>& config_file, size_t process_index);
 
 	void send_init_frags_();
 	SharedMemoryManager broadcasts_;
+	std::unique_ptr<detail::ShmemWakeup> buffer_wakeup_;  // Readers bump its space sequence when they release a buffer
 };
 }  // namespace artdaq
 
@@ -136,6 +136,7 @@ int artdaq::TransferTest::runTest()
 	TLOG(TLVL_INFO) << (my_rank < senders_ ? "Sent " : "Received ") << result.first << " bytes in " << duration << " seconds ( " << formatBytes(result.first / duration) << "/s )." << std::endl;
 	TLOG(TLVL_INFO) << "Rate of " << (my_rank < senders_ ? "sending" : "receiving") << ": " << formatBytes(result.first / result.second) << "/s." << std::endl;
 	metricMan->do_stop();
+	MetricHandle::Shutdown();
 	metricMan->shutdown();
 	TLOG(TLVL_DEBUG + 36) << "runTest DONE";
 	return return_code_;
@@ -1,8 +1,11 @@
 #ifndef artdaq_DAQrate_detail_FragCounter_hh
 #define artdaq_DAQrate_detail_FragCounter_hh
 
+#include <algorithm>
+#include <array>
 #include <atomic>
 #include <limits>
+#include <memory>
 #include <mutex>
 #include <unordered_map>
 
@@ -14,6 +17,9 @@ class FragCounter;
 
 /**
  * \brief Keep track of the count of Fragments received from a set of sources
+ *
+ * Slots below max_table_slot are kept in a fixed table of lazily-allocated blocks, so that incrementing or reading
+ * a slot which already exists takes no lock. The mutex is only taken to add a slot, or to access slots beyond the table.
  */
 class artdaq::detail::FragCounter
 {
@@ -23,6 +29,11 @@ public:
 	 */
 	explicit FragCounter();
 
+	/**
+	 * \brief FragCounter Destructor
+	 */
+	~FragCounter();
+
 	/**
 	 * \brief Increment the given slot by one
 	 * \param slot Slot to increment
@@ -75,14 +86,148 @@ public:
 	 */
 	size_t operator[](size_t slot) const { return slotCount(slot); }
 
+	static constexpr size_t slots_per_block = 64;                            ///< Number of slots allocated together in the slot table
+	static constexpr size_t block_count = 256;                               ///< Number of blocks in the slot table
+	static constexpr size_t max_table_slot = slots_per_block * block_count;  ///< Slots at or above this value are kept in a locked map
+
 private:
-	mutable std::mutex receipts_mutex_;
-	std::unordered_map<size_t, std::atomic<size_t>> receipts_;
+	FragCounter(FragCounter const&) = delete;
+	FragCounter(FragCounter&&) = delete;
+	FragCounter& operator=(FragCounter const&) = delete;
+	FragCounter& operator=(FragCounter&&) = delete;
+
+	// Each slot has its own cache line, so that threads counting different slots do not contend
+	struct alignas(64) Slot
+	{
+		std::atomic<size_t> count{0};
+		std::atomic<bool> used{false};
+	};
+	struct Block
+	{
+		std::array<Slot, slots_per_block> slots;
+	};
+
+	Slot* findSlot_(size_t slot) const;
+	Slot* getOrAddSlot_(size_t slot);
+
+	template<typename F>
+	void forEachSlot_(F&& f) const;
+
+	mutable std::mutex receipts_mutex_;  // Held while adding slots, and for access to overflow_receipts_
+	std::array<std::atomic<Block*>, block_count> blocks_;
+	std::atomic<size_t> block_limit_;  // One past the highest allocated block
+	std::atomic<size_t> slot_count_;
+	std::atomic<bool> has_overflow_;
+	std::unordered_map<size_t, std::unique_ptr<Slot>> overflow_receipts_;
 };
 
 inline artdaq::detail::FragCounter::
     FragCounter()
-    : receipts_() {}
+    : block_limit_(0)
+    , slot_count_(0)
+    , has_overflow_(false)
+    , overflow_receipts_()
+{
+	for (auto& block : blocks_)
+	{
+		block.store(nullptr, std::memory_order_relaxed);
+	}
+}
+
+inline artdaq::detail::FragCounter::
+    ~FragCounter()
+{
+	for (auto& block : blocks_)
+	{
+		delete block.load(std::memory_order_relaxed);
+	}
+}
+
+inline artdaq::detail::FragCounter::Slot*
+artdaq::detail::FragCounter::
+    findSlot_(size_t slot) const
+{
+	if (slot < max_table_slot)
+	{
+		auto block = blocks_[slot / slots_per_block].load(std::memory_order_acquire);
+		if (block == nullptr) return nullptr;
+		auto& s = block->slots[slot % slots_per_block];
+		return s.used.load(std::memory_order_acquire) ? &s : nullptr;
+	}
+
+	if (!has_overflow_.load(std::memory_order_acquire)) return nullptr;
+	std::unique_lock<std::mutex> lk(receipts_mutex_);
+	auto it = overflow_receipts_.find(slot);
+	return it != overflow_receipts_.end() ? it->second.get() : nullptr;
+}
+
+inline artdaq::detail::FragCounter::Slot*
+artdaq::detail::FragCounter::
+    getOrAddSlot_(size_t slot)
+{
+	if (slot < max_table_slot)
+	{
+		auto s = findSlot_(slot);
+		if (s != nullptr) return s;
+	}
+
+	std::unique_lock<std::mutex> lk(receipts_mutex_);
+	if (slot >= max_table_slot)
+	{
+		auto& s = overflow_receipts_[slot];
+		if (!s)
+		{
+			s = std::make_unique<Slot>();
+			s->used.store(true, std::memory_order_relaxed);
+			slot_count_.fetch_add(1, std::memory_order_relaxed);
+			has_overflow_.store(true, std::memory_order_release);
+		}
+		return s.get();
+	}
+
+	auto block_index = slot / slots_per_block;
+	auto block = blocks_[block_index].load(std::memory_order_relaxed);
+	if (block == nullptr)
+	{
+		block = new Block();
+		blocks_[block_index].store(block, std::memory_order_release);
+		if (block_limit_.load(std::memory_order_relaxed) <= block_index)
+		{
+			block_limit_.store(block_index + 1, std::memory_order_release);
+		}
+	}
+	auto& s = block->slots[slot % slots_per_block];
+	if (!s.used.load(std::memory_order_relaxed))
+	{
+		s.used.store(true, std::memory_order_release);
+		slot_count_.fetch_add(1, std::memory_order_relaxed);
+	}
+	return &s;
+}
+
+template<typename F>
+inline void
+artdaq::detail::FragCounter::
+    forEachSlot_(F&& f) const
+{
+	auto limit = block_limit_.load(std::memory_order_acquire);
+	for (size_t ii = 0; ii < limit; ++ii)
+	{
+		auto block = blocks_[ii].load(std::memory_order_acquire);
+		if (block == nullptr) continue;
+		for (auto& s : block->slots)
+		{
+			if (s.used.load(std::memory_order_acquire)) f(s.count.load(std::memory_order_relaxed));
+		}
+	}
+
+	if (!has_overflow_.load(std::memory_order_acquire)) return;
+	std::unique_lock<std::mutex> lk(receipts_mutex_);
+	for (auto& it : overflow_receipts_)
+	{
+		f(it.second->count.load(std::memory_order_relaxed));
+	}
+}
 
 inline void
 artdaq::detail::FragCounter::
@@ -95,36 +240,29 @@ inline void
 artdaq::detail::FragCounter::
     incSlot(size_t slot, size_t inc)
 {
-	std::unique_lock<std::mutex> lk(receipts_mutex_);
-	receipts_[slot].fetch_add(inc);
+	getOrAddSlot_(slot)->count.fetch_add(inc, std::memory_order_relaxed);
 }
 
 inline void
 artdaq::detail::FragCounter::
     setSlot(size_t slot, size_t val)
 {
-	std::unique_lock<std::mutex> lk(receipts_mutex_);
-	receipts_[slot] = val;
+	getOrAddSlot_(slot)->count.store(val, std::memory_order_relaxed);
 }
 
 inline size_t
 artdaq::detail::FragCounter::
     nSlots() const
 {
-	std::unique_lock<std::mutex> lk(receipts_mutex_);
-	return receipts_.size();
+	return slot_count_.load(std::memory_order_relaxed);
 }
 
 inline size_t
 artdaq::detail::FragCounter::
     count() const
 {
-	std::unique_lock<std::mutex> lk(receipts_mutex_);
 	size_t acc = 0;
-	for (auto& it : receipts_)
-	{
-		acc += it.second;
-	}
+	forEachSlot_([&](size_t val) { acc += val; });
 	return acc;
 }
 
@@ -132,20 +270,16 @@ inline size_t
 artdaq::detail::FragCounter::
     slotCount(size_t slot) const
 {
-	std::unique_lock<std::mutex> lk(receipts_mutex_);
-	return receipts_.count(slot) ? receipts_.at(slot).load() : 0;
+	auto s = findSlot_(slot);
+	return s != nullptr ? s->count.load(std::memory_order_relaxed) : 0;
 }
 
 inline size_t
 artdaq::detail::FragCounter::
     minCount() const
 {
-	std::unique_lock<std::mutex> lk(receipts_mutex_);
 	size_t min = std::numeric_limits<size_t>::max();
-	for (auto& it : receipts_)
-	{
-		if (it.second < min) min = it.second;
-	}
+	forEachSlot_([&](size_t val) { min = std::min(min, val); });
 	return min;
 }
 
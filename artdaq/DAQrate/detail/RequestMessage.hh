@@ -21,8 +21,9 @@ class RequestMessage;
  */
 enum class RequestMessageMode : uint8_t
 {
-	Normal = 0,    ///< Normal running
-	EndOfRun = 1,  ///< End of Run mode (Used to end request processing on receiver)
+	Normal = 0,           ///< Normal running
+	EndOfRun = 1,         ///< End of Run mode (Used to end request processing on receiver)
+	SnapshotRequest = 2,  ///< Sent by a receiver back to the RequestSender when it has missed a message. The sender replies with a full snapshot
 };
 
 /**
@@ -41,6 +42,9 @@ inline std::ostream& operator<<(std::ostream& o, RequestMessageMode m)
 		case RequestMessageMode::EndOfRun:
 			o << "EndOfRun";
 			break;
+		case RequestMessageMode::SnapshotRequest:
+			o << "SnapshotRequest";
+			break;
 	}
 	return o;
 }
@@ -85,11 +89,13 @@ public:
 struct artdaq::detail::RequestHeader
 {
 	/** The magic bytes for the request header */
-	uint32_t header{0x48454452};                          // HEDR, or 0x48454452
-	uint32_t packet_count{0};                             ///< The number of RequestPackets in this Request message
-	int rank{my_rank};                                    ///< Rank of the sender
-	uint32_t run_number{0};                               ///< The Run with which this request should be associated
-	RequestMessageMode mode{RequestMessageMode::Normal};  ///< Communicates additional information to the Request receiver
+	uint32_t header{0x48454452};                           // HEDR, or 0x48454452
+	uint32_t packet_count{0};                              ///< The number of RequestPackets in this Request message
+	int rank{my_rank};                                     ///< Rank of the sender
+	uint32_t run_number{0};                                ///< The Run with which this request should be associated
+	RequestMessageMode mode{RequestMessageMode::Normal};   ///< Communicates additional information to the Request receiver
+	uint32_t message_sequence{0};                          ///< Counts the messages from this sender, starting at 1. Receivers use it to detect lost messages (0: not counted)
+	Fragment::sequence_id_t lowest_active_sequence_id{0};  ///< Lowest sequence ID the sender still has an active request for
 
 	RequestHeader() = default;
 
@@ -102,6 +108,12 @@ struct artdaq::detail::RequestHeader
 
 /**
  * \brief A RequestMessage consists of a RequestHeader and zero or more RequestPackets. They will usually be sent in two calls to send()
+ *
+ * In Normal mode, RequestSender only includes requests which are new since its last message, plus periodic full snapshots.
+ * In EndOfRun mode, every message carries all active requests.
+ * Receivers merge the RequestPackets from each message into their existing request list, and drop the requests from that
+ * sender which are below its lowest active sequence ID. A receiver which sees a gap in the message sequence numbers sends
+ * a SnapshotRequest header back to the sender.
  */
 class artdaq::detail::RequestMessage
 {
@@ -122,7 +134,7 @@ public:
 	{
 		auto size = sizeof(RequestHeader) + packets_.size() * sizeof(RequestPacket);
 		header_.packet_count = packets_.size();
-		assert(size < MAX_REQUEST_MESSAGE_SIZE);
+		assert(size <= MAX_REQUEST_MESSAGE_SIZE);
 		auto output = std::vector<uint8_t>(size);
 		memcpy(&output[0], &header_, sizeof(RequestHeader));
 		memcpy(&output[sizeof(RequestHeader)], &packets_[0], packets_.size() * sizeof(RequestPacket));
@@ -158,6 +170,25 @@ public:
 		header_.run_number = run;
 	}
 
+	/**
+	 * \brief Set the lowest sequence ID which the sender still has an active request for.
+	 * Requests below this sequence ID have been satisfied or abandoned by the sender.
+	 * \param seq Lowest active sequence ID
+	 */
+	void setLowestActiveSequenceID(Fragment::sequence_id_t seq)
+	{
+		header_.lowest_active_sequence_id = seq;
+	}
+
+	/**
+	 * \brief Set the message sequence number in the header. RequestSender numbers each message it sends.
+	 * \param seq Message sequence number
+	 */
+	void setMessageSequence(uint32_t seq)
+	{
+		header_.message_sequence = seq;
+	}
+
 	/**
 	 * \brief Get the number of RequestPackets in the RequestMessage
 	 * \return The number of RequestPackets in the RequestMessage
@@ -202,6 +202,8 @@ void artdaq::RequestReceiver::receiveRequestsLoop()
 	running_ = true;
 	requests_->reset();
 	requests_->setRunning(true);
+	last_message_sequence_.clear();
+	sender_requests_.clear();
 	while (!should_stop_)
 	{
 		TLOG(TLVL_DEBUG + 35) << "receiveRequestsLoop: Polling Request socket for new requests";
@@ -246,7 +248,7 @@ void artdaq::RequestReceiver::receiveRequestsLoop()
 		}
 
 		auto hdr_buffer = reinterpret_cast<artdaq::detail::RequestHeader*>(&buffer[0]);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
-		TLOG(TLVL_DEBUG + 34) << "Request header word: 0x" << std::hex << hdr_buffer->header << std::dec << ", packet_count: " << hdr_buffer->packet_count << " from rank " << hdr_buffer->rank << ", " << inet_ntoa(from.sin_addr) << ":" << from.sin_port << ", run number: " << hdr_buffer->run_number;
+		TLOG(TLVL_DEBUG + 34) << "Request header word: 0x" << std::hex << hdr_buffer->header << std::dec << ", packet_count: " << hdr_buffer->packet_count << " from rank " << hdr_buffer->rank << ", " << inet_ntoa(from.sin_addr) << ":" << from.sin_port << ", run number: " << hdr_buffer->run_number << ", message: " << hdr_buffer->message_sequence << ", lowest active sequence ID: " << hdr_buffer->lowest_active_sequence_id;
 		if (!hdr_buffer->isValid())
 		{
 			continue;
@@ -270,6 +272,24 @@ void artdaq::RequestReceiver::receiveRequestsLoop()
 			request_stop_requested_ = true;
 		}
 
+		// A receiver which joins late, or misses a message, asks the sender for a snapshot instead of waiting for the next periodic one
+		bool missed_messages = false;
+		if (hdr_buffer->message_sequence != 0)
+		{
+			auto last = last_message_sequence_.find(hdr_buffer->rank);
+			if (last == last_message_sequence_.end())
+			{
+				TLOG(TLVL_DEBUG + 33) << "First request message from rank " << hdr_buffer->rank << ", asking for a snapshot";
+				missed_messages = true;
+			}
+			else if (hdr_buffer->message_sequence > last->second + 1)
+			{
+				TLOG(TLVL_WARNING) << "Missed " << hdr_buffer->message_sequence - last->second - 1 << " request message(s) from rank " << hdr_buffer->rank << ", asking for a snapshot";
+				missed_messages = true;
+			}
+			last_message_sequence_[hdr_buffer->rank] = hdr_buffer->message_sequence;
+		}
+
 		std::vector<artdaq::detail::RequestPacket> pkt_buffer(hdr_buffer->packet_count);
 		memcpy(&pkt_buffer[0], &buffer[sizeof(artdaq::detail::RequestHeader)], sizeof(artdaq::detail::RequestPacket) * hdr_buffer->packet_count);
 
@@ -278,14 +298,44 @@ void artdaq::RequestReceiver::receiveRequestsLoop()
 			break;
 		}
 
+		// RequestSender only sends new requests (and periodic snapshots), RequestBuffer::push merges them into the existing list
+		auto& sender_requests = sender_requests_[hdr_buffer->rank];
 		for (auto& buffer : pkt_buffer)
 		{
 			TLOG(TLVL_DEBUG + 36) << "Request Packet: hdr=" << /*std::dec <<*/ buffer.header << ", seq=" << buffer.sequence_id << ", ts=" << buffer.timestamp;
 			if (!buffer.isValid()) continue;
 			requests_->push(buffer.sequence_id, buffer.timestamp);
+			sender_requests.insert(buffer.sequence_id);
+		}
+
+		// The sender has satisfied or abandoned its requests below the watermark, they no longer need a response
+		auto watermark = sender_requests.lower_bound(hdr_buffer->lowest_active_sequence_id);
+		for (auto it = sender_requests.begin(); it != watermark; ++it)
+		{
+			TLOG(TLVL_DEBUG + 36) << "Request for sequence ID " << *it << " is below the watermark of rank " << hdr_buffer->rank << ", removing";
+			requests_->RemoveRequest(*it);
+		}
+		sender_requests.erase(sender_requests.begin(), watermark);
+
+		if (missed_messages)
+		{
+			send_snapshot_request_(from);
 		}
 	}
 	TLOG(TLVL_DEBUG + 32) << "Ending Request Thread";
 	running_ = false;
 	requests_->setRunning(false);
 }
+
+void artdaq::RequestReceiver::send_snapshot_request_(struct sockaddr_in const& to)
+{
+	artdaq::detail::RequestMessage message;
+	message.setMode(artdaq::detail::RequestMessageMode::SnapshotRequest);
+	message.setRank(my_rank);
+	message.setRunNumber(run_number_);
+	auto buf = message.GetMessage();
+	if (sendto(request_socket_, &buf[0], buf.size(), 0, reinterpret_cast<struct sockaddr const*>(&to), sizeof(to)) < 0)  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+	{
+		TLOG(TLVL_WARNING) << "Error sending snapshot request to " << inet_ntoa(to.sin_addr) << ":" << ntohs(to.sin_port) << ", err=" << strerror(errno);
+	}
+}
@@ -15,8 +15,11 @@ class ParameterSet;
 #include "fhiclcpp/types/ConfigurationTable.h"
 #include "fhiclcpp/types/Name.h"
 
+#include <netinet/in.h>
 #include <boost/thread.hpp>
+#include <map>
 #include <mutex>
+#include <set>
 
 namespace artdaq {
 /// <summary>
@@ -119,6 +122,12 @@ private:
 	boost::thread requestThread_;
 
 	std::shared_ptr<RequestBuffer> requests_;
+
+	// Per sender rank, only used by the request thread
+	std::map<int, uint32_t> last_message_sequence_;
+	std::map<int, std::set<Fragment::sequence_id_t>> sender_requests_;  // Requests received from each sender which are not yet below its watermark
+
+	void send_snapshot_request_(struct sockaddr_in const& to);
 };
 }  // namespace artdaq
 
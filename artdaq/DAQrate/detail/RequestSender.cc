@@ -10,6 +10,7 @@
 #include <boost/thread.hpp>
 
 #include <dlfcn.h>
+#include <algorithm>
 #include <chrono>
 #include <cstring>
 #include <fstream>
@@ -23,6 +24,7 @@ namespace artdaq {
 RequestSender::RequestSender(const fhicl::ParameterSet& pset)
     : send_requests_(pset.get<bool>("send_requests", false))
     , initialized_(false)
+    , next_sequence_id_(0)
     , request_address_(pset.get<std::string>("request_address", "227.128.12.26"))
     , request_port_(pset.get<int>("request_port", 3001))
     , request_delay_(pset.get<size_t>("request_delay_ms", 0) * 1000)
@@ -31,11 +33,20 @@ RequestSender::RequestSender(const fhicl::ParameterSet& pset)
     , multicast_out_addr_(pset.get<std::string>("multicast_interface_ip", pset.get<std::string>("output_address", "0.0.0.0")))
     , request_mode_(detail::RequestMessageMode::Normal)
     , min_request_interval_ms_(pset.get<size_t>("min_request_interval_ms", 100))
+    , snapshot_interval_ms_(pset.get<size_t>("request_snapshot_interval_ms", 1000))
+    , last_snapshot_time_(std::chrono::steady_clock::now())
+    , snapshot_requested_(false)
+    , message_sequence_(0)
     , request_sending_(0)
     , run_number_(0)
+    , stop_requested_(false)
 {
 	TLOG(TLVL_DEBUG) << "RequestSender CONSTRUCTOR pset=" << pset.to_string();
 	setup_requests_();
+	if (send_requests_)
+	{
+		send_thread_ = boost::thread([this] { send_thread_proc_(); });
+	}
 
 	TLOG(TLVL_DEBUG + 35) << "artdaq::RequestSender::RequestSender ctor - reader_thread_ initialized";
 	initialized_ = true;
@@ -53,7 +64,12 @@ RequestSender::~RequestSender()
 	}
 	{
 		std::lock_guard<std::mutex> lk(request_mutex_);
-		std::lock_guard<std::mutex> lk2(request_send_mutex_);
+		stop_requested_ = true;
+	}
+	request_cv_.notify_all();
+	if (send_thread_.joinable())
+	{
+		send_thread_.join();
 	}
 	TLOG(TLVL_INFO) << "Shutting down RequestSender: request_socket_: " << request_socket_;
 	if (request_socket_ != -1)
@@ -75,6 +91,7 @@ void RequestSender::SetRequestMode(detail::RequestMessageMode mode)
 	{
 		std::lock_guard<std::mutex> lk(request_mutex_);
 		request_mode_ = mode;
+		snapshot_requested_ = true;
 	}
 	SendRequest(true);
 }
@@ -148,51 +165,188 @@ void RequestSender::setup_requests_()
 	}
 }
 
-void RequestSender::do_send_request_()
+void RequestSender::send_thread_proc_()
 {
-	if (!send_requests_)
+	std::vector<detail::RequestMessage> messages;
+	while (true)
 	{
-		request_sending_--;
-		return;
+		{
+			std::unique_lock<std::mutex> lk(request_mutex_);
+			while (!stop_requested_ && request_sending_ == 0)
+			{
+				if (receive_snapshot_requests_())
+				{
+					snapshot_requested_ = true;
+					break;
+				}
+
+				auto next_snapshot_time = last_snapshot_time_ + std::chrono::milliseconds(snapshot_interval_ms_);
+				// Without an explicit send, wake for the next snapshot, or to flush requests held back by min_request_interval_ms
+				auto deadline = std::chrono::steady_clock::time_point::max();
+				if (snapshot_interval_ms_ > 0 && !active_requests_.empty())
+				{
+					deadline = next_snapshot_time;
+				}
+				if (!new_requests_.empty())
+				{
+					deadline = std::min(deadline, last_request_send_time_ + std::chrono::milliseconds(min_request_interval_ms_));
+				}
+
+				// While there are active requests, a receiver which lost a message may ask for a snapshot
+				auto wake_time = deadline;
+				if (!active_requests_.empty())
+				{
+					wake_time = std::min(deadline, std::chrono::steady_clock::now() + std::chrono::milliseconds(10));
+				}
+
+				if (wake_time == std::chrono::steady_clock::time_point::max())
+				{
+					request_cv_.wait(lk);
+				}
+				else if (request_cv_.wait_until(lk, wake_time) == std::cv_status::timeout && std::chrono::steady_clock::now() >= deadline)
+				{
+					break;
+				}
+			}
+			if (stop_requested_)
+			{
+				break;
+			}
+		}
+
+		TLOG(TLVL_DEBUG + 33) << "Waiting for " << request_delay_ << " microseconds.";
+		std::this_thread::sleep_for(std::chrono::microseconds(request_delay_));
+
+		TLOG(TLVL_DEBUG + 33) << "Creating RequestMessage";
+		int sends = 0;
+		int repeats = 1;
+		messages.clear();
+		{
+			std::lock_guard<std::mutex> lk(request_mutex_);
+			sends = request_sending_.load();
+			auto next_snapshot_time = last_snapshot_time_ + std::chrono::milliseconds(snapshot_interval_ms_);
+
+			auto add_request = [&](Fragment::sequence_id_t seq, Fragment::timestamp_t ts) {
+				if (messages.empty() || messages.back().size() >= detail::RequestMessage::max_request_count())
+				{
+					messages.emplace_back();
+				}
+				TLOG(TLVL_DEBUG + 36) << "Adding a request with sequence ID " << seq << ", timestamp " << ts << " to request message";
+				messages.back().addRequest(seq, ts);
+			};
+
+			if (snapshot_interval_ms_ > 0 && std::chrono::steady_clock::now() >= next_snapshot_time)
+			{
+				snapshot_requested_ = true;
+			}
+			// At end of run, receivers use the complete request list: each send carries all active requests, as it always has
+			if (request_mode_ == detail::RequestMessageMode::EndOfRun)
+			{
+				snapshot_requested_ = true;
+				repeats = std::max(sends, 1);
+			}
+			if (snapshot_requested_)
+			{
+				TLOG(TLVL_DEBUG + 33) << "Sending snapshot of " << active_requests_.size() << " active requests";
+				for (auto& req : active_requests_)
+				{
+					add_request(req.first, req.second);
+				}
+				snapshot_requested_ = false;
+				last_snapshot_time_ = std::chrono::steady_clock::now();
+			}
+			else
+			{
+				for (auto& seq : new_requests_)
+				{
+					auto it = active_requests_.find(seq);
+					if (it != active_requests_.end())
+					{
+						add_request(it->first, it->second);
+					}
+				}
+			}
+			new_requests_.clear();
+			last_request_send_time_ = std::chrono::steady_clock::now();
+
+			// Always send at least the header, it carries the mode
+			if (messages.empty())
+			{
+				messages.emplace_back();
+			}
+
+			auto lowest_active = active_requests_.empty() ? next_sequence_id_ : active_requests_.begin()->first;
+			TLOG(TLVL_DEBUG + 33) << "Setting mode flag in Message Header to " << static_cast<int>(request_mode_) << ", lowest active sequence ID to " << lowest_active;
+			for (auto& message : messages)
+			{
+				message.setRank(my_rank);
+				message.setRunNumber(run_number_);
+				message.setMode(request_mode_);
+				message.setLowestActiveSequenceID(lowest_active);
+			}
+		}
+
+		for (int ii = 0; ii < repeats; ++ii)
+		{
+			do_send_request_(messages);
+		}
+		request_sending_ -= sends;
 	}
+	TLOG(TLVL_DEBUG + 32) << "Request send thread exiting";
+}
+
+void RequestSender::do_send_request_(std::vector<detail::RequestMessage>& messages)
+{
 	if (request_socket_ == -1)
 	{
 		setup_requests_();
 	}
 
-	TLOG(TLVL_DEBUG + 33) << "Waiting for " << request_delay_ << " microseconds.";
-	std::this_thread::sleep_for(std::chrono::microseconds(request_delay_));
-
-	TLOG(TLVL_DEBUG + 33) << "Creating RequestMessage";
-	detail::RequestMessage message;
-	message.setRank(my_rank);
-	message.setRunNumber(run_number_);
+	char str[INET_ADDRSTRLEN];
+	inet_ntop(AF_INET, &(request_addr_.sin_addr), str, INET_ADDRSTRLEN);
+	for (auto& message : messages)
 	{
-		std::lock_guard<std::mutex> lk(request_mutex_);
-		for (auto& req : active_requests_)
+		TLOG(TLVL_DEBUG + 33) << "Sending request for " << message.size() << " events to multicast group " << str
+		                      << ", port " << request_port_ << ", interface " << multicast_out_addr_;
+		message.setMessageSequence(++message_sequence_);
+		auto buf = message.GetMessage();
+		auto sts = sendto(request_socket_, &buf[0], buf.size(), 0, reinterpret_cast<struct sockaddr*>(&request_addr_), sizeof(request_addr_));  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+		if (sts < 0 || static_cast<size_t>(sts) != buf.size())
 		{
-			TLOG(TLVL_DEBUG + 36) << "Adding a request with sequence ID " << req.first << ", timestamp " << req.second << " to request message";
-			message.addRequest(req.first, req.second);
+			TLOG(TLVL_ERROR) << "Error sending request message err=" << strerror(errno) << "sts=" << sts;
+			close(request_socket_);
+			request_socket_ = -1;
+			// Make sure the requests which were lost go out again
+			std::lock_guard<std::mutex> lk(request_mutex_);
+			snapshot_requested_ = true;
+			return;
 		}
-		TLOG(TLVL_DEBUG + 33) << "Setting mode flag in Message Header to " << static_cast<int>(request_mode_);
-		message.setMode(request_mode_);
+		TLOG(TLVL_DEBUG + 33) << "Done sending request sts=" << sts;
 	}
-	char str[INET_ADDRSTRLEN];
-	inet_ntop(AF_INET, &(request_addr_.sin_addr), str, INET_ADDRSTRLEN);
-	std::lock_guard<std::mutex> lk2(request_send_mutex_);
-	TLOG(TLVL_DEBUG + 33) << "Sending request for " << message.size() << " events to multicast group " << str
-	                      << ", port " << request_port_ << ", interface " << multicast_out_addr_;
-	auto buf = message.GetMessage();
-	auto sts = sendto(request_socket_, &buf[0], buf.size(), 0, reinterpret_cast<struct sockaddr*>(&request_addr_), sizeof(request_addr_));  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
-	if (sts < 0 || static_cast<size_t>(sts) != buf.size())
+}
+
+bool RequestSender::receive_snapshot_requests_()
+{
+	if (request_socket_ == -1)
 	{
-		TLOG(TLVL_ERROR) << "Error sending request message err=" << strerror(errno) << "sts=" << sts;
-		request_socket_ = -1;
-		request_sending_--;
-		return;
+		return false;
 	}
-	TLOG(TLVL_DEBUG + 33) << "Done sending request sts=" << sts;
-	request_sending_--;
+
+	bool requested = false;
+	detail::RequestHeader hdr;
+	struct sockaddr_in from;
+	socklen_t len = sizeof(from);
+	ssize_t sts = 0;
+	while ((sts = recvfrom(request_socket_, &hdr, sizeof(hdr), MSG_DONTWAIT, reinterpret_cast<struct sockaddr*>(&from), &len)) >= 0)  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+	{
+		if (static_cast<size_t>(sts) == sizeof(hdr) && hdr.isValid() && hdr.mode == detail::RequestMessageMode::SnapshotRequest)
+		{
+			TLOG(TLVL_DEBUG + 33) << "Rank " << hdr.rank << " (" << inet_ntoa(from.sin_addr) << ") missed a request message, sending a snapshot";
+			requested = true;
+		}
+		len = sizeof(from);
+	}
+	return requested;
 }
 
 void RequestSender::SendRequest(bool endOfRunOnly)
@@ -212,11 +366,10 @@ void RequestSender::SendRequest(bool endOfRunOnly)
 		{
 			return;
 		}
+		last_request_send_time_ = std::chrono::steady_clock::now();
+		request_sending_++;
 	}
-	last_request_send_time_ = std::chrono::steady_clock::now();
-	request_sending_++;
-	boost::thread request([this] { do_send_request_(); });
-	request.detach();
+	request_cv_.notify_one();
 }
 
 void RequestSender::AddRequest(Fragment::sequence_id_t seqID, Fragment::timestamp_t timestamp)
@@ -226,21 +379,26 @@ void RequestSender::AddRequest(Fragment::sequence_id_t seqID, Fragment::timestam
 		usleep(1000);
 	}
 
+	bool recently_sent = false;
 	{
 		std::lock_guard<std::mutex> lk(request_mutex_);
 		if (active_requests_.count(seqID) == 0u)
 		{
 			TLOG(TLVL_DEBUG + 37) << "Adding request for sequence ID " << seqID << " and timestamp " << timestamp << " to request list.";
 			active_requests_[seqID] = timestamp;
+			// Only the send thread drains new_requests_
+			if (send_requests_)
+			{
+				new_requests_.push_back(seqID);
+			}
+			if (seqID >= next_sequence_id_)
+			{
+				next_sequence_id_ = seqID + 1;
+			}
 		}
-
-		while (active_requests_.size() > detail::RequestMessage::max_request_count())
-		{
-			TLOG(TLVL_WARNING) << "Erasing request with seqID " << active_requests_.begin()->first << " due to over-large request list size! (" << active_requests_.size() << " / " << detail::RequestMessage::max_request_count() << ")";
-			active_requests_.erase(active_requests_.begin());
-		}
+		recently_sent = TimeUtils::GetElapsedTimeMilliseconds(last_request_send_time_) < min_request_interval_ms_;
 	}
-	SendRequest(TimeUtils::GetElapsedTimeMilliseconds(last_request_send_time_) < min_request_interval_ms_);
+	SendRequest(recently_sent);
 }
 
 void RequestSender::RemoveRequest(Fragment::sequence_id_t seqID)
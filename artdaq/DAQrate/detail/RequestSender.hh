@@ -9,14 +9,20 @@
 #include "fhiclcpp/types/Name.h"
 #include "fhiclcpp/types/Table.h"
 
+#include <boost/thread.hpp>
+
 #include <arpa/inet.h>
 #include <netinet/in.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <cstdint>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <vector>
 
 namespace artdaq {
 
@@ -45,6 +51,8 @@ public:
 		fhicl::Atom<std::string> request_address{fhicl::Name{"request_address"}, fhicl::Comment{"Multicast address to send DataRequests to"}, "227.128.12.26"};
 		/// "min_request_interval_ms" (Default: 500): Minimum time between automatic sends (ignored in EndOfRun RequetsMode)
 		fhicl::Atom<size_t> min_request_interval_ms{fhicl::Name{"min_request_interval_ms"}, fhicl::Comment{"Minimum time between automatic sends (ignored in EndOfRun RequetsMode)"}, 100};
+		/// "request_snapshot_interval_ms" (Default: 1000): How often to send the full list of active requests, in addition to the snapshots receivers ask for when they join late or lose a message (0 to disable)
+		fhicl::Atom<size_t> request_snapshot_interval_ms{fhicl::Name{"request_snapshot_interval_ms"}, fhicl::Comment{"How often to send the full list of active requests, in addition to the snapshots receivers ask for when they join late or lose a message (0 to disable)"}, 1000};
 	};
 	/// Used for ParameterSet validation (if desired)
 	using Parameters = fhicl::WrappedTable<Config>;
@@ -81,6 +89,9 @@ public:
 	/**
 	 * \brief Set the mode for RequestMessages. Used to indicate when RequestSender should enter "EndOfRun" mode
 	 * \param mode Mode to set
+	 *
+	 * The mode change is announced with a full snapshot of the active requests. In EndOfRun mode, every send
+	 * carries all active requests, and sends are not coalesced.
 	 */
 	void SetRequestMode(detail::RequestMessageMode mode);
 
@@ -91,7 +102,7 @@ public:
 	detail::RequestMessageMode GetRequestMode() const { return request_mode_; }
 
 	/**
-	 * \brief Send a request message containing all current requests
+	 * \brief Wake the sender thread to send a request message containing all requests added since the last message
 	 * \param endOfRunOnly Whether the request should only be sent in EndOfRun RequestMessageMode (default: false)
 	 */
 	void SendRequest(bool endOfRunOnly = false);
@@ -129,8 +140,10 @@ private:
 	bool send_requests_;
 	std::atomic<bool> initialized_;
 	mutable std::mutex request_mutex_;
-	mutable std::mutex request_send_mutex_;
+	std::condition_variable request_cv_;
 	std::map<Fragment::sequence_id_t, Fragment::timestamp_t> active_requests_;
+	std::vector<Fragment::sequence_id_t> new_requests_;  // Added since the last message was sent; only kept if send_requests_
+	Fragment::sequence_id_t next_sequence_id_;           // One past the highest sequence ID ever requested
 	std::string request_address_;
 	int request_port_;
 	size_t request_delay_;
@@ -141,14 +154,26 @@ private:
 	detail::RequestMessageMode request_mode_;
 	std::chrono::steady_clock::time_point last_request_send_time_;
 	size_t min_request_interval_ms_;
+	size_t snapshot_interval_ms_;
+	std::chrono::steady_clock::time_point last_snapshot_time_;
+	bool snapshot_requested_;
+	uint32_t message_sequence_;  // Only used by the send thread
 
 	std::atomic<int> request_sending_;
 	uint32_t run_number_;
 
+	std::atomic<bool> stop_requested_;
+	boost::thread send_thread_;
+
 private:
 	void setup_requests_();
 
-	void do_send_request_();
+	void send_thread_proc_();
+
+	// Drain the SnapshotRequest messages receivers have sent back to request_socket_. Returns whether there were any
+	bool receive_snapshot_requests_();
+
+	void do_send_request_(std::vector<detail::RequestMessage>& messages);
 };
 }  // namespace artdaq
 #endif /* artdaq_DAQrate_RequestSender_hh */
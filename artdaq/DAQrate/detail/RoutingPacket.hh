@@ -4,6 +4,7 @@
 #include "TRACE/tracemf.h"  // Pre-empt TRACE/trace.h from Fragment.hh.
 #include "artdaq-core/Data/Fragment.hh"
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -16,10 +17,13 @@ struct RoutingPacketEntry;
  * should be sent, followed by &RoutingPacket.at(0) (the physical storage of the vector)
  */
 using RoutingPacket = std::vector<RoutingPacketEntry>;
+struct RoutingPacketRange;
 struct RoutingPacketHeader;
+struct RoutingTableUpdateHeader;
 struct RoutingConnectHeader;
 struct RoutingRequest;
 struct RoutingToken;
+struct RoutingTokenLoad;
 
 /**
  * \brief Mode indicating whether the RoutingManager is routing events by Sequence ID or by Send Count
@@ -93,31 +97,112 @@ struct artdaq::detail::RoutingPacketEntry
 	int32_t destination_rank{-1};                                      ///< The destination rank for this sequence ID
 };
 
+/**
+ * \brief A block of consecutive sequence IDs which are all routed to the same destination rank.
+ * Routing tables are sent as a RoutingPacketHeader followed by RoutingPacketRanges.
+ */
+struct artdaq::detail::RoutingPacketRange
+{
+	/**
+	 * \brief Default Constructor
+	 */
+	RoutingPacketRange() {}
+	/**
+	 * \brief Construct a RoutingPacketRange covering count sequence IDs starting at first
+	 * \param first The first sequence ID in the range
+	 * \param n The number of consecutive sequence IDs in the range
+	 * \param rank The destination rank for all sequence IDs in the range
+	 */
+	RoutingPacketRange(Fragment::sequence_id_t first, uint32_t n, int rank)
+	    : first_sequence_id(first), count(n), destination_rank(rank) {}
+
+	Fragment::sequence_id_t first_sequence_id{Fragment::InvalidSequenceID};  ///< The first sequence ID of the range
+	uint32_t count{0};                                                       ///< The number of consecutive sequence IDs in the range
+	int32_t destination_rank{-1};                                            ///< The destination rank for all sequence IDs in the range
+};
+
+namespace artdaq {
+namespace detail {
+/**
+ * \brief Range-encode a RoutingPacket, merging consecutive sequence IDs with the same destination rank
+ * \param packet RoutingPacket to encode
+ * \return List of RoutingPacketRanges covering the same entries as packet
+ */
+inline std::vector<RoutingPacketRange> EncodeRoutingPacket(RoutingPacket const& packet)
+{
+	std::vector<RoutingPacketRange> ranges;
+	for (auto const& entry : packet)
+	{
+		if (!ranges.empty())
+		{
+			auto& last = ranges.back();
+			if (last.destination_rank == entry.destination_rank && last.first_sequence_id + last.count == entry.sequence_id && last.count < UINT32_MAX)
+			{
+				last.count++;
+				continue;
+			}
+		}
+		ranges.emplace_back(entry.sequence_id, 1, entry.destination_rank);
+	}
+	return ranges;
+}
+}  // namespace detail
+}  // namespace artdaq
+
 /**
  * \brief Magic bytes expected in every RoutingPacketHeader
  */
 #define ROUTING_MAGIC 0x1337beef
 
 /**
- * \brief The header of the Routing Table, containing the magic bytes and the number of entries
+ * \brief The header of the Routing Table, containing the magic bytes, the number of entries and the number of RoutingPacketRanges which follow
  */
 struct artdaq::detail::RoutingPacketHeader
 {
 	uint32_t header{0};    ///< Magic bytes to make sure the packet wasn't garbled
-	uint64_t nEntries{0};  ///< The number of RoutingPacketEntries in the RoutingPacket
+	uint64_t nEntries{0};  ///< The number of sequence IDs routed by the RoutingPacket
+	uint64_t nRanges{0};   ///< The number of RoutingPacketRanges following the header
 
 	/**
-	 * \brief Construct a RoutingPacketHeader declaring a given number of entries
-	 * \param n The number of RoutingPacketEntries in the associated RoutingPacket
+	 * \brief Construct a RoutingPacketHeader declaring a given number of entries and ranges
+	 * \param n The number of sequence IDs routed by the associated RoutingPacket
+	 * \param ranges The number of RoutingPacketRanges following the header
 	 */
-	explicit RoutingPacketHeader(size_t n)
-	    : header(ROUTING_MAGIC), nEntries(n) {}
+	RoutingPacketHeader(size_t n, size_t ranges)
+	    : header(ROUTING_MAGIC), nEntries(n), nRanges(ranges) {}
 	/**
 	 * \brief Default Constructor
 	 */
 	RoutingPacketHeader() {}
 };
 
+/**
+ * \brief Magic bytes expected in every RoutingTableUpdateHeader
+ */
+#define ROUTING_UPDATE_MAGIC 0x1337cafe
+
+/**
+ * \brief Header of a routing table update published on the routing table multicast group. It is followed by a
+ * RoutingPacketHeader and its RoutingPacketRanges. Updates are numbered consecutively, so that receivers can detect
+ * the ones they missed and request them again over their table connection.
+ */
+struct artdaq::detail::RoutingTableUpdateHeader
+{
+	uint32_t header{0};         ///< Magic bytes to make sure the datagram is a routing table update
+	uint64_t update_number{0};  ///< Number of this update. The first update sent by a RoutingManager is 1
+
+	/**
+	 * \brief Construct a RoutingTableUpdateHeader for the given update number
+	 * \param n The number of the update
+	 */
+	explicit RoutingTableUpdateHeader(uint64_t n)
+	    : header(ROUTING_UPDATE_MAGIC), update_number(n) {}
+	/**
+	 * \brief Default Constructor
+	 */
+	RoutingTableUpdateHeader() {}
+};
+
 /**
  * @brief Represents a request sent to the RoutingManager for routing information
  */
@@ -131,6 +216,7 @@ struct artdaq::detail::RoutingRequest
 		Connect = 0,
 		Disconnect = 1,
 		Request = 2,
+		Resend = 3,  ///< Resend a multicast table update over the table connection. sequence_id holds the update number
 		Invalid = 255,
 	};
 
@@ -149,6 +235,8 @@ struct artdaq::detail::RoutingRequest
 				return "Disconnect";
 			case RequestMode::Request:
 				return "Request";
+			case RequestMode::Resend:
+				return "Resend";
 			case RequestMode::Invalid:
 				return "Invalid";
 		}
@@ -178,6 +266,15 @@ struct artdaq::detail::RoutingRequest
 	RoutingRequest(int r, Fragment::sequence_id_t seq)
 	    : header(ROUTING_MAGIC), rank(r), sequence_id(seq), mode(RequestMode::Request) {}
 
+	/**
+	 * @brief Create a RoutingRequest using the given rank, sequence ID and mode
+	 * @param r Rank of the requestor
+	 * @param seq Sequence ID of request, or update number in Resend mode
+	 * @param m Mode of this request
+	 */
+	RoutingRequest(int r, Fragment::sequence_id_t seq, RequestMode m)
+	    : header(ROUTING_MAGIC), rank(r), sequence_id(seq), mode(m) {}
+
 	RoutingRequest() {}  ///< Default constructor
 };
 
@@ -198,4 +295,21 @@ struct artdaq::detail::RoutingToken
 	unsigned run_number;      ///< The Run with which this token should be associated
 };
 
+/**
+ * \brief Magic bytes of a RoutingToken which is followed by a RoutingTokenLoad
+ */
+#define TOKEN_LOAD_MAGIC 0xbeefcaff
+
+/**
+ * \brief Occupancy of the token sender, sent after a RoutingToken whose header is TOKEN_LOAD_MAGIC.
+ * Load-aware RoutingManagerPolicies use it to choose between receivers which have free slots.
+ */
+struct artdaq::detail::RoutingTokenLoad
+{
+	uint32_t free_buffers{0};      ///< Number of shared memory buffers which are not in use
+	uint32_t art_queue_depth{0};   ///< Number of complete events waiting to be read by art
+	uint32_t build_latency_us{0};  ///< Recent average time from the first Fragment of an event to its completion, in microseconds
+	uint32_t reserved{0};          ///< Unused, keeps the message a multiple of 8 bytes
+};
+
 #endif  // artdaq_Application_Routing_RoutingPacket_hh
@@ -11,7 +11,11 @@
 #include <poll.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <algorithm>
+#include <array>
 #include <chrono>
+#include <cstring>
+#include <iterator>
 
 artdaq::TableReceiver::TableReceiver(const fhicl::ParameterSet& pset)
     : use_routing_manager_(pset.get<bool>("use_routing_manager", false))
@@ -19,6 +23,14 @@ artdaq::TableReceiver::TableReceiver(const fhicl::ParameterSet& pset)
     , table_port_(pset.get<int>("table_update_port", 35556))
     , table_address_(pset.get<std::string>("routing_manager_hostname", "localhost"))
     , table_socket_(-1)
+    , use_multicast_(pset.get<bool>("table_update_multicast", false))
+    , multicast_port_(0)
+    , multicast_interface_(pset.get<std::string>("multicast_interface_ip", "0.0.0.0"))
+    , multicast_socket_(-1)
+    , next_update_number_(0)
+    , max_resend_requests_(pset.get<size_t>("table_update_max_resend_requests", 100))
+    , missed_table_updates_(0)
+    , routing_table_entry_count_(0)
     , routing_table_last_(0)
     , routing_table_max_size_(pset.get<size_t>("routing_table_max_size", 1000))
     , routing_wait_time_(0)
@@ -30,6 +42,12 @@ artdaq::TableReceiver::TableReceiver(const fhicl::ParameterSet& pset)
 
 	if (use_routing_manager_)
 	{
+		if (use_multicast_)
+		{
+			multicast_address_ = pset.get<std::string>("table_update_multicast_address", portMan->GetRoutingTableGroupAddress());
+			multicast_port_ = pset.get<int>("table_update_multicast_port", portMan->GetRoutingTablePort());
+			setupMulticastListener_();
+		}
 		startTableReceiverThread_();
 	}
 }
@@ -53,21 +71,26 @@ artdaq::TableReceiver::~TableReceiver()
 		{  // IGNORED
 		}
 	}
+	if (multicast_socket_ != -1)
+	{
+		close(multicast_socket_);
+		multicast_socket_ = -1;
+	}
 	TLOG(TLVL_DEBUG + 32) << "Shutting down TableReceiver END.";
 }
 
 artdaq::TableReceiver::RoutingTable artdaq::TableReceiver::GetRoutingTable() const
 {
 	std::lock_guard<std::mutex> lk(routing_mutex_);
-	RoutingTable routing_table_copy(routing_table_);
-	return routing_table_copy;
+	return expandRoutingTable_();
 }
 
 artdaq::TableReceiver::RoutingTable artdaq::TableReceiver::GetAndClearRoutingTable()
 {
 	std::lock_guard<std::mutex> lk(routing_mutex_);
-	RoutingTable routing_table_copy(routing_table_);
+	auto routing_table_copy = expandRoutingTable_();
 	routing_table_.clear();
+	routing_table_entry_count_ = 0;
 	return routing_table_copy;
 }
 
@@ -86,11 +109,12 @@ int artdaq::TableReceiver::GetRoutingTableEntry(artdaq::Fragment::sequence_id_t
 		while (!should_stop_ && TimeUtils::GetElapsedTimeMilliseconds(start_time) < routing_timeout_ms)
 		{
 			std::unique_lock<std::mutex> lk(routing_mutex_);
-			routing_cv_.wait_for(lk, condition_wait, [&]() { return routing_table_.count(seqID); });
-			if (routing_table_.count(seqID))
+			routing_cv_.wait_for(lk, condition_wait, [&]() { return findRoute_(seqID) != ROUTING_FAILED; });
+			auto dest = findRoute_(seqID);
+			if (dest != ROUTING_FAILED)
 			{
 				routing_wait_time_.fetch_add(TimeUtils::GetElapsedTimeMicroseconds(start_time));
-				return routing_table_.at(seqID);
+				return dest;
 			}
 		}
 		TLOG(TLVL_WARNING) << "Bad Omen: Timeout receiving routing information for " << seqID
@@ -121,6 +145,9 @@ void artdaq::TableReceiver::connectToRoutingManager_()
 
 	detail::RoutingRequest startHdr(my_rank);
 	write(table_socket_, &startHdr, sizeof(startHdr));
+
+	// The RoutingManager may have been restarted, so the next multicast update number is not known
+	next_update_number_ = 0;
 }
 
 void artdaq::TableReceiver::disconnectFromRoutingManager_()
@@ -154,6 +181,51 @@ void artdaq::TableReceiver::startTableReceiverThread_()
 	}
 }
 
+void artdaq::TableReceiver::setupMulticastListener_()
+{
+	TLOG(TLVL_INFO) << "Setting up table update multicast socket, address=" << multicast_address_ << ":" << multicast_port_ << ", multicast interface=" << multicast_interface_;
+	multicast_socket_ = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, IPPROTO_UDP);
+	if (multicast_socket_ < 0)
+	{
+		TLOG(TLVL_ERROR) << "Error creating socket for receiving table updates! err=" << strerror(errno);
+		exit(1);
+	}
+
+	int yes = 1;
+	if (setsockopt(multicast_socket_, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes)) < 0)
+	{
+		TLOG(TLVL_ERROR) << "Unable to enable port reuse on table update socket, err=" << strerror(errno);
+		exit(1);
+	}
+	struct sockaddr_in si_me;
+	memset(&si_me, 0, sizeof(si_me));
+	si_me.sin_family = AF_INET;
+	si_me.sin_port = htons(multicast_port_);
+	si_me.sin_addr.s_addr = htonl(INADDR_ANY);
+	if (bind(multicast_socket_, reinterpret_cast<struct sockaddr*>(&si_me), sizeof(si_me)) == -1)  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+	{
+		TLOG(TLVL_ERROR) << "Cannot bind table update socket to port " << multicast_port_ << ", err=" << strerror(errno);
+		exit(1);
+	}
+
+	struct ip_mreq mreq;
+	if (ResolveHost(multicast_address_.c_str(), mreq.imr_multiaddr) == -1)
+	{
+		TLOG(TLVL_ERROR) << "Unable to resolve table update multicast address, err=" << strerror(errno);
+		exit(1);
+	}
+	if (GetInterfaceForNetwork(multicast_interface_.c_str(), mreq.imr_interface) == -1)
+	{
+		TLOG(TLVL_ERROR) << "Unable to determine the multicast network interface for " << multicast_interface_;
+		exit(1);
+	}
+	if (setsockopt(multicast_socket_, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0)
+	{
+		TLOG(TLVL_ERROR) << "Unable to join table update multicast group, err=" << strerror(errno);
+		exit(1);
+	}
+}
+
 bool artdaq::TableReceiver::receiveTableUpdate_()
 {
 	TLOG(TLVL_DEBUG + 33) << __func__ << ": Polling table socket for new routes (address:port = " << table_address_ << ":" << table_port_ << ")";
@@ -168,123 +240,194 @@ bool artdaq::TableReceiver::receiveTableUpdate_()
 		return false;
 	}
 
-	struct pollfd fd;
-	fd.fd = table_socket_;
-	fd.events = POLLIN | POLLPRI;
+	std::array<struct pollfd, 2> fds;
+	fds[0].fd = table_socket_;
+	fds[0].events = POLLIN | POLLPRI;
+	fds[1].fd = multicast_socket_;
+	fds[1].events = POLLIN;
+
+	auto res = poll(fds.data(), multicast_socket_ != -1 ? 2 : 1, 1000);
+	if (res <= 0)
+	{
+		return false;
+	}
+
+	bool updated = false;
+	if (multicast_socket_ != -1 && (fds[1].revents & POLLIN) != 0)
+	{
+		updated = receiveMulticastTableUpdates_();
+	}
+	if ((fds[0].revents & (POLLIN | POLLPRI)) != 0)
+	{
+		updated = receiveTCPTableUpdate_() || updated;
+	}
+	else if (fds[0].revents != 0)
+	{
+		TLOG(TLVL_DEBUG + 32) << "Poll indicates socket closure. Disconnecting from Routing Manager";
+		disconnectFromRoutingManager_();
+	}
+	return updated;
+}
+
+bool artdaq::TableReceiver::receiveTCPTableUpdate_()
+{
+	TLOG(TLVL_DEBUG + 32) << __func__ << ": Going to receive RoutingPacketHeader";
+	artdaq::detail::RoutingPacketHeader hdr;
+	ssize_t stss = recv(table_socket_, &hdr, sizeof(hdr), MSG_WAITALL);
+	if (stss != sizeof(hdr))
+	{
+		TLOG(TLVL_ERROR) << "Error reading Table Header from Table socket, errno=" << errno << " (" << strerror(errno) << ")";
+		disconnectFromRoutingManager_();
+		return false;
+	}
+
+	TLOG(TLVL_DEBUG + 32) << "receiveTableUpdatesLoop_: Checking for valid header with nEntries=" << hdr.nEntries << ", nRanges=" << hdr.nRanges << " header=" << std::hex << hdr.header;
+	if (hdr.header != ROUTING_MAGIC)
+	{
+		TLOG(TLVL_DEBUG + 33) << __func__ << ": non-RoutingPacket received. No ROUTING_MAGIC.";
+		return false;
+	}
+	if (hdr.nEntries == 0 || hdr.nRanges == 0)
+	{
+		TLOG(TLVL_DEBUG + 33) << __func__ << ": Empty Routing Table update received.";
+		return false;
+	}
 
-	auto res = poll(&fd, 1, 1000);
-	if (res > 0)
+	std::vector<artdaq::detail::RoutingPacketRange> buffer(hdr.nRanges);
+	size_t sts = 0;
+	size_t total = sizeof(artdaq::detail::RoutingPacketRange) * hdr.nRanges;
+	while (sts < total)
 	{
-		if (fd.revents & (POLLIN | POLLPRI))
+		stss = read(table_socket_, reinterpret_cast<char*>(&buffer[0]) + sts, total - sts);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		sts += stss;
+		TLOG(TLVL_DEBUG + 32) << "Read " << stss << " bytes, total " << sts << " / " << total;
+		if (stss < 0)
 		{
-			TLOG(TLVL_DEBUG + 32) << __func__ << ": Going to receive RoutingPacketHeader";
-			artdaq::detail::RoutingPacketHeader hdr;
-			ssize_t stss = recv(table_socket_, &hdr, sizeof(hdr), MSG_WAITALL);
-			if (stss != sizeof(hdr))
-			{
-				TLOG(TLVL_ERROR) << "Error reading Table Header from Table socket, errno=" << errno << " (" << strerror(errno) << ")";
-				disconnectFromRoutingManager_();
-				return false;
-			}
+			TLOG(TLVL_ERROR) << "Error reading Table Data from Table socket, errno=" << errno << " (" << strerror(errno) << ")";
+			disconnectFromRoutingManager_();
+			return false;
+		}
+	}
 
-			TLOG(TLVL_DEBUG + 32) << "receiveTableUpdatesLoop_: Checking for valid header with nEntries=" << hdr.nEntries << " header=" << std::hex << hdr.header;
-			if (hdr.header != ROUTING_MAGIC)
-			{
-				TLOG(TLVL_DEBUG + 33) << __func__ << ": non-RoutingPacket received. No ROUTING_MAGIC.";
-				return false;
-			}
-			if (hdr.nEntries == 0)
-			{
-				TLOG(TLVL_DEBUG + 33) << __func__ << ": Empty Routing Table update received.";
-				return false;
-			}
+	return applyTableUpdate_(hdr, buffer);
+}
 
-			artdaq::detail::RoutingPacket buffer(hdr.nEntries);
-			size_t sts = 0;
-			size_t total = sizeof(artdaq::detail::RoutingPacketEntry) * hdr.nEntries;
-			while (sts < total)
+bool artdaq::TableReceiver::receiveMulticastTableUpdates_()
+{
+	bool updated = false;
+	std::vector<uint8_t> datagram(65536);
+	while (true)
+	{
+		auto sts = recv(multicast_socket_, datagram.data(), datagram.size(), MSG_DONTWAIT);
+		if (sts < 0)
+		{
+			if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
 			{
-				stss = read(table_socket_, reinterpret_cast<char*>(&buffer[0]) + sts, total - sts);
-				sts += stss;
-				TLOG(TLVL_DEBUG + 32) << "Read " << stss << " bytes, total " << sts << " / " << total;
-				if (stss < 0)
-				{
-					TLOG(TLVL_ERROR) << "Error reading Table Data from Table socket, errno=" << errno << " (" << strerror(errno) << ")";
-					disconnectFromRoutingManager_();
-					return false;
-				}
+				TLOG(TLVL_ERROR) << "Error reading from table update multicast socket, errno=" << errno << " (" << strerror(errno) << ")";
 			}
+			return updated;
+		}
 
-			auto first = buffer.front().sequence_id;
-			auto last = buffer.back().sequence_id;
+		detail::RoutingTableUpdateHeader update_hdr;
+		detail::RoutingPacketHeader hdr;
+		if (static_cast<size_t>(sts) < sizeof(update_hdr) + sizeof(hdr))
+		{
+			TLOG(TLVL_DEBUG + 33) << __func__ << ": Datagram of " << sts << " bytes is too short for a table update";
+			continue;
+		}
+		memcpy(&update_hdr, datagram.data(), sizeof(update_hdr));
+		memcpy(&hdr, datagram.data() + sizeof(update_hdr), sizeof(hdr));  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		if (update_hdr.header != ROUTING_UPDATE_MAGIC || hdr.header != ROUTING_MAGIC ||
+		    static_cast<size_t>(sts) != sizeof(update_hdr) + sizeof(hdr) + hdr.nRanges * sizeof(detail::RoutingPacketRange))
+		{
+			TLOG(TLVL_DEBUG + 33) << __func__ << ": Received a datagram which is not a valid table update";
+			continue;
+		}
 
-			if (first + hdr.nEntries - 1 != last)
+		auto number = update_hdr.update_number;
+		uint64_t expected = next_update_number_;
+		if (expected != 0 && number > expected)
+		{
+			// Request the updates which were lost. Resent updates arrive on the table connection.
+			auto missed = number - expected;
+			missed_table_updates_ += missed;
+			auto first = missed > max_resend_requests_ ? number - max_resend_requests_ : expected;
+			TLOG(TLVL_DEBUG + 32) << __func__ << ": Missed table updates " << expected << "-" << number - 1 << ", requesting " << first << "-" << number - 1 << " again";
+			for (auto missing = first; missing < number && table_socket_ != -1; ++missing)
 			{
-				TLOG(TLVL_ERROR) << __func__ << ": Skipping this RoutingPacket because the first (" << first << ") and last (" << last << ") entries are inconsistent (sz=" << hdr.nEntries << ")!";
-				return false;
+				detail::RoutingRequest pkt(my_rank, missing, detail::RoutingRequest::RequestMode::Resend);
+				write(table_socket_, &pkt, sizeof(pkt));
 			}
+		}
+		if (expected == 0 || number >= expected)
+		{
+			next_update_number_ = number + 1;
+		}
 
-			auto thisSeqID = first;
+		if (hdr.nEntries == 0 || hdr.nRanges == 0)
+		{
+			continue;
+		}
+		std::vector<detail::RoutingPacketRange> buffer(hdr.nRanges);
+		memcpy(buffer.data(), datagram.data() + sizeof(update_hdr) + sizeof(hdr), hdr.nRanges * sizeof(detail::RoutingPacketRange));  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		updated = applyTableUpdate_(hdr, buffer) || updated;
+	}
+}
 
-			{
-				std::lock_guard<std::mutex> lck(routing_mutex_);
-				if (routing_table_.count(last) == 0)
-				{
-					for (auto entry : buffer)
-					{
-						if (thisSeqID != entry.sequence_id)
-						{
-							TLOG(TLVL_ERROR) << __func__ << ": Aborting processing of this RoutingPacket because I encountered an inconsistent entry (seqid=" << entry.sequence_id << ", expected=" << thisSeqID << ")!";
-							last = thisSeqID - 1;
-							break;
-						}
-						thisSeqID++;
-						if (routing_table_.count(entry.sequence_id) != 0u)
-						{
-							if (routing_table_[entry.sequence_id] != entry.destination_rank)
-							{
-								TLOG(TLVL_ERROR) << __func__ << ": Detected routing table corruption! Recevied update specifying that sequence ID " << entry.sequence_id
-								                 << " should go to rank " << entry.destination_rank << ", but I had already been told to send it to " << routing_table_[entry.sequence_id] << "!"
-								                 << " I will use the original value!";
-							}
-							continue;
-						}
-						if (entry.sequence_id < routing_table_last_)
-						{
-							continue;
-						}
-						routing_table_[entry.sequence_id] = entry.destination_rank;
-						TLOG(TLVL_DEBUG + 32) << __func__ << ": (my_rank=" << my_rank << ") received update: SeqID " << entry.sequence_id
-						                      << " -> Rank " << entry.destination_rank;
-					}
-				}
+bool artdaq::TableReceiver::applyTableUpdate_(detail::RoutingPacketHeader const& hdr, std::vector<detail::RoutingPacketRange> const& buffer)
+{
+	auto first = buffer.front().first_sequence_id;
+	auto last = buffer.back().first_sequence_id + buffer.back().count - 1;
+
+	if (first + hdr.nEntries - 1 != last)
+	{
+		TLOG(TLVL_ERROR) << __func__ << ": Skipping this RoutingPacket because the first (" << first << ") and last (" << last << ") entries are inconsistent (sz=" << hdr.nEntries << ")!";
+		return false;
+	}
 
-				TLOG(TLVL_DEBUG + 32) << __func__ << ": There are now " << routing_table_.size() << " entries in the Routing Table";
-				if (!routing_table_.empty())
+	auto thisSeqID = first;
+
+	{
+		std::lock_guard<std::mutex> lck(routing_mutex_);
+		if (findRoute_(last) == ROUTING_FAILED)
+		{
+			for (auto const& range : buffer)
+			{
+				if (thisSeqID != range.first_sequence_id)
 				{
-					TLOG(TLVL_DEBUG + 32) << __func__ << ": Last routing table entry is seqID=" << routing_table_.rbegin()->first;
+					TLOG(TLVL_ERROR) << __func__ << ": Aborting processing of this RoutingPacket because I encountered an inconsistent entry (seqid=" << range.first_sequence_id << ", expected=" << thisSeqID << ")!";
+					break;
 				}
+				thisSeqID += range.count;
 
-				auto counter = 0;
-				for (auto& entry : routing_table_)
+				auto range_first = std::max(range.first_sequence_id, routing_table_last_);
+				if (range_first >= thisSeqID)
 				{
-					TLOG(TLVL_DEBUG + 40) << "Routing Table Entry" << counter << ": " << entry.first << " -> " << entry.second;
-					counter++;
+					continue;
 				}
+				insertRoutes_(range_first, thisSeqID - range_first, range.destination_rank);
+				TLOG(TLVL_DEBUG + 32) << __func__ << ": (my_rank=" << my_rank << ") received update: SeqIDs " << range_first << "-" << thisSeqID - 1
+				                      << " -> Rank " << range.destination_rank;
 			}
-			routing_cv_.notify_all();
+		}
 
-			SendMetrics();
-			return true;
+		TLOG(TLVL_DEBUG + 32) << __func__ << ": There are now " << routing_table_entry_count_ << " entries in " << routing_table_.size() << " ranges in the Routing Table";
+		if (!routing_table_.empty())
+		{
+			TLOG(TLVL_DEBUG + 32) << __func__ << ": Last routing table entry is seqID=" << routing_table_.rbegin()->first + routing_table_.rbegin()->second.count - 1;
 		}
-		else
+
+		auto counter = 0;
+		for (auto& entry : routing_table_)
 		{
-			TLOG(TLVL_DEBUG + 32) << "Poll indicates socket closure. Disconnecting from Routing Manager";
-			disconnectFromRoutingManager_();
-			return false;
+			TLOG(TLVL_DEBUG + 40) << "Routing Table Range " << counter << ": " << entry.first << "-" << entry.first + entry.second.count - 1 << " -> " << entry.second.destination_rank;
+			counter++;
 		}
 	}
-	return false;
+	routing_cv_.notify_all();
+
+	SendMetrics();
+	return true;
 }
 
 void artdaq::TableReceiver::receiveTableUpdatesLoop_()
@@ -307,9 +450,10 @@ void artdaq::TableReceiver::sendTableUpdateRequest_(Fragment::sequence_id_t seq)
 	TLOG(TLVL_DEBUG + 33) << "sendTableUpdateRequest_ BEGIN";
 	{
 		std::lock_guard<std::mutex> lck(routing_mutex_);
-		if (routing_table_.count(seq))
+		auto dest = findRoute_(seq);
+		if (dest != ROUTING_FAILED)
 		{
-			TLOG(TLVL_DEBUG + 33) << "sendTableUpdateRequest_ END (no request sent): " << routing_table_.at(seq);
+			TLOG(TLVL_DEBUG + 33) << "sendTableUpdateRequest_ END (no request sent): " << dest;
 			return;
 		}
 	}
@@ -328,14 +472,23 @@ void artdaq::TableReceiver::sendTableUpdateRequest_(Fragment::sequence_id_t seq)
 size_t artdaq::TableReceiver::GetRoutingTableEntryCount() const
 {
 	std::lock_guard<std::mutex> lck(routing_mutex_);
-	return routing_table_.size();
+	return routing_table_entry_count_;
 }
 
 size_t artdaq::TableReceiver::GetRemainingRoutingTableEntries() const
 {
 	std::lock_guard<std::mutex> lck(routing_mutex_);
-	// Find the distance from the next highest sequence ID to the end of the list
-	size_t dist = std::distance(routing_table_.upper_bound(highest_sequence_id_routed_), routing_table_.end());
+	// Count the entries above the highest sequence ID routed
+	size_t dist = 0;
+	for (auto it = routing_table_.rbegin(); it != routing_table_.rend(); ++it)
+	{
+		auto range_last = it->first + it->second.count - 1;
+		if (range_last <= highest_sequence_id_routed_)
+		{
+			break;
+		}
+		dist += it->first > highest_sequence_id_routed_ ? it->second.count : range_last - highest_sequence_id_routed_;
+	}
 	return dist;  // If dist == 1, there is one entry left.
 }
 
@@ -347,12 +500,115 @@ void artdaq::TableReceiver::RemoveRoutingTableEntry(Fragment::sequence_id_t seq)
 	//	{
 	//		routing_table_.erase(routing_table_.begin());
 	//	}
-	if (routing_table_.find(seq) != routing_table_.end())
+	eraseRoute_(seq);
+}
+
+int artdaq::TableReceiver::findRoute_(Fragment::sequence_id_t seq) const
+{
+	auto it = routing_table_.upper_bound(seq);
+	if (it == routing_table_.begin())
+	{
+		return ROUTING_FAILED;
+	}
+	--it;
+	return seq - it->first < it->second.count ? it->second.destination_rank : ROUTING_FAILED;
+}
+
+void artdaq::TableReceiver::insertRoutes_(Fragment::sequence_id_t first, Fragment::sequence_id_t count, int rank)
+{
+	auto cur = first;
+	auto end = first + count;
+	while (cur < end)
+	{
+		auto next = routing_table_.upper_bound(cur);
+		auto prev = next == routing_table_.begin() ? routing_table_.end() : std::prev(next);
+		if (prev != routing_table_.end() && cur < prev->first + prev->second.count)
+		{
+			auto overlap_end = std::min(end, prev->first + prev->second.count);
+			if (prev->second.destination_rank != rank)
+			{
+				TLOG(TLVL_ERROR) << __func__ << ": Detected routing table corruption! Recevied update specifying that sequence IDs " << cur << "-" << overlap_end - 1
+				                 << " should go to rank " << rank << ", but I had already been told to send them to " << prev->second.destination_rank << "!"
+				                 << " I will use the original value!";
+			}
+			cur = overlap_end;
+			continue;
+		}
+
+		auto stop = (next != routing_table_.end() && next->first < end) ? next->first : end;
+		RouteRangeMap::iterator range;
+		if (prev != routing_table_.end() && prev->first + prev->second.count == cur && prev->second.destination_rank == rank)
+		{
+			range = prev;
+			range->second.count += stop - cur;
+		}
+		else
+		{
+			range = routing_table_.emplace_hint(next, cur, RouteRange{stop - cur, rank});
+		}
+		if (next != routing_table_.end() && next->first == stop && next->second.destination_rank == rank)
+		{
+			range->second.count += next->second.count;
+			routing_table_.erase(next);
+		}
+		routing_table_entry_count_ += stop - cur;
+		cur = stop;
+	}
+}
+
+void artdaq::TableReceiver::eraseRoute_(Fragment::sequence_id_t seq)
+{
+	auto it = routing_table_.upper_bound(seq);
+	if (it == routing_table_.begin())
+	{
+		return;
+	}
+	--it;
+	auto range_first = it->first;
+	auto& range = it->second;
+	if (seq - range_first >= range.count)
+	{
+		return;
+	}
+
+	routing_table_entry_count_--;
+	if (range.count == 1)
+	{
+		routing_table_.erase(it);
+	}
+	else if (seq == range_first)
+	{
+		// Re-key the range in place, sequence IDs are usually removed in order
+		auto node = routing_table_.extract(it);
+		node.key() = seq + 1;
+		node.mapped().count--;
+		routing_table_.insert(std::move(node));
+	}
+	else if (seq == range_first + range.count - 1)
+	{
+		range.count--;
+	}
+	else
 	{
-		routing_table_.erase(routing_table_.find(seq));
+		RouteRange tail{range_first + range.count - seq - 1, range.destination_rank};
+		range.count = seq - range_first;
+		routing_table_.emplace_hint(std::next(it), seq + 1, tail);
 	}
 }
 
+artdaq::TableReceiver::RoutingTable artdaq::TableReceiver::expandRoutingTable_() const
+{
+	RoutingTable output;
+	for (auto const& range : routing_table_)
+	{
+		for (Fragment::sequence_id_t seq = range.first; seq < range.first + range.second.count; ++seq)
+		{
+			output.emplace_hint(output.end(), seq, range.second.destination_rank);
+		}
+	}
+	return output;
+}
+
 void artdaq::TableReceiver::SendMetrics() const
 {
 	if (metricMan)
@@ -361,6 +617,10 @@ void artdaq::TableReceiver::SendMetrics() const
 		if (use_routing_manager_)
 		{
 			metricMan->sendMetric("Routing Table Size", GetRoutingTableEntryCount(), "events", 2, MetricMode::LastPoint);
+			if (use_multicast_)
+			{
+				metricMan->sendMetric("Missed Table Updates", missed_table_updates_.load(), "updates", 2, MetricMode::LastPoint);
+			}
 			if (routing_wait_time_ > 0)
 			{
 				metricMan->sendMetric("Routing Wait Time", static_cast<double>(routing_wait_time_.load()) / 1000000, "s", 2, MetricMode::Average);
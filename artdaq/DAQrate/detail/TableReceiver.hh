@@ -3,6 +3,7 @@
 
 #include "TRACE/tracemf.h"  // Pre-empt TRACE/trace.h from Fragment.hh.
 #include "artdaq-core/Data/Fragment.hh"
+#include "artdaq/DAQrate/detail/RoutingPacket.hh"
 
 namespace fhicl {
 class ParameterSet;
@@ -12,6 +13,7 @@ class ParameterSet;
 #include "fhiclcpp/types/Comment.h"
 #include "fhiclcpp/types/ConfigurationTable.h"
 #include "fhiclcpp/types/Name.h"
+#include "fhiclcpp/types/OptionalAtom.h"
 #include "fhiclcpp/types/OptionalTable.h"
 #include "fhiclcpp/types/TableFragment.h"
 
@@ -22,6 +24,7 @@ class ParameterSet;
 #include <map>
 #include <memory>
 #include <set>
+#include <vector>
 
 namespace artdaq {
 class TableReceiver;
@@ -55,11 +58,21 @@ public:
 		fhicl::Atom<int> routing_timeout_ms{fhicl::Name{"routing_timeout_ms"}, fhicl::Comment{"Time to wait (in ms) for a routing table update"}, 1000};
 		///   "routing_table_max_size" (Default: 1000): Maximum number of entries in the routing table
 		fhicl::Atom<size_t> routing_table_max_size{fhicl::Name{"routing_table_max_size"}, fhicl::Comment{"Maximum number of entries in the routing table"}, 1000};
+		///   "table_update_multicast" (Default: false): True if the RoutingManager publishes table updates on a multicast group. Missed updates are requested over the table connection.
+		fhicl::Atom<bool> table_update_multicast{fhicl::Name{"table_update_multicast"}, fhicl::Comment{"True if the RoutingManager publishes table updates on a multicast group. Missed updates are requested over the table connection."}, false};
+		///   "table_update_multicast_address" (Default: PortManager routing table group): Multicast group on which table updates are published
+		fhicl::OptionalAtom<std::string> table_update_multicast_address{fhicl::Name{"table_update_multicast_address"}, fhicl::Comment{"Multicast group on which table updates are published. Default is the PortManager routing table group"}};
+		///   "table_update_multicast_port" (Default: PortManager routing table port): Port on which table updates are published
+		fhicl::OptionalAtom<int> table_update_multicast_port{fhicl::Name{"table_update_multicast_port"}, fhicl::Comment{"Port on which table updates are published. Default is the PortManager routing table port"}};
+		///   "multicast_interface_ip" (Default: "0.0.0.0"): Address of the network on which to receive table updates
+		fhicl::Atom<std::string> multicast_interface_ip{fhicl::Name{"multicast_interface_ip"}, fhicl::Comment{"Address of the network on which to receive table updates"}, "0.0.0.0"};
+		///   "table_update_max_resend_requests" (Default: 100): Maximum number of missed table updates to request at once. Routes from older ones are requested by sequence ID when needed.
+		fhicl::Atom<size_t> table_update_max_resend_requests{fhicl::Name{"table_update_max_resend_requests"}, fhicl::Comment{"Maximum number of missed table updates to request at once. Routes from older ones are requested by sequence ID when needed."}, 100};
 	};
 	/// Used for ParameterSet validation (if desired)
 	using Parameters = fhicl::WrappedTable<Config>;
 
-	using RoutingTable = std::map<artdaq::Fragment::sequence_id_t, int>;  ///< Internal representation of a routing table, relating a sequence ID to a destination rank
+	using RoutingTable = std::map<artdaq::Fragment::sequence_id_t, int>;  ///< Expanded representation of a routing table, relating a sequence ID to a destination rank
 
 	static constexpr int ROUTING_FAILED = -1111;  ///< Value used to indicate that a route was not properly generated
 
@@ -75,7 +88,7 @@ public:
 	virtual ~TableReceiver();
 
 	/**
-	 * @brief Get a copy of the current RoutingTable
+	 * @brief Get a copy of the current RoutingTable, with one entry per sequence ID
 	 */
 	RoutingTable GetRoutingTable() const;
 
@@ -124,6 +137,11 @@ public:
 	 */
 	bool RoutingManagerEnabled() const { return use_routing_manager_; }
 
+	/**
+	 * @brief Get the number of multicast table updates which were not received, and had to be requested again
+	 */
+	size_t GetMissedTableUpdateCount() const { return missed_table_updates_; }
+
 private:
 	TableReceiver(TableReceiver const&) = delete;
 	TableReceiver(TableReceiver&&) = delete;
@@ -135,18 +153,46 @@ private:
 
 	void startTableReceiverThread_();
 
+	void setupMulticastListener_();
+
 	bool receiveTableUpdate_();
+	bool receiveTCPTableUpdate_();
+	bool receiveMulticastTableUpdates_();
+	bool applyTableUpdate_(detail::RoutingPacketHeader const& hdr, std::vector<detail::RoutingPacketRange> const& buffer);
 	void receiveTableUpdatesLoop_();
 
 	void sendTableUpdateRequest_(Fragment::sequence_id_t seq);
 
+	// These functions must be called with routing_mutex_ held
+	int findRoute_(Fragment::sequence_id_t seq) const;
+	void insertRoutes_(Fragment::sequence_id_t first, Fragment::sequence_id_t count, int rank);
+	void eraseRoute_(Fragment::sequence_id_t seq);
+	RoutingTable expandRoutingTable_() const;
+
 private:
+	/// Consecutive sequence IDs routed to the same destination are stored as a single range
+	struct RouteRange
+	{
+		Fragment::sequence_id_t count;  ///< Number of consecutive sequence IDs in the range
+		int destination_rank;           ///< Destination rank for the range
+	};
+	using RouteRangeMap = std::map<Fragment::sequence_id_t, RouteRange>;  ///< First sequence ID of a range -> RouteRange
+
 	bool use_routing_manager_;
 	std::atomic<bool> should_stop_;
 	int table_port_;
 	std::string table_address_;
 	int table_socket_;
-	RoutingTable routing_table_;
+	bool use_multicast_;
+	std::string multicast_address_;
+	int multicast_port_;
+	std::string multicast_interface_;
+	int multicast_socket_;
+	std::atomic<uint64_t> next_update_number_;  // 0 until the first multicast update since connecting to the RoutingManager
+	size_t max_resend_requests_;
+	std::atomic<size_t> missed_table_updates_;
+	RouteRangeMap routing_table_;
+	size_t routing_table_entry_count_;
 	Fragment::sequence_id_t routing_table_last_;
 	size_t routing_table_max_size_;
 	mutable std::mutex routing_mutex_;
@@ -2,13 +2,18 @@
 #define TRACE_NAME (app_name + "_TokenReceiver").c_str()
 
 #include <arpa/inet.h>
+#include <sys/eventfd.h>
 
+#include <cstring>
 #include <utility>
 
 #include <utility>
 #include "artdaq/DAQdata/TCP_listen_fd.hh"
 #include "artdaq/DAQrate/detail/TokenReceiver.hh"
 
+// TokenSender coalesces tokens, so a single read may return several of them
+static constexpr size_t token_read_size = 64 * sizeof(artdaq::detail::RoutingToken);
+
 artdaq::TokenReceiver::TokenReceiver(const fhicl::ParameterSet& ps, std::shared_ptr<RoutingManagerPolicy> policy,
                                      size_t update_interval_msec)
     : token_port_(ps.get<int>("routing_token_port", 35555))
@@ -23,11 +28,20 @@ artdaq::TokenReceiver::TokenReceiver(const fhicl::ParameterSet& ps, std::shared_
     , statsHelperPtr_(nullptr)
 {
 	receive_token_events_ = std::vector<epoll_event>(policy_->GetReceiverCount() + 1);
+	token_event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (token_event_fd_ == -1)
+	{
+		TLOG(TLVL_WARNING) << "Could not create token eventfd, errno=" << errno << " (" << strerror(errno) << ")";
+	}
 }
 
 artdaq::TokenReceiver::~TokenReceiver()
 {
 	stopTokenReception(true);
+	if (token_event_fd_ != -1)
+	{
+		close(token_event_fd_);
+	}
 }
 
 void artdaq::TokenReceiver::startTokenReception()
@@ -104,7 +118,7 @@ void artdaq::TokenReceiver::receiveTokensLoop_()
 		if (token_socket_ == -1)
 		{
 			TLOG(TLVL_DEBUG + 32) << "Opening token listener socket";
-			token_socket_ = TCP_listen_fd(token_port_, 3 * sizeof(detail::RoutingToken));
+			token_socket_ = TCP_listen_fd(token_port_, token_read_size);
 
 			if (token_epoll_fd_ != -1)
 			{
@@ -140,6 +154,7 @@ void artdaq::TokenReceiver::receiveTokensLoop_()
 		}
 
 		TLOG(TLVL_DEBUG + 35) << "Received " << nfds << " events on token sockets";
+		bool tokens_added = false;
 		for (auto n = 0; n < nfds; ++n)
 		{
 			if (receive_token_events_[n].data.fd == token_socket_)
@@ -173,14 +188,19 @@ void artdaq::TokenReceiver::receiveTokensLoop_()
 			{
 				auto startTime = artdaq::MonitoredQuantity::getCurrentTime();
 
-				detail::RoutingToken buff;
-				int sts = recv(receive_token_events_[n].data.fd, &buff, sizeof(detail::RoutingToken), MSG_WAITALL);
+				auto fd = receive_token_events_[n].data.fd;
+				auto& token_buffer = receive_token_buffers_[fd];
+				auto offset = token_buffer.size();
+				token_buffer.resize(offset + token_read_size);
+				int sts = recv(fd, &token_buffer[offset], token_read_size, 0);
+				token_buffer.resize(offset + (sts > 0 ? sts : 0));
 				if (sts == 0)
 				{
-					TLOG(TLVL_WARNING) << "Received 0-size token from " << receive_token_addrs_[receive_token_events_[n].data.fd] << ", closing socket";
-					receive_token_addrs_.erase(receive_token_events_[n].data.fd);
-					close(receive_token_events_[n].data.fd);
-					epoll_ctl(token_epoll_fd_, EPOLL_CTL_DEL, receive_token_events_[n].data.fd, nullptr);
+					TLOG(TLVL_WARNING) << "Received 0-size token from " << receive_token_addrs_[fd] << ", closing socket";
+					receive_token_addrs_.erase(fd);
+					receive_token_buffers_.erase(fd);
+					close(fd);
+					epoll_ctl(token_epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
 				}
 				else if (sts < 0 && errno == EAGAIN)
 				{
@@ -189,26 +209,56 @@ void artdaq::TokenReceiver::receiveTokensLoop_()
 				else if (sts < 0)
 				{
 					TLOG(TLVL_ERROR) << "Error reading from token socket: sts=" << sts << ", errno=" << errno;
-					receive_token_addrs_.erase(receive_token_events_[n].data.fd);
-					close(receive_token_events_[n].data.fd);
-					epoll_ctl(token_epoll_fd_, EPOLL_CTL_DEL, receive_token_events_[n].data.fd, nullptr);
-				}
-				else if (sts == sizeof(detail::RoutingToken) && buff.header != TOKEN_MAGIC)
-				{
-					TLOG(TLVL_ERROR) << "Received invalid token from " << receive_token_addrs_[receive_token_events_[n].data.fd] << " sts=" << sts;
+					receive_token_addrs_.erase(fd);
+					receive_token_buffers_.erase(fd);
+					close(fd);
+					epoll_ctl(token_epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
 				}
-				else if (sts == sizeof(detail::RoutingToken))
+				else
 				{
-					TLOG(TLVL_DEBUG + 32) << "Received token from " << buff.rank << " indicating " << buff.new_slots_free << " slots are free. (run=" << buff.run_number << ")";
-					if (buff.run_number != run_number_)
+					// A single read may contain several tokens; process every complete one and keep any remainder
+					size_t pos = 0;
+					while (token_buffer.size() - pos >= sizeof(detail::RoutingToken))
 					{
-						TLOG(TLVL_DEBUG + 32) << "Received token from a different run number! Current = " << run_number_ << ", token = " << buff.run_number << ", ignoring (n=" << buff.new_slots_free << ")";
-					}
-					else
-					{
-						received_token_count_ += buff.new_slots_free;
-						policy_->AddReceiverToken(buff.rank, buff.new_slots_free);
+						detail::RoutingToken buff;
+						memcpy(&buff, &token_buffer[pos], sizeof(detail::RoutingToken));
+						if (buff.header != TOKEN_MAGIC && buff.header != TOKEN_LOAD_MAGIC)
+						{
+							TLOG(TLVL_ERROR) << "Received invalid token from " << receive_token_addrs_[fd] << ", discarding " << token_buffer.size() - pos << " buffered bytes";
+							pos = token_buffer.size();
+							break;
+						}
+						bool has_load = buff.header == TOKEN_LOAD_MAGIC;
+						detail::RoutingTokenLoad load;
+						if (has_load)
+						{
+							if (token_buffer.size() - pos < sizeof(detail::RoutingToken) + sizeof(detail::RoutingTokenLoad))
+							{
+								break;  // The rest of the token has not arrived yet
+							}
+							memcpy(&load, &token_buffer[pos + sizeof(detail::RoutingToken)], sizeof(detail::RoutingTokenLoad));
+							pos += sizeof(detail::RoutingTokenLoad);
+						}
+						pos += sizeof(detail::RoutingToken);
+
+						TLOG(TLVL_DEBUG + 32) << "Received token from " << buff.rank << " indicating " << buff.new_slots_free << " slots are free. (run=" << buff.run_number << ")";
+						if (buff.run_number != run_number_)
+						{
+							TLOG(TLVL_DEBUG + 32) << "Received token from a different run number! Current = " << run_number_ << ", token = " << buff.run_number << ", ignoring (n=" << buff.new_slots_free << ")";
+						}
+						else
+						{
+							received_token_count_ += buff.new_slots_free;
+							if (has_load)
+							{
+								// Before the token, so that the policy sees the load the new slots belong to
+								policy_->UpdateReceiverLoad(buff.rank, load);
+							}
+							policy_->AddReceiverToken(buff.rank, buff.new_slots_free);
+							tokens_added = true;
+						}
 					}
+					token_buffer.erase(token_buffer.begin(), token_buffer.begin() + pos);
 				}
 				auto delta_time = artdaq::MonitoredQuantity::getCurrentTime() - startTime;
 				if (statsHelperPtr_ != nullptr) { statsHelperPtr_->addSample(tokens_received_stat_key_, delta_time); }
@@ -218,5 +268,12 @@ void artdaq::TokenReceiver::receiveTokensLoop_()
 				TLOG(TLVL_DEBUG + 32) << "Received event mask " << receive_token_events_[n].events << " from token fd " << receive_token_events_[n].data.fd;
 			}
 		}
+
+		// One notification per batch of sockets, not per token
+		if (tokens_added && token_event_fd_ != -1)
+		{
+			uint64_t one = 1;
+			write(token_event_fd_, &one, sizeof(one));
+		}
 	}
 }
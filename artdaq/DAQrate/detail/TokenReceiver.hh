@@ -94,6 +94,12 @@ public:
 	 */
 	size_t getReceivedTokenCount() const { return received_token_count_; }
 
+	/**
+	 * \brief Get an eventfd which becomes readable whenever tokens have been added to the RoutingManagerPolicy
+	 * \return The eventfd, for use with poll/epoll by the caller. The caller resets it by reading its 8-byte counter.
+	 */
+	int getTokenEventFD() const { return token_event_fd_; }
+
 private:
 	TokenReceiver(TokenReceiver const&) = delete;
 	TokenReceiver(TokenReceiver&&) = delete;
@@ -109,7 +115,9 @@ private:
 	int token_socket_{-1};
 	std::vector<epoll_event> receive_token_events_;
 	std::unordered_map<int, std::string> receive_token_addrs_;
+	std::unordered_map<int, std::vector<uint8_t>> receive_token_buffers_;  // Partial tokens left over from the last read on each connection
 	int token_epoll_fd_{-1};
+	int token_event_fd_{-1};
 
 	boost::thread token_thread_;
 	std::atomic<bool> thread_is_running_;
@@ -23,10 +23,22 @@ TokenSender::TokenSender(const fhicl::ParameterSet& pset)
     , token_address_(pset.get<std::string>("routing_manager_hostname", "localhost"))
     , tokens_sent_(0)
     , run_number_(0)
+    , batch_count_(pset.get<size_t>("routing_token_batch_count", 20))
+    , batch_timeout_(pset.get<size_t>("routing_token_batch_timeout_us", 500))
+    , pending_slot_count_(0)
+    , stop_requested_(false)
+    , send_load_(pset.get<bool>("routing_token_send_load", false))
+    , load_free_buffers_(0)
+    , load_art_queue_depth_(0)
+    , load_build_latency_us_(0)
 {
 	TLOG(TLVL_DEBUG + 32) << "TokenSender CONSTRUCTOR";
 
 	setup_tokens_();
+	if (send_routing_tokens_)
+	{
+		send_thread_ = boost::thread([this] { send_thread_proc_(); });
+	}
 	TLOG(TLVL_DEBUG + 35) << "artdaq::TokenSender::TokenSender ctor - reader_thread_ initialized";
 	initialized_ = true;
 }
@@ -35,6 +47,16 @@ TokenSender::~TokenSender()
 {
 	TLOG(TLVL_INFO) << "Shutting down TokenSender, token_socket_: " << token_socket_;
 
+	{
+		std::lock_guard<std::mutex> lk(pending_tokens_mutex_);
+		stop_requested_ = true;
+	}
+	pending_tokens_cv_.notify_all();
+	if (send_thread_.joinable())
+	{
+		send_thread_.join();
+	}
+
 	if (token_socket_ != -1)
 	{
 		if (shutdown(token_socket_, 2) != 0 && errno == ENOTSOCK)
@@ -67,47 +89,113 @@ void TokenSender::setup_tokens_()
 		if (token_socket_ < 0)
 		{
 			TLOG(TLVL_ERROR) << "I failed to create the socket for sending Routing Tokens! err=" << strerror(errno);
-			exit(1);
+			throw cet::exception("TokenSender") << "Failed to create the socket for sending Routing Tokens to " << token_address_ << ":" << token_port_;  // NOLINT(cert-err60-cpp)
 		}
 		TLOG(TLVL_INFO) << "Routing Token sending socket created successfully for address " << token_address_;
 	}
 }
 
-void TokenSender::send_routing_token_(int nSlots, int run_number, int rank)
+void TokenSender::send_thread_proc_()
 {
-	TLOG(TLVL_DEBUG + 33) << "send_routing_token_ called, send_routing_tokens_=" << std::boolalpha << send_routing_tokens_;
-	if (!send_routing_tokens_)
+	std::vector<uint8_t> buffer;
+	while (true)
 	{
-		return;
+		{
+			std::unique_lock<std::mutex> lk(pending_tokens_mutex_);
+			while (!stop_requested_ && pending_slot_count_ < batch_count_)
+			{
+				if (pending_slot_count_ == 0)
+				{
+					pending_tokens_cv_.wait(lk);
+				}
+				else if (pending_tokens_cv_.wait_until(lk, first_pending_time_ + batch_timeout_) == std::cv_status::timeout)
+				{
+					break;
+				}
+			}
+			if (stop_requested_ && pending_slot_count_ == 0)
+			{
+				break;
+			}
+
+			detail::RoutingTokenLoad load;
+			load.free_buffers = load_free_buffers_;
+			load.art_queue_depth = load_art_queue_depth_;
+			load.build_latency_us = load_build_latency_us_;
+
+			buffer.clear();
+			for (auto const& pending : pending_tokens_)
+			{
+				detail::RoutingToken token;
+				token.header = send_load_ ? TOKEN_LOAD_MAGIC : TOKEN_MAGIC;
+				token.rank = pending.first.second;
+				token.new_slots_free = pending.second;
+				token.run_number = pending.first.first;
+				auto token_bytes = reinterpret_cast<const uint8_t*>(&token);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+				buffer.insert(buffer.end(), token_bytes, token_bytes + sizeof(token));  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+				if (send_load_)
+				{
+					auto load_bytes = reinterpret_cast<const uint8_t*>(&load);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+					buffer.insert(buffer.end(), load_bytes, load_bytes + sizeof(load));  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+				}
+			}
+			pending_tokens_.clear();
+			pending_slot_count_ = 0;
+		}
+
+		write_routing_tokens_(buffer);
 	}
-	if (token_socket_ == -1)
+	TLOG(TLVL_DEBUG + 32) << "Token send thread exiting";
+}
+
+bool TokenSender::reconnect_()
+{
+	try
 	{
 		setup_tokens_();
 	}
-	detail::RoutingToken token;
-	token.header = TOKEN_MAGIC;
-	token.rank = rank;
-	token.new_slots_free = nSlots;
-	token.run_number = run_number;
+	catch (cet::exception const& e)
+	{
+		TLOG(TLVL_ERROR) << "Could not reconnect to the RoutingManager: " << e.what();
+		return false;
+	}
+	return true;
+}
 
-	TLOG(TLVL_DEBUG + 33) << "Sending RoutingToken to " << token_address_ << ":" << token_port_;
+void TokenSender::write_routing_tokens_(std::vector<uint8_t> const& buffer)
+{
+	TLOG(TLVL_DEBUG + 33) << "Sending " << buffer.size() << " bytes of RoutingTokens to " << token_address_ << ":" << token_port_;
+	size_t size = buffer.size();
+	size_t record_size = sizeof(detail::RoutingToken) + (send_load_ ? sizeof(detail::RoutingTokenLoad) : 0);
 	size_t sts = 0;
-	while (sts < sizeof(detail::RoutingToken))
+	while (sts < size)
 	{
-		auto res = send(token_socket_, reinterpret_cast<uint8_t*>(&token) + sts, sizeof(detail::RoutingToken) - sts, 0);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		if (token_socket_ == -1 && !reconnect_())
+		{
+			// Keep trying while running; the slots would otherwise be lost to the RoutingManager for the rest of the run
+			if (stop_requested_)
+			{
+				TLOG(TLVL_ERROR) << "Dropping " << size - sts << " bytes of RoutingTokens at shutdown, RoutingManager is unreachable";
+				return;
+			}
+			continue;
+		}
+
+		auto res = send(token_socket_, buffer.data() + sts, size - sts, 0);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
 		if (res < 0)
 		{
-			TLOG(TLVL_WARNING) << "Error on token_socket, reconnecting";
+			// Tokens which were completely written have been counted by the RoutingManager; sending them again would
+			// announce slots which do not exist. Resend from the start of the first incomplete token, which the
+			// RoutingManager discards with the old connection.
+			TLOG(TLVL_WARNING) << "Error on token_socket, reconnecting and resending from byte " << sts - sts % record_size << " of " << size;
 			close(token_socket_);
 			token_socket_ = -1;
-			sts = 0;
-			setup_tokens_();
+			sts -= sts % record_size;
 			continue;
 		}
 		sts += res;
 	}
-	tokens_sent_ += nSlots;
-	TLOG(TLVL_DEBUG + 33) << "Done sending RoutingToken to " << token_address_ << ":" << token_port_;
+	TLOG(TLVL_DEBUG + 33) << "Done sending RoutingTokens to " << token_address_ << ":" << token_port_;
 }
 
 void TokenSender::SendRoutingToken(int nSlots, int run_number, int rank)
@@ -116,13 +204,22 @@ void TokenSender::SendRoutingToken(int nSlots, int run_number, int rank)
 	{
 		usleep(1000);
 	}
-	if (!send_routing_tokens_)
+	TLOG(TLVL_DEBUG + 33) << "SendRoutingToken called, send_routing_tokens_=" << std::boolalpha << send_routing_tokens_;
+	if (!send_routing_tokens_ || nSlots <= 0)
 	{
 		return;
 	}
-	boost::thread token([this, nSlots, run_number, rank] { send_routing_token_(nSlots, run_number, rank); });
-	token.detach();
-	usleep(0);  // Give up time slice
+	{
+		std::lock_guard<std::mutex> lk(pending_tokens_mutex_);
+		if (pending_slot_count_ == 0)
+		{
+			first_pending_time_ = std::chrono::steady_clock::now();
+		}
+		pending_tokens_[std::make_pair(run_number, rank)] += nSlots;
+		pending_slot_count_ += nSlots;
+	}
+	tokens_sent_ += nSlots;
+	pending_tokens_cv_.notify_one();
 }
 
 }  // namespace artdaq
@@ -13,14 +13,23 @@ class ParameterSet;
 #include <netinet/in.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <boost/thread.hpp>
+
 #include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <cstdint>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace artdaq {
+namespace detail {
+struct RoutingToken;
+}
 
 /**
  * \brief The TokenSender contains methods used to send data requests and Routing tokens
@@ -41,6 +50,12 @@ public:
 		fhicl::Atom<int> routing_token_port{fhicl::Name{"routing_token_port"}, fhicl::Comment{"Port to send tokens on"}, 35555};
 		/// "routing_manager_hostname" (Default: "localhost") : Hostname or IP of RoutingManager
 		fhicl::Atom<std::string> routing_token_host{fhicl::Name{"routing_manager_hostname"}, fhicl::Comment{"Hostname or IP of RoutingManager"}, "localhost"};
+		/// "routing_token_batch_count" (Default: 20) : Number of outstanding slots which causes the pending tokens to be sent immediately
+		fhicl::Atom<size_t> routing_token_batch_count{fhicl::Name{"routing_token_batch_count"}, fhicl::Comment{"Number of outstanding slots which causes the pending tokens to be sent immediately"}, 20};
+		/// "routing_token_batch_timeout_us" (Default: 500) : Maximum time a token may be held for coalescing before it is sent
+		fhicl::Atom<size_t> routing_token_batch_timeout_us{fhicl::Name{"routing_token_batch_timeout_us"}, fhicl::Comment{"Maximum time a token may be held for coalescing before it is sent"}, 500};
+		/// "routing_token_send_load" (Default: false) : Whether tokens should carry the occupancy last given to SetLoad, for load-aware routing policies
+		fhicl::Atom<bool> routing_token_send_load{fhicl::Name{"routing_token_send_load"}, fhicl::Comment{"Whether tokens should carry the occupancy last given to SetLoad, for load-aware routing policies"}, false};
 	};
 	/// Used for ParameterSet validation (if desired)
 	using Parameters = fhicl::WrappedTable<Config>;
@@ -67,6 +82,7 @@ public:
 	/**
 	 * \brief TokenSender Constructor
 	 * \param pset ParameterSet used to configured TokenSender. See artdaq::TokenSender::Config
+	 * \exception cet::exception if use_routing_manager is set and the RoutingManager cannot be reached within 30 s
 	 */
 	explicit TokenSender(const fhicl::ParameterSet& pset);
 	/**
@@ -75,16 +91,38 @@ public:
 	virtual ~TokenSender();
 
 	/**
-	 * \brief Send a RoutingToken message indicating that slots are available
+	 * \brief Queue slots to be announced to the RoutingManager
 	 * \param nSlots Number of slots available
 	 * \param run_number Run number for token
 	 * \param rank Rank of token
+	 *
+	 * Slots are coalesced per rank and run number by the send thread, which writes a single
+	 * RoutingToken for each once routing_token_batch_count slots are pending or routing_token_batch_timeout_us has elapsed.
 	 */
 	void SendRoutingToken(int nSlots, int run_number, int rank = my_rank);
 
+	/**
+	 * \brief Set the occupancy reported with the next tokens, if routing_token_send_load is enabled
+	 * \param free_buffers Number of buffers which are not in use
+	 * \param art_queue_depth Number of complete events waiting to be read by art
+	 * \param build_latency_us Recent average time to complete an event, in microseconds
+	 */
+	void SetLoad(unsigned free_buffers, unsigned art_queue_depth, unsigned build_latency_us)
+	{
+		load_free_buffers_ = free_buffers;
+		load_art_queue_depth_ = art_queue_depth;
+		load_build_latency_us_ = build_latency_us;
+	}
+
+	/**
+	 * \brief Determine if tokens carry occupancy information
+	 * \return If routing_token_send_load is enabled
+	 */
+	bool LoadReportsEnabled() const { return send_load_; }
+
 	/**
 	 * \brief Get the count of number of tokens sent
-	 * \return The number of tokens sent by TokenSender
+	 * \return The number of tokens sent by TokenSender (including those still being coalesced)
 	 */
 	size_t GetSentTokenCount() const { return tokens_sent_.load(); }
 
@@ -110,10 +148,28 @@ private:
 	std::atomic<size_t> tokens_sent_;
 	uint32_t run_number_;
 
+	size_t batch_count_;
+	std::chrono::microseconds batch_timeout_;
+	std::mutex pending_tokens_mutex_;
+	std::condition_variable pending_tokens_cv_;
+	std::map<std::pair<int, int>, unsigned> pending_tokens_;  // (run number, rank) -> slots
+	size_t pending_slot_count_;
+	std::chrono::steady_clock::time_point first_pending_time_;
+	std::atomic<bool> stop_requested_;
+	boost::thread send_thread_;
+
+	bool send_load_;
+	std::atomic<unsigned> load_free_buffers_;
+	std::atomic<unsigned> load_art_queue_depth_;
+	std::atomic<unsigned> load_build_latency_us_;
+
 private:
 	void setup_tokens_();
+	bool reconnect_();
+
+	void send_thread_proc_();
 
-	void send_routing_token_(int nSlots, int run_number, int rank);
+	void write_routing_tokens_(std::vector<uint8_t> const& buffer);
 };
 }  // namespace artdaq
 #endif /* artdaq_DAQrate_TokenSender_hh */
@@ -90,6 +90,11 @@ artdaq::CommandableFragmentGenerator::CommandableFragmentGenerator(const fhicl::
 	instance_name_for_metrics_ = "BoardReader." + boost::lexical_cast<std::string>(first_fragment_id);
 
 	sleep_on_stop_us_ = ps.get<int>("sleep_on_stop_us", 0);
+
+	if (ps.get<bool>("use_fragment_pool", false))
+	{
+		fragmentPool_ = std::make_unique<FragmentPool>(ps);
+	}
 }
 
 artdaq::CommandableFragmentGenerator::~CommandableFragmentGenerator()
@@ -97,6 +102,26 @@ artdaq::CommandableFragmentGenerator::~CommandableFragmentGenerator()
 	joinThreads();
 }
 
+artdaq::FragmentPtr artdaq::CommandableFragmentGenerator::AllocateFragment(size_t payload_words, Fragment::sequence_id_t sequence_id, Fragment::fragment_id_t fragment_id,
+                                                                          Fragment::type_t type, Fragment::timestamp_t timestamp)
+{
+	if (fragmentPool_)
+	{
+		return fragmentPool_->Get(payload_words, sequence_id, fragment_id, type, timestamp);
+	}
+	auto frag = std::make_unique<Fragment>(sequence_id, fragment_id, type, timestamp);
+	frag->resize(payload_words);
+	return frag;
+}
+
+void artdaq::CommandableFragmentGenerator::RecycleFragment(FragmentPtr frag)
+{
+	if (fragmentPool_)
+	{
+		fragmentPool_->Recycle(std::move(frag));
+	}
+}
+
 void artdaq::CommandableFragmentGenerator::joinThreads()
 {
 	should_stop_ = true;
@@ -8,12 +8,14 @@
 
 #include "artdaq-core/Plugins/FragmentGenerator.hh"
 #include "artdaq/DAQrate/FragmentBuffer.hh"
+#include "artdaq/DAQrate/FragmentPool.hh"
 #include "artdaq/DAQrate/RequestBuffer.hh"
 
 #include "fhiclcpp/types/Atom.h"
 #include "fhiclcpp/types/Comment.h"
 #include "fhiclcpp/types/ConfigurationTable.h"
 #include "fhiclcpp/types/Name.h"
+#include "fhiclcpp/types/TableFragment.h"
 namespace fhicl {
 class ParameterSet;
 }
@@ -106,6 +108,9 @@ public:
 		fhicl::Atom<int> fragment_id{fhicl::Name{"fragment_id"}, fhicl::Comment{"The Fragment ID created by this CommandableFragmentGenerator"}, -99};
 		/// "sleep_on_stop_us" (Default: 0) : How long to sleep before returning when stop transition is called
 		fhicl::Atom<int> sleep_on_stop_us{fhicl::Name{"sleep_on_stop_us"}, fhicl::Comment{"How long to sleep before returning when stop transition is called"}, 0};
+		/// "use_fragment_pool" (Default: false) : Whether AllocateFragment should reuse the memory of Fragments which have already been sent
+		fhicl::Atom<bool> use_fragment_pool{fhicl::Name{"use_fragment_pool"}, fhicl::Comment{"Whether AllocateFragment should reuse the memory of Fragments which have already been sent"}, false};
+		fhicl::TableFragment<artdaq::FragmentPool::Config> fragmentPoolConfig;  ///< Configuration of the FragmentPool, if use_fragment_pool is true. See artdaq::FragmentPool::Config
 	};
 	/// Used for ParameterSet validation (if desired)
 	using Parameters = fhicl::WrappedTable<Config>;
@@ -281,6 +286,12 @@ public:
 
 	void SetFragmentBuffer(std::shared_ptr<FragmentBuffer> buffer) { fragmentBuffer_ = buffer; }
 
+	/**
+	 * \brief Hand back a Fragment which has been sent, so that AllocateFragment can reuse its memory
+	 * \param frag Fragment which is no longer needed. It is freed if use_fragment_pool is false.
+	 */
+	void RecycleFragment(FragmentPtr frag);
+
 protected:
 	// John F., 12/6/13 -- need to figure out which of these getter
 	// functions should be promoted to "public"
@@ -374,6 +385,19 @@ protected:
 
 	std::shared_ptr<FragmentBuffer> GetFragmentBuffer() { return fragmentBuffer_; }
 
+	/**
+	 * \brief Create a Fragment for getNext_ to fill. If use_fragment_pool is true, the memory of a Fragment passed to
+	 * RecycleFragment is reused, avoiding an allocation (and page faults) for every Fragment.
+	 * \param payload_words Size of the payload, in RawDataType words
+	 * \param sequence_id Sequence ID of the Fragment
+	 * \param fragment_id Fragment ID of the Fragment
+	 * \param type Type of the Fragment
+	 * \param timestamp Timestamp of the Fragment
+	 * \return A Fragment without metadata, whose payload contents are unspecified
+	 */
+	FragmentPtr AllocateFragment(size_t payload_words, Fragment::sequence_id_t sequence_id, Fragment::fragment_id_t fragment_id,
+	                             Fragment::type_t type = Fragment::DataFragmentType, Fragment::timestamp_t timestamp = Fragment::InvalidTimestamp);
+
 private:
 	CommandableFragmentGenerator(CommandableFragmentGenerator const&) = delete;
 	CommandableFragmentGenerator(CommandableFragmentGenerator&&) = delete;
@@ -426,6 +450,8 @@ private:
 	std::shared_ptr<RequestBuffer> requestBuffer_;
 	std::shared_ptr<FragmentBuffer> fragmentBuffer_;
 
+	std::unique_ptr<FragmentPool> fragmentPool_;
+
 protected:
 	/// <summary>
 	/// Obtain the next group of Fragments, if any are available. Return false if readout cannot continue,
@@ -46,9 +46,6 @@ public:
 	virtual detail::RoutingPacketEntry CreateRouteForSequenceID(artdaq::Fragment::sequence_id_t seq, int requesting_rank) override;
 
 private:
-	std::pair<size_t, std::map<int, int>> sortTokens_();
-	void restoreUnusedTokens_(std::map<int, int> const& sorted_tokens);
-
 	CapacityTestPolicy(CapacityTestPolicy const&) = delete;
 	CapacityTestPolicy(CapacityTestPolicy&&) = delete;
 	CapacityTestPolicy& operator=(CapacityTestPolicy const&) = delete;
@@ -64,18 +61,16 @@ CapacityTestPolicy::CapacityTestPolicy(const fhicl::ParameterSet& ps)
 
 void CapacityTestPolicy::CreateRoutingTable(detail::RoutingPacket& output)
 {
-	auto sorted_tokens = sortTokens_();
-	size_t tokenCount = sorted_tokens.first;
-	auto table = sorted_tokens.second;
+	size_t tokenCount = tokens_.Size();
 	size_t tokensToUse = ceil(tokenCount * tokenUsagePercent_ / 100.0);
 
-	for (auto r : table)
+	for (auto rank : tokens_.Ranks())
 	{
 		bool breakCondition = false;
-		while (table[r.first] > 0)
+		while (tokens_.Count(rank) > 0)
 		{
-			output.emplace_back(detail::RoutingPacketEntry(next_sequence_id_++, r.first));
-			table[r.first]--;
+			output.emplace_back(detail::RoutingPacketEntry(next_sequence_id_++, rank));
+			tokens_.Take(rank);
 			tokens_used_since_last_update_++;
 			if (tokens_used_since_last_update_ >= tokensToUse)
 			{
@@ -88,49 +83,30 @@ void CapacityTestPolicy::CreateRoutingTable(detail::RoutingPacket& output)
 			break;
 		}
 	}
-
-	restoreUnusedTokens_(table);
 }
 
 detail::RoutingPacketEntry CapacityTestPolicy::CreateRouteForSequenceID(artdaq::Fragment::sequence_id_t seq, int)
 {
 	// TODO, ELF 09/22/2020: Do we want to use the tokens_used_per_table_percent limitation here, too?
 	detail::RoutingPacketEntry output;
-	auto sorted_tokens = sortTokens_();
-	if (sorted_tokens.first == 0) return output;  // Trivial case: no tokens
-	auto dest = sorted_tokens.second.begin()->first;
-	sorted_tokens.second[dest]--;
+	if (tokens_.Empty()) return output;  // Trivial case: no tokens
+	auto dest = -1;
+	for (auto rank : tokens_.Ranks())
+	{
+		if (tokens_.Count(rank) > 0)
+		{
+			dest = rank;
+			break;
+		}
+	}
+	tokens_.Take(dest);
 	tokens_used_since_last_update_++;
-	restoreUnusedTokens_(sorted_tokens.second);
 
 	output = detail::RoutingPacketEntry(seq, dest);
 
 	return output;
 }
 
-std::pair<size_t, std::map<int, int>> CapacityTestPolicy::sortTokens_()
-{
-	auto output = std::make_pair(0, std::map<int, int>());
-	for (auto token : tokens_)
-	{
-		output.second[token]++;
-		output.first++;
-	}
-	tokens_.clear();
-	return output;
-}
-
-void CapacityTestPolicy::restoreUnusedTokens_(std::map<int, int> const& sorted_tokens)
-{
-	for (auto r : sorted_tokens)
-	{
-		for (auto i = 0; i < r.second; ++i)
-		{
-			tokens_.push_back(r.first);
-		}
-	}
-}
-
 }  // namespace artdaq
 
 DEFINE_ARTDAQ_ROUTING_POLICY(artdaq::CapacityTestPolicy)
\ No newline at end of file
@@ -0,0 +1,221 @@
+#include "artdaq/DAQdata/Globals.hh"
+#define TRACE_NAME (app_name + "_LeastLoaded_policy").c_str()
+#include "TRACE/tracemf.h"
+
+#include "artdaq/RoutingPolicies/PolicyMacros.hh"
+#include "artdaq/RoutingPolicies/RoutingManagerPolicy.hh"
+
+#include "fhiclcpp/ParameterSet.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace artdaq {
+/**
+ * \brief A RoutingManagerPolicy which sends each Sequence ID to the receiver, out of a few holding tokens, which is
+ * expected to finish it first, using the occupancy which receivers report with their tokens (see the
+ * routing_token_send_load TokenSender parameter).
+ *
+ * The expected delay of a receiver is its reported build latency times one more than the number of Sequence IDs
+ * routed to it which it has not yet returned a token for. Receivers which do not report their occupancy are compared
+ * by that number alone.
+ *
+ * Without max_queue_depth, every token is eventually used, so each receiver still gets as many Sequence IDs as it
+ * returns tokens for; the policy only orders them. Limiting the outstanding Sequence IDs per receiver keeps the rest
+ * unassigned until a receiver which is keeping up can take them.
+ */
+class LeastLoadedPolicy : public RoutingManagerPolicy
+{
+public:
+	/**
+	 * \brief LeastLoadedPolicy Constructor
+	 * \param ps ParameterSet used to configure LeastLoadedPolicy
+	 *
+	 * LeastLoadedPolicy accepts the following Parameters:
+	 * "choices" (Default: 2): Number of receivers, chosen at random from those holding tokens, to compare for each Sequence ID. 0 compares all of them.
+	 * "max_queue_depth" (Default: 0): Receivers with this many outstanding Sequence IDs are not routed to, even if they hold tokens. Their tokens are kept for later table updates. 0 disables the limit.
+	 * "random_seed" (Default: 271828): Seed for the choice of receivers to compare
+	 */
+	explicit LeastLoadedPolicy(const fhicl::ParameterSet& ps)
+	    : RoutingManagerPolicy(ps)
+	    , choices_(ps.get<size_t>("choices", 2))
+	    , max_queue_depth_(ps.get<size_t>("max_queue_depth", 0))
+	    , engine_(ps.get<int64_t>("random_seed", 271828))
+	{
+	}
+
+	/**
+	 * \brief Default virtual Destructor
+	 */
+	~LeastLoadedPolicy() override = default;
+
+	/**
+	 * @brief Add entries to the given RoutingPacket using currently-held tokens
+	 * @param output RoutingPacket to add entries to
+	 *
+	 * LeastLoadedPolicy assigns Sequence IDs one at a time, each to the least-loaded of "choices" receivers, until no
+	 * receiver which is below max_queue_depth holds a token.
+	 */
+	void CreateRoutingTable(detail::RoutingPacket& output) override;
+	/**
+	 * @brief Get an artdaq::detail::RoutingPacketEntry for a given sequence ID and rank. Used by RequestBasedEventBuilder and DataFlow RoutingManagerMode
+	 * @param seq Sequence Number to get route for
+	 * @param requesting_rank Rank to route for
+	 * @return artdaq::detail::RoutingPacketEntry connecting sequence ID to destination rank
+	 */
+	detail::RoutingPacketEntry CreateRouteForSequenceID(artdaq::Fragment::sequence_id_t seq, int requesting_rank) override;
+
+private:
+	LeastLoadedPolicy(LeastLoadedPolicy const&) = delete;
+	LeastLoadedPolicy(LeastLoadedPolicy&&) = delete;
+	LeastLoadedPolicy& operator=(LeastLoadedPolicy const&) = delete;
+	LeastLoadedPolicy& operator=(LeastLoadedPolicy&&) = delete;
+
+	std::vector<int> eligible_() const;
+	size_t outstanding_(int rank) const;
+	bool admissible_(int rank) const;
+	bool lessLoaded_(int lhs, int rhs) const;
+	size_t chooseReceiver_(std::vector<int> const& eligible);
+	void assign_(int rank);
+
+	size_t choices_;
+	size_t max_queue_depth_;
+	std::mt19937 engine_;
+};
+
+void LeastLoadedPolicy::CreateRoutingTable(detail::RoutingPacket& output)
+{
+	TLOG(TLVL_DEBUG + 35) << "LeastLoadedPolicy::GetCurrentTable token count is " << tokens_.Size();
+	auto eligible = eligible_();
+	TLOG(TLVL_DEBUG + 36) << "LeastLoadedPolicy::GetCurrentTable " << eligible.size() << " receivers with tokens are below max_queue_depth";
+
+	while (!eligible.empty())
+	{
+		auto index = chooseReceiver_(eligible);
+		auto rank = eligible[index];
+		TLOG(TLVL_DEBUG + 38) << "LeastLoadedPolicy::GetCurrentTable assigning sequenceID " << next_sequence_id_ << " to rank " << rank << " (outstanding " << outstanding_(rank) << ")";
+		output.emplace_back(detail::RoutingPacketEntry(next_sequence_id_++, rank));
+		assign_(rank);
+
+		if (tokens_.Count(rank) == 0 || !admissible_(rank))
+		{
+			eligible[index] = eligible.back();
+			eligible.pop_back();
+		}
+	}
+
+	TLOG(TLVL_DEBUG + 36) << "LeastLoadedPolicy::GetCurrentTable " << tokens_.Size() << " unused tokens will be saved for later";
+
+	TLOG(TLVL_DEBUG + 35) << "LeastLoadedPolicy::GetCurrentTable return with table size " << output.size();
+}
+
+detail::RoutingPacketEntry LeastLoadedPolicy::CreateRouteForSequenceID(artdaq::Fragment::sequence_id_t seq, int)
+{
+	detail::RoutingPacketEntry output;
+	auto eligible = eligible_();
+
+	if (eligible.empty())
+	{
+		TLOG(TLVL_DEBUG + 36) << "No receiver below max_queue_depth holds a token, cannot route sequence ID " << seq;
+	}
+	else
+	{
+		auto rank = eligible[chooseReceiver_(eligible)];
+		output = detail::RoutingPacketEntry(seq, rank);
+		assign_(rank);
+	}
+
+	return output;
+}
+
+std::vector<int> LeastLoadedPolicy::eligible_() const
+{
+	std::vector<int> output;
+	for (auto rank : tokens_.Ranks())
+	{
+		if (tokens_.Count(rank) > 0 && admissible_(rank))
+		{
+			output.push_back(rank);
+		}
+	}
+	return output;
+}
+
+size_t LeastLoadedPolicy::outstanding_(int rank) const
+{
+	auto it = receiver_loads_.find(rank);
+	return it == receiver_loads_.end() ? 0 : it->second.outstanding;
+}
+
+bool LeastLoadedPolicy::admissible_(int rank) const
+{
+	return max_queue_depth_ == 0 || outstanding_(rank) < max_queue_depth_;
+}
+
+bool LeastLoadedPolicy::lessLoaded_(int lhs, int rhs) const
+{
+	auto lhs_it = receiver_loads_.find(lhs);
+	auto rhs_it = receiver_loads_.find(rhs);
+	size_t lhs_outstanding = lhs_it == receiver_loads_.end() ? 0 : lhs_it->second.outstanding;
+	size_t rhs_outstanding = rhs_it == receiver_loads_.end() ? 0 : rhs_it->second.outstanding;
+	if (lhs_it == receiver_loads_.end() || rhs_it == receiver_loads_.end() || !lhs_it->second.has_report || !rhs_it->second.has_report)
+	{
+		return lhs_outstanding < rhs_outstanding;
+	}
+
+	auto const& lhs_report = lhs_it->second.report;
+	auto const& rhs_report = rhs_it->second.report;
+	auto lhs_delay = (lhs_outstanding + 1) * std::max<uint64_t>(lhs_report.build_latency_us, 1);
+	auto rhs_delay = (rhs_outstanding + 1) * std::max<uint64_t>(rhs_report.build_latency_us, 1);
+	if (lhs_delay != rhs_delay)
+	{
+		return lhs_delay < rhs_delay;
+	}
+
+	// Equal expected delays: prefer the receiver with more free buffers, then the one with fewer events waiting for art
+	if (lhs_report.free_buffers != rhs_report.free_buffers)
+	{
+		return lhs_report.free_buffers > rhs_report.free_buffers;
+	}
+	return lhs_report.art_queue_depth < rhs_report.art_queue_depth;
+}
+
+size_t LeastLoadedPolicy::chooseReceiver_(std::vector<int> const& eligible)
+{
+	size_t best = 0;
+	if (choices_ == 0 || choices_ >= eligible.size())
+	{
+		for (size_t ii = 1; ii < eligible.size(); ++ii)
+		{
+			if (lessLoaded_(eligible[ii], eligible[best]))
+			{
+				best = ii;
+			}
+		}
+		return best;
+	}
+
+	std::uniform_int_distribution<size_t> dist(0, eligible.size() - 1);
+	best = dist(engine_);
+	for (size_t ii = 1; ii < choices_; ++ii)
+	{
+		auto candidate = dist(engine_);
+		if (lessLoaded_(eligible[candidate], eligible[best]))
+		{
+			best = candidate;
+		}
+	}
+	return best;
+}
+
+void LeastLoadedPolicy::assign_(int rank)
+{
+	tokens_.Take(rank);
+	receiver_loads_[rank].outstanding++;
+	tokens_used_since_last_update_++;
+}
+
+}  // namespace artdaq
+
+DEFINE_ARTDAQ_ROUTING_POLICY(artdaq::LeastLoadedPolicy)
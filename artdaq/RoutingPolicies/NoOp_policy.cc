@@ -55,11 +55,10 @@ private:
 
 void NoOpPolicy::CreateRoutingTable(detail::RoutingPacket& table)
 {
-	while (!tokens_.empty())
+	while (!tokens_.Empty())
 	{
-		table.emplace_back(next_sequence_id_, tokens_.front());
+		table.emplace_back(next_sequence_id_, tokens_.TakeNext());
 		next_sequence_id_++;
-		tokens_.pop_front();
 		tokens_used_since_last_update_++;
 	}
 }
@@ -67,11 +66,10 @@ void NoOpPolicy::CreateRoutingTable(detail::RoutingPacket& table)
 detail::RoutingPacketEntry NoOpPolicy::CreateRouteForSequenceID(artdaq::Fragment::sequence_id_t seq, int)
 {
 	detail::RoutingPacketEntry output;
-	if (!tokens_.empty())
+	if (!tokens_.Empty())
 	{
-		auto dest = tokens_.front();  // No-Op: Use first token
+		auto dest = tokens_.TakeNext();  // No-Op: Use first token
 		output = detail::RoutingPacketEntry(seq, dest);
-		tokens_.pop_front();
 		tokens_used_since_last_update_++;
 	}
 
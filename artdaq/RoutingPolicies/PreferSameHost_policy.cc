@@ -8,7 +8,8 @@
 
 #include "fhiclcpp/ParameterSet.h"
 
-#include <map>
+#include <utility>
+#include <vector>
 
 namespace artdaq {
 /**
@@ -59,8 +60,7 @@ private:
 	PreferSameHostPolicy& operator=(PreferSameHostPolicy const&) = delete;
 	PreferSameHostPolicy& operator=(PreferSameHostPolicy&&) = delete;
 
-	std::map<int, int> sortTokens_();
-	void restoreUnusedTokens_(std::map<int, int> const& sorted_tokens_);
+	std::vector<std::pair<int, size_t>> sortTokens_() const;
 	int calculateMinimum_();
 
 	int minimum_participants_;
@@ -69,7 +69,7 @@ private:
 
 void PreferSameHostPolicy::CreateRoutingTable(detail::RoutingPacket& output)
 {
-	TLOG(TLVL_DEBUG + 35) << "PreferSameHostPolicy::GetCurrentTable token list size is " << tokens_.size();
+	TLOG(TLVL_DEBUG + 35) << "PreferSameHostPolicy::GetCurrentTable token count is " << tokens_.Size();
 	auto table = sortTokens_();
 	TLOG(TLVL_DEBUG + 36) << "PreferSameHostPolicy::GetCurrentTable table size is " << table.size();
 
@@ -79,118 +79,83 @@ void PreferSameHostPolicy::CreateRoutingTable(detail::RoutingPacket& output)
 
 	while (!endCondition)
 	{
-		for (auto it = table.begin(); it != table.end();)
+		size_t remaining = 0;
+		for (auto& entry : table)
 		{
-			TLOG(TLVL_DEBUG + 38) << "PreferSameHostPolicy::GetCurrentTable assigning sequenceID " << next_sequence_id_ << " to rank " << it->first;
-			output.emplace_back(detail::RoutingPacketEntry(next_sequence_id_++, it->first));
-			table[it->first]--;
+			TLOG(TLVL_DEBUG + 38) << "PreferSameHostPolicy::GetCurrentTable assigning sequenceID " << next_sequence_id_ << " to rank " << entry.first;
+			output.emplace_back(detail::RoutingPacketEntry(next_sequence_id_++, entry.first));
+			tokens_.Take(entry.first);
 
-			if (table[it->first] <= 0)
+			if (--entry.second > 0)
 			{
-				it = table.erase(it);
-			}
-			else
-			{
-				++it;
+				table[remaining++] = entry;
 			}
 		}
+		table.resize(remaining);
 		endCondition = table.size() < static_cast<size_t>(minimum);
 	}
 
-	restoreUnusedTokens_(table);
-	TLOG(TLVL_DEBUG + 36) << "PreferSameHostPolicy::GetCurrentTable " << tokens_.size() << " unused tokens will be saved for later";
+	TLOG(TLVL_DEBUG + 36) << "PreferSameHostPolicy::GetCurrentTable " << tokens_.Size() << " unused tokens will be saved for later";
 
 	TLOG(TLVL_DEBUG + 35) << "PreferSameHostPolicy::GetCurrentTable return with table size " << output.size();
 }
 detail::RoutingPacketEntry PreferSameHostPolicy::CreateRouteForSequenceID(artdaq::Fragment::sequence_id_t seq, int requesting_rank)
 {
 	detail::RoutingPacketEntry output;
-	auto table = sortTokens_();
 
 	// Trivial case: no tokens
-	if (table.empty()) return output;
+	if (tokens_.Empty()) return output;
 
-	if (host_map_.count(requesting_rank) == 0)
+	auto requesting_host = host_map_.find(requesting_rank);
+	if (requesting_host == host_map_.end())
 	{
 		TLOG(TLVL_WARNING) << "Received Routing Request from rank " << requesting_rank << ", which is not in my Host Map!";
 	}
-	auto host = host_map_[requesting_rank];
 
-	// First try to find a match
-	std::set<int> matching_ranks_;
+	// Prefer the receiver on the requesting host with the most tokens, otherwise the receiver with the most tokens
 	int max_rank = -1;
-	int max_rank_tokens = 0;
-	for (auto& entry : table)
+	size_t max_rank_tokens = 0;
+	int match_rank = -1;
+	size_t match_rank_tokens = 0;
+	for (auto rank : tokens_.Ranks())
 	{
-		if (entry.second == 0) continue;
-		if (host_map_.count(entry.first) == 0)
+		auto count = tokens_.Count(rank);
+		if (count == 0) continue;
+		auto host = host_map_.find(rank);
+		if (host == host_map_.end())
 		{
-			TLOG(TLVL_WARNING) << "Receiver rank " << entry.first << " is not in the host map! Is this policy configured correctly?!";
+			TLOG(TLVL_WARNING) << "Receiver rank " << rank << " is not in the host map! Is this policy configured correctly?!";
 		}
-		else
+		else if (requesting_host != host_map_.end() && host->second == requesting_host->second && count > match_rank_tokens)
 		{
-			if (host_map_[entry.first] == host)
-			{
-				matching_ranks_.insert(entry.first);
-			}
+			match_rank = rank;
+			match_rank_tokens = count;
 		}
-		if (entry.second > max_rank_tokens)
+		if (count > max_rank_tokens)
 		{
-			max_rank = entry.first;
-			max_rank_tokens = entry.second;
+			max_rank = rank;
+			max_rank_tokens = count;
 		}
 	}
 
-	if (matching_ranks_.size() == 0)
-	{
-		output = detail::RoutingPacketEntry(seq, max_rank);
-		table[max_rank]--;
-	}
-	else if (matching_ranks_.size() == 1)
-	{
-		output = detail::RoutingPacketEntry(seq, *matching_ranks_.begin());
-		table[*matching_ranks_.begin()]--;
-	}
-	else
-	{
-		// Find the most tokens in matching_ranks_
-		int max = 0;
-		int max_rank = -1;
-		for (auto& rank : matching_ranks_)
-		{
-			if (table[rank] > max)
-			{
-				max = table[rank];
-				max_rank = rank;
-			}
-		}
-		output = detail::RoutingPacketEntry(seq, max_rank);
-		table[max_rank]--;
-	}
-
-	restoreUnusedTokens_(table);
+	auto dest = match_rank != -1 ? match_rank : max_rank;
+	output = detail::RoutingPacketEntry(seq, dest);
+	tokens_.Take(dest);
 	return output;
 }
-std::map<int, int> PreferSameHostPolicy::sortTokens_()
+std::vector<std::pair<int, size_t>> PreferSameHostPolicy::sortTokens_() const
 {
-	auto output = std::map<int, int>();
-	for (auto token : tokens_)
+	// Ranks holding tokens, in rank order, with their token counts
+	auto output = std::vector<std::pair<int, size_t>>();
+	for (auto rank : tokens_.Ranks())
 	{
-		output[token]++;
-	}
-	tokens_.clear();
-	return output;
-}
-
-void PreferSameHostPolicy::restoreUnusedTokens_(std::map<int, int> const& sorted_tokens)
-{
-	for (auto r : sorted_tokens)
-	{
-		for (auto i = 0; i < r.second; ++i)
+		auto count = tokens_.Count(rank);
+		if (count > 0)
 		{
-			tokens_.push_back(r.first);
+			output.emplace_back(rank, count);
 		}
 	}
+	return output;
 }
 
 int PreferSameHostPolicy::calculateMinimum_()
@@ -56,8 +56,7 @@ private:
 	RoundRobinPolicy& operator=(RoundRobinPolicy const&) = delete;
 	RoundRobinPolicy& operator=(RoundRobinPolicy&&) = delete;
 
-	std::map<int, int> sortTokens_();
-	void restoreUnusedTokens_(std::map<int, int> const& sorted_tokens_);
+	std::vector<std::pair<int, size_t>> sortTokens_() const;
 	int calculateMinimum_();
 
 	int minimum_participants_;
@@ -66,7 +65,7 @@ private:
 
 void RoundRobinPolicy::CreateRoutingTable(detail::RoutingPacket& output)
 {
-	TLOG(TLVL_DEBUG + 35) << "RoundRobinPolicy::GetCurrentTable token list size is " << tokens_.size();
+	TLOG(TLVL_DEBUG + 35) << "RoundRobinPolicy::GetCurrentTable token count is " << tokens_.Size();
 	auto table = sortTokens_();
 	TLOG(TLVL_DEBUG + 36) << "RoundRobinPolicy::GetCurrentTable table size is " << table.size();
 
@@ -76,26 +75,23 @@ void RoundRobinPolicy::CreateRoutingTable(detail::RoutingPacket& output)
 
 	while (!endCondition)
 	{
-		for (auto it = table.begin(); it != table.end();)
+		size_t remaining = 0;
+		for (auto& entry : table)
 		{
-			TLOG(TLVL_DEBUG + 38) << "RoundRobinPolicy::GetCurrentTable assigning sequenceID " << next_sequence_id_ << " to rank " << it->first;
-			output.emplace_back(detail::RoutingPacketEntry(next_sequence_id_++, it->first));
-			table[it->first]--;
+			TLOG(TLVL_DEBUG + 38) << "RoundRobinPolicy::GetCurrentTable assigning sequenceID " << next_sequence_id_ << " to rank " << entry.first;
+			output.emplace_back(detail::RoutingPacketEntry(next_sequence_id_++, entry.first));
+			tokens_.Take(entry.first);
 
-			if (table[it->first] <= 0)
-			{
-				it = table.erase(it);
-			}
-			else
+			if (--entry.second > 0)
 			{
-				++it;
+				table[remaining++] = entry;
 			}
 		}
+		table.resize(remaining);
 		endCondition = table.size() < static_cast<size_t>(minimum);
 	}
 
-	restoreUnusedTokens_(table);
-	TLOG(TLVL_DEBUG + 36) << "RoundRobinPolicy::GetCurrentTable " << tokens_.size() << " unused tokens will be saved for later";
+	TLOG(TLVL_DEBUG + 36) << "RoundRobinPolicy::GetCurrentTable " << tokens_.Size() << " unused tokens will be saved for later";
 
 	TLOG(TLVL_DEBUG + 35) << "RoundRobinPolicy::GetCurrentTable return with table size " << output.size();
 }
@@ -125,35 +121,27 @@ detail::RoutingPacketEntry RoundRobinPolicy::CreateRouteForSequenceID(artdaq::Fr
 		for (auto& entry : table)
 		{
 			receivers_in_current_round_.insert(entry.first);
-			entry.second--;
+			tokens_.Take(entry.first);
 		}
 		output = detail::RoutingPacketEntry(seq, *receivers_in_current_round_.begin());
 		receivers_in_current_round_.erase(receivers_in_current_round_.begin());
 	}
 
-	restoreUnusedTokens_(table);
-	return output;
-}
-std::map<int, int> RoundRobinPolicy::sortTokens_()
-{
-	auto output = std::map<int, int>();
-	for (auto token : tokens_)
-	{
-		output[token]++;
-	}
-	tokens_.clear();
 	return output;
 }
-
-void RoundRobinPolicy::restoreUnusedTokens_(std::map<int, int> const& sorted_tokens)
+std::vector<std::pair<int, size_t>> RoundRobinPolicy::sortTokens_() const
 {
-	for (auto r : sorted_tokens)
+	// Ranks holding tokens, in rank order, with their token counts
+	auto output = std::vector<std::pair<int, size_t>>();
+	for (auto rank : tokens_.Ranks())
 	{
-		for (auto i = 0; i < r.second; ++i)
+		auto count = tokens_.Count(rank);
+		if (count > 0)
 		{
-			tokens_.push_back(r.first);
+			output.emplace_back(rank, count);
 		}
 	}
+	return output;
 }
 
 int RoundRobinPolicy::calculateMinimum_()
@@ -0,0 +1,128 @@
+#include "artdaq/RoutingPolicies/RoutingCache.hh"
+
+#include <algorithm>
+
+artdaq::RoutingCache::RoutingCache(size_t max_size)
+    : base_(0)
+    , lowest_(0)
+    , ring_count_(0)
+{
+	size_t size = 16;
+	while (size < 2 * max_size)
+	{
+		size *= 2;
+	}
+	ring_.resize(size);
+	mask_ = size - 1;
+}
+
+std::vector<artdaq::RoutingCache::Entry>* artdaq::RoutingCache::Find(Fragment::sequence_id_t seq)
+{
+	if (seq < base_)
+	{
+		auto it = overflow_.find(seq);
+		return it == overflow_.end() ? nullptr : &it->second;
+	}
+	if (seq - base_ >= ring_.size())
+	{
+		return nullptr;
+	}
+	auto& slot = ring_[seq & mask_];
+	return slot.sequence_id == seq ? &slot.entries : nullptr;
+}
+
+std::vector<artdaq::RoutingCache::Entry>& artdaq::RoutingCache::Insert(Fragment::sequence_id_t seq)
+{
+	if (seq < base_)
+	{
+		return overflow_[seq];
+	}
+	if (seq - base_ >= ring_.size())
+	{
+		slide_(seq);
+	}
+
+	auto& slot = ring_[seq & mask_];
+	if (slot.sequence_id != seq)
+	{
+		slot.sequence_id = seq;
+		slot.entries.clear();
+		lowest_ = ring_count_ == 0 ? seq : std::min(lowest_, seq);
+		ring_count_++;
+	}
+	return slot.entries;
+}
+
+void artdaq::RoutingCache::Reserve(size_t max_size)
+{
+	auto size = ring_.size();
+	while (size < 2 * max_size)
+	{
+		size *= 2;
+	}
+	if (size == ring_.size())
+	{
+		return;
+	}
+
+	// The window keeps its base, so every sequence ID in the old ring fits in the new one
+	std::vector<Slot> ring(size);
+	for (auto& slot : ring_)
+	{
+		if (slot.sequence_id != Fragment::InvalidSequenceID)
+		{
+			ring[slot.sequence_id & (size - 1)] = std::move(slot);
+		}
+	}
+	ring_.swap(ring);
+	mask_ = size - 1;
+}
+
+void artdaq::RoutingCache::Trim(size_t max_size)
+{
+	while (Size() > max_size)
+	{
+		// Everything in overflow_ is below the ring
+		if (!overflow_.empty())
+		{
+			overflow_.erase(overflow_.begin());
+			continue;
+		}
+
+		while (ring_[lowest_ & mask_].sequence_id != lowest_)
+		{
+			++lowest_;
+		}
+		ring_[lowest_ & mask_].sequence_id = Fragment::InvalidSequenceID;
+		ring_count_--;
+		++lowest_;
+	}
+}
+
+bool artdaq::RoutingCache::Contains(Fragment::sequence_id_t seq) const
+{
+	if (seq < base_)
+	{
+		return overflow_.count(seq) != 0;
+	}
+	return seq - base_ < ring_.size() && ring_[seq & mask_].sequence_id == seq;
+}
+
+void artdaq::RoutingCache::slide_(Fragment::sequence_id_t seq)
+{
+	// Move seq to the top of the window. Sequence IDs which fall out of the bottom move to overflow_.
+	auto new_base = seq - ring_.size() + 1;
+	auto end = std::min(new_base, base_ + ring_.size());
+	for (auto ii = std::max(base_, lowest_); ring_count_ > 0 && ii < end; ++ii)
+	{
+		auto& slot = ring_[ii & mask_];
+		if (slot.sequence_id == ii)
+		{
+			overflow_[ii].swap(slot.entries);
+			slot.sequence_id = Fragment::InvalidSequenceID;
+			ring_count_--;
+		}
+	}
+	base_ = new_base;
+	lowest_ = std::max(lowest_, base_);
+}
@@ -0,0 +1,105 @@
+#ifndef artdaq_RoutingPolicies_RoutingCache_hh
+#define artdaq_RoutingPolicies_RoutingCache_hh
+
+#include "TRACE/tracemf.h"  // Pre-empt TRACE/trace.h from Fragment.hh.
+#include "artdaq-core/Data/Fragment.hh"
+
+#include <map>
+#include <vector>
+
+namespace artdaq {
+/**
+ * \brief The routes handed out by a RoutingManagerPolicy, indexed by sequence ID
+ *
+ * Routes are kept in a ring of slots indexed by sequence ID, covering a window that ends at the highest sequence ID
+ * routed so far. Lookups, insertions and trimming of the oldest routes are O(1) while sequence IDs stay within the
+ * window, which is at least twice the configured cache size. Routes for sequence IDs below the window (late or
+ * arbitrary requests) are kept in an ordered map until they are trimmed.
+ *
+ * RoutingCache is not thread-safe; RoutingManagerPolicy protects it with its cache lock.
+ */
+class RoutingCache
+{
+public:
+	/// A route for a sequence ID, as requested by one rank
+	struct Entry
+	{
+		int destination_rank{-1};                                           ///< Rank the sequence ID is routed to
+		Fragment::sequence_id_t sequence_id{Fragment::InvalidSequenceID};  ///< Sequence ID of the route
+		int requesting_rank{-1};                                            ///< Rank which requested the route
+		bool included_in_table{false};                                      ///< Whether the route has been sent in a table update
+
+		/**
+		 * \brief Construct an Entry
+		 * \param seq Sequence ID of the route
+		 * \param dest Rank the sequence ID is routed to
+		 * \param source Rank which requested the route
+		 */
+		Entry(Fragment::sequence_id_t seq, int dest, int source)
+		    : destination_rank(dest), sequence_id(seq), requesting_rank(source) {}
+	};
+
+	/**
+	 * \brief RoutingCache Constructor
+	 * \param max_size Number of sequence IDs the cache is expected to be trimmed to; sets the size of the ring
+	 */
+	explicit RoutingCache(size_t max_size);
+
+	/**
+	 * \brief Get the routes for a sequence ID
+	 * \param seq Sequence ID to look up
+	 * \return The routes for the sequence ID, or nullptr if there are none
+	 */
+	std::vector<Entry>* Find(Fragment::sequence_id_t seq);
+
+	/**
+	 * \brief Get the routes for a sequence ID, adding the sequence ID if it is not in the cache
+	 * \param seq Sequence ID to look up
+	 * \return The routes for the sequence ID, empty if it was just added
+	 */
+	std::vector<Entry>& Insert(Fragment::sequence_id_t seq);
+
+	/**
+	 * \brief Grow the ring so that max_size sequence IDs stay within it. Never shrinks the ring.
+	 * \param max_size Number of sequence IDs the cache is expected to be trimmed to
+	 */
+	void Reserve(size_t max_size);
+
+	/**
+	 * \brief Remove the lowest sequence IDs until at most max_size are left
+	 * \param max_size Number of sequence IDs to keep
+	 */
+	void Trim(size_t max_size);
+
+	/**
+	 * \brief Get the number of sequence IDs in the cache
+	 * \return The number of sequence IDs in the cache
+	 */
+	size_t Size() const { return ring_count_ + overflow_.size(); }
+
+	/**
+	 * \brief Determine whether the cache has routes for a sequence ID
+	 * \param seq Sequence ID to look up
+	 * \return Whether the cache has routes for the sequence ID
+	 */
+	bool Contains(Fragment::sequence_id_t seq) const;
+
+private:
+	struct Slot
+	{
+		Fragment::sequence_id_t sequence_id{Fragment::InvalidSequenceID};
+		std::vector<Entry> entries;  // Keeps its capacity when the slot is reused
+	};
+
+	void slide_(Fragment::sequence_id_t seq);
+
+	std::vector<Slot> ring_;  // Power-of-two size; sequence ID s lives in ring_[s & mask_]
+	size_t mask_;
+	Fragment::sequence_id_t base_;    // Lowest sequence ID the ring covers; it covers [base_, base_ + ring_.size())
+	Fragment::sequence_id_t lowest_;  // No sequence ID below this is in the ring
+	size_t ring_count_;
+	std::map<Fragment::sequence_id_t, std::vector<Entry>> overflow_;  // Sequence IDs below base_
+};
+}  // namespace artdaq
+
+#endif  // artdaq_RoutingPolicies_RoutingCache_hh
@@ -6,9 +6,12 @@
 
 #include "fhiclcpp/ParameterSet.h"
 
+#include <algorithm>
+
 artdaq::RoutingManagerPolicy::RoutingManagerPolicy(const fhicl::ParameterSet& ps)
     : tokens_used_since_last_update_(0)
     , next_sequence_id_(1)
+    , routing_cache_(ps.get<size_t>("routing_cache_size", 1000))
     , max_token_count_(0)
 {
 	routing_mode_ = detail::RoutingManagerModeConverter::stringToRoutingManagerMode(ps.get<std::string>("routing_manager_mode", "EventBuilding"));
@@ -36,44 +39,49 @@ artdaq::detail::RoutingPacket artdaq::RoutingManagerPolicy::GetCurrentTable()
 
 void artdaq::RoutingManagerPolicy::AddReceiverToken(int rank, unsigned new_slots_free)
 {
+	TLOG(TLVL_DEBUG + 35) << "AddReceiverToken BEGIN";
+	std::lock_guard<std::mutex> lk(tokens_mutex_);
 	if (receiver_ranks_.count(rank) == 0u)
 	{
 		TLOG(TLVL_INFO) << "Adding rank " << rank << " to receivers list (initial tokens=" << new_slots_free << ")";
 		receiver_ranks_.insert(rank);
-	}
-	TLOG(TLVL_DEBUG + 35) << "AddReceiverToken BEGIN";
-	std::lock_guard<std::mutex> lk(tokens_mutex_);
-	if (new_slots_free == 1)
-	{
-		tokens_.push_back(rank);
+
+		// The slots of a start-of-run multitoken are interleaved at random with those of the other receivers
+		tokens_.Add(rank, new_slots_free, new_slots_free > 1);
 	}
 	else
 	{
-		// Randomly distribute multitokens through the token list
-		// Only used at start run time, so we can take the performance hit
-		for (unsigned i = 0; i < new_slots_free; ++i)
+		// Batched tokens from a running receiver are kept in arrival order
+		tokens_.Add(rank, new_slots_free);
+
+		auto load = receiver_loads_.find(rank);
+		if (load != receiver_loads_.end())
 		{
-			auto it = tokens_.begin();
-			if (!tokens_.empty())
-			{
-				std::advance(it, rand() % tokens_.size());  // NOLINT(cert-msc50-cpp)
-			}
-			tokens_.insert(it, rank);
+			load->second.outstanding -= std::min<size_t>(load->second.outstanding, new_slots_free);
 		}
 	}
-	if (tokens_.size() > max_token_count_)
+	if (tokens_.Size() > max_token_count_)
 	{
-		max_token_count_ = tokens_.size();
+		max_token_count_ = tokens_.Size();
 	}
 	TLOG(TLVL_DEBUG + 35) << "AddReceiverToken END";
 }
 
+void artdaq::RoutingManagerPolicy::UpdateReceiverLoad(int rank, detail::RoutingTokenLoad const& load)
+{
+	std::lock_guard<std::mutex> lk(tokens_mutex_);
+	auto& receiver = receiver_loads_[rank];
+	receiver.report = load;
+	receiver.has_report = true;
+}
+
 void artdaq::RoutingManagerPolicy::Reset()
 {
 	next_sequence_id_ = 1;
 	std::unique_lock<std::mutex> lk(tokens_mutex_);
-	tokens_.clear();
+	tokens_.Clear();
 	receiver_ranks_.clear();
+	receiver_loads_.clear();
 }
 
 artdaq::detail::RoutingPacketEntry artdaq::RoutingManagerPolicy::GetRouteForSequenceID(artdaq::Fragment::sequence_id_t seq, int requesting_rank)
@@ -81,17 +89,29 @@ artdaq::detail::RoutingPacketEntry artdaq::RoutingManagerPolicy::GetRouteForSequ
 	if (routing_mode_ != detail::RoutingManagerMode::DataFlow)
 	{
 		std::lock_guard<std::mutex> lk(routing_cache_mutex_);
-		if (routing_cache_.count(seq))
+		auto routes = routing_cache_.Find(seq);
+		if (routes != nullptr && !routes->empty())
 		{
-			return detail::RoutingPacketEntry(seq, routing_cache_[seq][0].destination_rank);
+			return detail::RoutingPacketEntry(seq, routes->front().destination_rank);
 		}
 		else
 		{
 			std::lock_guard<std::mutex> tlk(tokens_mutex_);
+			if (routing_mode_ == detail::RoutingManagerMode::EventBuilding && seq < next_sequence_id_)
+			{
+				// The sequence ID was routed by a table and has since been trimmed from the cache. A new route could
+				// send part of the event to a different receiver.
+				TLOG(TLVL_ERROR) << "Route for sequence ID " << seq << " requested by rank " << requesting_rank << " is no longer in the routing cache (next sequence ID is " << next_sequence_id_ << "); not creating a new route. Consider increasing routing_cache_size.";
+				return detail::RoutingPacketEntry();
+			}
 			auto entry = CreateRouteForSequenceID(seq, requesting_rank);
 			if (entry.sequence_id == seq)
 			{
-				routing_cache_[seq].emplace_back(seq, entry.destination_rank, requesting_rank);
+				routing_cache_.Insert(seq).emplace_back(seq, entry.destination_rank, requesting_rank);
+				if (routing_mode_ == detail::RoutingManagerMode::RequestBasedEventBuilding)
+				{
+					pending_table_routes_.push_back(seq);
+				}
 			}
 			return entry;
 		}
@@ -99,9 +119,10 @@ artdaq::detail::RoutingPacketEntry artdaq::RoutingManagerPolicy::GetRouteForSequ
 	else
 	{
 		std::lock_guard<std::mutex> lk(routing_cache_mutex_);
-		if (routing_cache_.count(seq))
+		auto routes = routing_cache_.Find(seq);
+		if (routes != nullptr)
 		{
-			for (auto& entry : routing_cache_[seq])
+			for (auto& entry : *routes)
 			{
 				if (entry.requesting_rank == requesting_rank)
 				{
@@ -114,7 +135,7 @@ artdaq::detail::RoutingPacketEntry artdaq::RoutingManagerPolicy::GetRouteForSequ
 		auto entry = CreateRouteForSequenceID(seq, requesting_rank);
 		if (entry.sequence_id == seq)
 		{
-			routing_cache_[seq].emplace_back(seq, entry.destination_rank, requesting_rank);
+			routing_cache_.Insert(seq).emplace_back(seq, entry.destination_rank, requesting_rank);
 		}
 
 		TrimRoutingCache();
@@ -125,10 +146,15 @@ artdaq::detail::RoutingPacketEntry artdaq::RoutingManagerPolicy::GetRouteForSequ
 
 void artdaq::RoutingManagerPolicy::TrimRoutingCache()
 {
-	while (routing_cache_.size() > routing_cache_max_size_)
+	auto max_size = routing_cache_max_size_;
+	if (routing_mode_ == detail::RoutingManagerMode::EventBuilding)
 	{
-		routing_cache_.erase(routing_cache_.begin());
+		// Receivers which fall behind request the routes they missed one sequence ID at a time. Keep every route which
+		// may still be waiting for data in an EventBuilder buffer; max_token_count_ is about the number of buffers.
+		max_size = std::max(max_size, 4 * max_token_count_.load());
+		routing_cache_.Reserve(max_size);
 	}
+	routing_cache_.Trim(max_size);
 }
 
 void artdaq::RoutingManagerPolicy::UpdateCache(detail::RoutingPacket& table)
@@ -137,11 +163,14 @@ void artdaq::RoutingManagerPolicy::UpdateCache(detail::RoutingPacket& table)
 
 	for (auto& entry : table)
 	{
-		if (!routing_cache_.count(entry.sequence_id))
+		auto& routes = routing_cache_.Insert(entry.sequence_id);
+		if (routes.empty())
 		{
-			routing_cache_[entry.sequence_id].emplace_back(entry.sequence_id, entry.destination_rank, my_rank);
+			routes.emplace_back(entry.sequence_id, entry.destination_rank, my_rank);
 		}
 	}
+
+	TrimRoutingCache();
 }
 
 void artdaq::RoutingManagerPolicy::CreateRoutingTableFromCache(detail::RoutingPacket& table)
@@ -150,14 +179,18 @@ void artdaq::RoutingManagerPolicy::CreateRoutingTableFromCache(detail::RoutingPa
 
 	if (routing_mode_ == detail::RoutingManagerMode::RequestBasedEventBuilding)
 	{
-		for (auto& cache_entry : routing_cache_)
+		// Tables list routes in sequence ID order
+		std::sort(pending_table_routes_.begin(), pending_table_routes_.end());
+		for (auto seq : pending_table_routes_)
 		{
-			if (!cache_entry.second[0].included_in_table)
+			auto routes = routing_cache_.Find(seq);
+			if (routes != nullptr && !routes->empty() && !routes->front().included_in_table)
 			{
-				table.push_back(artdaq::detail::RoutingPacketEntry(cache_entry.second[0].sequence_id, cache_entry.second[0].destination_rank));
-				cache_entry.second[0].included_in_table = true;
+				table.push_back(artdaq::detail::RoutingPacketEntry(seq, routes->front().destination_rank));
+				routes->front().included_in_table = true;
 			}
 		}
+		pending_table_routes_.clear();
 
 		TrimRoutingCache();
 	}
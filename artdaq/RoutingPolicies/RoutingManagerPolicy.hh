@@ -5,13 +5,15 @@
 #include "artdaq-core/Data/Fragment.hh"
 
 #include "artdaq/DAQrate/detail/RoutingPacket.hh"  // No library dependence.
+#include "artdaq/RoutingPolicies/RoutingCache.hh"
+#include "artdaq/RoutingPolicies/RoutingTokenPool.hh"
 
 namespace fhicl {
 class ParameterSet;
 }
 
-#include <deque>
 #include <mutex>
+#include <unordered_map>
 #include <unordered_set>
 
 namespace artdaq {
@@ -61,10 +63,23 @@ public:
 	/**
 	 * \brief Add a token to the token list
 	 * \param rank Rank that the token is from
-	 * \param new_slots_free Number of slots that are now free (should usually be 1)
+	 * \param new_slots_free Number of slots that are now free
+	 *
+	 * The first token from a rank in a run (the start-of-run multitoken) is spread randomly through the token list;
+	 * subsequent (possibly batched) tokens are appended to the end, and each of their slots completes one of the
+	 * rank's outstanding sequence IDs.
 	 */
 	void AddReceiverToken(int rank, unsigned new_slots_free);
 
+	/**
+	 * \brief Record the occupancy reported by a receiver along with its tokens
+	 * \param rank Rank that the report is from
+	 * \param load Reported occupancy
+	 *
+	 * The report supersedes the previous one from the same rank.
+	 */
+	void UpdateReceiverLoad(int rank, detail::RoutingTokenLoad const& load);
+
 	/**
 	 * \brief Reset the policy, setting the next sequence ID to be used to 1, and removing any tokens
 	 */
@@ -83,7 +98,7 @@ public:
 	size_t GetHeldTokenCount() const
 	{
 		std::unique_lock<std::mutex> lk(tokens_mutex_);
-		return tokens_.size();
+		return tokens_.Size();
 	}
 
 	/**
@@ -96,7 +111,8 @@ public:
 	 * @brief Get an artdaq::detail::RoutingPacketEntry for a given sequence ID and rank. Used by RequestBasedEventBuilder and DataFlow RoutingManagerMode
 	 * @param seq Sequence Number to get route for
 	 * @param requesting_rank Rank to route for
-	 * @return artdaq::detail::RoutingPacketEntry connecting sequence ID to destination rank
+	 * @return artdaq::detail::RoutingPacketEntry connecting sequence ID to destination rank. In EventBuilding mode, an
+	 * empty entry if the sequence ID was already routed and has been trimmed from the routing cache.
 	 */
 	detail::RoutingPacketEntry GetRouteForSequenceID(artdaq::Fragment::sequence_id_t seq, int requesting_rank);
 
@@ -111,13 +127,13 @@ public:
 	 * @brief Get the size of the routing cache. For testing
 	 * @return Size of the routing cache
 	 */
-	size_t GetCacheSize() const { return routing_cache_.size(); }
+	size_t GetCacheSize() const { return routing_cache_.Size(); }
 	/**
 	 * @brief Determine whether the routing cache has a route for the given sequence ID. For testing
 	 * @param seq Sequence ID to check
 	 * @return True if the sequence ID is in the cache
 	 */
-	bool CacheHasRoute(artdaq::Fragment::sequence_id_t seq) const { return routing_cache_.count(seq) != 0; }
+	bool CacheHasRoute(artdaq::Fragment::sequence_id_t seq) const { return routing_cache_.Contains(seq); }
 
 protected:
 	/**
@@ -135,9 +151,18 @@ protected:
 	virtual detail::RoutingPacketEntry CreateRouteForSequenceID(artdaq::Fragment::sequence_id_t seq, int requesting_rank) = 0;
 
 	// Tokens
-	std::deque<int> tokens_;                             ///< The list of tokens which are available for use
+	RoutingTokenPool tokens_;                            ///< The tokens which are available for use, counted per receiver
 	std::atomic<size_t> tokens_used_since_last_update_;  ///< Number of tokens consumed since last metric update
 
+	/// Occupancy of a receiver, as last reported with its tokens and as seen from the RoutingManager
+	struct ReceiverLoad
+	{
+		detail::RoutingTokenLoad report;  ///< The last RoutingTokenLoad received from the receiver
+		bool has_report{false};           ///< Whether the receiver has reported its occupancy at all
+		size_t outstanding{0};            ///< Sequence IDs routed to the receiver (counted by the policy) for which it has not yet returned a token
+	};
+	std::unordered_map<int, ReceiverLoad> receiver_loads_;  ///< Occupancy of each receiver. Protected by the same lock as tokens_
+
 	// Routing Information
 	Fragment::sequence_id_t next_sequence_id_;  ///< The next sequence ID to be assigned
 	std::unordered_set<int> receiver_ranks_;    ///< Configured receiver (e.g. EventBuilder for BR->EB routing) ranks
@@ -154,19 +179,8 @@ private:
 	void TrimRoutingCache();
 	void UpdateCache(detail::RoutingPacket& table);
 
-	struct RoutingCacheEntry
-	{
-		bool is_valid{false};
-		int destination_rank{-1};
-		Fragment::sequence_id_t sequence_id{artdaq::Fragment::InvalidSequenceID};
-		int requesting_rank{-1};
-		bool included_in_table{false};
-
-		RoutingCacheEntry() {}
-		RoutingCacheEntry(Fragment::sequence_id_t seq, int dest, int source)
-		    : is_valid(true), destination_rank(dest), sequence_id(seq), requesting_rank(source) {}
-	};
-	std::map<Fragment::sequence_id_t, std::vector<RoutingCacheEntry>> routing_cache_;
+	RoutingCache routing_cache_;
+	std::vector<Fragment::sequence_id_t> pending_table_routes_;  // RequestBasedEventBuilding routes not yet sent in a table
 	size_t routing_cache_max_size_;
 	mutable std::mutex routing_cache_mutex_;
 	std::atomic<size_t> max_token_count_;
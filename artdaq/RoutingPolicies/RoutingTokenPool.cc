@@ -0,0 +1,212 @@
+#include "artdaq/RoutingPolicies/RoutingTokenPool.hh"
+
+#include <algorithm>
+
+artdaq::RoutingTokenPool::RoutingTokenPool()
+    : spread_tree_(1, 0)
+    , spread_total_(0)
+    , size_(0)
+    , engine_(std::random_device()())
+{}
+
+void artdaq::RoutingTokenPool::Add(int rank, size_t count, bool spread)
+{
+	auto slot = slot_(rank);
+	counts_[slot] += count;
+	size_ += count;
+	if (count == 0)
+	{
+		return;
+	}
+
+	if (spread)
+	{
+		spread_counts_[slot] += count;
+		spread_total_ += count;
+		addSpread_(slot, count);
+		return;
+	}
+
+	if (!arrivals_.empty() && arrivals_.back().first == rank)
+	{
+		arrivals_.back().second += count;
+	}
+	else
+	{
+		arrivals_.emplace_back(rank, count);
+	}
+	// Tokens removed by Take stay in arrivals_ until TakeNext reaches them; keep them from piling up
+	if (arrivals_.size() > 2 * size_ + 64)
+	{
+		compact_();
+	}
+}
+
+void artdaq::RoutingTokenPool::Take(int rank, size_t count)
+{
+	auto it = slots_.find(rank);
+	if (it == slots_.end())
+	{
+		return;
+	}
+	auto slot = it->second;
+	count = std::min(count, counts_[slot]);
+	counts_[slot] -= count;
+	size_ -= count;
+
+	auto spread = std::min(count, spread_counts_[slot]);
+	if (spread > 0)
+	{
+		spread_counts_[slot] -= spread;
+		spread_total_ -= spread;
+		addSpread_(slot, -spread);
+	}
+	taken_early_[slot] += count - spread;
+
+	if (size_ == 0)
+	{
+		arrivals_.clear();
+		std::fill(taken_early_.begin(), taken_early_.end(), 0);
+	}
+}
+
+int artdaq::RoutingTokenPool::TakeNext()
+{
+	if (size_ == 0)
+	{
+		return -1;
+	}
+
+	if (spread_total_ > 0)
+	{
+		std::uniform_int_distribution<size_t> dist(0, spread_total_ - 1);
+		auto rank = ranks_[findSpread_(dist(engine_))];
+		Take(rank, 1);
+		return rank;
+	}
+
+	while (true)
+	{
+		auto& run = arrivals_.front();
+		auto slot = slots_[run.first];
+		auto skip = std::min(run.second, taken_early_[slot]);
+		run.second -= skip;
+		taken_early_[slot] -= skip;
+		if (run.second == 0)
+		{
+			arrivals_.pop_front();
+			continue;
+		}
+
+		auto rank = run.first;
+		if (--run.second == 0)
+		{
+			arrivals_.pop_front();
+		}
+		counts_[slot]--;
+		if (--size_ == 0)
+		{
+			arrivals_.clear();
+			std::fill(taken_early_.begin(), taken_early_.end(), 0);
+		}
+		return rank;
+	}
+}
+
+void artdaq::RoutingTokenPool::Clear()
+{
+	ranks_.clear();
+	slots_.clear();
+	counts_.clear();
+	spread_counts_.clear();
+	spread_tree_.assign(1, 0);
+	spread_total_ = 0;
+	arrivals_.clear();
+	taken_early_.clear();
+	size_ = 0;
+}
+
+size_t artdaq::RoutingTokenPool::slot_(int rank)
+{
+	auto it = slots_.find(rank);
+	if (it != slots_.end())
+	{
+		return it->second;
+	}
+
+	// New receiver: keep the slots in rank order. Happens once per receiver per run.
+	auto slot = static_cast<size_t>(std::lower_bound(ranks_.begin(), ranks_.end(), rank) - ranks_.begin());
+	ranks_.insert(ranks_.begin() + slot, rank);
+	counts_.insert(counts_.begin() + slot, 0);
+	spread_counts_.insert(spread_counts_.begin() + slot, 0);
+	taken_early_.insert(taken_early_.begin() + slot, 0);
+	for (size_t ii = slot; ii < ranks_.size(); ++ii)
+	{
+		slots_[ranks_[ii]] = ii;
+	}
+
+	spread_tree_.assign(ranks_.size() + 1, 0);
+	for (size_t ii = 1; ii < spread_tree_.size(); ++ii)
+	{
+		spread_tree_[ii] += spread_counts_[ii - 1];
+		auto parent = ii + (ii & (~ii + 1));
+		if (parent < spread_tree_.size())
+		{
+			spread_tree_[parent] += spread_tree_[ii];
+		}
+	}
+	return slot;
+}
+
+void artdaq::RoutingTokenPool::addSpread_(size_t slot, size_t count)
+{
+	// Unsigned arithmetic: adding the two's complement of a count subtracts it
+	for (auto ii = slot + 1; ii < spread_tree_.size(); ii += ii & (~ii + 1))
+	{
+		spread_tree_[ii] += count;
+	}
+}
+
+size_t artdaq::RoutingTokenPool::findSpread_(size_t index) const
+{
+	// Find the slot holding the index-th spread token, descending the Fenwick tree
+	size_t pos = 0;
+	size_t step = 1;
+	while (step * 2 < spread_tree_.size())
+	{
+		step *= 2;
+	}
+	for (; step > 0; step /= 2)
+	{
+		if (pos + step < spread_tree_.size() && spread_tree_[pos + step] <= index)
+		{
+			pos += step;
+			index -= spread_tree_[pos];
+		}
+	}
+	return pos;
+}
+
+void artdaq::RoutingTokenPool::compact_()
+{
+	std::deque<std::pair<int, size_t>> arrivals;
+	for (auto& run : arrivals_)
+	{
+		auto slot = slots_[run.first];
+		auto skip = std::min(run.second, taken_early_[slot]);
+		taken_early_[slot] -= skip;
+		if (run.second == skip)
+		{
+			continue;
+		}
+		if (!arrivals.empty() && arrivals.back().first == run.first)
+		{
+			arrivals.back().second += run.second - skip;
+		}
+		else
+		{
+			arrivals.emplace_back(run.first, run.second - skip);
+		}
+	}
+	arrivals_.swap(arrivals);
+}
@@ -0,0 +1,105 @@
+#ifndef artdaq_RoutingPolicies_RoutingTokenPool_hh
+#define artdaq_RoutingPolicies_RoutingTokenPool_hh
+
+#include <cstddef>
+#include <deque>
+#include <random>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace artdaq {
+/**
+ * \brief The routing tokens held by a RoutingManagerPolicy, counted per receiver
+ *
+ * Policies which route by token count use Count and Take, which are O(1). Policies which route tokens in the order
+ * they arrived use TakeNext. Tokens added with spread set (the start-of-run multitoken of a receiver) are handed out
+ * by TakeNext first, in random order: each one goes to a receiver chosen with probability proportional to its
+ * remaining spread tokens, which interleaves the receivers' initial slots. The others follow in arrival order.
+ * Both orders cost O(log R) or less per token, R being the number of receivers.
+ *
+ * RoutingTokenPool is not thread-safe; RoutingManagerPolicy protects it with its token lock.
+ */
+class RoutingTokenPool
+{
+public:
+	/**
+	 * \brief RoutingTokenPool Constructor
+	 */
+	RoutingTokenPool();
+
+	/**
+	 * \brief Add tokens from a receiver
+	 * \param rank Rank of the receiver
+	 * \param count Number of tokens (free slots)
+	 * \param spread Whether TakeNext should hand these tokens out in random order, interleaved with the other spread tokens
+	 */
+	void Add(int rank, size_t count, bool spread = false);
+
+	/**
+	 * \brief Remove tokens from a receiver
+	 * \param rank Rank of the receiver
+	 * \param count Number of tokens to remove. At most Count(rank) are removed.
+	 */
+	void Take(int rank, size_t count = 1);
+
+	/**
+	 * \brief Remove the next token, in the order described above
+	 * \return Rank of the token, or -1 if there are no tokens
+	 */
+	int TakeNext();
+
+	/**
+	 * \brief Remove all tokens and receivers
+	 */
+	void Clear();
+
+	/**
+	 * \brief Get the number of tokens held for a receiver
+	 * \param rank Rank of the receiver
+	 * \return Number of tokens held for the receiver
+	 */
+	size_t Count(int rank) const
+	{
+		auto it = slots_.find(rank);
+		return it == slots_.end() ? 0 : counts_[it->second];
+	}
+
+	/**
+	 * \brief Get the total number of tokens held
+	 * \return The total number of tokens held
+	 */
+	size_t Size() const { return size_; }
+
+	/**
+	 * \brief Determine whether any tokens are held
+	 * \return Whether Size() is 0
+	 */
+	bool Empty() const { return size_ == 0; }
+
+	/**
+	 * \brief Get the ranks which have added tokens, in ascending order. Some may have no tokens left.
+	 * \return The ranks which have added tokens
+	 */
+	std::vector<int> const& Ranks() const { return ranks_; }
+
+private:
+	size_t slot_(int rank);
+	void addSpread_(size_t slot, size_t count);
+	size_t findSpread_(size_t index) const;
+	void compact_();
+
+	std::vector<int> ranks_;                 // Sorted; the slot of a rank is its index
+	std::unordered_map<int, size_t> slots_;  // rank -> slot
+	std::vector<size_t> counts_;             // Tokens held per slot
+	std::vector<size_t> spread_counts_;      // Of which spread tokens not yet taken
+	std::vector<size_t> spread_tree_;        // Fenwick tree over spread_counts_, for weighted random choice
+	size_t spread_total_;
+	std::deque<std::pair<int, size_t>> arrivals_;  // (rank, count) runs of non-spread tokens, in arrival order
+	std::vector<size_t> taken_early_;              // Per slot: tokens taken by Take which are still in arrivals_
+	size_t size_;
+	std::mt19937 engine_;
+};
+}  // namespace artdaq
+
+#endif  // artdaq_RoutingPolicies_RoutingTokenPool_hh
@@ -90,6 +90,19 @@ public:
 	 */
 	bool isRunning() override { return theTransfer_->isRunning(); }
 
+	/**
+	 * \brief Get the file descriptors which become readable when data is available to this receiver
+	 * \param[out] fds Filled with the currently-connected receive file descriptors
+	 * \return True if the underlying plugin supports readiness notification through file descriptors
+	 */
+	bool getReceiveFDs(std::vector<int>& fds) override { return theTransfer_->getReceiveFDs(fds); }
+
+	/**
+	 * \brief Get a counter which changes whenever the file descriptors returned by getReceiveFDs change
+	 * \return The counter of the underlying transfer plugin
+	 */
+	size_t getReceiveFDsVersion() const override { return theTransfer_->getReceiveFDsVersion(); }
+
 	/**
 	 * \brief Flush any in-flight data. This should be used by the receiver after the receive loop has
 	 * ended.
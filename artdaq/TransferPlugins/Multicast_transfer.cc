@@ -10,20 +10,33 @@
 #include "fhiclcpp/ParameterSet.h"
 
 #include <boost/asio.hpp>
+#include <boost/exception/all.hpp>
+#include <boost/thread.hpp>
 
-#include <bitset>
+#include <poll.h>
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <cstring>
+#include <deque>
 #include <iostream>
+#include <map>
+#include <mutex>
+#include <random>
 #include <string>
 #include <type_traits>
 #include <vector>
 
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wunused-parameter"
-
 namespace artdaq {
 /**
  * \brief MulticastTransfer is a TransferInterface implementation plugin that transfers data using Multicast
+ *
+ * Each Fragment is split into datagrams of at most subfragment_size bytes, which carry a per-sender transfer sequence number.
+ * The sender keeps the most recently sent Fragments in a bounded retransmit window. Receivers deliver Fragments in sequence
+ * order, and request missing datagrams with NAKs sent back to the sender over unicast; the sender retransmits them to the
+ * multicast group. A Fragment which is still incomplete after gap_timeout_ms, or which has left the sender's window, is dropped.
+ * While idle, the sender multicasts a heartbeat carrying its latest sequence number, so that receivers notice a lost final Fragment.
  */
 class MulticastTransfer : public TransferInterface
 {
@@ -31,9 +44,9 @@ public:
 	using byte_t = artdaq::Fragment::byte_t;  ///< Copy Fragment::byte_t into local scope
 
 	/**
-	 * \brief Default destructor
+	 * \brief MulticastTransfer Destructor
 	 */
-	~MulticastTransfer() override = default;
+	~MulticastTransfer() override;
 
 	/**
 	 * \brief MulticastTransfer Constructor
@@ -42,13 +55,21 @@ public:
 	 *
 	 * \verbatim
 	 * MulticastTransfer accepts the following Parameters:
-	 * "subfragment_size" (REQUIRED): Size of the sub-Fragments
-	 * "subfragments_per_send" (REQUIRED): How many sub-Fragments to send in each batch
-	 * "pause_on_copy_usecs" (Default: 0): Pause after sending a batch of sub-Fragments for this many microseconds
+	 * "subfragment_size" (REQUIRED): Size of the payload of each datagram, in bytes
+	 * "subfragments_per_send" (REQUIRED): How many datagrams to send between pauses
+	 * "pause_on_copy_usecs" (Default: 0): Pause after sending subfragments_per_send datagrams for this many microseconds
 	 * "multicast_port" (REQUIRED): Port number to connect to
 	 * "multicast_address" (REQUIRED): Multicast address to send to/receive from
-	 * "local_address" (REQUIRED): Local origination address for multicast
+	 * "local_address" (REQUIRED): Local address of the interface used for multicast
 	 * "receive_buffer_size" (Default: 0): The UDP receive buffer size. 0 uses automatic size.
+	 * "retransmit_window_fragments" (Default: 100): Sender: Maximum number of sent Fragments kept for retransmission
+	 * "retransmit_window_mb" (Default: 64): Sender: Maximum total size of the Fragments kept for retransmission, in MB
+	 * "retransmit_holdoff_us" (Default: 1000): Sender: Minimum time between retransmissions of the same datagram, so that NAKs from several receivers cause one retransmission
+	 * "heartbeat_interval_ms" (Default: 100): Sender: Interval between heartbeats while no data is being sent
+	 * "debug_drop_fraction" (Default: 0.0): Sender: Fraction of data datagrams deliberately not sent the first time, for testing retransmission. Retransmissions are always sent.
+	 * "nak_interval_us" (Default: 2000): Receiver: Time without progress on an incomplete Fragment before a NAK is sent, and between repeated NAKs
+	 * "gap_timeout_ms" (Default: 1000): Receiver: Time after which an incomplete Fragment is dropped
+	 * "reorder_window_fragments" (Default: 100): Receiver: Maximum number of incomplete Fragments held while waiting for retransmissions
 	 * \endverbatim
 	 * MulticastTransfer also requires all Parameters for configuring a TransferInterface
 	 */
@@ -80,7 +101,7 @@ public:
 	int receiveFragmentData(RawDataType* destination, size_t wordCount) override;
 
 	/**
-	 * \brief Copy a Fragment to the destination. Multicast is always unreliable
+	 * \brief Copy a Fragment to the destination. Lost datagrams are retransmitted while the Fragment is in the retransmit window.
 	 * \param fragment Fragment to copy
 	 * \param send_timeout_usec How long to try to send before discarding data
 	 * \return CopyStatus detailing result of copy
@@ -88,7 +109,7 @@ public:
 	CopyStatus transfer_fragment_min_blocking_mode(artdaq::Fragment const& fragment, size_t send_timeout_usec) override;
 
 	/**
-	 * \brief Move a Fragment to the destination. Multicast is always unreliable
+	 * \brief Move a Fragment to the destination. Lost datagrams are retransmitted while the Fragment is in the retransmit window.
 	 * \param fragment Fragment to move
 	 * \return CopyStatus detailing result of copy
 	 */
@@ -112,37 +133,67 @@ private:
 	MulticastTransfer& operator=(MulticastTransfer const&) = delete;
 	MulticastTransfer& operator=(MulticastTransfer&&) = delete;
 
-	void fill_staging_memory(const artdaq::Fragment& frag);
-
-	template<typename T>
-	void book_container_of_buffers(std::vector<T>& buffers,
-	                               size_t fragment_size,
-	                               size_t total_subfragments,
-	                               size_t first_subfragment_num,
-	                               size_t last_subfragment_num);
+	enum class datagram_type : uint16_t
+	{
+		kData = 1,         // Sender -> receivers: one subfragment of a Fragment
+		kHeartbeat = 2,    // Sender -> receivers: transfer_sequence is the latest sequence sent
+		kNak = 3,          // Receiver -> sender: followed by subfragment_count missing subfragment numbers; none means the whole Fragment
+		kUnavailable = 4,  // Sender -> receivers: the requested Fragment has left the retransmit window
+	};
 
-	void get_fragment_quantities(const boost::asio::mutable_buffer& buf, size_t& payload_size, size_t& fragment_size,
-	                             size_t& expected_subfragments);
+	struct datagram_header
+	{
+		static constexpr uint32_t magic_value = 0x4D435354;  // "MCST"
+
+		uint32_t magic{magic_value};
+		datagram_type type{datagram_type::kData};
+		uint16_t reserved{0};
+		uint32_t subfragment_number{0};
+		uint32_t subfragment_count{0};
+		uint32_t subfragment_size{0};  // Payload size of all but the last datagram of the Fragment
+		uint32_t reserved2{0};
+		uint64_t transfer_sequence{0};
+		uint64_t fragment_bytes{0};
+	};
+	static_assert(sizeof(datagram_header) == 40, "datagram_header must have the same layout on sender and receiver");
 
-	void set_receive_buffer_size(size_t recv_buff_size);
+	// Sender: a Fragment in the retransmit window, staged as complete datagrams
+	struct sent_fragment
+	{
+		uint64_t transfer_sequence;
+		size_t subfragment_count;
+		std::vector<byte_t> datagrams;  // subfragment_count slots of sizeof(datagram_header) + subfragment_size_ bytes
+		std::vector<size_t> datagram_sizes;
+		std::vector<std::chrono::steady_clock::time_point> sent_at;
+	};
 
-	class subfragment_identifier
+	// Receiver: a Fragment which has not been delivered yet
+	struct pending_fragment
 	{
-	public:
-		subfragment_identifier(size_t sequenceID, size_t fragmentID, size_t subfragment_number)
-		    : sequenceID_(sequenceID)
-		    , fragmentID_(fragmentID)
-		    , subfragment_number_(subfragment_number) {}
+		Fragment fragment;  // Datagrams are copied straight into place, header included
+		std::vector<bool> received;
+		size_t subfragment_count{0};  // 0 until a datagram of this Fragment has been seen
+		size_t received_count{0};
+		bool dropped{false};
+		std::chrono::steady_clock::time_point first_seen;
+		std::chrono::steady_clock::time_point last_progress;
+		std::chrono::steady_clock::time_point last_nak;
+		size_t nak_count{0};
+	};
 
-		size_t sequenceID() const { return sequenceID_; }
-		size_t fragmentID() const { return fragmentID_; }
-		size_t subfragment_number() const { return subfragment_number_; }
+	// Sender
+	void send_datagram_(sent_fragment& frag, size_t subfragment, bool retransmit);
+	void service_sender_();
+	void handle_nak_(datagram_header const& nak, uint32_t const* subfragments);
+	void send_control_(datagram_type type, uint64_t transfer_sequence, boost::asio::ip::udp::endpoint const& destination);
 
-	private:
-		size_t sequenceID_;
-		size_t fragmentID_;
-		size_t subfragment_number_;
-	};
+	// Receiver
+	bool pop_fragment_(artdaq::Fragment& fragment);
+	void process_datagram_(size_t bytes, boost::asio::ip::udp::endpoint const& from);
+	void service_receiver_();
+	void send_nak_(uint64_t transfer_sequence, pending_fragment const& frag);
+
+	void set_receive_buffer_size(size_t recv_buff_size);
 
 	std::unique_ptr<boost::asio::io_service> io_service_;
 
@@ -158,9 +209,35 @@ private:
 	size_t pause_on_copy_usecs_;
 	Fragment fragment_buffer_;
 
-	std::vector<byte_t> staging_memory_;
-
-	std::vector<boost::asio::mutable_buffer> receive_buffers_;
+	std::vector<byte_t> datagram_buffer_;
+
+	// Sender
+	size_t retransmit_window_fragments_;
+	size_t retransmit_window_bytes_;
+	std::chrono::microseconds retransmit_holdoff_;
+	std::chrono::milliseconds heartbeat_interval_;
+	double debug_drop_fraction_;
+	std::mutex socket_mutex_;  // Held for every use of socket_ and window_ on the sender
+	std::deque<sent_fragment> window_;
+	size_t window_bytes_;
+	uint64_t last_transfer_sequence_;
+	std::chrono::steady_clock::time_point last_send_time_;
+	size_t datagram_count_;
+	std::minstd_rand drop_engine_;
+	std::uniform_real_distribution<double> drop_distribution_;
+	std::atomic<bool> stop_service_thread_;
+	std::unique_ptr<boost::thread> service_thread_;
+
+	// Receiver
+	std::chrono::microseconds nak_interval_;
+	std::chrono::milliseconds gap_timeout_;
+	size_t reorder_window_fragments_;
+	boost::asio::ip::udp::endpoint sender_endpoint_;  // NAKs are sent here
+	std::map<uint64_t, pending_fragment> pending_;
+	uint64_t next_sequence_;     // Next Fragment to deliver; 0 until the first datagram from the sender arrives
+	uint64_t highest_sequence_;  // Highest sequence number announced by the sender
+	bool have_sender_;
+	size_t dropped_fragments_;
 };
 }  // namespace artdaq
 
@@ -174,7 +251,32 @@ artdaq::MulticastTransfer::MulticastTransfer(fhicl::ParameterSet const& pset, Ro
     , subfragment_size_(pset.get<size_t>("subfragment_size"))
     , subfragments_per_send_(pset.get<size_t>("subfragments_per_send"))
     , pause_on_copy_usecs_(pset.get<size_t>("pause_on_copy_usecs", 0))
+    , retransmit_window_fragments_(pset.get<size_t>("retransmit_window_fragments", 100))
+    , retransmit_window_bytes_(pset.get<size_t>("retransmit_window_mb", 64) * 1024 * 1024)
+    , retransmit_holdoff_(pset.get<size_t>("retransmit_holdoff_us", 1000))
+    , heartbeat_interval_(pset.get<size_t>("heartbeat_interval_ms", 100))
+    , debug_drop_fraction_(pset.get<double>("debug_drop_fraction", 0.0))
+    , window_bytes_(0)
+    , last_transfer_sequence_(0)
+    , last_send_time_(std::chrono::steady_clock::now())
+    , datagram_count_(0)
+    , drop_engine_(source_rank() + 1)
+    , drop_distribution_(0.0, 1.0)
+    , stop_service_thread_(false)
+    , service_thread_(nullptr)
+    , nak_interval_(pset.get<size_t>("nak_interval_us", 2000))
+    , gap_timeout_(pset.get<size_t>("gap_timeout_ms", 1000))
+    , reorder_window_fragments_(pset.get<size_t>("reorder_window_fragments", 100))
+    , next_sequence_(0)
+    , highest_sequence_(0)
+    , have_sender_(false)
+    , dropped_fragments_(0)
 {
+	// Subfragment payloads are copied into Fragments at multiples of subfragment_size_, which must stay word-aligned
+	subfragment_size_ = std::max(sizeof(RawDataType), subfragment_size_ - subfragment_size_ % sizeof(RawDataType));
+	subfragments_per_send_ = std::max(static_cast<size_t>(1), subfragments_per_send_);
+	datagram_buffer_.resize(sizeof(datagram_header) + std::max(subfragment_size_, static_cast<size_t>(65536)));
+
 	try
 	{
 		portMan->UpdateConfiguration(pset);
@@ -185,6 +287,8 @@ artdaq::MulticastTransfer::MulticastTransfer(fhicl::ParameterSet const& pset, Ro
 		TLOG(TLVL_DEBUG + 32) << GetTraceName() << "multicast address is set to " << multicast_address;
 		TLOG(TLVL_DEBUG + 32) << GetTraceName() << "local address is set to " << local_address;
 
+		boost::system::error_code ec;
+
 		if (TransferInterface::role() == Role::kSend)
 		{
 			local_endpoint_ = std::make_unique<std::remove_reference<decltype(*local_endpoint_)>::type>(local_address, 0);
@@ -193,6 +297,15 @@ artdaq::MulticastTransfer::MulticastTransfer(fhicl::ParameterSet const& pset, Ro
 			socket_ = std::make_unique<std::remove_reference<decltype(*socket_)>::type>(*io_service_,
 			                                                                            multicast_endpoint_->protocol());
 			socket_->bind(*local_endpoint_);
+
+			if (local_address.is_v4())
+			{
+				socket_->set_option(boost::asio::ip::multicast::outbound_interface(local_address.to_v4()), ec);
+				if (ec.value() != 0)
+				{
+					TLOG(TLVL_ERROR) << "boost::system::error_code with value " << ec << " was found in setting outbound_interface option";
+				}
+			}
 		}
 		else
 		{  // TransferInterface::role() == Role::kReceive
@@ -203,8 +316,6 @@ artdaq::MulticastTransfer::MulticastTransfer(fhicl::ParameterSet const& pset, Ro
 			socket_ = std::make_unique<std::remove_reference<decltype(*socket_)>::type>(*io_service_,
 			                                                                            local_endpoint_->protocol());
 
-			boost::system::error_code ec;
-
 			socket_->set_option(boost::asio::ip::udp::socket::reuse_address(true), ec);
 
 			if (ec.value() != 0)
@@ -216,9 +327,16 @@ artdaq::MulticastTransfer::MulticastTransfer(fhicl::ParameterSet const& pset, Ro
 
 			socket_->bind(boost::asio::ip::udp::endpoint(multicast_address, port));
 
-			// Join the multicast group.
+			// Join the multicast group on the interface given by local_address.
 
-			socket_->set_option(boost::asio::ip::multicast::join_group(multicast_address), ec);
+			if (local_address.is_v4() && multicast_address.is_v4())
+			{
+				socket_->set_option(boost::asio::ip::multicast::join_group(multicast_address.to_v4(), local_address.to_v4()), ec);
+			}
+			else
+			{
+				socket_->set_option(boost::asio::ip::multicast::join_group(multicast_address), ec);
+			}
 
 			if (ec.value() != 0)
 			{
@@ -231,157 +349,94 @@ artdaq::MulticastTransfer::MulticastTransfer(fhicl::ParameterSet const& pset, Ro
 		ExceptionHandler(ExceptionHandlerRethrow::yes, "Problem setting up the socket in MulticastTransfer");
 	}
 
-	auto max_subfragments =
-	    static_cast<size_t>(std::ceil(max_fragment_size_words_ / static_cast<float>(subfragment_size_)));
-
-	staging_memory_.resize(max_subfragments * (sizeof(subfragment_identifier) + subfragment_size_));
-
-	if (TransferInterface::role() == Role::kReceive)
+	if (TransferInterface::role() == Role::kSend)
 	{
-		book_container_of_buffers(receive_buffers_, max_fragment_size_words_, max_subfragments, 0, max_subfragments - 1);
+		// NAKs from the receivers arrive on the sending socket, at the address the datagrams were sent from
+		try
+		{
+			service_thread_ = std::make_unique<boost::thread>(&MulticastTransfer::service_sender_, this);
+			char tname[16];                                              // Size 16 - see man page pthread_setname_np(3) and/or prctl(2)
+			snprintf(tname, sizeof(tname) - 1, "%d-MCastNAK", my_rank);  // NOLINT
+			tname[sizeof(tname) - 1] = '\0';                             // assure term. snprintf is not too evil :)
+			auto handle = service_thread_->native_handle();
+			pthread_setname_np(handle, tname);
+		}
+		catch (const boost::exception& e)
+		{
+			TLOG(TLVL_ERROR) << "Caught boost::exception starting Multicast NAK thread: " << boost::diagnostic_information(e) << ", errno=" << errno;
+			std::cerr << "Caught boost::exception starting Multicast NAK thread: " << boost::diagnostic_information(e) << ", errno=" << errno << std::endl;
+			exit(5);
+		}
 	}
 
-	TLOG(TLVL_DEBUG + 32) << GetTraceName() << "max_subfragments is " << max_subfragments;
-	TLOG(TLVL_DEBUG + 32) << GetTraceName() << "Staging buffer size is " << staging_memory_.size();
+	TLOG(TLVL_DEBUG + 32) << GetTraceName() << "subfragment_size is " << subfragment_size_ << ", retransmit window is " << retransmit_window_fragments_ << " Fragments";
 }
 
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wunused-variable"
-
-int artdaq::MulticastTransfer::receiveFragment(artdaq::Fragment& fragment,
-                                               size_t receiveTimeout)
+artdaq::MulticastTransfer::~MulticastTransfer()
 {
-	assert(TransferInterface::role() == Role::kReceive);
-
-	if (fragment.dataSizeBytes() > 0)
+	stop_service_thread_ = true;
+	if (service_thread_ && service_thread_->joinable())
 	{
-		throw cet::exception("MulticastTransfer") << "Error in MulticastTransfer::receiveFragmentFrom: "  // NOLINT(cert-err60-cpp)
-		                                          << "nonzero payload found in fragment passed as argument";
+		service_thread_->join();
 	}
-
-	static bool print_warning = true;
-
-	if (print_warning)
+	if (TransferInterface::role() == Role::kReceive && dropped_fragments_ > 0)
 	{
-		TLOG(TLVL_WARNING) << "Please note that MulticastTransfer::receiveFragmentFrom does not use its receiveTimeout argument";
-		print_warning = false;
+		TLOG(TLVL_WARNING) << GetTraceName() << dropped_fragments_ << " Fragments were dropped because they could not be completed";
 	}
+}
 
-	fragment.resizeBytes(max_fragment_size_words_ - sizeof(artdaq::detail::RawFragmentHeader));
-
-	static auto current_sequenceID = std::numeric_limits<Fragment::sequence_id_t>::max();
-	static auto current_fragmentID = std::numeric_limits<Fragment::fragment_id_t>::max();
+int artdaq::MulticastTransfer::receiveFragment(artdaq::Fragment& fragment,
+                                               size_t receiveTimeout)
+{
+	assert(TransferInterface::role() == Role::kReceive);
 
-	size_t fragment_size = 0;
-	size_t expected_subfragments = 0;
-	size_t current_subfragments = 0;
-	bool fragment_complete = false;
-	bool last_fragment_truncated = false;
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(receiveTimeout);
 
 	while (true)
 	{
-		auto bytes_received = socket_->receive_from(receive_buffers_, *opposite_endpoint_);
-
-		size_t bytes_processed = 0;
-
-		for (auto& buf : receive_buffers_)
+		if (pop_fragment_(fragment))
 		{
-			auto buf_size = boost::asio::buffer_size(buf);
-			auto size_t_ptr = boost::asio::buffer_cast<const size_t*>(buf);
-			auto seqID = *size_t_ptr;
-			auto fragID = *(size_t_ptr + 1);     // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-			auto subfragID = *(size_t_ptr + 2);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-
-			if (seqID != current_sequenceID || fragID != current_fragmentID)
-			{
-				// JCF, Jun-22-2016
-				// Code currently operates under the assumption that all subfragments from the call are from the same fragment
-
-				assert(bytes_processed == 0);
-
-				if (current_subfragments < expected_subfragments)
-				{
-					last_fragment_truncated = true;
-
-					if (expected_subfragments != std::numeric_limits<size_t>::max())
-					{
-						TLOG(TLVL_WARNING) << "Warning: only received " << current_subfragments << " subfragments for fragment with seqID = " << current_sequenceID << ", fragID = " << current_fragmentID << " (expected " << expected_subfragments << ")";
-					}
-					else
-					{
-						TLOG(TLVL_WARNING) << "Warning: only received " << current_subfragments << " subfragments for fragment with seqID = " << current_sequenceID << ", fragID = " << current_fragmentID << ", # of expected subfragments is unknown as fragment header was not received)";
-					}
-				}
-
-				current_subfragments = 0;
-				fragment_size = std::numeric_limits<size_t>::max();
-				expected_subfragments = std::numeric_limits<size_t>::max();
-				current_sequenceID = seqID;
-				current_fragmentID = fragID;
-			}
-
-			auto ptr_into_fragment = fragment.headerBeginBytes() + subfragID * subfragment_size_;  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-
-			auto ptr_into_buffer = boost::asio::buffer_cast<const byte_t*>(buf) + sizeof(subfragment_identifier);
-
-			std::copy(ptr_into_buffer, ptr_into_buffer + buf_size - sizeof(subfragment_identifier), ptr_into_fragment);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-
-			if (subfragID == 0)
-			{
-				if (buf_size >= sizeof(subfragment_identifier) + sizeof(artdaq::detail::RawFragmentHeader))
-				{
-					auto payload_size = std::numeric_limits<size_t>::max();
-					get_fragment_quantities(buf, payload_size, fragment_size, expected_subfragments);
-
-					fragment.resizeBytes(payload_size);
-				}
-				else
-				{
-					throw cet::exception("MulticastTransfer") << "Buffer size is too small to completely contain an artdaq::Fragment header; "  // NOLINT(cert-err60-cpp)
-					                                          << "please increase the default size";
-				}
-			}
-
-			current_subfragments++;
-
-			if (current_subfragments == expected_subfragments)
-			{
-				fragment_complete = true;
-			}
-
-			bytes_processed += buf_size;
-
-			if (bytes_processed >= bytes_received)
-			{
-				break;
-			}
+			return source_rank();
 		}
 
-		if (last_fragment_truncated)
+		service_receiver_();
+		if (pop_fragment_(fragment))
 		{
-			// JCF, 7-7-2017
-
-			// Don't yet have code to handle the scenario where the set of
-			// subfragments received in the last iteration of the loop was
-			// its own complete fragment, but we know the previous fragment
-			// to be incomplete
+			return source_rank();
+		}
 
-			assert(!fragment_complete);
-			TLOG(TLVL_WARNING) << GetTraceName() << "Got an incomplete fragment";
-			return artdaq::TransferInterface::RECV_TIMEOUT;
+		auto now = std::chrono::steady_clock::now();
+		if (now >= deadline)
+		{
+			return TransferInterface::RECV_TIMEOUT;
 		}
 
-		if (fragment_complete)
+		// Wake up in time to send the next round of NAKs even if nothing arrives
+		auto wait = std::min(std::chrono::duration_cast<std::chrono::microseconds>(deadline - now), nak_interval_);
+		pollfd pfd{socket_->native_handle(), POLLIN, 0};
+		auto ret = poll(&pfd, 1, static_cast<int>(std::max(static_cast<int64_t>(1), static_cast<int64_t>((wait.count() + 999) / 1000))));
+		if (ret <= 0 || (pfd.revents & POLLIN) == 0)
 		{
-			return source_rank();
+			continue;
 		}
+
+		// Drain everything which has arrived, so that a burst of datagrams is handled in one pass
+		boost::system::error_code ec;
+		do
+		{
+			auto bytes = socket_->receive_from(boost::asio::buffer(datagram_buffer_), *opposite_endpoint_, 0, ec);
+			if (ec.value() != 0)
+			{
+				TLOG(TLVL_WARNING) << GetTraceName() << "Error receiving datagram: " << ec.message();
+				break;
+			}
+			process_datagram_(bytes, *opposite_endpoint_);
+		} while (socket_->available(ec) > 0 && ec.value() == 0);
 	}
 
 	return TransferInterface::RECV_TIMEOUT;
 }
 
-#pragma GCC diagnostic pop
-
 int artdaq::MulticastTransfer::receiveFragmentHeader(detail::RawFragmentHeader& header, size_t receiveTimeout)
 {
 	auto ret = receiveFragment(fragment_buffer_, receiveTimeout);
@@ -397,14 +452,13 @@ int artdaq::MulticastTransfer::receiveFragmentData(RawDataType* destination, siz
 {
 	if (fragment_buffer_.size() > detail::RawFragmentHeader::num_words())
 	{
-		auto dataSize = (fragment_buffer_.size() - detail::RawFragmentHeader::num_words()) * sizeof(RawDataType);
-		memcpy(destination, fragment_buffer_.headerAddress() + detail::RawFragmentHeader::num_words(), dataSize);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		auto dataWords = std::min(wordCount, fragment_buffer_.size() - detail::RawFragmentHeader::num_words());
+		memcpy(destination, fragment_buffer_.headerAddress() + detail::RawFragmentHeader::num_words(), dataWords * sizeof(RawDataType));  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
 		return source_rank();
 	}
 	return RECV_TIMEOUT;
 }
 
-// Reliable transport is undefined for multicast; just use copy
 artdaq::TransferInterface::CopyStatus
 artdaq::MulticastTransfer::transfer_fragment_reliable_mode(artdaq::Fragment&& f)
 {
@@ -417,120 +471,389 @@ artdaq::MulticastTransfer::transfer_fragment_min_blocking_mode(artdaq::Fragment
 {
 	assert(TransferInterface::role() == Role::kSend);
 
-	if (fragment.sizeBytes() > max_fragment_size_words_)
+	if (fragment.size() > max_fragment_size_words_)
 	{
-		throw cet::exception("MulticastTransfer") << "Error in MulticastTransfer::copyFragmentTo: " << fragment.sizeBytes() << " byte fragment exceeds max_fragment_size of " << max_fragment_size_words_;  // NOLINT(cert-err60-cpp)
+		throw cet::exception("MulticastTransfer") << "Error in MulticastTransfer::copyFragmentTo: " << fragment.size() << " word fragment exceeds max_fragment_size of " << max_fragment_size_words_;  // NOLINT(cert-err60-cpp)
 	}
 
-	auto num_subfragments = static_cast<size_t>(std::ceil(fragment.sizeBytes() / static_cast<float>(subfragment_size_)));
+	auto fragment_bytes = fragment.sizeBytes();
+	auto num_subfragments = (fragment_bytes + subfragment_size_ - 1) / subfragment_size_;
+	auto slot_size = sizeof(datagram_header) + subfragment_size_;
 
-	fill_staging_memory(fragment);
+	std::unique_lock<std::mutex> lk(socket_mutex_);
 
-	for (size_t batch_index = 0;; batch_index++)
+	// Make room in the window, reusing the storage of the oldest entry
+	sent_fragment entry;
+	while (!window_.empty() && (window_.size() >= retransmit_window_fragments_ || window_bytes_ + fragment_bytes > retransmit_window_bytes_))
 	{
-		auto first_subfragment = batch_index * subfragments_per_send_;
-		auto last_subfragment = (batch_index + 1) * subfragments_per_send_ >= num_subfragments ? num_subfragments - 1 : (batch_index + 1) * subfragments_per_send_ - 1;
+		window_bytes_ -= window_.front().datagrams.size();
+		entry = std::move(window_.front());
+		window_.pop_front();
+	}
+
+	entry.transfer_sequence = ++last_transfer_sequence_;
+	entry.subfragment_count = num_subfragments;
+	entry.datagrams.resize(num_subfragments * slot_size);
+	entry.datagram_sizes.resize(num_subfragments);
+	entry.sent_at.assign(num_subfragments, std::chrono::steady_clock::time_point());
 
-		std::vector<boost::asio::const_buffer> buffers;
+	TLOG(TLVL_DEBUG + 33) << GetTraceName() << "Sending Fragment with sequence ID " << fragment.sequenceID() << " as transfer " << entry.transfer_sequence << " in " << num_subfragments << " datagrams";
 
-		book_container_of_buffers(buffers, fragment.sizeBytes(), num_subfragments, first_subfragment, last_subfragment);
+	for (size_t ii = 0; ii < num_subfragments; ++ii)
+	{
+		auto slot = &entry.datagrams[ii * slot_size];
+		auto payload_bytes = std::min(subfragment_size_, fragment_bytes - ii * subfragment_size_);
+
+		datagram_header hdr;
+		hdr.type = datagram_type::kData;
+		hdr.subfragment_number = ii;
+		hdr.subfragment_count = num_subfragments;
+		hdr.subfragment_size = subfragment_size_;
+		hdr.transfer_sequence = entry.transfer_sequence;
+		hdr.fragment_bytes = fragment_bytes;
+		memcpy(slot, &hdr, sizeof(hdr));
+		memcpy(slot + sizeof(hdr), fragment.headerBeginBytes() + ii * subfragment_size_, payload_bytes);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		entry.datagram_sizes[ii] = sizeof(hdr) + payload_bytes;
+	}
 
-		socket_->send_to(buffers, *multicast_endpoint_);
+	window_bytes_ += entry.datagrams.size();
+	window_.push_back(std::move(entry));
+	auto& sent = window_.back();
 
-		usleep(pause_on_copy_usecs_);
+	for (size_t ii = 0; ii < num_subfragments; ++ii)
+	{
+		send_datagram_(sent, ii, false);
 
-		if (last_subfragment == num_subfragments - 1)
+		if (++datagram_count_ % subfragments_per_send_ == 0 && pause_on_copy_usecs_ > 0)
 		{
-			break;
+			// Let the NAK thread in while pausing
+			lk.unlock();
+			usleep(pause_on_copy_usecs_);
+			lk.lock();
 		}
 	}
+	last_send_time_ = std::chrono::steady_clock::now();
+
 	return CopyStatus::kSuccess;
 }
 
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wsign-compare"
-
-void artdaq::MulticastTransfer::fill_staging_memory(const artdaq::Fragment& fragment)
+void artdaq::MulticastTransfer::send_datagram_(sent_fragment& frag, size_t subfragment, bool retransmit)
 {
-	auto num_subfragments = static_cast<size_t>(std::ceil(fragment.sizeBytes() / static_cast<float>(subfragment_size_)));
-	TLOG(TLVL_DEBUG + 32) << GetTraceName() << "# of subfragments to use is " << num_subfragments;
+	auto now = std::chrono::steady_clock::now();
+	if (retransmit && now - frag.sent_at[subfragment] < retransmit_holdoff_)
+	{
+		return;
+	}
+	frag.sent_at[subfragment] = now;
 
-	for (auto i_s = 0; i_s < num_subfragments; ++i_s)
+	// Only first transmissions are dropped, so that a retransmission requested by a NAK always goes out
+	if (!retransmit && debug_drop_fraction_ > 0.0 && drop_distribution_(drop_engine_) < debug_drop_fraction_)
+	{
+		TLOG(TLVL_DEBUG + 35) << GetTraceName() << "Dropping datagram " << subfragment << " of transfer " << frag.transfer_sequence << " for testing";
+		return;
+	}
+
+	auto slot_size = sizeof(datagram_header) + subfragment_size_;
+	boost::system::error_code ec;
+	socket_->send_to(boost::asio::buffer(&frag.datagrams[subfragment * slot_size], frag.datagram_sizes[subfragment]), *multicast_endpoint_, 0, ec);
+	if (ec.value() != 0)
+	{
+		TLOG(TLVL_WARNING) << GetTraceName() << "Error sending datagram " << subfragment << " of transfer " << frag.transfer_sequence << ": " << ec.message();
+	}
+}
+
+void artdaq::MulticastTransfer::send_control_(datagram_type type, uint64_t transfer_sequence, boost::asio::ip::udp::endpoint const& destination)
+{
+	datagram_header hdr;
+	hdr.type = type;
+	hdr.transfer_sequence = transfer_sequence;
+	boost::system::error_code ec;
+	socket_->send_to(boost::asio::buffer(&hdr, sizeof(hdr)), destination, 0, ec);
+	if (ec.value() != 0)
 	{
-		auto staging_memory_copyto = &staging_memory_.at(i_s * (sizeof(subfragment_identifier) + subfragment_size_));
+		TLOG(TLVL_WARNING) << GetTraceName() << "Error sending control datagram: " << ec.message();
+	}
+}
 
-		subfragment_identifier sfi(fragment.sequenceID(), fragment.fragmentID(), i_s);
+void artdaq::MulticastTransfer::service_sender_()
+{
+	boost::asio::ip::udp::endpoint from;
+	while (!stop_service_thread_)
+	{
+		pollfd pfd{socket_->native_handle(), POLLIN, 0};
+		auto ret = poll(&pfd, 1, 10);
 
-		std::copy(reinterpret_cast<byte_t*>(&sfi),                                   // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
-		          reinterpret_cast<byte_t*>(&sfi) + sizeof(subfragment_identifier),  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic,cppcoreguidelines-pro-type-reinterpret-cast)
-		          staging_memory_copyto);
+		std::unique_lock<std::mutex> lk(socket_mutex_);
+		if (ret > 0 && (pfd.revents & POLLIN) != 0)
+		{
+			boost::system::error_code ec;
+			while (socket_->available(ec) > 0 && ec.value() == 0)
+			{
+				auto bytes = socket_->receive_from(boost::asio::buffer(datagram_buffer_), from, 0, ec);
+				if (ec.value() != 0)
+				{
+					break;
+				}
+				datagram_header nak;
+				if (bytes < sizeof(nak))
+				{
+					continue;
+				}
+				memcpy(&nak, datagram_buffer_.data(), sizeof(nak));
+				if (nak.magic != datagram_header::magic_value || nak.type != datagram_type::kNak || bytes < sizeof(nak) + nak.subfragment_count * sizeof(uint32_t))
+				{
+					continue;
+				}
+				TLOG(TLVL_DEBUG + 34) << GetTraceName() << "Received NAK for " << nak.subfragment_count << " datagrams of transfer " << nak.transfer_sequence << " from " << from;
+				std::vector<uint32_t> subfragments(nak.subfragment_count);
+				memcpy(subfragments.data(), datagram_buffer_.data() + sizeof(nak), subfragments.size() * sizeof(uint32_t));
+				handle_nak_(nak, subfragments.data());
+			}
+		}
 
-		auto low_ptr_into_fragment = fragment.headerBeginBytes() + subfragment_size_ * i_s;  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		if (last_transfer_sequence_ > 0 && std::chrono::steady_clock::now() - last_send_time_ >= heartbeat_interval_)
+		{
+			send_control_(datagram_type::kHeartbeat, last_transfer_sequence_, *multicast_endpoint_);
+			last_send_time_ = std::chrono::steady_clock::now();
+		}
+	}
+}
 
-		auto high_ptr_into_fragment = (i_s == num_subfragments - 1) ? fragment.dataEndBytes() : fragment.headerBeginBytes() + subfragment_size_ * (i_s + 1);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+void artdaq::MulticastTransfer::handle_nak_(datagram_header const& nak, uint32_t const* subfragments)
+{
+	if (window_.empty() || nak.transfer_sequence < window_.front().transfer_sequence || nak.transfer_sequence > window_.back().transfer_sequence)
+	{
+		TLOG(TLVL_DEBUG + 34) << GetTraceName() << "Transfer " << nak.transfer_sequence << " is no longer in the retransmit window";
+		send_control_(datagram_type::kUnavailable, nak.transfer_sequence, *multicast_endpoint_);
+		return;
+	}
 
-		std::copy(low_ptr_into_fragment,
-		          high_ptr_into_fragment,
-		          staging_memory_copyto + sizeof(subfragment_identifier));  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	auto& frag = window_[nak.transfer_sequence - window_.front().transfer_sequence];
+	if (nak.subfragment_count == 0)
+	{
+		for (size_t ii = 0; ii < frag.subfragment_count; ++ii)
+		{
+			send_datagram_(frag, ii, true);
+		}
+		return;
+	}
+	for (size_t ii = 0; ii < nak.subfragment_count; ++ii)
+	{
+		if (subfragments[ii] < frag.subfragment_count)  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		{
+			send_datagram_(frag, subfragments[ii], true);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		}
 	}
 }
 
-#pragma GCC diagnostic pop
+bool artdaq::MulticastTransfer::pop_fragment_(artdaq::Fragment& fragment)
+{
+	while (next_sequence_ != 0)
+	{
+		auto it = pending_.find(next_sequence_);
+		if (it == pending_.end())
+		{
+			return false;
+		}
+		auto& frag = it->second;
+		if (frag.dropped)
+		{
+			TLOG(TLVL_WARNING) << GetTraceName() << "Dropping transfer " << next_sequence_ << ": received " << frag.received_count << " of " << frag.subfragment_count << " datagrams";
+			++dropped_fragments_;
+			pending_.erase(it);
+			++next_sequence_;
+			continue;
+		}
+		if (frag.subfragment_count == 0 || frag.received_count < frag.subfragment_count)
+		{
+			return false;
+		}
 
-// Note that book_container_of_buffers includes, rather than excludes,
-// "last_subfragment_num"; in this regard it's different than the way
-// STL functions receive iterators. Note also that the lowest possible
-// value for "first_subfragment_num" is 0, not 1.
+		fragment = std::move(frag.fragment);
+		TLOG(TLVL_DEBUG + 33) << GetTraceName() << "Received transfer " << next_sequence_ << ", Fragment with sequence ID " << fragment.sequenceID();
+		pending_.erase(it);
+		++next_sequence_;
+		return true;
+	}
+	return false;
+}
 
-template<typename T>
-void artdaq::MulticastTransfer::book_container_of_buffers(std::vector<T>& buffers,
-                                                          const size_t fragment_size,
-                                                          const size_t total_subfragments,
-                                                          const size_t first_subfragment_num,
-                                                          const size_t last_subfragment_num)
+void artdaq::MulticastTransfer::process_datagram_(size_t bytes, boost::asio::ip::udp::endpoint const& from)
 {
-	assert(staging_memory_.size() >= total_subfragments * (sizeof(subfragment_identifier) + subfragment_size_));
-	assert(buffers.empty());
-	assert(last_subfragment_num < total_subfragments);
+	datagram_header hdr;
+	if (bytes < sizeof(hdr))
+	{
+		return;
+	}
+	memcpy(&hdr, datagram_buffer_.data(), sizeof(hdr));
+	if (hdr.magic != datagram_header::magic_value || hdr.type == datagram_type::kNak || hdr.transfer_sequence == 0)
+	{
+		return;
+	}
 
-	for (auto i_f = first_subfragment_num; i_f <= last_subfragment_num; ++i_f)
+	// A new sender endpoint means the sender was restarted, and its sequence numbers start over
+	if (!have_sender_ || from != sender_endpoint_)
 	{
-		auto bytes_to_store = (i_f == total_subfragments - 1) ? sizeof(subfragment_identifier) + (fragment_size - (total_subfragments - 1) * subfragment_size_) : sizeof(subfragment_identifier) + subfragment_size_;
+		if (have_sender_)
+		{
+			TLOG(TLVL_WARNING) << GetTraceName() << "Sender changed from " << sender_endpoint_ << " to " << from << ", resynchronizing";
+			pending_.clear();
+		}
+		sender_endpoint_ = from;
+		have_sender_ = true;
+		next_sequence_ = 0;
+		highest_sequence_ = 0;
+	}
 
-		buffers.emplace_back(&staging_memory_.at(i_f * (sizeof(subfragment_identifier) + subfragment_size_)),
-		                     bytes_to_store);
+	if (next_sequence_ == 0)
+	{
+		// Start with the first Fragment seen, and ignore what was sent before this receiver joined. Early in the
+		// sender's run, start from its first Fragment instead, in case the first datagrams which reached us were retransmissions.
+		next_sequence_ = hdr.type == datagram_type::kData ? hdr.transfer_sequence : hdr.transfer_sequence + 1;
+		if (hdr.transfer_sequence <= reorder_window_fragments_)
+		{
+			next_sequence_ = 1;
+		}
+	}
+	if (hdr.transfer_sequence < next_sequence_)
+	{
+		return;  // Duplicate of something already delivered or dropped
+	}
+	highest_sequence_ = std::max(highest_sequence_, hdr.transfer_sequence);
+
+	auto now = std::chrono::steady_clock::now();
+	if (hdr.type == datagram_type::kUnavailable)
+	{
+		auto it = pending_.find(hdr.transfer_sequence);
+		if (it != pending_.end() && (it->second.subfragment_count == 0 || it->second.received_count < it->second.subfragment_count))
+		{
+			it->second.dropped = true;
+		}
+		else if (it == pending_.end())
+		{
+			pending_[hdr.transfer_sequence].dropped = true;
+		}
+		return;
+	}
+	if (hdr.type != datagram_type::kData)
+	{
+		return;
 	}
-}
 
-#pragma GCC diagnostic push  // Needed since profile builds will ignore the assert
-#pragma GCC diagnostic ignored "-Wunused-variable"
+	// The header comes straight off the wire; check it before it sizes any allocation
+	auto payload_bytes = bytes - sizeof(hdr);
+	auto offset = static_cast<size_t>(hdr.subfragment_number) * hdr.subfragment_size;
+	if (hdr.fragment_bytes < sizeof(detail::RawFragmentHeader) || hdr.fragment_bytes > max_fragment_size_words_ * sizeof(RawDataType) || hdr.fragment_bytes % sizeof(RawDataType) != 0 ||
+	    hdr.subfragment_size != subfragment_size_ || hdr.subfragment_count != (hdr.fragment_bytes + subfragment_size_ - 1) / subfragment_size_ ||
+	    hdr.subfragment_number >= hdr.subfragment_count || offset + payload_bytes > hdr.fragment_bytes)
+	{
+		TLOG(TLVL_WARNING) << GetTraceName() << "Malformed datagram " << hdr.subfragment_number << " of transfer " << hdr.transfer_sequence << ", ignoring";
+		return;
+	}
 
-void artdaq::MulticastTransfer::get_fragment_quantities(const boost::asio::mutable_buffer& buf, size_t& payload_size,
-                                                        size_t& fragment_size,
-                                                        size_t& expected_subfragments)
+	auto& frag = pending_[hdr.transfer_sequence];
+	if (frag.dropped)
+	{
+		return;
+	}
+	if (frag.subfragment_count == 0)
+	{
+		frag.subfragment_count = hdr.subfragment_count;
+		frag.fragment = Fragment(hdr.fragment_bytes / sizeof(RawDataType) - detail::RawFragmentHeader::num_words());
+		frag.received.assign(hdr.subfragment_count, false);
+		if (frag.first_seen == std::chrono::steady_clock::time_point())
+		{
+			frag.first_seen = now;
+		}
+	}
+	if (frag.fragment.sizeBytes() != hdr.fragment_bytes || frag.subfragment_count != hdr.subfragment_count)
+	{
+		TLOG(TLVL_WARNING) << GetTraceName() << "Datagram " << hdr.subfragment_number << " of transfer " << hdr.transfer_sequence << " does not match the size of the Fragment, ignoring";
+		return;
+	}
+	frag.last_progress = now;
+	if (!frag.received[hdr.subfragment_number])
+	{
+		memcpy(frag.fragment.headerBeginBytes() + offset, datagram_buffer_.data() + sizeof(hdr), payload_bytes);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		frag.received[hdr.subfragment_number] = true;
+		++frag.received_count;
+	}
+}
+
+void artdaq::MulticastTransfer::service_receiver_()
 {
-	auto* buffer_ptr = boost::asio::buffer_cast<byte_t*>(buf);
+	if (next_sequence_ == 0)
+	{
+		return;
+	}
 
-	auto subfragment_num = *(reinterpret_cast<size_t*>(buffer_ptr) + 2);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	auto now = std::chrono::steady_clock::now();
 
-	assert(subfragment_num == 0);
+	// Fragments which fall out of the reorder window are given up on
+	if (highest_sequence_ >= next_sequence_ + reorder_window_fragments_)
+	{
+		auto first_kept = highest_sequence_ - reorder_window_fragments_ + 1;
+		TLOG(TLVL_WARNING) << GetTraceName() << "More than " << reorder_window_fragments_ << " Fragments outstanding, dropping transfers " << next_sequence_ << " through " << first_kept - 1;
+		dropped_fragments_ += first_kept - next_sequence_;
+		pending_.erase(pending_.begin(), pending_.lower_bound(first_kept));
+		next_sequence_ = first_kept;
+	}
 
-	auto* header =
-	    reinterpret_cast<artdaq::detail::RawFragmentHeader*>(buffer_ptr + sizeof(subfragment_identifier));  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	for (auto seq = next_sequence_; seq <= highest_sequence_; ++seq)
+	{
+		auto& frag = pending_[seq];
+		if (frag.dropped || (frag.subfragment_count > 0 && frag.received_count == frag.subfragment_count))
+		{
+			continue;
+		}
+		if (frag.first_seen == std::chrono::steady_clock::time_point())
+		{
+			// Known to exist only because a later Fragment, or a heartbeat, has been seen
+			frag.first_seen = now;
+			frag.last_progress = now;
+		}
+		if (now - frag.first_seen >= gap_timeout_)
+		{
+			frag.dropped = true;
+			continue;
+		}
+		if (now - frag.last_progress >= nak_interval_ && now - frag.last_nak >= nak_interval_)
+		{
+			send_nak_(seq, frag);
+			frag.last_nak = now;
+			++frag.nak_count;
+		}
+	}
+}
 
-	fragment_size = header->word_count * sizeof(artdaq::RawDataType);
+void artdaq::MulticastTransfer::send_nak_(uint64_t transfer_sequence, pending_fragment const& frag)
+{
+	// Missing subfragment numbers follow the header; an empty list asks for the whole Fragment
+	constexpr size_t max_entries = 1024;
+	std::vector<uint32_t> missing;
+	for (size_t ii = 0; ii < frag.subfragment_count && missing.size() < max_entries; ++ii)
+	{
+		if (!frag.received[ii])
+		{
+			missing.push_back(ii);
+		}
+	}
 
-	auto metadata_size = header->metadata_word_count * sizeof(artdaq::RawDataType);
-	payload_size = fragment_size - metadata_size - artdaq::detail::RawFragmentHeader::num_words() * sizeof(artdaq::RawDataType);
+	datagram_header hdr;
+	hdr.type = datagram_type::kNak;
+	hdr.subfragment_count = missing.size();
+	hdr.transfer_sequence = transfer_sequence;
 
-	assert(fragment_size ==
-	       artdaq::detail::RawFragmentHeader::num_words() * sizeof(artdaq::RawDataType) +
-	           metadata_size +
-	           payload_size);
+	TLOG(TLVL_DEBUG + 34) << GetTraceName() << "Sending NAK for " << (missing.empty() ? std::string("all") : std::to_string(missing.size())) << " datagrams of transfer " << transfer_sequence;
 
-	expected_subfragments = static_cast<size_t>(std::ceil(fragment_size / static_cast<float>(subfragment_size_)));
+	std::vector<boost::asio::const_buffer> buffers{boost::asio::buffer(&hdr, sizeof(hdr)), boost::asio::buffer(missing)};
+	boost::system::error_code ec;
+	socket_->send_to(buffers, sender_endpoint_, 0, ec);
+	if (ec.value() != 0)
+	{
+		TLOG(TLVL_WARNING) << GetTraceName() << "Error sending NAK: " << ec.message();
+	}
 }
-#pragma GCC diagnostic pop
 
 void artdaq::MulticastTransfer::set_receive_buffer_size(size_t recv_buff_size)
 {
@@ -558,6 +881,4 @@ void artdaq::MulticastTransfer::set_receive_buffer_size(size_t recv_buff_size)
 	TLOG(TLVL_DEBUG + 32) << GetTraceName() << "After attempted change, receive buffer size is now " << actual_recv_buff_size.value();
 }
 
-#pragma GCC diagnostic pop
-
 DEFINE_ARTDAQ_TRANSFER(artdaq::MulticastTransfer)
@@ -39,10 +39,13 @@ artdaq::ShmemTransfer::ShmemTransfer(fhicl::ParameterSet const& pset, Role role)
 	if (role == Role::kReceive)
 	{
 		shm_manager_ = std::make_unique<SharedMemoryFragmentManager>(shmKey, buffer_count_, max_fragment_size_words_ * sizeof(artdaq::RawDataType), pset.get<size_t>("stale_buffer_timeout_usec", 100 * 1000000));
+		wakeup_ = std::make_unique<detail::ShmemWakeup>(shmKey, true);
 	}
 	else
 	{
 		shm_manager_ = std::make_unique<SharedMemoryFragmentManager>(shmKey);
+		wakeup_ = std::make_unique<detail::ShmemWakeup>(shmKey, false);
+		wakeup_->SetWriterAttached(true);
 	}
 	TLOG(TLVL_DEBUG + 32) << GetTraceName() << "Constructor END";
 }
@@ -51,29 +54,18 @@ artdaq::ShmemTransfer::~ShmemTransfer() noexcept
 {
 	TLOG(TLVL_DEBUG + 34) << GetTraceName() << " ~ShmemTransfer called - " << uniqueLabel();
 	shm_manager_.reset(nullptr);
+	if (role() == Role::kSend)
+	{
+		wakeup_->SetWriterAttached(false);
+	}
+	wakeup_.reset(nullptr);
 	TLOG(TLVL_DEBUG + 34) << GetTraceName() << " ~ShmemTransfer done - " << uniqueLabel();
 }
 
 int artdaq::ShmemTransfer::receiveFragment(artdaq::Fragment& fragment,
                                            size_t receiveTimeout)
 {
-	auto waitStart = std::chrono::steady_clock::now();
-	while (!shm_manager_->ReadyForRead() && TimeUtils::GetElapsedTimeMicroseconds(waitStart) < 1000)
-	{
-		// BURN THAT CPU!
-	}
-	if (!shm_manager_->ReadyForRead())
-	{
-		int64_t loopCount = 0;
-		size_t sleepTime = 1000;  // microseconds
-		int64_t nloops = (receiveTimeout - 1000) / sleepTime;
-
-		while (!shm_manager_->ReadyForRead() && loopCount < nloops)
-		{
-			usleep(sleepTime);
-			++loopCount;
-		}
-	}
+	wakeup_->WaitForData([this] { return shm_manager_->ReadyForRead(); }, receiveTimeout);
 	if (!shm_manager_->ReadyForRead() && shm_manager_->IsEndOfData())
 	{
 		return artdaq::TransferInterface::DATA_END;
@@ -84,6 +76,7 @@ int artdaq::ShmemTransfer::receiveFragment(artdaq::Fragment& fragment,
 	if (shm_manager_->ReadyForRead())
 	{
 		auto sts = shm_manager_->ReadFragment(fragment);
+		wakeup_->NotifySpace();
 
 		if (sts != 0)
 		{
@@ -104,23 +97,7 @@ int artdaq::ShmemTransfer::receiveFragment(artdaq::Fragment& fragment,
 
 int artdaq::ShmemTransfer::receiveFragmentHeader(detail::RawFragmentHeader& header, size_t receiveTimeout)
 {
-	auto waitStart = std::chrono::steady_clock::now();
-	while (!shm_manager_->ReadyForRead() && TimeUtils::GetElapsedTimeMicroseconds(waitStart) < 1000)
-	{
-		// BURN THAT CPU!
-	}
-	if (!shm_manager_->ReadyForRead())
-	{
-		int64_t loopCount = 0;
-		size_t sleepTime = 1000;  // microseconds
-		int64_t nloops = (receiveTimeout - 1000) / sleepTime;
-
-		while (!shm_manager_->ReadyForRead() && loopCount < nloops)
-		{
-			usleep(sleepTime);
-			++loopCount;
-		}
-	}
+	wakeup_->WaitForData([this] { return shm_manager_->ReadyForRead(); }, receiveTimeout);
 
 	if (!shm_manager_->ReadyForRead() && shm_manager_->IsEndOfData())
 	{
@@ -154,6 +131,7 @@ int artdaq::ShmemTransfer::receiveFragmentHeader(detail::RawFragmentHeader& head
 int artdaq::ShmemTransfer::receiveFragmentData(RawDataType* destination, size_t word_count)
 {
 	auto sts = shm_manager_->ReadFragmentData(destination, word_count);
+	wakeup_->NotifySpace();
 
 	TLOG(TLVL_DEBUG + 33) << GetTraceName() << "Return status from ReadFragmentData is " << sts;
 
@@ -194,6 +172,7 @@ artdaq::ShmemTransfer::sendFragment(artdaq::Fragment&& fragment, size_t send_tim
 	}
 	shm_manager_->SetRank(my_rank);
 	// wait for the shm to become free, if requested
+	wakeup_->WaitForSpace([this, reliableMode] { return shm_manager_->ReadyForWrite(!reliableMode); }, send_timeout_usec == 0 ? 1000000 : send_timeout_usec);
 
 	TLOG(TLVL_DEBUG + 34) << GetTraceName() << "Sending fragment with seqID=" << fragment.sequenceID();
 	artdaq::RawDataType* fragAddr = fragment.headerAddress();
@@ -205,7 +184,9 @@ artdaq::ShmemTransfer::sendFragment(artdaq::Fragment&& fragment, size_t send_tim
 	{
 		auto seq = fragment.sequenceID();
 		TLOG(TLVL_DEBUG + 34) << GetTraceName() << "Writing fragment with seqID=" << seq;
+		// WriteFragment copies the Fragment into the shared memory buffer; its own buffer is left with the caller
 		auto sts = shm_manager_->WriteFragment(std::move(fragment), !reliableMode, send_timeout_usec);
+		wakeup_->NotifyData();
 		if (sts == -3)
 		{
 			TLOG(TLVL_WARNING) << GetTraceName() << "Timeout writing fragment with seqID=" << seq;
@@ -3,6 +3,7 @@
 
 #include "artdaq-core/Core/SharedMemoryFragmentManager.hh"
 #include "artdaq/TransferPlugins/TransferInterface.hh"
+#include "artdaq/DAQdata/ShmemWakeup.hh"
 
 #include <memory>
 
@@ -96,6 +97,7 @@ private:
 	                        size_t send_timeout_usec, bool reliable = false);
 
 	std::unique_ptr<SharedMemoryFragmentManager> shm_manager_;
+	std::unique_ptr<detail::ShmemWakeup> wakeup_;  // Futex words used to wake the peer instead of polling
 };
 }  // namespace artdaq
 
@@ -5,14 +5,18 @@
 // rev="$Revision: 1.30 $$Date: 2016/03/01 14:27:27 $";
 
 // C Includes
-#include <arpa/inet.h>   // ntohl, ntohs
-#include <poll.h>        // struct pollfd
-#include <sys/socket.h>  // socket, socklen_t
-#include <sys/types.h>   // size_t
-#include <sys/un.h>      // sockaddr_un
-#include <cstdlib>       // atoi, strtoul
+#include <arpa/inet.h>        // ntohl, ntohs
+#include <linux/errqueue.h>   // sock_extended_err
+#include <netinet/in.h>       // IP_RECVERR
+#include <poll.h>             // struct pollfd
+#include <sys/epoll.h>        // epoll_create1, epoll_ctl, epoll_wait
+#include <sys/socket.h>       // socket, socklen_t
+#include <sys/types.h>        // size_t
+#include <sys/un.h>           // sockaddr_un
+#include <cstdlib>            // atoi, strtoul
 
 // C++ Includes
+#include <array>
 #include <atomic>
 #include <fstream>
 #include <memory>
@@ -34,21 +38,30 @@
 #include "artdaq/TransferPlugins/detail/SRSockets.hh"
 #include "artdaq/TransferPlugins/detail/Timeout.hh"
 
-#define USE_SENDMSG 1
-
 std::atomic<int> artdaq::TCPSocketTransfer::listen_thread_refcount_(0);
 std::unique_ptr<boost::thread> artdaq::TCPSocketTransfer::listen_thread_ = nullptr;
 std::map<int, std::set<int>> artdaq::TCPSocketTransfer::connected_fds_ = std::map<int, std::set<int>>();
 std::mutex artdaq::TCPSocketTransfer::listen_thread_mutex_;
 std::mutex artdaq::TCPSocketTransfer::fd_mutex_;
+std::map<int, artdaq::TCPSocketTransfer*> artdaq::TCPSocketTransfer::receive_transfers_ = std::map<int, artdaq::TCPSocketTransfer*>();
 
 artdaq::TCPSocketTransfer::
     TCPSocketTransfer(fhicl::ParameterSet const& pset, TransferInterface::Role role)
     : TransferInterface(pset, role)
     , send_fd_(-1)
+    , active_receive_fd_(-1)
+    , epoll_fd_(-1)
+    , connected_fd_count_(0)
+    , ready_events_()
+    , ready_index_(0)
+    , ready_count_(0)
     , rcvbuf_(pset.get<size_t>("tcp_receive_buffer_size", 0))
     , sndbuf_(pset.get<size_t>("tcp_send_buffer_size", max_fragment_size_words_ * sizeof(artdaq::RawDataType) * buffer_count_))
     , send_retry_timeout_us_(pset.get<size_t>("send_retry_timeout_us", 1000000))
+    , zero_copy_threshold_bytes_(pset.get<size_t>("zero_copy_threshold_bytes", 0))
+    , zero_copy_enabled_(false)
+    , zero_copy_next_id_(0)
+    , zero_copy_completed_id_(0)
     , timeoutMessageArmed_(true)
     , receive_disconnected_wait_s_(pset.get<double>("receive_socket_disconnected_wait_s", 10.0))
     , receive_err_wait_us_(pset.get<size_t>("receive_socket_disconnected_wait_us", 10000))
@@ -60,6 +73,20 @@ artdaq::TCPSocketTransfer::
 
 	if (role == TransferInterface::Role::kReceive)
 	{
+		epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+		if (epoll_fd_ == -1)
+		{
+			throw cet::exception("TCPSocketTransfer") << "Unable to create epoll instance for receiving from rank " << source_rank() << " (errno=" << errno << ": " << strerror(errno) << ")";  // NOLINT(cert-err60-cpp)
+		}
+		{
+			std::lock_guard<std::mutex> lk(fd_mutex_);
+			receive_transfers_[source_rank()] = this;
+			for (auto fd : connected_fds_[source_rank()])
+			{
+				watch_receive_fd_(fd);
+			}
+		}
+
 		// Wait for sender to connect...
 		TLOG(TLVL_DEBUG + 32) << GetTraceName() << "Listening for connections";
 		start_listen_thread_();
@@ -85,6 +112,7 @@ artdaq::TCPSocketTransfer::~TCPSocketTransfer() noexcept
 		MessHead mh = {0, MessHead::stop_v0, htons(TransferInterface::source_rank()), {0}};
 		if (send_fd_ != -1)
 		{
+			waitForZeroCopyCompletions_(0);
 			// should be blocking with modest timeo
 			timeval tv = {0, 100000};
 			socklen_t len = sizeof(tv);
@@ -97,6 +125,16 @@ artdaq::TCPSocketTransfer::~TCPSocketTransfer() noexcept
 	else
 	{
 		TCPSocketTransfer::flush_buffers();
+		{
+			std::lock_guard<std::mutex> lk(fd_mutex_);
+			auto it = receive_transfers_.find(source_rank());
+			if (it != receive_transfers_.end() && it->second == this)
+			{
+				receive_transfers_.erase(it);
+			}
+		}
+		close(epoll_fd_);
+		epoll_fd_ = -1;
 		try
 		{
 			if (ack_listen_thread_ && ack_listen_thread_->joinable())
@@ -133,7 +171,7 @@ int artdaq::TCPSocketTransfer::receiveFragmentHeader(detail::RawFragmentHeader&
 	int ret_rank = RECV_TIMEOUT;
 
 	// Don't bomb out until received at least one connection...
-	if (getConnectedFDCount_(source_rank()) == 0)
+	if (getConnectedFDCount_() == 0)
 	{  // what if just listen_fd???
 		//	if (receive_socket_has_been_connected_ && TimeUtils::GetElapsedTime(last_recv_time_) > receive_disconnected_wait_s_)
 		//	{
@@ -180,93 +218,62 @@ int artdaq::TCPSocketTransfer::receiveFragmentHeader(detail::RawFragmentHeader&
 	bool noDataWarningSent = false;
 	int loop_guard = 0;
 
-	while (!done && getConnectedFDCount_(source_rank()) > 0)
+	while (!done && getConnectedFDCount_() > 0)
 	{
-		if (getActiveFD_(source_rank()) == -1)
+		if (active_receive_fd_ == -1)
 		{
 			loop_guard = 0;
-			size_t fd_count = 0;
-			std::vector<pollfd> pollfds;
+			if (ready_index_ == ready_count_)
 			{
-				std::lock_guard<std::mutex> lk(fd_mutex_);
-				fd_count = connected_fds_[source_rank()].size();
-				pollfds.resize(fd_count);
-				auto iter = connected_fds_[source_rank()].begin();
-				for (size_t ii = 0; ii < fd_count; ++ii)
+				// TLOG(TLVL_DEBUG + 32) << GetTraceName() << "receiveFragment: Waiting for data on any connection" ;
+				int num_fds_ready = epoll_wait(epoll_fd_, ready_events_.data(), ready_events_.size(), timeout_ms);
+				if (num_fds_ready <= 0)
 				{
-					pollfds[ii].events = POLLIN | POLLPRI | POLLERR;
-					pollfds[ii].fd = *iter;
-					++iter;
+					if (num_fds_ready < 0 && errno != EINTR)
+					{
+						TLOG(TLVL_WARNING) << GetTraceName() << "receiveFragmentHeader: Error in epoll_wait: errno=" << errno << " (" << strerror(errno) << ")";
+					}
+					TLOG(TLVL_DEBUG + 34) << GetTraceName() << "receiveFragmentHeader: No data on receive socket, returning RECV_TIMEOUT";
+					return RECV_TIMEOUT;
 				}
-			}
-			// TLOG(TLVL_DEBUG + 32) << GetTraceName() << "receiveFragment: Polling fd to see if there's data" ;
-			int num_fds_ready = poll(&pollfds[0], fd_count, timeout_ms);
-			if (num_fds_ready <= 0)
-			{
-				TLOG(TLVL_DEBUG + 34) << GetTraceName() << "receiveFragmentHeader: No data on receive socket, returning RECV_TIMEOUT";
-				return RECV_TIMEOUT;
-			}
+				ready_index_ = 0;
+				ready_count_ = num_fds_ready;
 
-			size_t index = 0;
-			if (getLastActiveFD_(source_rank()) != -1)
-			{
-				for (auto& pollfd : pollfds)
+				if (timeout_usec > 0)
 				{
-					index++;
-					if (pollfd.fd == getLastActiveFD_(source_rank()))
+					// calc next timeout_ms (unless timed out)
+					size_t delta_us = TimeUtils::gettimeofday_us() - start_time_us;
+					if (delta_us > timeout_usec)
+					{
+						timeout_ms = 0;
+					}
+					else
 					{
-						break;
+						timeout_ms = ((timeout_usec - delta_us) + 999) / 1000;  // want at least 1 ms
 					}
 				}
 			}
 
-			int active_index = -1;
-			int16_t anomolous_events = 0;
-			for (size_t ii = index; ii < index + pollfds.size(); ++ii)
+			// Every connection in a batch gets one Fragment before epoll_wait is called again, so that a busy sender cannot starve the others.
+			// Level-triggered epoll reports connections which still have data behind the newly-ready ones in the next batch.
+			auto& event = ready_events_[ready_index_++];  // NOLINT(cppcoreguidelines-pro-bounds-constant-array-index)
+			if (event.data.fd == -1)
 			{
-				auto pollfd_index = (ii + index) % pollfds.size();
-				setActiveFD_(source_rank(), pollfds[pollfd_index].fd);
-				if ((pollfds[pollfd_index].revents & (POLLIN | POLLPRI)) != 0)
-				{
-					active_index = pollfd_index;
-					break;
-				}
-				if ((pollfds[pollfd_index].revents & (POLLHUP | POLLERR)) != 0)
-				{
-					disconnect_receive_socket_("Poll returned POLLHUP or POLLERR, indicating problems with the sender.");
-					continue;
-				}
-				else if ((pollfds[pollfd_index].revents & (POLLNVAL)) != 0)
-				{
-					TLOG(TLVL_DEBUG + 32) << GetTraceName() << "receiveFragmentHeader: FD is closed, most likely because the peer went away. Removing from fd list.";
-					disconnect_receive_socket_("FD is closed, most likely because the peer went away.");
-					continue;
-				}
-				else if (pollfds[pollfd_index].revents != 0)
-				{
-					anomolous_events |= pollfds[pollfd_index].revents;
-				}
+				continue;  // Disconnected since the batch was collected
 			}
-
-			if (active_index == -1)
+			active_receive_fd_ = event.data.fd;
+			if ((event.events & (EPOLLIN | EPOLLPRI)) == 0)
 			{
-				if (anomolous_events != 0)
+				if ((event.events & (EPOLLHUP | EPOLLERR)) != 0)
 				{
-					TLOG(TLVL_DEBUG + 32) << GetTraceName() << "receiveFragmentHeader: Wrong event received from a pollfd. Mask: " << static_cast<int>(anomolous_events);
+					disconnect_receive_socket_("epoll_wait returned EPOLLHUP or EPOLLERR, indicating problems with the sender.");
 				}
-				setActiveFD_(source_rank(), -1);
-				continue;
-			}
-
-			if (!done && timeout_usec > 0)
-			{
-				// calc next timeout_ms (unless timed out)
-				size_t delta_us = TimeUtils::gettimeofday_us() - start_time_us;
-				if (delta_us > timeout_usec)
+				else
 				{
-					return RECV_TIMEOUT;
+					TLOG(TLVL_DEBUG + 32) << GetTraceName() << "receiveFragmentHeader: Wrong event received from epoll_wait. Mask: " << event.events;
+					active_receive_fd_ = -1;
 				}
-				timeout_ms = ((timeout_usec - delta_us) + 999) / 1000;  // want at least 1 ms
+				continue;
 			}
 		}
 		if (loop_guard > 10) { usleep(1000); }
@@ -274,7 +281,7 @@ int artdaq::TCPSocketTransfer::receiveFragmentHeader(detail::RawFragmentHeader&
 		{
 			TLOG(TLVL_WARNING) << GetTraceName() << "receiveFragmentHeader: loop guard triggered, returning RECV_TIMEOUT";
 			usleep(receive_err_wait_us_);
-			setActiveFD_(source_rank(), -1);
+			active_receive_fd_ = -1;
 			return RECV_TIMEOUT;
 		}
 
@@ -298,7 +305,7 @@ int artdaq::TCPSocketTransfer::receiveFragmentHeader(detail::RawFragmentHeader&
 		//	return RECV_TIMEOUT;
 		// }
 
-		auto fd = getActiveFD_(source_rank());
+		auto fd = active_receive_fd_;
 		if (byte_cnt > 0)
 		{
 			TLOG(TLVL_DEBUG + 35) << GetTraceName() << "receiveFragmentHeader: Reading " << byte_cnt << " bytes from socket " << fd;
@@ -385,22 +392,19 @@ int artdaq::TCPSocketTransfer::receiveFragmentHeader(detail::RawFragmentHeader&
 void artdaq::TCPSocketTransfer::disconnect_receive_socket_(const std::string& msg)
 {
 	std::lock_guard<std::mutex> lk(fd_mutex_);
-	auto fd = active_receive_fds_[source_rank()];
+	auto fd = active_receive_fd_;
 	TLOG(TLVL_WARNING) << GetTraceName() << "disconnect_receive_socket_: " << msg << " Closing socket " << fd << " for rank " << source_rank();
+	unwatch_receive_fd_(fd);
 	close(fd);
-	if (connected_fds_.count(source_rank()) != 0u)
-	{
-		connected_fds_[source_rank()].erase(fd);
-	}
-	active_receive_fds_[source_rank()] = -1;
-	TLOG(TLVL_DEBUG + 32) << GetTraceName() << "disconnect_receive_socket_: There are now " << connected_fds_[source_rank()].size() << " active senders.";
+	active_receive_fd_ = -1;
+	TLOG(TLVL_DEBUG + 32) << GetTraceName() << "disconnect_receive_socket_: There are now " << getConnectedFDCount_() << " active senders.";
 }
 
 int artdaq::TCPSocketTransfer::receiveFragmentData(RawDataType* destination, size_t /*wordCount*/)
 {
 	TLOG(TLVL_DEBUG + 39) << GetTraceName() << "receiveFragmentData: BEGIN";
 	int ret_rank = RECV_TIMEOUT;
-	if (getActiveFD_(source_rank()) == -1)
+	if (active_receive_fd_ == -1)
 	{  // what if just listen_fd???
 		TLOG(TLVL_ERROR) << GetTraceName() << "receiveFragmentData: Receive socket not connected, returning RECV_TIMEOUT (Will result in \"Unexpected return code error\")";
 		return RECV_TIMEOUT;
@@ -416,7 +420,7 @@ int artdaq::TCPSocketTransfer::receiveFragmentData(RawDataType* destination, siz
 
 	pollfd pollfd_s;
 	pollfd_s.events = POLLIN | POLLPRI | POLLERR;
-	pollfd_s.fd = getActiveFD_(source_rank());
+	pollfd_s.fd = active_receive_fd_;
 
 	int loop_guard = 0;
 	bool done = false;
@@ -485,7 +489,7 @@ int artdaq::TCPSocketTransfer::receiveFragmentData(RawDataType* destination, siz
 		}
 
 		TLOG(TLVL_DEBUG + 38) << GetTraceName() << "receiveFragmentData: Reading " << byte_cnt << " bytes from socket into " << static_cast<void*>(buff);
-		sts = read(getActiveFD_(source_rank()), buff, byte_cnt);
+		sts = read(active_receive_fd_, buff, byte_cnt);
 		// TLOG(TLVL_DEBUG + 32) << GetTraceName() << "receiveFragmentData: Done with read" ;
 
 		TLOG(TLVL_DEBUG + 38) << GetTraceName() << "recvFragment state=" << static_cast<int>(state) << " read=" << sts;
@@ -497,7 +501,7 @@ int artdaq::TCPSocketTransfer::receiveFragmentData(RawDataType* destination, siz
 			if (++loop_guard > 10010)
 			{
 				TLOG(TLVL_WARNING) << GetTraceName() << "receiveFragmentData: loop guard triggered, returning RECV_TIMEOUT";
-				setActiveFD_(source_rank(), -1);
+				active_receive_fd_ = -1;
 				return RECV_TIMEOUT;
 			}
 		}
@@ -579,8 +583,7 @@ int artdaq::TCPSocketTransfer::receiveFragmentData(RawDataType* destination, siz
 
 	}  // while(!done)...poll
 
-	setLastActiveFD_(source_rank(), getActiveFD_(source_rank()));
-	setActiveFD_(source_rank(), -1);
+	active_receive_fd_ = -1;
 
 	TLOG(TLVL_DEBUG + 39) << GetTraceName() << "receiveFragmentData: Returning rank " << ret_rank;
 	return ret_rank;
@@ -593,13 +596,27 @@ bool artdaq::TCPSocketTransfer::isRunning()
 		case TransferInterface::Role::kSend:
 			return send_fd_ != -1;
 		case TransferInterface::Role::kReceive:
-			auto count = getConnectedFDCount_(source_rank());
+			auto count = getConnectedFDCount_();
 			TLOG(TLVL_DEBUG + 32) << GetTraceName() << "isRunning: There are " << count << " fds connected.";
 			return count > 0;
 	}
 	return false;
 }
 
+bool artdaq::TCPSocketTransfer::getReceiveFDs(std::vector<int>& fds)
+{
+	if (role() != TransferInterface::Role::kReceive || epoll_fd_ == -1)
+	{
+		return false;
+	}
+
+	// epoll_fd_ is readable whenever one of the connections it watches is, so callers can wait on it instead of
+	// registering every connection a second time. It lives as long as this instance, and the listen thread keeps its
+	// contents current, so callers need not refresh it when connections come and go.
+	fds.assign(1, epoll_fd_);
+	return true;
+}
+
 void artdaq::TCPSocketTransfer::flush_buffers()
 {
 	std::set<int> fds;
@@ -611,7 +628,10 @@ void artdaq::TCPSocketTransfer::flush_buffers()
 			fds = connected_fds_[rank];
 			connected_fds_.erase(rank);
 		}
+		connected_fd_count_ = 0;
 	}
+	ready_index_ = 0;
+	ready_count_ = 0;
 
 	char discard_buf[0x1000];
 	for (auto& fd : fds)
@@ -627,18 +647,17 @@ void artdaq::TCPSocketTransfer::flush_buffers()
 			TLOG(TLVL_WARNING) << GetTraceName() << "flush_buffers: Flushed " << bytes_read << " bytes from socket " << fd << " for rank " << rank;
 		}
 		TLOG(TLVL_INFO) << GetTraceName() << "flush_buffers: Closing socket " << fd << " for rank " << rank;
-		close(fd);
+		close(fd);  // Also removes it from epoll_fd_
 	}
-	active_receive_fds_[rank] = -1;
-	last_active_receive_fds_[rank] = -1;
+	active_receive_fd_ = -1;
 }
 
 // Send the given Fragment. Return the rank of the destination to which
 // the Fragment was sent OR -1 if to none.
-artdaq::TransferInterface::CopyStatus artdaq::TCPSocketTransfer::sendFragment_(Fragment&& frag, size_t send_timeout_usec)
+artdaq::TransferInterface::CopyStatus artdaq::TCPSocketTransfer::sendFragment_(Fragment const& frag, Fragment* owned, size_t send_timeout_usec)
 {
 	TLOG(TLVL_DEBUG + 42) << GetTraceName() << "sendFragment begin send of fragment with sequenceID=" << frag.sequenceID();
-	artdaq::Fragment grab_ownership_frag = std::move(frag);
+	auto send = std::make_unique<PendingSend>();
 
 	reconnect_();
 	if (send_fd_ == -1 && connection_was_lost_)
@@ -647,41 +666,57 @@ artdaq::TransferInterface::CopyStatus artdaq::TCPSocketTransfer::sendFragment_(F
 		return TransferInterface::CopyStatus::kErrorNotRequiringException;
 	}
 
-	// Send Fragment Header
-
 #if USE_ACKS
 	// Wait for fragments to be received
 	while (static_cast<size_t>(send_ack_diff_) > buffer_count_) usleep(10000);
 #endif
 
-	iovec iov = {static_cast<void*>(grab_ownership_frag.headerAddress()),
-	             detail::RawFragmentHeader::num_words() * sizeof(RawDataType)};
+	// With MSG_ZEROCOPY the kernel reads the Fragment after sendmsg returns, so it has to be kept until the completion
+	// arrives. Otherwise it is sent in place and left with the caller, who may reuse its buffer.
+	bool zero_copy = zero_copy_enabled_ && frag.sizeBytes() >= zero_copy_threshold_bytes_;
+	Fragment const* source = &frag;
+	if (zero_copy)
+	{
+		send->frag = owned != nullptr ? std::move(*owned) : Fragment(frag);
+		source = &send->frag;
+	}
+
+	// The Fragment header and data are sent as two messages (each preceded by a MessHead), as the receiver expects,
+	// but they are handed to the kernel together.
+	auto header_bytes = detail::RawFragmentHeader::num_words() * sizeof(RawDataType);
+	auto data_bytes = source->sizeBytes() - header_bytes;
+	send->header_mh = {0, MessHead::header_v0, htons(source_rank()), {htonl(header_bytes)}};
+	send->data_mh = {0, MessHead::data_v0, htons(source_rank()), {htonl(data_bytes)}};
+
+	// sendmsg does not write through these pointers
+	auto header_address = const_cast<RawDataType*>(source->headerAddress());  // NOLINT(cppcoreguidelines-pro-type-const-cast)
+	std::array<iovec, 4> iov = {{{&send->header_mh, sizeof(MessHead)},
+	                             {header_address, header_bytes},
+	                             {&send->data_mh, sizeof(MessHead)},
+	                             {header_address + detail::RawFragmentHeader::num_words(), data_bytes}}};  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+	bool used_zero_copy = false;
 
-	auto sts = sendData_(&iov, 1, send_retry_timeout_us_, true);
+	auto sts = sendMessage_(&iov[0], iov.size(), zero_copy, used_zero_copy);
 	auto start_time = std::chrono::steady_clock::now();
-	// If it takes more than 10 seconds to write a Fragment header, give up
+	// If it takes more than 10 seconds to start writing a Fragment, give up
 	while (sts == CopyStatus::kTimeout && (send_timeout_usec == 0 || TimeUtils::GetElapsedTimeMicroseconds(start_time) < send_timeout_usec) && TimeUtils::GetElapsedTimeMicroseconds(start_time) < 10000000)
 	{
 		TLOG(TLVL_DEBUG + 43) << GetTraceName() << "sendFragment: Timeout sending fragment";
-		sts = sendData_(&iov, 1, send_retry_timeout_us_, true);
-		usleep(1000);
+		sts = sendMessage_(&iov[0], iov.size(), zero_copy, used_zero_copy);
 	}
-	if (sts != CopyStatus::kSuccess)
+
+	if (used_zero_copy && send_fd_ != -1)
 	{
-		return sts;
+		// The kernel may still be reading from the Fragment; keep it until the completion notification arrives
+		send->last_zero_copy_id = zero_copy_next_id_ - 1;
+		zero_copy_pending_.push_back(std::move(send));
+		reapZeroCopyCompletions_();
+		waitForZeroCopyCompletions_(buffer_count_);
 	}
-
-	// Send Fragment Data
-
-	iov = {static_cast<void*>(grab_ownership_frag.headerAddress() + detail::RawFragmentHeader::num_words()),  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-	       grab_ownership_frag.sizeBytes() - detail::RawFragmentHeader::num_words() * sizeof(RawDataType)};
-	sts = sendData_(&iov, 1, send_retry_timeout_us_);
-	start_time = std::chrono::steady_clock::now();
-	while (sts == CopyStatus::kTimeout && (send_timeout_usec == 0 || TimeUtils::GetElapsedTimeMicroseconds(start_time) < send_timeout_usec) && TimeUtils::GetElapsedTimeMicroseconds(start_time) < 10000000)
+	else if (zero_copy && owned != nullptr)
 	{
-		TLOG(TLVL_DEBUG + 43) << GetTraceName() << "sendFragment: Timeout sending fragment";
-		sts = sendData_(&iov, 1, send_retry_timeout_us_);
-		usleep(1000);
+		*owned = std::move(send->frag);  // The kernel copied it after all, so the caller can have the buffer back
 	}
 
 #if USE_ACKS
@@ -692,198 +727,220 @@ artdaq::TransferInterface::CopyStatus artdaq::TCPSocketTransfer::sendFragment_(F
 	return sts;
 }
 
-artdaq::TransferInterface::CopyStatus artdaq::TCPSocketTransfer::sendData_(const void* buf, size_t bytes, size_t send_timeout_usec, bool isHeader)
-{
-	TLOG(TLVL_DEBUG + 32) << GetTraceName() << "sendData_ Converting buf to iovec";
-	iovec iov = {const_cast<void*>(buf), bytes};  // NOLINT(cppcoreguidelines-pro-type-const-cast)
-	return sendData_(&iov, 1, send_timeout_usec, isHeader);
-}
-
-artdaq::TransferInterface::CopyStatus artdaq::TCPSocketTransfer::sendData_(const struct iovec* iov, int iovcnt, size_t send_timeout_usec, bool isHeader)
+artdaq::TransferInterface::CopyStatus artdaq::TCPSocketTransfer::sendMessage_(iovec* iov, size_t iovcnt, bool zero_copy, bool& used_zero_copy)
 {
 	// check all connected??? -- currently just check fd!=-1
 	if (send_fd_ == -1)
 	{
 		if (timeoutMessageArmed_)
 		{
-			TLOG(TLVL_DEBUG + 32) << GetTraceName() << "sendData_: Send fd is not open. Returning kTimeout";
+			TLOG(TLVL_DEBUG + 32) << GetTraceName() << "sendMessage_: Send fd is not open. Returning kTimeout";
 			timeoutMessageArmed_ = false;
 		}
 		return CopyStatus::kTimeout;
 	}
 	timeoutMessageArmed_ = true;
-	TLOG(TLVL_DEBUG + 44) << GetTraceName() << "send_timeout_usec is " << send_timeout_usec << ", currently unused.";
-
-	// TLOG(TLVL_DEBUG + 32) << GetTraceName() << "sendData_: Determining write size" ;
-	uint32_t total_to_write_bytes = 0;
-	std::vector<iovec> iov_in(iovcnt + 1);  // need contiguous (for the unlike case that only partial MH
-	std::vector<iovec> iovv(iovcnt + 2);    // 1 more for mh and another one for any partial
-	int ii;
-	for (ii = 0; ii < iovcnt; ++ii)
+
+	size_t total_to_write_bytes = 0;
+	for (size_t ii = 0; ii < iovcnt; ++ii)
 	{
-		iov_in[ii + 1] = iov[ii];                 // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
 		total_to_write_bytes += iov[ii].iov_len;  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
 	}
-	// TLOG(TLVL_DEBUG + 32) << GetTraceName() << "sendData_: Constructing Message Header" ;
-	MessHead mh = {0, isHeader ? MessHead::header_v0 : MessHead::data_v0, htons(source_rank()), {htonl(total_to_write_bytes)}};
-	iov_in[0].iov_base = &mh;
-	iov_in[0].iov_len = sizeof(mh);
-	total_to_write_bytes += sizeof(mh);
 
-	ssize_t sts = 0;
-	ssize_t total_written_bytes = 0;
-	ssize_t per_write_max_bytes = (32 * 1024);
-
-	size_t in_iov_idx = 0;  // only increment this when we know the associated data has been xferred
-	size_t out_iov_idx = 0;
-	ssize_t this_write_bytes = 0;
-
-	do
+	int flags = MSG_NOSIGNAL | MSG_DONTWAIT;
+#ifdef MSG_ZEROCOPY
+	if (zero_copy)
 	{
-		// The first out_iov may be set at the end of the previous loop.
-		// iov looping from below (b/c of the latter, we need to check this_write_bytes)
-		for (;
-		     (in_iov_idx + out_iov_idx) < iov_in.size() && this_write_bytes < per_write_max_bytes;
-		     ++out_iov_idx)
-		{
-			this_write_bytes += iov_in[in_iov_idx + out_iov_idx].iov_len;
-			iovv[out_iov_idx] = iov_in[in_iov_idx + out_iov_idx];
-		}
-		if (this_write_bytes > per_write_max_bytes)
-		{
-			iovv[out_iov_idx - 1].iov_len -= this_write_bytes - per_write_max_bytes;
-			this_write_bytes = per_write_max_bytes;
-		}
-
-		// need to do blocking algorithm -- including throttled block notifications
-	do_again:
-#ifndef __OPTIMIZE__  // This can be an expensive TRACE call (even if disabled) due to multiplicity of calls
-		TLOG(TLVL_DEBUG + 44) << GetTraceName() << "sendFragment b4 writev " << std::setw(7) << total_written_bytes << " total_written_bytes send_fd_=" << send_fd_ << " in_idx=" << in_iov_idx
-		                      << " iovcnt=" << out_iov_idx << " 1st.len=" << iovv[0].iov_len;
+		flags |= MSG_ZEROCOPY;
+	}
+#else
+	(void)zero_copy;
 #endif
-// TLOG(TLVL_DEBUG + 32) << GetTraceName() << " calling writev" ;
-#if USE_SENDMSG
+
+	size_t total_written_bytes = 0;
+	size_t iov_idx = 0;
+	while (total_written_bytes < total_to_write_bytes)
+	{
 		msghdr msg;
 		memset(&msg, 0, sizeof(msghdr));
-		msg.msg_iov = &(iovv[0]);
-		msg.msg_iovlen = out_iov_idx;  // at this point out_iov_idx is really the count (not an idx per se)
-		sts = sendmsg(send_fd_, &msg, MSG_NOSIGNAL | (blocking != 0u ? 0 : MSG_DONTWAIT));
-#else
-		sts = writev(send_fd_, &(iovv[0]), out_iov_idx);  // SIGPIPE may occur -- need signal handler or mask/ignore
-#endif
-		// TLOG(TLVL_DEBUG + 32) << GetTraceName() << " done with writev" ;
+		msg.msg_iov = &iov[iov_idx];  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		msg.msg_iovlen = iovcnt - iov_idx;
+		auto sts = sendmsg(send_fd_, &msg, flags);
 
 		if (sts == -1)
 		{
+#ifdef MSG_ZEROCOPY
+			if (errno == ENOBUFS && (flags & MSG_ZEROCOPY) != 0)
+			{
+				// Out of pinned-page budget (optmem); copy the rest of this message instead
+				TLOG(TLVL_DEBUG + 33) << GetTraceName() << "sendMessage_: ENOBUFS with MSG_ZEROCOPY, copying remainder of message";
+				flags &= ~MSG_ZEROCOPY;
+				continue;
+			}
+#endif
 			if (errno == EAGAIN /* same as EWOULDBLOCK */)
 			{
-				TLOG(TLVL_DEBUG + 32) << GetTraceName() << "sendFragment EWOULDBLOCK";
-				blocking = 1u;
+				// Until the first byte is written, the caller may still give up on this message. After that, it
+				// has to be finished, or the stream would be corrupted.
+				auto wait_sts = waitForSendReady_(total_written_bytes == 0 ? send_retry_timeout_us_ : 0);
+				if (wait_sts != CopyStatus::kSuccess)
+				{
+					return wait_sts;
+				}
+				continue;
+			}
+			TLOG(TLVL_WARNING) << GetTraceName() << "sendMessage_: WRITE ERROR " << errno << ": " << strerror(errno);
+			closeSendSocket_();
+			return TransferInterface::CopyStatus::kErrorNotRequiringException;
+		}
 
-				fcntl(send_fd_, F_SETFL, 0);  // clear O_NONBLOCK
+#ifdef MSG_ZEROCOPY
+		if ((flags & MSG_ZEROCOPY) != 0)
+		{
+			++zero_copy_next_id_;
+			used_zero_copy = true;
+		}
+#endif
+		total_written_bytes += sts;
+		// skip the iovs which are done, and adjust the partial one
+		while (iov_idx < iovcnt && static_cast<size_t>(sts) >= iov[iov_idx].iov_len)  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		{
+			sts -= iov[iov_idx].iov_len;  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+			++iov_idx;
+		}
+		if (iov_idx < iovcnt)
+		{
+			iov[iov_idx].iov_base = static_cast<uint8_t*>(iov[iov_idx].iov_base) + sts;  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+			iov[iov_idx].iov_len -= sts;                                                 // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		}
+#ifndef __OPTIMIZE__  // This can be an expensive TRACE call (even if disabled) due to multiplicity of calls
+		TLOG(TLVL_DEBUG + 44) << GetTraceName() << "sendMessage_ wrote " << total_written_bytes << " of " << total_to_write_bytes << " bytes, send_fd_=" << send_fd_ << " iov_idx=" << iov_idx;
+#endif
+	}
 
-				// NOTE: YES -- could drop here
-				goto do_again;
-			}
-			TLOG(TLVL_WARNING) << GetTraceName() << "sendFragment_: WRITE ERROR " << errno << ": " << strerror(errno);
-			connect_state = 0;  // any write error closes
-			close(send_fd_);
-			send_fd_ = -1;
-			connection_was_lost_ = true;
+	TLOG(TLVL_DEBUG + 44) << GetTraceName() << "sendMessage_ sts=" << total_written_bytes;
+	return TransferInterface::CopyStatus::kSuccess;
+}
+
+artdaq::TransferInterface::CopyStatus artdaq::TCPSocketTransfer::waitForSendReady_(size_t timeout_usec)
+{
+	auto start_time = std::chrono::steady_clock::now();
+	while (send_fd_ != -1)
+	{
+		pollfd pfd = {send_fd_, POLLOUT, 0};
+		int timeout_ms = timeout_usec == 0 ? static_cast<int>(send_retry_timeout_us_ / 1000) + 1 : static_cast<int>((timeout_usec + 999) / 1000);
+		auto sts = poll(&pfd, 1, timeout_ms);
+		if (sts == -1 && errno != EINTR)
+		{
+			TLOG(TLVL_WARNING) << GetTraceName() << "waitForSendReady_: poll error " << errno << ": " << strerror(errno);
+			closeSendSocket_();
 			return TransferInterface::CopyStatus::kErrorNotRequiringException;
 		}
-		if (sts != this_write_bytes)
+		if (sts > 0 && (pfd.revents & POLLERR) != 0)
 		{
-			// we'll loop around -- with
-			TLOG(TLVL_DEBUG + 32) << GetTraceName() << "sendFragment writev sts(" << sts << ")!=requested_send_bytes(" << this_write_bytes << ")";
-			total_written_bytes += sts;  // add sts to total_written_bytes now as sts is adjusted next
-			// find which iovs are done
-			for (ii = 0; static_cast<size_t>(sts) >= iovv[ii].iov_len; ++ii)
+			// Zero-copy completions are reported on the error queue, which also raises POLLERR
+			if (reapZeroCopyCompletions_() == 0)
 			{
-				sts -= iovv[ii].iov_len;
+				int err = 0;
+				socklen_t len = sizeof(err);
+				getsockopt(send_fd_, SOL_SOCKET, SO_ERROR, &err, &len);
+				TLOG(TLVL_WARNING) << GetTraceName() << "waitForSendReady_: socket error " << err << ": " << strerror(err);
+				closeSendSocket_();
+				return TransferInterface::CopyStatus::kErrorNotRequiringException;
 			}
-			in_iov_idx += ii;                                                    // done with these in_iovs
-			iovv[ii].iov_len -= sts;                                             // adjust partial iov
-			iovv[ii].iov_base = static_cast<uint8_t*>(iovv[ii].iov_base) + sts;  // adjust partial iov // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		}
+		if (sts > 0 && (pfd.revents & POLLHUP) != 0)
+		{
+			TLOG(TLVL_WARNING) << GetTraceName() << "waitForSendReady_: receiver hung up";
+			closeSendSocket_();
+			return TransferInterface::CopyStatus::kErrorNotRequiringException;
+		}
+		if (sts > 0 && (pfd.revents & POLLOUT) != 0)
+		{
+			return TransferInterface::CopyStatus::kSuccess;
+		}
+		if (timeout_usec != 0 && TimeUtils::GetElapsedTimeMicroseconds(start_time) >= timeout_usec)
+		{
+			TLOG(TLVL_DEBUG + 32) << GetTraceName() << "waitForSendReady_: Socket not writable after " << timeout_usec << " us";
+			return TransferInterface::CopyStatus::kTimeout;
+		}
+	}
+	return TransferInterface::CopyStatus::kErrorNotRequiringException;
+}
+
+size_t artdaq::TCPSocketTransfer::reapZeroCopyCompletions_()
+{
+	size_t notifications = 0;
+#ifdef MSG_ZEROCOPY
+	while (send_fd_ != -1)
+	{
+		std::array<char, 128> control;
+		msghdr msg;
+		memset(&msg, 0, sizeof(msghdr));
+		msg.msg_control = &control[0];
+		msg.msg_controllen = control.size();
+		if (recvmsg(send_fd_, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) == -1)
+		{
+			break;
+		}
 
-			// add more to get up to per_write_max_bytes
-			out_iov_idx = 0;
-			if (ii != 0)
+		for (auto* cm = CMSG_FIRSTHDR(&msg); cm != nullptr; cm = CMSG_NXTHDR(&msg, cm))
+		{
+			if (!((cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) || (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR)))
 			{
-				iovv[out_iov_idx] = iovv[ii];
+				continue;
 			}
-			// starting over
-			this_write_bytes = iovv[out_iov_idx].iov_len;
-			// add any left over from appropriate in_iov_idx --
-			// i.e. match this out_iov with the in_iov that was used to
-			// initialize it; see how close the out base+len is to in base+len
-			// check !>per_write_max_bytes
-			auto additional = (reinterpret_cast<uintptr_t>(iov_in[in_iov_idx].iov_base) + iov_in[in_iov_idx].iov_len) - (reinterpret_cast<uintptr_t>(iovv[out_iov_idx].iov_base) + iovv[out_iov_idx].iov_len);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
-			if (additional != 0u)
+			auto* serr = reinterpret_cast<sock_extended_err*>(CMSG_DATA(cm));  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+			if (serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
 			{
-				iovv[out_iov_idx].iov_len += additional;
-				this_write_bytes += additional;
-				if (this_write_bytes > per_write_max_bytes)
-				{
-					iovv[out_iov_idx].iov_len -= this_write_bytes - per_write_max_bytes;
-					this_write_bytes = per_write_max_bytes;
-				}
+				continue;
 			}
-			++out_iov_idx;  // done with
-			TLOG(TLVL_DEBUG + 33) << GetTraceName() << "sendFragment writev sts!=: this_write_bytes=" << this_write_bytes
-			                      << " out_iov_idx=" << out_iov_idx
-			                      << " additional=" << additional
-			                      << " ii=" << ii;
-		}
-		else
-		{
-#ifndef __OPTIMIZE__  // This can be an expensive TRACE call (even if disabled) due to multiplicity of calls
-			TLOG(TLVL_DEBUG + 33) << GetTraceName() << "sendFragment writev sts(" << sts << ")==requested_send_bytes(" << this_write_bytes << ")";
-#endif
-			total_written_bytes += sts;
-			--out_iov_idx;                                                                                               // make it the index of the last iovv
-			iovv[out_iov_idx].iov_base = static_cast<uint8_t*>(iovv[out_iov_idx].iov_base) + iovv[out_iov_idx].iov_len;  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-			iovv[out_iov_idx].iov_len = 0;
-			in_iov_idx += out_iov_idx;  // at least this many complete (one more if "last iovv" is complete
-			this_write_bytes = 0;
-			// need to check last iovv against appropriate iov_in
-			auto additional = (reinterpret_cast<uintptr_t>(iov_in[in_iov_idx].iov_base) + iov_in[in_iov_idx].iov_len) - (reinterpret_cast<uintptr_t>(iovv[out_iov_idx].iov_base) + iovv[out_iov_idx].iov_len);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
-			if (additional != 0u)
+			++notifications;
+			// Notifications cover the inclusive range [ee_info, ee_data] of zero-copy send calls
+			if (static_cast<int32_t>(serr->ee_data + 1 - zero_copy_completed_id_) > 0)
 			{
-				iovv[out_iov_idx].iov_len += additional;
-				this_write_bytes += additional;
-				if (this_write_bytes > per_write_max_bytes)
-				{
-					iovv[out_iov_idx].iov_len -= this_write_bytes - per_write_max_bytes;
-					this_write_bytes = per_write_max_bytes;
-				}
-				if (out_iov_idx != 0)
-				{
-					iovv[0] = iovv[out_iov_idx];
-				}
-				out_iov_idx = 1;
+				zero_copy_completed_id_ = serr->ee_data + 1;
 			}
-			else
+			if ((serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) != 0 && zero_copy_enabled_)
 			{
-				++in_iov_idx;
-				out_iov_idx = 0;
+				// e.g. loopback, or a device without scatter-gather: pinning pages only adds overhead
+				TLOG(TLVL_INFO) << GetTraceName() << "Kernel copied zero-copy send data; disabling MSG_ZEROCOPY for this connection";
+				zero_copy_enabled_ = false;
 			}
 		}
-	} while (total_written_bytes < total_to_write_bytes);
-	if (total_written_bytes > total_to_write_bytes)
+	}
+
+	while (!zero_copy_pending_.empty() && static_cast<int32_t>(zero_copy_pending_.front()->last_zero_copy_id - zero_copy_completed_id_) < 0)
 	{
-		TLOG(TLVL_ERROR) << GetTraceName() << "sendFragment program error: too many bytes transferred";
+		zero_copy_pending_.pop_front();
 	}
+#endif
+	return notifications;
+}
 
-	if (blocking != 0u)
+void artdaq::TCPSocketTransfer::waitForZeroCopyCompletions_(size_t max_pending)
+{
+	auto start_time = std::chrono::steady_clock::now();
+	while (zero_copy_pending_.size() > max_pending && send_fd_ != -1)
 	{
-		blocking = 0u;
-		fcntl(send_fd_, F_SETFL, O_NONBLOCK);  // set O_NONBLOCK
+		pollfd pfd = {send_fd_, 0, 0};  // POLLERR is always reported
+		poll(&pfd, 1, 10);
+		reapZeroCopyCompletions_();
+		if (TimeUtils::GetElapsedTimeMicroseconds(start_time) > send_retry_timeout_us_ * 10)
+		{
+			TLOG(TLVL_WARNING) << GetTraceName() << "waitForZeroCopyCompletions_: " << zero_copy_pending_.size() << " zero-copy sends still outstanding after " << TimeUtils::GetElapsedTime(start_time) << " s";
+			break;
+		}
 	}
-	sts = total_written_bytes - sizeof(MessHead);
+}
 
-	TLOG(TLVL_DEBUG + 44) << GetTraceName() << "sendFragment sts=" << sts;
-	return TransferInterface::CopyStatus::kSuccess;
+void artdaq::TCPSocketTransfer::closeSendSocket_()
+{
+	connect_state = 0;  // any write error closes
+	close(send_fd_);
+	send_fd_ = -1;
+	connection_was_lost_ = true;
+	zero_copy_pending_.clear();
 }
 
 void artdaq::TCPSocketTransfer::connect_()
@@ -911,7 +968,10 @@ void artdaq::TCPSocketTransfer::connect_()
 		}
 	}
 	connect_state = 0;
-	blocking = 0;
+	zero_copy_pending_.clear();
+	zero_copy_enabled_ = false;
+	zero_copy_next_id_ = 0;
+	zero_copy_completed_id_ = 0;
 	TLOG(TLVL_DEBUG + 32) << GetTraceName() << "connect_ " + hostMap_[destination_rank()] + ":" << portMan->GetTCPSocketTransferPort(destination_rank()) << " send_fd_=" << send_fd_;
 	if (send_fd_ != -1)
 	{
@@ -930,6 +990,17 @@ void artdaq::TCPSocketTransfer::connect_()
 		else
 		{
 			TLOG(TLVL_INFO) << GetTraceName() << "connect_: Successfully connected";
+			if (zero_copy_threshold_bytes_ > 0)
+			{
+#ifdef SO_ZEROCOPY
+				int one = 1;
+				zero_copy_enabled_ = setsockopt(send_fd_, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) == 0;
+#endif
+				if (!zero_copy_enabled_)
+				{
+					TLOG(TLVL_WARNING) << GetTraceName() << "connect_: MSG_ZEROCOPY is not available on this system, zero_copy_threshold_bytes will be ignored";
+				}
+			}
 			// consider it all connected/established
 			connect_state = 1;
 			connection_was_lost_ = false;
@@ -1130,6 +1201,11 @@ void artdaq::TCPSocketTransfer::listen_(int port, size_t rcvbuf)
 			// now add (new) connection
 			std::lock_guard<std::mutex> lk(fd_mutex_);
 			connected_fds_[mh.source_id].insert(fd);
+			auto receiver = receive_transfers_.find(mh.source_id);
+			if (receiver != receive_transfers_.end())
+			{
+				receiver->second->watch_receive_fd_(fd);
+			}
 
 			TLOG(TLVL_INFO) << "listen_: New fd is " << fd << " for source rank " << mh.source_id;
 		}
@@ -1160,44 +1236,33 @@ void artdaq::TCPSocketTransfer::listen_(int port, size_t rcvbuf)
 
 }  // do_connect_
 
-size_t artdaq::TCPSocketTransfer::getConnectedFDCount_(int source_rank)
+void artdaq::TCPSocketTransfer::watch_receive_fd_(int fd)
 {
-	std::lock_guard<std::mutex> lk(fd_mutex_);
-#ifndef __OPTIMIZE__
-	TLOG(TLVL_DEBUG + 45) << GetTraceName() << "getConnectedFDCount_: count is " << (connected_fds_.count(source_rank) != 0u ? connected_fds_[source_rank].size() : 0);
-#endif
-	return connected_fds_.count(source_rank) != 0u ? connected_fds_[source_rank].size() : 0;
+	epoll_event event{};
+	event.events = EPOLLIN | EPOLLPRI;  // EPOLLHUP and EPOLLERR are always reported
+	event.data.fd = fd;
+	if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) == -1 && errno != EEXIST)
+	{
+		TLOG(TLVL_WARNING) << GetTraceName() << "watch_receive_fd_: Unable to add socket " << fd << " to epoll set (errno=" << errno << ": " << strerror(errno) << ")";
+	}
+	connected_fd_count_ = connected_fds_[source_rank()].size();
 }
 
-int artdaq::TCPSocketTransfer::getActiveFD_(int source_rank)
+void artdaq::TCPSocketTransfer::unwatch_receive_fd_(int fd)
 {
-	std::lock_guard<std::mutex> lk(fd_mutex_);
-#ifndef __OPTIMIZE__
-	TLOG(TLVL_DEBUG + 45) << GetTraceName() << "getActiveFD_: fd is " << (active_receive_fds_.count(source_rank) != 0u ? active_receive_fds_[source_rank] : -1);
-#endif
-	return active_receive_fds_.count(source_rank) != 0u ? active_receive_fds_[source_rank] : -1;
-}
-void artdaq::TCPSocketTransfer::setActiveFD_(int source_rank, int fd)
-{
-	std::lock_guard<std::mutex> lk(fd_mutex_);
-#ifndef __OPTIMIZE__
-	TLOG(TLVL_DEBUG + 45) << GetTraceName() << "setActiveFD_: setting active fd for rank " << source_rank << " to " << fd;
-#endif
-	active_receive_fds_[source_rank] = fd;
-}
-int artdaq::TCPSocketTransfer::getLastActiveFD_(int source_rank)
-{
-	std::lock_guard<std::mutex> lk(fd_mutex_);
-#ifndef __OPTIMIZE__
-	TLOG(TLVL_DEBUG + 45) << GetTraceName() << "getLastActiveFD_: fd is " << (last_active_receive_fds_.count(source_rank) != 0u ? last_active_receive_fds_[source_rank] : -1);
-#endif
-	return last_active_receive_fds_.count(source_rank) != 0u ? last_active_receive_fds_[source_rank] : -1;
-}
-void artdaq::TCPSocketTransfer::setLastActiveFD_(int source_rank, int fd)
-{
-	std::lock_guard<std::mutex> lk(fd_mutex_);
-#ifndef __OPTIMIZE__
-	TLOG(TLVL_DEBUG + 45) << GetTraceName() << "setLastActiveFD_: setting last active fd for rank " << source_rank << " to " << fd;
-#endif
-	last_active_receive_fds_[source_rank] = fd;
+	epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+	if (connected_fds_.count(source_rank()) != 0u)
+	{
+		connected_fds_[source_rank()].erase(fd);
+	}
+	connected_fd_count_ = connected_fds_.count(source_rank()) != 0u ? connected_fds_[source_rank()].size() : 0;
+
+	// The fd number may be reused by the next accepted connection, so it must not be served from the current batch
+	for (auto ii = ready_index_; ii < ready_count_; ++ii)
+	{
+		if (ready_events_[ii].data.fd == fd)  // NOLINT(cppcoreguidelines-pro-bounds-constant-array-index)
+		{
+			ready_events_[ii].data.fd = -1;  // NOLINT(cppcoreguidelines-pro-bounds-constant-array-index)
+		}
+	}
 }
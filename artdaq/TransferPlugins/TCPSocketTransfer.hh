@@ -13,15 +13,18 @@
 #include "artdaq/TransferPlugins/detail/SRSockets.hh"
 
 // C Includes
-#include <sys/uio.h>  // iovec
-#include <cstdint>    // uint64_t
+#include <sys/epoll.h>  // epoll_event
+#include <sys/uio.h>    // iovec
+#include <cstdint>      // uint64_t
 
 // C++ Includes
 #include <boost/thread.hpp>
 
+#include <array>
 #include <atomic>
 #include <chrono>
 #include <condition_variable>
+#include <deque>
 #include <map>
 #include <memory>
 #include <mutex>
@@ -51,6 +54,8 @@ public:
 	 * TCPSocketTransfer accepts the following Parameters:
 	 * "tcp_receive_buffer_size" (Default: 0): The TCP buffer size on the receive socket
 	 * "send_retry_timeout_us" (Default: 1000000): Microseconds between send retries (infinite retries for moveFragment, up to send_timeout_us for copyFragment)
+	 * "zero_copy_threshold_bytes" (Default: 0): Fragments at least this large are sent with MSG_ZEROCOPY, if the kernel supports it.
+	 *   The Fragment is held until the kernel reports the send complete. 0 disables zero-copy sends.
 	 * "host_map" (REQUIRED): List of FHiCL tables containing information about other hosts in the system.
 	 *   Each table should contain:
 	 *   "rank" (Default: RECV_TIMEOUT): Rank of this host
@@ -86,14 +91,14 @@ public:
 	 * \param timeout_usec Timeout for send, in microseconds
 	 * \return CopyStatus detailing result of transfer
 	 */
-	CopyStatus transfer_fragment_min_blocking_mode(Fragment const& frag, size_t timeout_usec) override { return sendFragment_(Fragment(frag), timeout_usec); }
+	CopyStatus transfer_fragment_min_blocking_mode(Fragment const& frag, size_t timeout_usec) override { return sendFragment_(frag, nullptr, timeout_usec); }
 
 	/**
 	 * \brief Transfer a Fragment to the destination. This should be reliable, if the underlying transport mechanism supports reliable sending
-	 * \param frag Fragment to transfer
+	 * \param frag Fragment to transfer. It is only moved from if it is sent with MSG_ZEROCOPY.
 	 * \return CopyStatus detailing result of copy
 	 */
-	CopyStatus transfer_fragment_reliable_mode(Fragment&& frag) override { return sendFragment_(std::move(frag), 0); }
+	CopyStatus transfer_fragment_reliable_mode(Fragment&& frag) override { return sendFragment_(frag, &frag, 0); }
 
 	/**
 	 * \brief Determine whether the TransferInterface plugin is able to send/receive data
@@ -101,6 +106,13 @@ public:
 	 */
 	bool isRunning() override;
 
+	/**
+	 * \brief Get the epoll instance which watches the sockets connected to this receiver, for use with poll/epoll by the caller
+	 * \param[out] fds Filled with the epoll file descriptor, which is readable when any connection has data
+	 * \return True if this is a receiver, false otherwise
+	 */
+	bool getReceiveFDs(std::vector<int>& fds) override;
+
 	/**
 	 * \brief Flush any in-flight data. This should be used by the receiver after the receive loop has
 	 * ended.
@@ -113,9 +125,14 @@ private:
 	static std::unique_ptr<boost::thread> listen_thread_;
 	static std::map<int, std::set<int>> connected_fds_;
 	static std::mutex fd_mutex_;
+	static std::map<int, TCPSocketTransfer*> receive_transfers_;  // Receiving instances by source rank, so the listen thread can hand them new connections
 	int send_fd_;
-	std::map<int, int> active_receive_fds_;
-	std::map<int, int> last_active_receive_fds_;
+	int active_receive_fd_;
+	int epoll_fd_;                               // Watches every connection from source_rank; updated by the listen thread and on disconnect
+	std::atomic<size_t> connected_fd_count_;     // Size of connected_fds_[source_rank()], readable without fd_mutex_
+	std::array<epoll_event, 64> ready_events_;  // Last batch of ready connections from epoll_wait
+	size_t ready_index_;                         // Next entry of ready_events_ to serve
+	size_t ready_count_;                         // Number of valid entries in ready_events_
 
 	union
 	{
@@ -136,7 +153,20 @@ private:
 	hostMap_t hostMap_;
 
 	volatile unsigned connect_state : 1;  // 0=not "connected" (initial msg not sent)
-	unsigned blocking : 1;                // compatible with bool (true/false)
+
+	struct PendingSend
+	{
+		Fragment frag;
+		MessHead header_mh;
+		MessHead data_mh;
+		uint32_t last_zero_copy_id{0};  // Counter value of the last MSG_ZEROCOPY sendmsg call covering this Fragment
+	};
+
+	size_t zero_copy_threshold_bytes_;
+	bool zero_copy_enabled_;                                     // SO_ZEROCOPY was accepted on the current send socket
+	uint32_t zero_copy_next_id_;                                 // Kernel numbers MSG_ZEROCOPY calls on a socket from 0
+	uint32_t zero_copy_completed_id_;                            // All calls before this one have completed
+	std::deque<std::unique_ptr<PendingSend>> zero_copy_pending_;  // Fragments the kernel may still be reading
 
 	bool connection_was_lost_;
 
@@ -154,11 +184,21 @@ private:  // methods
 	TCPSocketTransfer& operator=(TCPSocketTransfer const&) = delete;
 	TCPSocketTransfer& operator=(TCPSocketTransfer&&) = delete;
 
-	CopyStatus sendFragment_(Fragment&& frag, size_t timeout_usec);
+	// Sends from frag in place. Only a zero-copy send keeps the Fragment, moving it out of owned if that is given
+	// and copying it otherwise.
+	CopyStatus sendFragment_(Fragment const& frag, Fragment* owned, size_t timeout_usec);
+
+	// Write all of the given iovecs to the send socket, with as few sendmsg calls as possible.
+	// Returns kTimeout only if nothing could be written within send_retry_timeout_us.
+	CopyStatus sendMessage_(iovec* iov, size_t iovcnt, bool zero_copy, bool& used_zero_copy);
+
+	CopyStatus waitForSendReady_(size_t timeout_usec);
+
+	size_t reapZeroCopyCompletions_();
 
-	CopyStatus sendData_(const void* buf, size_t bytes, size_t send_timeout_usec, bool isHeader = false);
+	void waitForZeroCopyCompletions_(size_t max_pending);
 
-	CopyStatus sendData_(const struct iovec* iov, int iovcnt, size_t send_timeout_usec, bool isHeader = false);
+	void closeSendSocket_();
 
 #if USE_ACKS
 	void receive_acks_();
@@ -176,11 +216,10 @@ private:  // methods
 	void start_listen_thread_();
 	static void listen_(int port, size_t rcvbuf);
 
-	size_t getConnectedFDCount_(int source_rank);
-	int getActiveFD_(int source_rank);
-	void setActiveFD_(int source_rank, int fd);
-	int getLastActiveFD_(int source_rank);
-	void setLastActiveFD_(int source_rank, int fd);
+	size_t getConnectedFDCount_() const { return connected_fd_count_.load(); }
+	// Both must be called with fd_mutex_ held
+	void watch_receive_fd_(int fd);
+	void unwatch_receive_fd_(int fd);
 };
 
 #endif  // TCPSocketTransfer_hh
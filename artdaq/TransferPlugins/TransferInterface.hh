@@ -24,6 +24,7 @@ class ParameterSet;
 #include <memory>
 #include <sstream>
 #include <string>
+#include <vector>
 
 namespace artdaq {
 /**
@@ -163,7 +164,8 @@ public:
 
 	/**
 	 * \brief Transfer a Fragment to the destination. This should be reliable, if the underlying transport mechanism supports reliable sending
-	 * \param fragment Fragment to transfer
+	 * \param fragment Fragment to transfer. Plugins should only move from it if they need its buffer after returning,
+	 * since callers may reuse the buffer of a Fragment which is left intact.
 	 * \return CopyStatus detailing result of copy
 	 */
 	virtual CopyStatus transfer_fragment_reliable_mode(artdaq::Fragment&& fragment) = 0;
@@ -191,6 +193,24 @@ public:
 	 */
 	virtual bool isRunning() { return false; }
 
+	/**
+	 * \brief Get the file descriptors which become readable when data is available to this receiver
+	 * \param[out] fds Filled with the currently-connected receive file descriptors
+	 * \return True if the plugin supports readiness notification through file descriptors
+	 *
+	 * Plugins which return false are polled periodically by the receiving application instead.
+	 */
+	virtual bool getReceiveFDs(std::vector<int>& /*fds*/) { return false; }
+
+	/**
+	 * \brief Get a counter which changes whenever the file descriptors returned by getReceiveFDs change
+	 * \return The current value of the counter
+	 *
+	 * Callers only call getReceiveFDs again when this value changes, so it should be cheap (no locks or system calls).
+	 * Plugins whose receive file descriptors never change can use the default.
+	 */
+	virtual size_t getReceiveFDsVersion() const { return 0; }
+
 	/**
 	 * \brief Flush any in-flight data. This should be used by the receiver after the receive loop has ended.
 	 */
@@ -0,0 +1,314 @@
+#define TRACE_NAME "RoutingManagerCore_t"
+
+#include "artdaq/Application/RoutingManagerCore.hh"
+#include "artdaq/DAQdata/Globals.hh"
+#include "artdaq/DAQdata/TCPConnect.hh"
+#include "artdaq/DAQrate/detail/RoutingPacket.hh"
+#include "artdaq/DAQrate/detail/TableReceiver.hh"
+
+#include "artdaq-core/Utilities/configureMessageFacility.hh"
+
+#include "fhiclcpp/ParameterSet.h"
+
+#define BOOST_TEST_MODULE RoutingManagerCore_t
+#include "cetlib/quiet_unit_test.hpp"
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+constexpr size_t table_update_interval_ms = 200;
+constexpr int table_receiver_rank = 10;
+constexpr int event_builder_ranks[] = {1, 2};
+constexpr int rounds = 20;
+const std::string table_multicast_address = "227.129.78.78";
+
+int connect_with_retry(int port)
+{
+	int fd = -1;
+	for (int ii = 0; ii < 100 && fd < 0; ++ii)
+	{
+		fd = TCPConnect("localhost", port);
+		if (fd < 0)
+		{
+			usleep(50000);
+		}
+	}
+	BOOST_REQUIRE(fd >= 0);
+	return fd;
+}
+
+// Reads table updates from fd until sequence ID seq has been routed. Returns false on timeout.
+bool wait_for_route(int fd, artdaq::Fragment::sequence_id_t seq, artdaq::Fragment::sequence_id_t& highest_routed)
+{
+	auto start = std::chrono::steady_clock::now();
+	while (highest_routed < seq)
+	{
+		if (std::chrono::steady_clock::now() - start > std::chrono::seconds(5))
+		{
+			return false;
+		}
+		pollfd pfd{fd, POLLIN, 0};
+		if (poll(&pfd, 1, 100) <= 0)
+		{
+			continue;
+		}
+		artdaq::detail::RoutingPacketHeader hdr;
+		BOOST_REQUIRE_EQUAL(recv(fd, &hdr, sizeof(hdr), MSG_WAITALL), static_cast<ssize_t>(sizeof(hdr)));
+		BOOST_REQUIRE_EQUAL(hdr.header, ROUTING_MAGIC);
+		if (hdr.nRanges == 0)
+		{
+			continue;
+		}
+		std::vector<artdaq::detail::RoutingPacketRange> ranges(hdr.nRanges);
+		auto bytes = static_cast<ssize_t>(ranges.size() * sizeof(artdaq::detail::RoutingPacketRange));
+		BOOST_REQUIRE_EQUAL(recv(fd, ranges.data(), bytes, MSG_WAITALL), bytes);
+		highest_routed = std::max(highest_routed, ranges.back().first_sequence_id + ranges.back().count - 1);
+	}
+	return true;
+}
+
+// A RoutingManagerCore running its main loop, with simulated EventBuilders connected to its token port
+class RoutingManagerHarness
+{
+public:
+	explicit RoutingManagerHarness(size_t min_routes, size_t max_queued_bytes = 10485760, bool multicast = false)
+	    : token_port_(static_cast<int>(seedAndRandom() % (32768 - 1024)) + 1024)
+	{
+		fhicl::ParameterSet policy_pset;
+		policy_pset.put("policy", "RoundRobin");
+		fhicl::ParameterSet token_pset;
+		token_pset.put("routing_token_port", token_port_);
+		fhicl::ParameterSet daq_pset;
+		daq_pset.put("rank", 0);
+		daq_pset.put("policy", policy_pset);
+		daq_pset.put("token_receiver", token_pset);
+		daq_pset.put("table_update_port", table_port());
+		daq_pset.put("table_update_interval_ms", table_update_interval_ms);
+		daq_pset.put("table_update_min_routes", min_routes);
+		daq_pset.put("table_connection_max_queued_bytes", max_queued_bytes);
+		if (multicast)
+		{
+			daq_pset.put("table_update_multicast", true);
+			daq_pset.put("table_update_multicast_address", table_multicast_address);
+			daq_pset.put("table_update_multicast_port", multicast_port());
+			daq_pset.put("multicast_interface_ip", "127.0.0.1");
+			daq_pset.put("table_update_multicast_max_datagram_size", 1024);
+		}
+		fhicl::ParameterSet pset;
+		pset.put("daq", daq_pset);
+
+		BOOST_REQUIRE(core_.initialize(pset, 0, 0));
+		BOOST_REQUIRE(core_.start(art::RunID(1), 0, 0));
+		loop_ = std::thread([this]() { core_.process_event_table(); });
+		for (size_t ii = 0; ii < sizeof(event_builder_ranks) / sizeof(event_builder_ranks[0]); ++ii)
+		{
+			token_fds_.push_back(connect_with_retry(token_port_));
+		}
+	}
+
+	~RoutingManagerHarness()
+	{
+		core_.stop(0, 0);
+		loop_.join();
+		for (auto fd : token_fds_)
+		{
+			close(fd);
+		}
+		core_.shutdown(0);
+	}
+
+	int table_port() const { return token_port_ + 1; }
+	int multicast_port() const { return token_port_ + 2; }
+
+	// Connects as a BoardReader which receives table updates
+	int connect_table_receiver(int rank) const
+	{
+		auto fd = connect_with_retry(table_port());
+		artdaq::detail::RoutingRequest connect_request(rank);
+		BOOST_REQUIRE_EQUAL(write(fd, &connect_request, sizeof(connect_request)), static_cast<ssize_t>(sizeof(connect_request)));
+		usleep(100000);  // Tables are only sent to connections the listen thread has registered
+		return fd;
+	}
+
+	// Every simulated EventBuilder returns slots tokens. Returns the time the last one was sent.
+	std::chrono::steady_clock::time_point send_tokens(unsigned slots)
+	{
+		std::chrono::steady_clock::time_point sent;
+		for (size_t ii = 0; ii < token_fds_.size(); ++ii)
+		{
+			artdaq::detail::RoutingToken token{TOKEN_MAGIC, event_builder_ranks[ii], slots, 1};
+			sent = std::chrono::steady_clock::now();
+			BOOST_REQUIRE_EQUAL(write(token_fds_[ii], &token, sizeof(token)), static_cast<ssize_t>(sizeof(token)));
+		}
+		return sent;
+	}
+
+	size_t event_builder_count() const { return token_fds_.size(); }
+
+private:
+	RoutingManagerHarness(RoutingManagerHarness const&) = delete;
+	RoutingManagerHarness(RoutingManagerHarness&&) = delete;
+	RoutingManagerHarness& operator=(RoutingManagerHarness const&) = delete;
+	RoutingManagerHarness& operator=(RoutingManagerHarness&&) = delete;
+
+	int token_port_;
+	artdaq::RoutingManagerCore core_;
+	std::thread loop_;
+	std::vector<int> token_fds_;
+};
+
+// Simulated EventBuilders return one token each per round. Measures the time from the last token of a round until
+// the routes it allows reach a simulated BoardReader.
+double mean_route_latency_ms(size_t min_routes)
+{
+	RoutingManagerHarness harness(min_routes);
+	auto table_fd = harness.connect_table_receiver(table_receiver_rank);
+
+	double total_ms = 0;
+	artdaq::Fragment::sequence_id_t highest_routed = 0;
+	artdaq::Fragment::sequence_id_t expected = 0;
+	for (int round = 0; round < rounds; ++round)
+	{
+		auto sent = harness.send_tokens(1);
+		expected += harness.event_builder_count();
+		BOOST_REQUIRE(wait_for_route(table_fd, expected, highest_routed));
+		total_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - sent).count();
+		usleep(seedAndRandom() % 20000);  // Tokens arrive at arbitrary points in the table interval
+	}
+
+	artdaq::detail::RoutingRequest disconnect(table_receiver_rank, artdaq::detail::RoutingRequest::RequestMode::Disconnect);
+	write(table_fd, &disconnect, sizeof(disconnect));
+	close(table_fd);
+	return total_ms / rounds;
+}
+}  // namespace
+
+BOOST_AUTO_TEST_SUITE(RoutingManagerCore_test)
+
+BOOST_AUTO_TEST_CASE(RouteAvailabilityLatency)
+{
+	artdaq::configureMessageFacility("RoutingManagerCore_t", true, true);
+	TLOG(TLVL_INFO) << "RouteAvailabilityLatency Test Case BEGIN";
+
+	auto interval_latency = mean_route_latency_ms(0);
+	auto reactive_latency = mean_route_latency_ms(1);
+	TLOG(TLVL_INFO) << "Mean route availability latency: " << interval_latency << " ms with interval-only table updates, "
+	                << reactive_latency << " ms with table_update_min_routes=1";
+
+	// Interval-only updates wait on average half an interval for the next table
+	BOOST_REQUIRE_LT(reactive_latency * 5, interval_latency);
+	BOOST_REQUIRE_LT(reactive_latency, table_update_interval_ms / 10.0);
+
+	TLOG(TLVL_INFO) << "RouteAvailabilityLatency Test Case END";
+}
+
+BOOST_AUTO_TEST_CASE(StuckTableReceiver)
+{
+	artdaq::configureMessageFacility("RoutingManagerCore_t", true, true);
+	TLOG(TLVL_INFO) << "StuckTableReceiver Test Case BEGIN";
+
+	// One BoardReader never reads its table updates. The other must keep getting them promptly, and the stuck
+	// one must be disconnected once its queue exceeds the limit, instead of blocking the RoutingManager.
+	RoutingManagerHarness harness(1, 1024 * 1024);
+	auto stuck_fd = harness.connect_table_receiver(table_receiver_rank + 1);
+	int rcvbuf = 4096;  // Keep the kernel from absorbing the backlog
+	setsockopt(stuck_fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+	auto table_fd = harness.connect_table_receiver(table_receiver_rank);
+
+	// Alternating destinations make one range per event, so each table update is about 64 KB
+	const unsigned slots = 2000;
+	artdaq::Fragment::sequence_id_t highest_routed = 0;
+	artdaq::Fragment::sequence_id_t expected = 0;
+	for (int round = 0; round < 150; ++round)
+	{
+		harness.send_tokens(slots);
+		expected += slots * harness.event_builder_count();
+		BOOST_REQUIRE(wait_for_route(table_fd, expected, highest_routed));
+	}
+
+	// Drain what the stuck receiver was sent; it must end with the RoutingManager closing the connection
+	std::vector<uint8_t> buffer(65536);
+	bool closed = false;
+	auto start = std::chrono::steady_clock::now();
+	while (!closed && std::chrono::steady_clock::now() - start < std::chrono::seconds(5))
+	{
+		auto sts = recv(stuck_fd, buffer.data(), buffer.size(), MSG_DONTWAIT);
+		closed = sts == 0 || (sts < 0 && errno != EAGAIN && errno != EWOULDBLOCK);
+		if (sts < 0 && !closed)
+		{
+			usleep(1000);
+		}
+	}
+	BOOST_REQUIRE(closed);
+	close(stuck_fd);
+	close(table_fd);
+
+	TLOG(TLVL_INFO) << "StuckTableReceiver Test Case END";
+}
+
+BOOST_AUTO_TEST_CASE(MulticastTablePublication)
+{
+	artdaq::configureMessageFacility("RoutingManagerCore_t", true, true);
+	TLOG(TLVL_INFO) << "MulticastTablePublication Test Case BEGIN";
+
+	RoutingManagerHarness harness(1, 10485760, true);
+
+	fhicl::ParameterSet receiver_pset;
+	receiver_pset.put("use_routing_manager", true);
+	receiver_pset.put("table_update_port", harness.table_port());
+	receiver_pset.put("routing_manager_hostname", "localhost");
+	receiver_pset.put("table_update_multicast", true);
+	receiver_pset.put("table_update_multicast_address", table_multicast_address);
+	receiver_pset.put("table_update_multicast_port", harness.multicast_port());
+	receiver_pset.put("multicast_interface_ip", "127.0.0.1");
+	std::vector<std::unique_ptr<artdaq::TableReceiver>> receivers;
+	for (int ii = 0; ii < 16; ++ii)
+	{
+		receivers.push_back(std::make_unique<artdaq::TableReceiver>(receiver_pset));
+	}
+	auto table_fd = harness.connect_table_receiver(table_receiver_rank);
+
+	// Alternating destinations make one range per event, so each table is split into several datagrams
+	const unsigned slots = 50;
+	size_t expected = 0;
+	for (int round = 0; round < rounds; ++round)
+	{
+		harness.send_tokens(slots);
+		expected += slots * harness.event_builder_count();
+		usleep(10000);
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	for (auto& receiver : receivers)
+	{
+		while (receiver->GetRoutingTableEntryCount() < expected && std::chrono::steady_clock::now() - start < std::chrono::seconds(5))
+		{
+			usleep(1000);
+		}
+		BOOST_REQUIRE_EQUAL(receiver->GetRoutingTableEntryCount(), expected);
+		BOOST_REQUIRE(receiver->GetRoutingTable() == receivers.front()->GetRoutingTable());
+	}
+
+	// Table updates are not sent on the table connections...
+	std::vector<uint8_t> buffer(65536);
+	BOOST_REQUIRE_LT(recv(table_fd, buffer.data(), buffer.size(), MSG_DONTWAIT), 0);
+
+	// ...but an update which was missed can be requested over one
+	artdaq::detail::RoutingRequest resend(table_receiver_rank, 1, artdaq::detail::RoutingRequest::RequestMode::Resend);
+	BOOST_REQUIRE_EQUAL(write(table_fd, &resend, sizeof(resend)), static_cast<ssize_t>(sizeof(resend)));
+	artdaq::Fragment::sequence_id_t highest_routed = 0;
+	BOOST_REQUIRE(wait_for_route(table_fd, 1, highest_routed));
+
+	receivers.clear();
+	close(table_fd);
+	TLOG(TLVL_INFO) << "MulticastTablePublication Test Case END";
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,133 @@
+#include "artdaq/ArtModules/detail/BinaryFileWriter.hh"
+
+#define BOOST_TEST_MODULE BinaryFileWriter_t
+#include <boost/test/unit_test.hpp>
+
+#include "cetlib_except/exception.h"
+
+#include <unistd.h>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace {
+// /dev/shm is tmpfs, which does not support O_DIRECT; the working directory is normally on a local filesystem which does
+std::vector<std::string> test_directories()
+{
+	std::vector<std::string> dirs{"."};
+	if (access("/dev/shm", W_OK) == 0)
+	{
+		dirs.emplace_back("/dev/shm");
+	}
+	return dirs;
+}
+
+std::string test_file_name(std::string const& dir, std::string const& name)
+{
+	return dir + "/BinaryFileWriter_t_" + std::to_string(getpid()) + "_" + name + ".bin";
+}
+
+std::vector<uint8_t> make_data(size_t size)
+{
+	std::vector<uint8_t> data(size);
+	for (size_t ii = 0; ii < size; ++ii)
+	{
+		data[ii] = static_cast<uint8_t>((ii * 7 + ii / 251) & 0xFF);
+	}
+	return data;
+}
+
+std::vector<uint8_t> read_file(std::string const& file_name)
+{
+	std::ifstream is(file_name, std::ios::binary);
+	return std::vector<uint8_t>(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+}
+
+// Write data in chunks of varying size, so that writes straddle buffer boundaries
+void write_and_check(std::string const& file_name, bool direct_io, size_t buffer_size, size_t buffer_count, size_t preallocate, size_t total)
+{
+	auto data = make_data(total);
+	{
+		art::BinaryFileWriter writer(file_name, direct_io, buffer_size, buffer_count, preallocate);
+		size_t offset = 0;
+		size_t chunk = 1;
+		while (offset < total)
+		{
+			auto count = std::min(chunk, total - offset);
+			writer.Write(&data[offset], count);
+			offset += count;
+			chunk = chunk * 3 % 20011 + 1;
+		}
+		BOOST_REQUIRE_EQUAL(writer.BytesWritten(), total);
+		writer.Close();
+	}
+	auto contents = read_file(file_name);
+	unlink(file_name.c_str());
+	BOOST_REQUIRE_EQUAL(contents.size(), total);
+	BOOST_REQUIRE(contents == data);
+}
+}  // namespace
+
+BOOST_AUTO_TEST_SUITE(BinaryFileWriter_test)
+
+BOOST_AUTO_TEST_CASE(BufferedIO)
+{
+	for (auto& dir : test_directories())
+	{
+		write_and_check(test_file_name(dir, "buffered"), false, 65536, 4, 0, 1000003);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(DirectIO)
+{
+	// Falls back to buffered IO where O_DIRECT is not supported; the result must be the same either way
+	for (auto& dir : test_directories())
+	{
+		write_and_check(test_file_name(dir, "direct"), true, 65536, 4, 0, 1000003);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(Preallocate)
+{
+	// The preallocated space beyond the data must be trimmed when the file is closed
+	for (auto& dir : test_directories())
+	{
+		write_and_check(test_file_name(dir, "prealloc"), true, 65536, 2, 1048576, 300001);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(SingleBuffer)
+{
+	// Less data than one buffer is only written at Close
+	for (auto& dir : test_directories())
+	{
+		write_and_check(test_file_name(dir, "small"), true, 1048576, 2, 0, 1234);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(EmptyFile)
+{
+	for (auto& dir : test_directories())
+	{
+		write_and_check(test_file_name(dir, "empty"), true, 65536, 2, 0, 0);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(WriteAfterClose)
+{
+	auto file_name = test_file_name(".", "closed");
+	art::BinaryFileWriter writer(file_name, false, 4096, 2, 0);
+	writer.Close();
+	uint8_t byte = 0;
+	BOOST_REQUIRE_THROW(writer.Write(&byte, 1), cet::exception);
+	unlink(file_name.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(BadPath)
+{
+	BOOST_REQUIRE_THROW(art::BinaryFileWriter("/nonexistent_directory/BinaryFileWriter_t.bin", false, 4096, 2, 0), cet::exception);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
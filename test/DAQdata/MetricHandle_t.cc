@@ -0,0 +1,149 @@
+#include "artdaq/DAQdata/Globals.hh"
+#include "artdaq/DAQdata/MetricHandle.hh"
+
+#define BOOST_TEST_MODULE MetricHandle_t
+#include <boost/test/unit_test.hpp>
+
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+/**
+ * Collects what MetricHandle publishes: the sum of the published values for Accumulate, and the extreme value seen
+ * for Minimum and Maximum
+ */
+struct PublishedValues
+{
+	PublishedValues()
+	{
+		artdaq::MetricHandle::SetPublishCallback([this](std::string const& name, double value, artdaq::MetricMode mode) {
+			std::lock_guard<std::mutex> lk(mutex);
+			switch (mode)
+			{
+				case artdaq::MetricMode::Accumulate:
+					totals[name] += value;
+					break;
+				case artdaq::MetricMode::Maximum:
+					extremes[name] = extremes.count(name) != 0u ? std::max(extremes[name], value) : value;
+					break;
+				case artdaq::MetricMode::Minimum:
+					extremes[name] = extremes.count(name) != 0u ? std::min(extremes[name], value) : value;
+					break;
+				default:
+					break;
+			}
+		});
+	}
+	~PublishedValues()
+	{
+		artdaq::MetricHandle::SetPublishCallback(nullptr);
+	}
+	PublishedValues(PublishedValues const&) = delete;
+	PublishedValues(PublishedValues&&) = delete;
+	PublishedValues& operator=(PublishedValues const&) = delete;
+	PublishedValues& operator=(PublishedValues&&) = delete;
+
+	double total(std::string const& name)
+	{
+		std::lock_guard<std::mutex> lk(mutex);
+		return totals[name];
+	}
+	double extreme(std::string const& name)
+	{
+		std::lock_guard<std::mutex> lk(mutex);
+		return extremes[name];
+	}
+
+	std::mutex mutex;
+	std::map<std::string, double> totals;
+	std::map<std::string, double> extremes;
+};
+}  // namespace
+
+BOOST_AUTO_TEST_SUITE(MetricHandle_test)
+
+// Threads record concurrently while the publisher runs, and most of them exit before the end of the test. Every
+// value must be published exactly once.
+BOOST_AUTO_TEST_CASE(ManyThreads)
+{
+	PublishedValues published;
+	artdaq::MetricHandle::SetPublishInterval(0.001);
+	auto handle = artdaq::MetricHandle::Register("MetricHandle_t ManyThreads", "", 1, artdaq::MetricMode::Accumulate | artdaq::MetricMode::Maximum | artdaq::MetricMode::Minimum);
+	BOOST_REQUIRE(handle.IsValid());
+
+	const int thread_count = 32;
+	const int records_per_thread = 10000;
+	std::vector<std::thread> short_lived;
+	std::vector<std::thread> long_lived;
+	std::mutex exit_mutex;
+	bool may_exit = false;
+	std::condition_variable exit_cv;
+	for (int ii = 0; ii < thread_count; ++ii)
+	{
+		auto record = [&handle, ii] {
+			for (int jj = 1; jj <= records_per_thread; ++jj)
+			{
+				handle.Record(ii % 2 == 0 ? jj : 1.0);
+			}
+		};
+		if (ii % 4 == 0)
+		{
+			long_lived.emplace_back([&, record] {
+				record();
+				std::unique_lock<std::mutex> lk(exit_mutex);
+				exit_cv.wait(lk, [&] { return may_exit; });
+			});
+		}
+		else
+		{
+			short_lived.emplace_back(record);
+		}
+	}
+	for (auto& thread : short_lived)
+	{
+		thread.join();
+	}
+	{
+		std::lock_guard<std::mutex> lk(exit_mutex);
+		may_exit = true;
+	}
+	exit_cv.notify_all();
+	for (auto& thread : long_lived)
+	{
+		thread.join();
+	}
+	artdaq::MetricHandle::Publish();
+
+	// Half of the threads record 1..N, the other half record 1.0 N times
+	double expected = thread_count / 2 * (static_cast<double>(records_per_thread) * (records_per_thread + 1) / 2) + thread_count / 2 * records_per_thread;
+	BOOST_REQUIRE_EQUAL(published.total("MetricHandle_t ManyThreads - Total"), expected);
+	BOOST_REQUIRE_EQUAL(published.extreme("MetricHandle_t ManyThreads - Max"), records_per_thread);
+	BOOST_REQUIRE_EQUAL(published.extreme("MetricHandle_t ManyThreads - Min"), 1.0);
+
+	// Nothing is published twice
+	artdaq::MetricHandle::Publish();
+	BOOST_REQUIRE_EQUAL(published.total("MetricHandle_t ManyThreads - Total"), expected);
+	artdaq::MetricHandle::SetPublishInterval(1.0);
+}
+
+// Values recorded by a thread which has exited are still published, and Shutdown publishes them before stopping
+BOOST_AUTO_TEST_CASE(Shutdown)
+{
+	PublishedValues published;
+	auto handle = artdaq::MetricHandle::Register("MetricHandle_t Shutdown", "", 1, artdaq::MetricMode::Accumulate);
+	std::thread([&handle] { handle.Record(3.0); }).join();
+	artdaq::MetricHandle::Shutdown();
+	BOOST_REQUIRE_EQUAL(published.total("MetricHandle_t Shutdown"), 3.0);
+
+	// Registering again starts a new publisher
+	handle = artdaq::MetricHandle::Register("MetricHandle_t Shutdown", "", 1, artdaq::MetricMode::Accumulate);
+	std::thread([&handle] { handle.Record(4.0); }).join();
+	artdaq::MetricHandle::Shutdown();
+	BOOST_REQUIRE_EQUAL(published.total("MetricHandle_t Shutdown"), 7.0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
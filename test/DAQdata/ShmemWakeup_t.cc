@@ -0,0 +1,90 @@
+#include "artdaq/DAQdata/ShmemWakeup.hh"
+
+#define BOOST_TEST_MODULE ShmemWakeup_t
+#include <boost/test/unit_test.hpp>
+
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+namespace {
+// Wait in the owner for a flag set by the attached instance, returning how long after the flag was set the wait
+// returned, in microseconds
+int64_t notify_latency_us(artdaq::detail::ShmemWakeup& owner, artdaq::detail::ShmemWakeup& attached)
+{
+	std::atomic<bool> flag{false};
+	std::atomic<int64_t> set_time{0};
+	std::thread notifier([&] {
+		usleep(200000);
+		set_time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		flag = true;
+		attached.NotifySpace();
+	});
+	BOOST_REQUIRE(owner.WaitForSpace([&] { return flag.load(); }, 5000000));
+	auto wake_time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	notifier.join();
+	return wake_time - set_time;
+}
+}  // namespace
+
+BOOST_AUTO_TEST_SUITE(ShmemWakeup_test)
+
+BOOST_AUTO_TEST_CASE(NotifyWait)
+{
+	uint32_t key = 0xFEE10000 + getpid();
+	artdaq::detail::ShmemWakeup owner(key, true);
+	artdaq::detail::ShmemWakeup attached(key, false);
+	BOOST_REQUIRE(owner.IsValid());
+	BOOST_REQUIRE(attached.IsValid());
+
+	// Nothing to wait for
+	BOOST_REQUIRE(owner.WaitForData([] { return true; }, 0));
+	// Nobody sets the condition
+	auto start = std::chrono::steady_clock::now();
+	BOOST_REQUIRE(!owner.WaitForData([] { return false; }, 50000));
+	BOOST_REQUIRE_GE(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count(), 50000);
+
+	// Space waits sleep for up to 100 ms at a time, so a prompt wakeup can only come from the notification
+	auto latency = notify_latency_us(owner, attached);
+	BOOST_TEST_MESSAGE("WaitForSpace returned " << latency << " us after the notification");
+	BOOST_REQUIRE_LT(latency, 50000);
+}
+
+BOOST_AUTO_TEST_CASE(OwnerRecreated)
+{
+	uint32_t key = 0xFEE20000 + getpid();
+	auto owner = std::make_unique<artdaq::detail::ShmemWakeup>(key, true);
+	artdaq::detail::ShmemWakeup attached(key, false);
+	attached.SetWriterAttached(true);
+	BOOST_REQUIRE(attached.IsValid());
+
+	// The receiver restarts, creating a new region under the same name
+	owner.reset(nullptr);
+	BOOST_REQUIRE(!attached.IsValid());
+	owner = std::make_unique<artdaq::detail::ShmemWakeup>(key, true);
+	BOOST_REQUIRE(!attached.IsValid());
+
+	// The next call moves the attached instance to the new region
+	attached.NotifyData();
+	BOOST_REQUIRE(attached.IsValid());
+
+	auto latency = notify_latency_us(*owner, attached);
+	BOOST_TEST_MESSAGE("WaitForSpace returned " << latency << " us after the notification");
+	BOOST_REQUIRE_LT(latency, 50000);
+
+	// A region left behind by an owner which never cleaned up is replaced the same way
+	auto replacement = std::make_unique<artdaq::detail::ShmemWakeup>(key, true);
+	BOOST_REQUIRE(!attached.IsValid());
+	BOOST_REQUIRE(!owner->IsValid());
+	attached.NotifySpace();
+	BOOST_REQUIRE(attached.IsValid());
+
+	latency = notify_latency_us(*replacement, attached);
+	BOOST_TEST_MESSAGE("WaitForSpace returned " << latency << " us after the notification");
+	BOOST_REQUIRE_LT(latency, 50000);
+	attached.SetWriterAttached(false);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -1,7 +1,9 @@
 #include "artdaq/DAQrate/DataReceiverManager.hh"
 
 #define BOOST_TEST_MODULE DataReceiverManager_t
+#include "artdaq/DAQdata/HostMap.hh"
 #include "artdaq/TransferPlugins/ShmemTransfer.hh"
+#include "artdaq/TransferPlugins/TCPSocketTransfer.hh"
 #include "cetlib/quiet_unit_test.hpp"
 #include "cetlib_except/exception.h"
 
@@ -101,4 +103,216 @@ BOOST_AUTO_TEST_CASE(ReceiveData)
 	TLOG(TLVL_DEBUG) << "Test Case ReceiveData END";
 }
 
+BOOST_AUTO_TEST_CASE(ReceiveDataThreadPool)
+{
+	artdaq::configureMessageFacility("DataReceiverManager_t", true, true);
+	TLOG(TLVL_DEBUG) << "Test Case ReceiveDataThreadPool BEGIN";
+	fhicl::ParameterSet pset;
+	pset.put("use_art", false);
+	pset.put("buffer_count", 2);
+	pset.put("max_event_size_bytes", 1000);
+	pset.put("expected_fragments_per_event", 2);
+	pset.put("receiver_thread_count", 1);
+
+	fhicl::ParameterSet source_fhicl;
+	source_fhicl.put("transferPluginType", "Shmem");
+	source_fhicl.put("destination_rank", 1);
+	source_fhicl.put("source_rank", 0);
+	source_fhicl.put("shm_key", 0xFEEF0000 + getpid());
+
+	fhicl::ParameterSet source2_fhicl;
+	source2_fhicl.put("transferPluginType", "Shmem");
+	source2_fhicl.put("destination_rank", 1);
+	source2_fhicl.put("source_rank", 2);
+	source2_fhicl.put("shm_key", 0xFEF00000 + getpid());
+
+	fhicl::ParameterSet sources_fhicl;
+	sources_fhicl.put("shmem", source_fhicl);
+	sources_fhicl.put("shmem2", source2_fhicl);
+	pset.put("sources", sources_fhicl);
+	auto shm = std::make_shared<artdaq::SharedMemoryEventManager>(pset, pset);
+	shm->startRun(1);
+	artdaq::DataReceiverManager t(pset, shm);
+	{
+		artdaq::ShmemTransfer transfer(source_fhicl, artdaq::TransferInterface::Role::kSend);
+		artdaq::ShmemTransfer transfer2(source2_fhicl, artdaq::TransferInterface::Role::kSend);
+		TRACE_REQUIRE_EQUAL(t.enabled_sources().size(), 2);
+		TRACE_REQUIRE_EQUAL(t.running_sources().size(), 0);
+		t.start_threads();
+		TRACE_REQUIRE_EQUAL(t.running_sources().size(), 2);
+
+		for (int rank = 0; rank < 2; ++rank)
+		{
+			artdaq::Fragment testFrag(10);
+			testFrag.setSequenceID(1);
+			testFrag.setFragmentID(rank);
+			testFrag.setTimestamp(0x100);
+			testFrag.setSystemType(artdaq::Fragment::DataFragmentType);
+
+			(rank == 0 ? transfer : transfer2).transfer_fragment_reliable_mode(std::move(testFrag));
+		}
+
+		sleep(1);
+		TRACE_REQUIRE_EQUAL(t.count(), 2);
+		TRACE_REQUIRE_EQUAL(t.slotCount(0), 1);
+		TRACE_REQUIRE_EQUAL(t.slotCount(2), 1);
+
+		artdaq::FragmentPtr eodFrag = artdaq::Fragment::eodFrag(1);
+		artdaq::FragmentPtr eodFrag2 = artdaq::Fragment::eodFrag(1);
+
+		transfer.transfer_fragment_reliable_mode(std::move(*(eodFrag.get())));
+		transfer2.transfer_fragment_reliable_mode(std::move(*(eodFrag2.get())));
+	}
+	sleep(2);
+	TRACE_REQUIRE_EQUAL(t.count(), 2);
+	TRACE_REQUIRE_EQUAL(t.running_sources().size(), 0);
+	t.stop_threads();
+	TLOG(TLVL_DEBUG) << "Test Case ReceiveDataThreadPool END";
+}
+
+BOOST_AUTO_TEST_CASE(ReceiveDataThreadPoolTCP)
+{
+	artdaq::configureMessageFacility("DataReceiverManager_t", true, true);
+	TLOG(TLVL_DEBUG) << "Test Case ReceiveDataThreadPoolTCP BEGIN";
+	fhicl::ParameterSet pset;
+	pset.put("use_art", false);
+	pset.put("buffer_count", 2);
+	pset.put("max_event_size_bytes", 1000);
+	pset.put("expected_fragments_per_event", 2);
+	pset.put("receiver_thread_count", 1);
+	// Long enough that the Fragments below only arrive in time if the pool thread is woken by the receive fd
+	pset.put("receive_timeout_usec", 2000000);
+
+	auto host_map = artdaq::MakeHostMapPset({{0, "localhost"}, {1, "localhost"}, {2, "localhost"}});
+
+	fhicl::ParameterSet source_fhicl;
+	source_fhicl.put("transferPluginType", "TCPSocket");
+	source_fhicl.put("destination_rank", 1);
+	source_fhicl.put("source_rank", 0);
+	source_fhicl.put("host_map", host_map);
+
+	fhicl::ParameterSet source2_fhicl;
+	source2_fhicl.put("transferPluginType", "TCPSocket");
+	source2_fhicl.put("destination_rank", 1);
+	source2_fhicl.put("source_rank", 2);
+	source2_fhicl.put("host_map", host_map);
+
+	fhicl::ParameterSet sources_fhicl;
+	sources_fhicl.put("tcp", source_fhicl);
+	sources_fhicl.put("tcp2", source2_fhicl);
+	pset.put("sources", sources_fhicl);
+	auto shm = std::make_shared<artdaq::SharedMemoryEventManager>(pset, pset);
+	shm->startRun(1);
+	artdaq::DataReceiverManager t(pset, shm);
+	{
+		artdaq::TCPSocketTransfer transfer(source_fhicl, artdaq::TransferInterface::Role::kSend);
+		artdaq::TCPSocketTransfer transfer2(source2_fhicl, artdaq::TransferInterface::Role::kSend);
+		TRACE_REQUIRE_EQUAL(t.enabled_sources().size(), 2);
+		TRACE_REQUIRE_EQUAL(t.running_sources().size(), 0);
+		t.start_threads();
+		TRACE_REQUIRE_EQUAL(t.running_sources().size(), 2);
+
+		for (int rank = 0; rank < 2; ++rank)
+		{
+			artdaq::Fragment testFrag(10);
+			testFrag.setSequenceID(1);
+			testFrag.setFragmentID(rank);
+			testFrag.setTimestamp(0x100);
+			testFrag.setSystemType(artdaq::Fragment::DataFragmentType);
+
+			(rank == 0 ? transfer : transfer2).transfer_fragment_reliable_mode(std::move(testFrag));
+		}
+
+		sleep(1);
+		TRACE_REQUIRE_EQUAL(t.count(), 2);
+		TRACE_REQUIRE_EQUAL(t.slotCount(0), 1);
+		TRACE_REQUIRE_EQUAL(t.slotCount(2), 1);
+
+		artdaq::FragmentPtr eodFrag = artdaq::Fragment::eodFrag(1);
+		artdaq::FragmentPtr eodFrag2 = artdaq::Fragment::eodFrag(1);
+
+		transfer.transfer_fragment_reliable_mode(std::move(*(eodFrag.get())));
+		transfer2.transfer_fragment_reliable_mode(std::move(*(eodFrag2.get())));
+	}
+	sleep(4);
+	TRACE_REQUIRE_EQUAL(t.count(), 2);
+	TRACE_REQUIRE_EQUAL(t.running_sources().size(), 0);
+	t.stop_threads();
+	TLOG(TLVL_DEBUG) << "Test Case ReceiveDataThreadPoolTCP END";
+}
+
+BOOST_AUTO_TEST_CASE(ThreadPoolBackpressure)
+{
+	artdaq::configureMessageFacility("DataReceiverManager_t", true, true);
+	TLOG(TLVL_DEBUG) << "Test Case ThreadPoolBackpressure BEGIN";
+	fhicl::ParameterSet pset;
+	pset.put("use_art", false);
+	pset.put("buffer_count", 2);
+	pset.put("max_event_size_bytes", 1000);
+	pset.put("expected_fragments_per_event", 2);
+	pset.put("receiver_thread_count", 1);
+
+	auto host_map = artdaq::MakeHostMapPset({{0, "localhost"}, {1, "localhost"}, {2, "localhost"}});
+
+	fhicl::ParameterSet source_fhicl;
+	source_fhicl.put("transferPluginType", "TCPSocket");
+	source_fhicl.put("destination_rank", 1);
+	source_fhicl.put("source_rank", 0);
+	source_fhicl.put("host_map", host_map);
+
+	fhicl::ParameterSet source2_fhicl;
+	source2_fhicl.put("transferPluginType", "TCPSocket");
+	source2_fhicl.put("destination_rank", 1);
+	source2_fhicl.put("source_rank", 2);
+	source2_fhicl.put("host_map", host_map);
+
+	fhicl::ParameterSet sources_fhicl;
+	sources_fhicl.put("tcp", source_fhicl);
+	sources_fhicl.put("tcp2", source2_fhicl);
+	pset.put("sources", sources_fhicl);
+	auto shm = std::make_shared<artdaq::SharedMemoryEventManager>(pset, pset);
+	shm->startRun(1);
+	artdaq::DataReceiverManager t(pset, shm);
+	{
+		artdaq::TCPSocketTransfer transfer(source_fhicl, artdaq::TransferInterface::Role::kSend);
+		artdaq::TCPSocketTransfer transfer2(source2_fhicl, artdaq::TransferInterface::Role::kSend);
+		t.start_threads();
+
+		auto send = [&](artdaq::TCPSocketTransfer& tr, int rank, artdaq::Fragment::sequence_id_t seq) {
+			artdaq::Fragment testFrag(10);
+			testFrag.setSequenceID(seq);
+			testFrag.setFragmentID(rank);
+			testFrag.setTimestamp(0x100 * seq);
+			testFrag.setSystemType(artdaq::Fragment::DataFragmentType);
+			tr.transfer_fragment_reliable_mode(std::move(testFrag));
+		};
+
+		// Both buffers hold an incomplete event, so the third Fragment from rank 0 has to wait for a buffer
+		for (artdaq::Fragment::sequence_id_t seq = 1; seq <= 3; ++seq)
+		{
+			send(transfer, 0, seq);
+		}
+		sleep(1);
+		TRACE_REQUIRE_EQUAL(t.slotCount(0), 2);
+
+		// The pool thread keeps serving rank 2, whose Fragments complete the events rank 0 is waiting on
+		send(transfer2, 2, 1);
+		send(transfer2, 2, 2);
+		sleep(1);
+		TRACE_REQUIRE_EQUAL(t.slotCount(2), 2);
+		TRACE_REQUIRE_EQUAL(t.slotCount(0), 3);
+
+		artdaq::FragmentPtr eodFrag = artdaq::Fragment::eodFrag(3);
+		artdaq::FragmentPtr eodFrag2 = artdaq::Fragment::eodFrag(2);
+
+		transfer.transfer_fragment_reliable_mode(std::move(*(eodFrag.get())));
+		transfer2.transfer_fragment_reliable_mode(std::move(*(eodFrag2.get())));
+	}
+	sleep(2);
+	TRACE_REQUIRE_EQUAL(t.count(), 5);
+	TRACE_REQUIRE_EQUAL(t.running_sources().size(), 0);
+	t.stop_threads();
+	TLOG(TLVL_DEBUG) << "Test Case ThreadPoolBackpressure END";
+}
+
 BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
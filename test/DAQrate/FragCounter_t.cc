@@ -6,6 +6,11 @@ using artdaq::detail::FragCounter;
 #define BOOST_TEST_MODULE FragCounter_t
 #include <boost/test/unit_test.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
 BOOST_AUTO_TEST_SUITE(FragCounter_test)
 
 BOOST_AUTO_TEST_CASE(Construct)
@@ -49,4 +54,100 @@ BOOST_AUTO_TEST_CASE(ApplyWithOffset)
 	BOOST_REQUIRE_EQUAL(f.count(), 8ul);
 }
 
+BOOST_AUTO_TEST_CASE(SetAndMin)
+{
+	FragCounter f;
+	f.setSlot(3, 10);
+	f.setSlot(70, 5);
+	f.incSlot(3);
+	BOOST_REQUIRE_EQUAL(f.nSlots(), 2ul);
+	BOOST_REQUIRE_EQUAL(f.slotCount(3), 11ul);
+	BOOST_REQUIRE_EQUAL(f.minCount(), 5ul);
+	BOOST_REQUIRE_EQUAL(f.count(), 16ul);
+	f.setSlot(70, 20);
+	BOOST_REQUIRE_EQUAL(f.minCount(), 11ul);
+	BOOST_REQUIRE_EQUAL(f[70], 20ul);
+}
+
+BOOST_AUTO_TEST_CASE(LargeSlots)
+{
+	// Slots beyond the lock-free table are still counted
+	FragCounter f;
+	auto big = FragCounter::max_table_slot + 12345;
+	f.incSlot(big, 3);
+	f.incSlot(1);
+	BOOST_REQUIRE_EQUAL(f.nSlots(), 2ul);
+	BOOST_REQUIRE_EQUAL(f.slotCount(big), 3ul);
+	BOOST_REQUIRE_EQUAL(f.slotCount(big + 1), 0ul);
+	BOOST_REQUIRE_EQUAL(f.count(), 4ul);
+	BOOST_REQUIRE_EQUAL(f.minCount(), 1ul);
+}
+
+BOOST_AUTO_TEST_CASE(ConcurrentInsert)
+{
+	// Threads adding and incrementing overlapping slots at the same time
+	FragCounter f;
+	const size_t thread_count = 8;
+	const size_t slots = 500;
+	std::vector<std::thread> threads;
+	for (size_t tt = 0; tt < thread_count; ++tt)
+	{
+		threads.emplace_back([&f, tt]() {
+			for (size_t ii = 0; ii < slots; ++ii)
+			{
+				f.incSlot((ii * 7 + tt) % slots);
+			}
+		});
+	}
+	for (auto& t : threads)
+	{
+		t.join();
+	}
+	BOOST_REQUIRE_EQUAL(f.nSlots(), slots);
+	BOOST_REQUIRE_EQUAL(f.count(), thread_count * slots);
+	BOOST_REQUIRE_EQUAL(f.minCount(), thread_count);
+}
+
+BOOST_AUTO_TEST_CASE(ContentionScaling)
+{
+	// Each thread counts its own slot, as the receiver threads of DataReceiverManager do. Throughput should grow
+	// with the number of threads; a shared lock on the hot path makes it fall instead. Timing depends on the load
+	// of the machine, so it is only reported; the test checks that no increment is lost.
+	const size_t increments = 5000000;
+	auto rate = [&](size_t thread_count) {
+		FragCounter f;
+		std::vector<std::thread> threads;
+		auto start = std::chrono::steady_clock::now();
+		for (size_t tt = 0; tt < thread_count; ++tt)
+		{
+			threads.emplace_back([&f, tt, &increments]() {
+				for (size_t ii = 0; ii < increments; ++ii)
+				{
+					f.incSlot(tt);
+				}
+			});
+		}
+		for (auto& t : threads)
+		{
+			t.join();
+		}
+		auto elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::steady_clock::now() - start).count();
+		BOOST_REQUIRE_EQUAL(f.count(), thread_count * increments);
+		for (size_t tt = 0; tt < thread_count; ++tt)
+		{
+			BOOST_REQUIRE_EQUAL(f.slotCount(tt), increments);
+		}
+		return thread_count * increments / elapsed;
+	};
+
+	auto max_threads = std::max(1u, std::min(8u, std::thread::hardware_concurrency()));
+	auto single_rate = rate(1);
+	BOOST_TEST_MESSAGE("1 thread: " << single_rate << " increments/s");
+	for (size_t thread_count = 2; thread_count <= max_threads; thread_count *= 2)
+	{
+		auto multi_rate = rate(thread_count);
+		BOOST_TEST_MESSAGE(thread_count << " threads: " << multi_rate << " increments/s, speedup " << multi_rate / single_rate);
+	}
+}
+
 BOOST_AUTO_TEST_SUITE_END()
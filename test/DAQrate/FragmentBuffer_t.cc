@@ -5,10 +5,14 @@
 
 #include "artdaq-core/Data/ContainerFragment.hh"
 #include "artdaq-core/Data/Fragment.hh"
+#include "artdaq-core/Utilities/TimeUtils.hh"
 #include "artdaq-core/Utilities/configureMessageFacility.hh"
 #include "artdaq/DAQrate/FragmentBuffer.hh"
+#include "artdaq/DAQrate/detail/RequestReceiver.hh"
 #include "artdaq/DAQrate/detail/RequestSender.hh"
 
+#include <condition_variable>
+#include <mutex>
 #include <thread>
 
 #define MESSAGEFACILITY_DEBUG true
@@ -2400,6 +2404,104 @@ BOOST_AUTO_TEST_CASE(WindowMode_RateTests_threaded)
 	TLOG(TLVL_INFO) << "WindowMode_RateTests_threaded test case END";
 }
 
+// Apply requests for the newest 1% of RATE_TEST_COUNT Fragments to a buffer of the given depth, returning the time taken
+// by applyRequests in seconds. With indexed lookups, this should barely depend on the depth.
+static double ApplyNewestRequests(std::string const& request_mode, size_t depth)
+{
+	fhicl::ParameterSet ps;
+	ps.put<int>("fragment_id", 1);
+	ps.put<artdaq::Fragment::timestamp_t>("request_window_offset", 0);
+	ps.put<artdaq::Fragment::timestamp_t>("request_window_width", 0);
+	ps.put<size_t>("data_buffer_depth_fragments", 2 * depth);
+	ps.put<bool>("circular_buffer_mode", false);
+	ps.put<bool>("receive_requests", true);
+	ps.put<std::string>("request_mode", request_mode);
+	ps.put<size_t>("missing_request_window_timeout_us", 500000);
+	ps.put<size_t>("window_close_timeout_us", 500000);
+
+	auto buffer = std::make_shared<artdaq::RequestBuffer>();
+	buffer->setRunning(true);
+	artdaqtest::FragmentBufferTestGenerator gen(ps);
+	artdaq::FragmentBuffer fp(ps);
+	fp.SetRequestBuffer(buffer);
+
+	auto beginop = std::chrono::steady_clock::now();
+	TLOG(TLVL_INFO) << "Generating/adding " << depth << " Fragments BEGIN";
+	fp.AddFragmentsToBuffer(gen.Generate(depth));
+	TLOG(TLVL_INFO) << "Generating/adding " << depth << " Fragments END. Time elapsed=" << artdaq::TimeUtils::GetElapsedTime(beginop)
+	                << " (" << depth / artdaq::TimeUtils::GetElapsedTime(beginop) << " frags/s)";
+
+	// Request only the newest data, so that each lookup has to skip over the whole depth of the buffer. In Window
+	// mode the requests carry consecutive Sequence IDs; in SequenceID mode they match the Fragments' Sequence IDs.
+	const size_t request_count = RATE_TEST_COUNT / 100;
+	bool window = request_mode == "window";
+	for (size_t ii = 1; ii <= request_count; ++ii)
+	{
+		auto ts = depth - request_count + ii;
+		buffer->push(window ? ii : ts, ts);
+	}
+
+	beginop = std::chrono::steady_clock::now();
+	TLOG(TLVL_INFO) << "Applying " << request_count << " requests to a buffer of depth " << depth << " BEGIN";
+	artdaq::FragmentPtrs fps;
+	auto sts = fp.applyRequests(fps);
+	auto elapsed = artdaq::TimeUtils::GetElapsedTime(beginop);
+	TLOG(TLVL_INFO) << "Applying requests END. Time elapsed=" << elapsed << " (" << request_count / elapsed << " reqs/s)";
+	TRACE_REQUIRE_EQUAL(sts, true);
+	TRACE_REQUIRE_EQUAL(fps.size(), request_count);
+
+	auto type = artdaq::Fragment::FirstUserFragmentType;
+	artdaq::Fragment::timestamp_t ts = depth - request_count + 1;
+	for (auto& frag : fps)
+	{
+		TRACE_REQUIRE_EQUAL(frag->timestamp(), ts);
+		if (window)
+		{
+			auto cf = artdaq::ContainerFragment(*frag);
+			TRACE_REQUIRE_EQUAL(cf.block_count(), 1);
+			TRACE_REQUIRE_EQUAL(cf.missing_data(), false);
+			TRACE_REQUIRE_EQUAL(cf.fragment_type(), type);
+			TRACE_REQUIRE_EQUAL(cf.at(0)->timestamp(), ts);
+		}
+		else
+		{
+			TRACE_REQUIRE_EQUAL(frag->sequenceID(), ts);
+		}
+		++ts;
+	}
+	if (window)
+	{
+		TRACE_REQUIRE_EQUAL(fp.GetNextSequenceID(), request_count + 1);
+	}
+	return elapsed;
+}
+
+// A buffer ten times as deep should not make requests much slower. A linear search would take about ten times as
+// long; the bound is loose (and has a small absolute allowance) so that a busy machine does not fail the test.
+static void CheckDeepBufferScaling(std::string const& request_mode)
+{
+	auto base_time = ApplyNewestRequests(request_mode, RATE_TEST_COUNT / 10);
+	auto deep_time = ApplyNewestRequests(request_mode, RATE_TEST_COUNT);
+	TLOG(TLVL_INFO) << "Request time at depth " << RATE_TEST_COUNT / 10 << ": " << base_time << " s, at depth " << RATE_TEST_COUNT << ": " << deep_time << " s";
+	BOOST_REQUIRE_LT(deep_time, 4 * base_time + 0.01);
+}
+
+BOOST_AUTO_TEST_CASE(WindowMode_DeepBuffer_RateTests)
+{
+	artdaq::configureMessageFacility("FragmentBuffer_t", true, MESSAGEFACILITY_DEBUG);
+	TLOG(TLVL_INFO) << "WindowMode_DeepBuffer_RateTests test case BEGIN";
+	CheckDeepBufferScaling("window");
+	TLOG(TLVL_INFO) << "WindowMode_DeepBuffer_RateTests test case END";
+}
+
+BOOST_AUTO_TEST_CASE(SequenceIDMode_DeepBuffer_RateTests)
+{
+	artdaq::configureMessageFacility("FragmentBuffer_t", true, MESSAGEFACILITY_DEBUG);
+	TLOG(TLVL_INFO) << "SequenceIDMode_DeepBuffer_RateTests test case BEGIN";
+	CheckDeepBufferScaling("SequenceID");
+	TLOG(TLVL_INFO) << "SequenceIDMode_DeepBuffer_RateTests test case END";
+}
+
 BOOST_AUTO_TEST_CASE(WaitForDataBufferReady_RaceCondition)
 {
 	artdaq::configureMessageFacility("FragmentBuffer_t", true, MESSAGEFACILITY_DEBUG);
@@ -2456,4 +2558,82 @@ BOOST_AUTO_TEST_CASE(WaitForDataBufferReady_RaceCondition)
 	TLOG(TLVL_INFO) << "WaitForDataBufferReady_RaceCondition test case END";
 }
 
+BOOST_AUTO_TEST_CASE(RequestTurnaround)
+{
+	artdaq::configureMessageFacility("FragmentBuffer_t", true, MESSAGEFACILITY_DEBUG);
+	TLOG(TLVL_INFO) << "RequestTurnaround test case BEGIN";
+	const int REQUEST_PORT = (seedAndRandom() % (32768 - 1024)) + 1024;
+	const size_t REQUEST_COUNT = 200;
+	fhicl::ParameterSet ps;
+	ps.put<int>("fragment_id", 1);
+	ps.put<bool>("receive_requests", true);
+	ps.put<std::string>("request_mode", "SequenceID");
+	ps.put<int>("request_port", REQUEST_PORT);
+	ps.put<std::string>("request_address", "localhost");
+	ps.put<bool>("send_requests", true);
+	ps.put<size_t>("request_delay_ms", 0);
+	ps.put<size_t>("min_request_interval_ms", 0);
+	ps.put<size_t>("request_snapshot_interval_ms", 0);
+
+	auto buffer = std::make_shared<artdaq::RequestBuffer>();
+	artdaq::RequestReceiver receiver(ps, buffer);
+	artdaq::RequestSender sender(ps);
+	artdaqtest::FragmentBufferTestGenerator gen(ps);
+	artdaq::FragmentBuffer fp(ps);
+	fp.SetRequestBuffer(buffer);
+
+	receiver.startRequestReception();
+	while (!buffer->isRunning())
+	{
+		usleep(1000);
+	}
+	fp.AddFragmentsToBuffer(gen.Generate(REQUEST_COUNT));
+
+	std::mutex reply_mutex;
+	std::condition_variable reply_cv;
+	size_t replies = 0;
+	std::atomic<bool> stop = false;
+	std::thread apply_requests([&]() {
+		while (!stop)
+		{
+			artdaq::FragmentPtrs fps;
+			fp.applyRequests(fps);
+			if (!fps.empty())
+			{
+				std::lock_guard<std::mutex> lk(reply_mutex);
+				replies += fps.size();
+				reply_cv.notify_all();
+			}
+		}
+	});
+
+	// Send one request at a time, so that each turnaround includes the wait in applyRequests
+	size_t total_us = 0;
+	size_t max_us = 0;
+	for (size_t ii = 1; ii <= REQUEST_COUNT; ++ii)
+	{
+		auto start = std::chrono::steady_clock::now();
+		sender.AddRequest(ii, ii);
+		{
+			std::unique_lock<std::mutex> lk(reply_mutex);
+			BOOST_REQUIRE(reply_cv.wait_for(lk, std::chrono::seconds(2), [&]() { return replies >= ii; }));
+		}
+		auto turnaround = artdaq::TimeUtils::GetElapsedTimeMicroseconds(start);
+		total_us += turnaround;
+		max_us = std::max(max_us, static_cast<size_t>(turnaround));
+		sender.RemoveRequest(ii);
+	}
+
+	stop = true;
+	fp.Stop();
+	apply_requests.join();
+	receiver.stopRequestReception(true);
+
+	TLOG(TLVL_INFO) << "Request turnaround: average " << total_us / REQUEST_COUNT << " us, max " << max_us << " us";
+	TRACE_REQUIRE_EQUAL(fp.GetNextSequenceID(), REQUEST_COUNT + 1);
+	BOOST_REQUIRE_LT(total_us / REQUEST_COUNT, 5000u);
+
+	TLOG(TLVL_INFO) << "RequestTurnaround test case END";
+}
+
 BOOST_AUTO_TEST_SUITE_END()
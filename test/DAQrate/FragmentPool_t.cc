@@ -0,0 +1,163 @@
+#include "artdaq/DAQdata/Globals.hh"
+#include "artdaq/DAQrate/FragmentPool.hh"
+
+#define BOOST_TEST_MODULE FragmentPool_t
+#include <boost/test/unit_test.hpp>
+
+#include "artdaq/DAQdata/HostMap.hh"
+#include "artdaq/DAQrate/DataSenderManager.hh"
+#include "artdaq/TransferPlugins/TCPSocketTransfer.hh"
+
+#include <cstdint>
+
+BOOST_AUTO_TEST_SUITE(FragmentPool_test)
+
+BOOST_AUTO_TEST_CASE(Reuse)
+{
+	artdaq::FragmentPool pool(4, 1024 * 1024);
+
+	auto frag = pool.Get(1000, 1, 2, artdaq::Fragment::FirstUserFragmentType, 3);
+	BOOST_REQUIRE_EQUAL(frag->dataSize(), 1000u);
+	BOOST_REQUIRE_EQUAL(pool.MissCount(), 1u);
+	auto address = frag.get();
+	auto payload = frag->dataBegin();
+	pool.Recycle(std::move(frag));
+	BOOST_REQUIRE_EQUAL(pool.IdleCount(), 1u);
+
+	// Same size class, smaller payload: the recycled Fragment and its memory are reused
+	frag = pool.Get(600, 4, 5, artdaq::Fragment::FirstUserFragmentType + 1, 6);
+	BOOST_REQUIRE_EQUAL(pool.HitCount(), 1u);
+	BOOST_REQUIRE_EQUAL(pool.IdleCount(), 0u);
+	BOOST_REQUIRE_EQUAL(frag.get(), address);
+	BOOST_REQUIRE_EQUAL(frag->dataBegin(), payload);
+	BOOST_REQUIRE_EQUAL(frag->dataSize(), 600u);
+	BOOST_REQUIRE_EQUAL(frag->sequenceID(), 4u);
+	BOOST_REQUIRE_EQUAL(frag->fragmentID(), 5);
+	BOOST_REQUIRE_EQUAL(frag->type(), artdaq::Fragment::FirstUserFragmentType + 1);
+	BOOST_REQUIRE_EQUAL(frag->timestamp(), 6u);
+
+	// After shrinking to 600 words, the Fragment can still be reused for the full size class
+	pool.Recycle(std::move(frag));
+	frag = pool.Get(1000, 7, 2);
+	BOOST_REQUIRE_EQUAL(pool.HitCount(), 2u);
+	BOOST_REQUIRE_EQUAL(frag.get(), address);
+	BOOST_REQUIRE_EQUAL(frag->dataSize(), 1000u);
+}
+
+BOOST_AUTO_TEST_CASE(MetadataIsCleared)
+{
+	artdaq::FragmentPool pool(4, 1024 * 1024);
+
+	auto frag = pool.Get(1000, 1, 2);
+	uint64_t metadata = 0x12345678;
+	frag->setMetadata(metadata);
+	BOOST_REQUIRE(frag->hasMetadata());
+	pool.Recycle(std::move(frag));
+
+	frag = pool.Get(1000, 3, 2);
+	BOOST_REQUIRE_EQUAL(pool.HitCount(), 1u);
+	BOOST_REQUIRE(!frag->hasMetadata());
+	BOOST_REQUIRE_EQUAL(frag->dataSize(), 1000u);
+	BOOST_REQUIRE_EQUAL(frag->sizeBytes(), artdaq::detail::RawFragmentHeader::num_words() * sizeof(artdaq::RawDataType) + 1000 * sizeof(artdaq::RawDataType));
+}
+
+BOOST_AUTO_TEST_CASE(SmallFragmentsAreNotPooled)
+{
+	artdaq::FragmentPool pool(4, 1024 * 1024);
+
+	auto frag = pool.Get(10, 1, 2);
+	BOOST_REQUIRE_EQUAL(frag->dataSize(), 10u);
+	pool.Recycle(std::move(frag));
+	BOOST_REQUIRE_EQUAL(pool.IdleCount(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(Bounds)
+{
+	artdaq::FragmentPool pool(2, 1024 * 1024);
+
+	// At most 2 Fragments per size class
+	artdaq::FragmentPtrs frags;
+	for (int ii = 0; ii < 3; ++ii)
+	{
+		frags.push_back(pool.Get(1000, ii, 1));
+	}
+	for (auto& frag : frags)
+	{
+		pool.Recycle(std::move(frag));
+	}
+	BOOST_REQUIRE_EQUAL(pool.IdleCount(), 2u);
+	BOOST_REQUIRE_EQUAL(pool.IdleBytes(), 2 * 1024 * sizeof(artdaq::RawDataType));
+
+	// A size class which would exceed the byte limit is not kept
+	auto large = pool.Get(1024 * 1024, 4, 1);
+	pool.Recycle(std::move(large));
+	BOOST_REQUIRE_EQUAL(pool.IdleCount(), 2u);
+}
+
+BOOST_AUTO_TEST_CASE(MovedFromFragment)
+{
+	artdaq::FragmentPool pool(4, 1024 * 1024);
+
+	auto frag = pool.Get(1000, 1, 2);
+	artdaq::Fragment sent(std::move(*frag));
+	BOOST_REQUIRE_EQUAL(sent.dataSize(), 1000u);
+	pool.Recycle(std::move(frag));
+	BOOST_REQUIRE_EQUAL(pool.IdleCount(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(ForeignFragment)
+{
+	artdaq::FragmentPool pool(4, 1024 * 1024);
+
+	// A Fragment which did not come from the pool is filed by its size
+	auto frag = std::make_unique<artdaq::Fragment>(1, 2);
+	frag->resize(3000);
+	auto address = frag.get();
+	pool.Recycle(std::move(frag));
+	BOOST_REQUIRE_EQUAL(pool.IdleCount(), 1u);
+
+	frag = pool.Get(2000, 3, 2);
+	BOOST_REQUIRE_EQUAL(pool.HitCount(), 1u);
+	BOOST_REQUIRE_EQUAL(frag.get(), address);
+	BOOST_REQUIRE_EQUAL(frag->dataSize(), 2000u);
+}
+
+// Sending a Fragment leaves its buffer with the caller, so that it can be recycled and reused for the next one
+BOOST_AUTO_TEST_CASE(RecycleAfterSend)
+{
+	my_rank = 0;
+	fhicl::ParameterSet transfer_pset;
+	transfer_pset.put("transferPluginType", "TCPSocket");
+	transfer_pset.put("source_rank", 0);
+	transfer_pset.put("destination_rank", 1);
+	transfer_pset.put("host_map", artdaq::MakeHostMapPset({{0, "localhost"}, {1, "localhost"}}));
+	artdaq::TCPSocketTransfer receiver(transfer_pset, artdaq::TransferInterface::Role::kReceive);
+
+	fhicl::ParameterSet destinations;
+	destinations.put("d1", transfer_pset);
+	fhicl::ParameterSet sender_pset;
+	sender_pset.put("destinations", destinations);
+	artdaq::DataSenderManager sender(sender_pset);
+
+	artdaq::FragmentPool pool(4, 1024 * 1024);
+	const size_t send_count = 5;
+	for (size_t ii = 1; ii <= send_count; ++ii)
+	{
+		auto frag = pool.Get(1000, ii, 0, artdaq::Fragment::FirstUserFragmentType, ii);
+		auto res = sender.sendFragment(std::move(*frag));
+		BOOST_REQUIRE_EQUAL(res.first, 1);
+		BOOST_REQUIRE(res.second == artdaq::TransferInterface::CopyStatus::kSuccess);
+		BOOST_REQUIRE(frag->headerAddress() != nullptr);
+
+		artdaq::Fragment received;
+		BOOST_REQUIRE_EQUAL(receiver.receiveFragment(received, 1000000), 0);
+		BOOST_REQUIRE_EQUAL(received.sequenceID(), ii);
+		BOOST_REQUIRE_EQUAL(received.dataSize(), 1000u);
+
+		pool.Recycle(std::move(frag));
+	}
+	BOOST_REQUIRE_EQUAL(pool.MissCount(), 1u);
+	BOOST_REQUIRE_EQUAL(pool.HitCount(), send_count - 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
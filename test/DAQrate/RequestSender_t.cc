@@ -4,9 +4,11 @@
 #include "tracemf.h"
 #define TRACE_NAME "RequestSender_t"
 
+#include "artdaq-core/Utilities/TimeUtils.hh"
 #include "artdaq-core/Utilities/configureMessageFacility.hh"
 #include "artdaq/DAQdata/TCPConnect.hh"
 #include "artdaq/DAQdata/TCP_listen_fd.hh"
+#include "artdaq/DAQrate/detail/RequestReceiver.hh"
 #include "artdaq/DAQrate/detail/RequestSender.hh"
 #include "artdaq/DAQrate/detail/RoutingPacket.hh"
 
@@ -127,6 +129,8 @@ BOOST_AUTO_TEST_CASE(Requests)
 			TRACE_REQUIRE_EQUAL(static_cast<uint8_t>(hdr_buffer.mode),
 			                    static_cast<uint8_t>(artdaq::detail::RequestMessageMode::Normal));
 			TRACE_REQUIRE_EQUAL(hdr_buffer.packet_count, 1);
+			TRACE_REQUIRE_EQUAL(hdr_buffer.message_sequence, 1);
+			TRACE_REQUIRE_EQUAL(hdr_buffer.lowest_active_sequence_id, 0);
 			if (hdr_buffer.isValid())
 			{
 				std::vector<artdaq::detail::RequestPacket> pkt_buffer(hdr_buffer.packet_count);
@@ -180,6 +184,7 @@ BOOST_AUTO_TEST_CASE(Requests)
 			TRACE_REQUIRE_EQUAL(static_cast<uint8_t>(hdr_buffer.mode),
 			                    static_cast<uint8_t>(artdaq::detail::RequestMessageMode::EndOfRun));
 			TRACE_REQUIRE_EQUAL(hdr_buffer.packet_count, 2);
+			TRACE_REQUIRE_EQUAL(hdr_buffer.lowest_active_sequence_id, 0);
 			if (hdr_buffer.isValid())
 			{
 				std::vector<artdaq::detail::RequestPacket> pkt_buffer(hdr_buffer.packet_count);
@@ -228,6 +233,7 @@ BOOST_AUTO_TEST_CASE(Requests)
 			TRACE_REQUIRE_EQUAL(static_cast<uint8_t>(hdr_buffer.mode),
 			                    static_cast<uint8_t>(artdaq::detail::RequestMessageMode::EndOfRun));
 			TRACE_REQUIRE_EQUAL(hdr_buffer.packet_count, 2);
+			TRACE_REQUIRE_EQUAL(hdr_buffer.lowest_active_sequence_id, 0);
 			if (hdr_buffer.isValid())
 			{
 				std::vector<artdaq::detail::RequestPacket> pkt_buffer(hdr_buffer.packet_count);
@@ -281,6 +287,7 @@ BOOST_AUTO_TEST_CASE(Requests)
 			TRACE_REQUIRE_EQUAL(static_cast<uint8_t>(hdr_buffer.mode),
 			                    static_cast<uint8_t>(artdaq::detail::RequestMessageMode::EndOfRun));
 			TRACE_REQUIRE_EQUAL(hdr_buffer.packet_count, 1);
+			TRACE_REQUIRE_EQUAL(hdr_buffer.lowest_active_sequence_id, 3);
 			if (hdr_buffer.isValid())
 			{
 				std::vector<artdaq::detail::RequestPacket> pkt_buffer(hdr_buffer.packet_count);
@@ -316,4 +323,180 @@ BOOST_AUTO_TEST_CASE(Requests)
 	artdaq::Globals::CleanUpGlobals();
 }
 
+BOOST_AUTO_TEST_CASE(RequestRate)
+{
+	artdaq::configureMessageFacility("RequestSender_t", true, true);
+	TLOG(TLVL_INFO) << "RequestRate Test Case BEGIN";
+	const int REQUEST_PORT = (seedAndRandom() % (32768 - 1024)) + 1024;
+	const int OUTSTANDING_REQUESTS = 10000;
+	const int TEST_REQUESTS = 1000;
+
+	fhicl::ParameterSet pset;
+	pset.put("request_port", REQUEST_PORT);
+	pset.put("request_delay_ms", 0);
+	pset.put("min_request_interval_ms", 0);
+	pset.put("request_snapshot_interval_ms", 0);
+	pset.put("send_requests", true);
+	pset.put("request_address", "localhost");
+	artdaq::RequestSender t(pset);
+
+	auto time_requests = [&](artdaq::Fragment::sequence_id_t first_seq) {
+		auto start_time = std::chrono::steady_clock::now();
+		for (artdaq::Fragment::sequence_id_t seq = first_seq; seq < first_seq + TEST_REQUESTS; ++seq)
+		{
+			t.AddRequest(seq, seq);
+		}
+		while (t.RequestsInFlight())
+		{
+			usleep(100);
+		}
+		return artdaq::TimeUtils::GetElapsedTime(start_time);
+	};
+
+	auto few_outstanding_time = time_requests(1);
+
+	for (artdaq::Fragment::sequence_id_t seq = TEST_REQUESTS + 1; seq <= TEST_REQUESTS + OUTSTANDING_REQUESTS; ++seq)
+	{
+		t.AddRequest(seq, seq);
+	}
+	while (t.RequestsInFlight())
+	{
+		usleep(100);
+	}
+	auto many_outstanding_time = time_requests(TEST_REQUESTS + OUTSTANDING_REQUESTS + 1);
+
+	TLOG(TLVL_INFO) << "Time per request with up to " << TEST_REQUESTS << " outstanding requests: " << few_outstanding_time / TEST_REQUESTS * 1e6
+	                << " us, with " << OUTSTANDING_REQUESTS << " outstanding requests: " << many_outstanding_time / TEST_REQUESTS * 1e6 << " us";
+	// Messages only contain new requests, so the cost per request should not depend on the number outstanding
+	BOOST_REQUIRE_LT(many_outstanding_time, 4 * few_outstanding_time + 0.05);
+
+	TLOG(TLVL_INFO) << "RequestRate Test Case END";
+}
+
+BOOST_AUTO_TEST_CASE(SnapshotRequest)
+{
+	artdaq::configureMessageFacility("RequestSender_t", true, true);
+	TLOG(TLVL_INFO) << "SnapshotRequest Test Case BEGIN";
+	const int REQUEST_PORT = (seedAndRandom() % (32768 - 1024)) + 1024;
+
+	fhicl::ParameterSet pset;
+	pset.put("request_port", REQUEST_PORT);
+	pset.put("request_delay_ms", 0);
+	pset.put("min_request_interval_ms", 0);
+	pset.put("request_snapshot_interval_ms", 0);
+	pset.put("send_requests", true);
+	pset.put("request_address", "localhost");
+	artdaq::RequestSender t(pset);
+
+	auto request_socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	struct sockaddr_in si_me_request;
+	memset(&si_me_request, 0, sizeof(si_me_request));
+	si_me_request.sin_family = AF_INET;
+	si_me_request.sin_port = htons(REQUEST_PORT);
+	si_me_request.sin_addr.s_addr = htonl(INADDR_ANY);
+	BOOST_REQUIRE_EQUAL(bind(request_socket, reinterpret_cast<struct sockaddr*>(&si_me_request), sizeof(si_me_request)), 0);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+
+	struct pollfd ufds[1];
+	ufds[0].fd = request_socket;
+	ufds[0].events = POLLIN | POLLPRI;
+	std::vector<uint8_t> buffer(MAX_REQUEST_MESSAGE_SIZE);
+	artdaq::detail::RequestHeader hdr_buffer;
+	struct sockaddr_in from;
+	socklen_t len = sizeof(from);
+
+	t.AddRequest(1, 0x10);
+	BOOST_REQUIRE_EQUAL(poll(ufds, 1, 1000), 1);
+	recvfrom(request_socket, &buffer[0], buffer.size(), 0, reinterpret_cast<struct sockaddr*>(&from), &len);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+	memcpy(&hdr_buffer, &buffer[0], sizeof(artdaq::detail::RequestHeader));
+	TRACE_REQUIRE_EQUAL(hdr_buffer.packet_count, 1);
+	TRACE_REQUIRE_EQUAL(hdr_buffer.message_sequence, 1);
+
+	// Only the new request is sent, until a receiver asks for a snapshot
+	t.AddRequest(2, 0x20);
+	BOOST_REQUIRE_EQUAL(poll(ufds, 1, 1000), 1);
+	recv(request_socket, &buffer[0], buffer.size(), 0);
+	memcpy(&hdr_buffer, &buffer[0], sizeof(artdaq::detail::RequestHeader));
+	TRACE_REQUIRE_EQUAL(hdr_buffer.packet_count, 1);
+	TRACE_REQUIRE_EQUAL(hdr_buffer.message_sequence, 2);
+
+	artdaq::detail::RequestMessage snapshot_request;
+	snapshot_request.setMode(artdaq::detail::RequestMessageMode::SnapshotRequest);
+	auto snapshot_request_buf = snapshot_request.GetMessage();
+	sendto(request_socket, &snapshot_request_buf[0], snapshot_request_buf.size(), 0, reinterpret_cast<struct sockaddr*>(&from), sizeof(from));  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+
+	BOOST_REQUIRE_EQUAL(poll(ufds, 1, 1000), 1);
+	recv(request_socket, &buffer[0], buffer.size(), 0);
+	memcpy(&hdr_buffer, &buffer[0], sizeof(artdaq::detail::RequestHeader));
+	TRACE_REQUIRE_EQUAL(hdr_buffer.packet_count, 2);
+	TRACE_REQUIRE_EQUAL(hdr_buffer.message_sequence, 3);
+	TRACE_REQUIRE_EQUAL(hdr_buffer.lowest_active_sequence_id, 1);
+
+	close(request_socket);
+	TLOG(TLVL_INFO) << "SnapshotRequest Test Case END";
+}
+
+BOOST_AUTO_TEST_CASE(ReceiveDeltas)
+{
+	artdaq::configureMessageFacility("RequestSender_t", true, true);
+	TLOG(TLVL_INFO) << "ReceiveDeltas Test Case BEGIN";
+	const int REQUEST_PORT = (seedAndRandom() % (32768 - 1024)) + 1024;
+
+	fhicl::ParameterSet pset;
+	pset.put("request_port", REQUEST_PORT);
+	pset.put("request_address", "localhost");
+	pset.put("receive_requests", true);
+	auto requests = std::make_shared<artdaq::RequestBuffer>();
+	artdaq::RequestReceiver r(pset, requests);
+	r.startRequestReception();
+	while (!requests->isRunning())
+	{
+		usleep(1000);
+	}
+
+	auto send_socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	struct sockaddr_in to;
+	BOOST_REQUIRE_EQUAL(ResolveHost("localhost", REQUEST_PORT, to), 0);
+	struct pollfd ufds[1];
+	ufds[0].fd = send_socket;
+	ufds[0].events = POLLIN | POLLPRI;
+
+	auto send_message = [&](uint32_t message_sequence, artdaq::Fragment::sequence_id_t lowest_active, artdaq::Fragment::sequence_id_t seq) {
+		artdaq::detail::RequestMessage message;
+		message.setRank(1);
+		message.setMessageSequence(message_sequence);
+		message.setLowestActiveSequenceID(lowest_active);
+		message.addRequest(seq, seq);
+		auto buf = message.GetMessage();
+		sendto(send_socket, &buf[0], buf.size(), 0, reinterpret_cast<struct sockaddr*>(&to), sizeof(to));  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+	};
+	auto snapshot_requested = [&]() {
+		if (poll(ufds, 1, 1000) != 1)
+		{
+			return false;
+		}
+		artdaq::detail::RequestHeader hdr;
+		recv(send_socket, &hdr, sizeof(hdr), 0);
+		return hdr.isValid() && hdr.mode == artdaq::detail::RequestMessageMode::SnapshotRequest;
+	};
+
+	// The receiver does not know what it missed before the first message
+	send_message(1, 1, 1);
+	BOOST_REQUIRE(snapshot_requested());
+	send_message(2, 1, 2);
+	BOOST_REQUIRE_EQUAL(poll(ufds, 1, 100), 0);
+	TRACE_REQUIRE_EQUAL(requests->size(), 2);
+
+	// Message 3 is lost. Message 4 moves the watermark past request 1
+	send_message(4, 2, 4);
+	BOOST_REQUIRE(snapshot_requested());
+	auto active = requests->GetRequests();
+	TRACE_REQUIRE_EQUAL(active.size(), 2);
+	TRACE_REQUIRE_EQUAL(active.count(2), 1);
+	TRACE_REQUIRE_EQUAL(active.count(4), 1);
+
+	close(send_socket);
+	r.stopRequestReception(true);
+	TLOG(TLVL_INFO) << "ReceiveDeltas Test Case END";
+}
+
 BOOST_AUTO_TEST_SUITE_END()
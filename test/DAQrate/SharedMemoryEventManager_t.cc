@@ -8,6 +8,9 @@
 #include "cetlib/quiet_unit_test.hpp"
 #include "cetlib_except/exception.h"
 
+#include <atomic>
+#include <chrono>
+#include <map>
 #include <thread>
 
 BOOST_AUTO_TEST_SUITE(SharedMemoryEventManager_test)
@@ -146,9 +149,11 @@ BOOST_AUTO_TEST_CASE(EndOfData)
 
 	memcpy(fragLoc3, frag->dataBegin(), 4 * sizeof(artdaq::RawDataType));
 	usleep(100000);
-	BOOST_REQUIRE_EQUAL(endComplete.load(), false);
+	// Assert only after join(): a failed assertion with the thread still running would end in std::terminate
+	auto completeBeforeWrite = endComplete.load();
 	t.DoneWritingFragment(hdr);
 	thread.join();
+	BOOST_REQUIRE_EQUAL(completeBeforeWrite, false);
 	BOOST_REQUIRE_EQUAL(endComplete.load(), true);
 	BOOST_REQUIRE_EQUAL(t.GetOpenEventCount(), 0);
 	BOOST_REQUIRE_EQUAL(t.GetArtEventCount(), 1);
@@ -492,4 +497,149 @@ BOOST_AUTO_TEST_CASE(RunNumbers)
 	TLOG(TLVL_INFO) << "Test RunNumbers END";
 }
 
+// Lookup of an open event by Sequence ID should not depend on the number of buffers
+BOOST_AUTO_TEST_CASE(SequenceIDLookupScaling)
+{
+	TLOG(TLVL_INFO) << "Test SequenceIDLookupScaling BEGIN";
+	const size_t lookups = 100000;
+	std::map<size_t, double> lookup_time_us;
+
+	for (size_t buffer_count : {10, 100, 1000, 10000})
+	{
+		fhicl::ParameterSet pset;
+		pset.put("use_art", false);
+		pset.put("buffer_count", buffer_count);
+		pset.put("max_event_size_bytes", 1000);
+		pset.put("expected_fragments_per_event", 2);
+		pset.put("stale_buffer_timeout_usec", 100000000);
+		artdaq::SharedMemoryEventManager t(pset, pset);
+		t.startRun(1);
+
+		artdaq::FragmentPtr frag(new artdaq::Fragment(1, 0, artdaq::Fragment::FirstUserFragmentType, 0UL));
+		frag->resize(4);
+
+		// Open one event in every buffer
+		for (size_t seq = 1; seq <= buffer_count; ++seq)
+		{
+			frag->setSequenceID(seq);
+			auto hdr = GetHeader(frag);
+			auto fragLoc = t.WriteFragmentHeader(hdr);
+			BOOST_REQUIRE(fragLoc != nullptr);
+			memcpy(fragLoc, frag->dataBegin(), 4 * sizeof(artdaq::RawDataType));
+			t.DoneWritingFragment(hdr);
+		}
+		BOOST_REQUIRE_EQUAL(t.GetOpenEventCount(), buffer_count);
+
+		size_t found = 0;
+		auto start = std::chrono::steady_clock::now();
+		for (size_t ii = 0; ii < lookups; ++ii)
+		{
+			found += t.GetFragmentCount(1 + (ii * 7919) % buffer_count);
+		}
+		lookup_time_us[buffer_count] = artdaq::TimeUtils::GetElapsedTimeMicroseconds(start) / static_cast<double>(lookups);
+		BOOST_REQUIRE_EQUAL(found, lookups);
+
+		TLOG(TLVL_INFO) << "SequenceIDLookupScaling: buffer_count=" << buffer_count << ", average lookup time " << lookup_time_us[buffer_count] << " us";
+		t.endOfData();
+	}
+
+	// A linear scan would be ~1000x slower at 10000 buffers than at 10; allow generous headroom for timing noise
+	BOOST_REQUIRE_LT(lookup_time_us[10000], 10 * lookup_time_us[10] + 1.0);
+	TLOG(TLVL_INFO) << "Test SequenceIDLookupScaling END";
+}
+
+// A receiver waiting for a free buffer should resume as soon as a slow reader releases one
+BOOST_AUTO_TEST_CASE(WaitForBuffer)
+{
+	TLOG(TLVL_INFO) << "Test WaitForBuffer BEGIN";
+	fhicl::ParameterSet pset;
+	pset.put("use_art", true);
+	pset.put("art_analyzer_count", 0);
+	pset.put("buffer_count", 1);
+	pset.put("max_event_size_bytes", 1000);
+	pset.put("expected_fragments_per_event", 1);
+	artdaq::SharedMemoryEventManager t(pset, pset);
+	t.startRun(1);
+
+	artdaq::FragmentPtr frag(new artdaq::Fragment(1, 0, artdaq::Fragment::FirstUserFragmentType, 0UL));
+	frag->resize(4);
+	auto hdr = GetHeader(frag);
+	auto fragLoc = t.WriteFragmentHeader(hdr);
+	BOOST_REQUIRE(fragLoc != nullptr);
+	memcpy(fragLoc, frag->dataBegin(), 4 * sizeof(artdaq::RawDataType));
+	t.DoneWritingFragment(hdr);
+
+	frag->setSequenceID(2);
+	hdr = GetHeader(frag);
+	BOOST_REQUIRE(t.WriteFragmentHeader(hdr) == nullptr);
+	BOOST_REQUIRE_EQUAL(t.WaitForBuffer(2, 10000), false);
+
+	// Boost.Test assertions may only be made on the main thread, and only once the reader has been joined
+	std::atomic<int64_t> release_time_us{0};
+	std::atomic<bool> ready_for_read{false};
+	std::thread reader([&] {
+		artdaq::SharedMemoryEventReceiver r(t.GetKey(), t.GetBroadcastKey());
+		artdaq::detail::ShmemWakeup wakeup(t.GetKey(), false);
+		usleep(200000);
+		bool errflag = false;
+		ready_for_read = r.ReadyForRead();
+		if (!ready_for_read)
+		{
+			return;
+		}
+		r.ReadHeader(errflag);
+		release_time_us = artdaq::TimeUtils::gettimeofday_us();
+		r.ReleaseBuffer();
+		wakeup.NotifySpace();
+	});
+
+	auto buffer_available = t.WaitForBuffer(2, 5000000);
+	auto wake_time_us = static_cast<int64_t>(artdaq::TimeUtils::gettimeofday_us());
+	reader.join();
+	BOOST_REQUIRE(ready_for_read.load());
+	BOOST_REQUIRE(buffer_available);
+	TLOG(TLVL_INFO) << "WaitForBuffer returned " << wake_time_us - release_time_us << " us after the buffer was released";
+	BOOST_REQUIRE_LT(wake_time_us - release_time_us, 20000);
+	BOOST_REQUIRE(t.WriteFragmentHeader(hdr) != nullptr);
+	TLOG(TLVL_INFO) << "Test WaitForBuffer END";
+}
+
+// "sleep" stands in for art. It never attaches to shared memory, so StartArtProcess waits its full 5 s timeout for it.
+BOOST_AUTO_TEST_CASE(PrestartArt)
+{
+	TLOG(TLVL_INFO) << "Test PrestartArt BEGIN";
+	fhicl::ParameterSet pset;
+	pset.put("use_art", true);
+	pset.put("art_analyzer_count", 1);
+	pset.put("art_command_line", "sleep 60");
+	pset.put("prestart_art_processes", true);
+	pset.put("buffer_count", 2);
+	pset.put("max_event_size_bytes", 1000);
+	pset.put("expected_fragments_per_event", 1);
+	pset.put("expected_art_event_processing_time_us", 1000);
+	pset.put("send_init_fragments", false);
+	artdaq::SharedMemoryEventManager t(pset, pset);
+
+	t.PrestartArt();
+	usleep(100000);
+	auto start = std::chrono::steady_clock::now();
+	t.startRun(1);
+	BOOST_REQUIRE_LT(artdaq::TimeUtils::GetElapsedTime(start), 2.0);
+	BOOST_REQUIRE_EQUAL(t.runID(), 1);
+	BOOST_REQUIRE(t.endOfData());
+
+	// A configuration change replaces the pre-started process with a newly started one
+	t.PrestartArt();
+	usleep(100000);
+	fhicl::ParameterSet art_pset = pset;
+	art_pset.put("changed", true);
+	t.UpdateArtConfiguration(art_pset);
+	start = std::chrono::steady_clock::now();
+	t.startRun(2);
+	BOOST_REQUIRE_GE(artdaq::TimeUtils::GetElapsedTime(start), 4.5);
+	BOOST_REQUIRE_EQUAL(t.runID(), 2);
+	BOOST_REQUIRE(t.endOfData());
+	TLOG(TLVL_INFO) << "Test PrestartArt END";
+}
+
 BOOST_AUTO_TEST_SUITE_END()
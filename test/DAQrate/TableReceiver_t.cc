@@ -0,0 +1,169 @@
+#define TRACE_NAME "TableReceiver_t"
+
+#include "artdaq/DAQdata/Globals.hh"
+#include "artdaq/DAQdata/TCPConnect.hh"
+#include "artdaq/DAQdata/TCP_listen_fd.hh"
+#include "artdaq/DAQrate/detail/RoutingPacket.hh"
+#include "artdaq/DAQrate/detail/TableReceiver.hh"
+
+#include "fhiclcpp/ParameterSet.h"
+
+#define BOOST_TEST_MODULE TableReceiver_t
+#include "cetlib/quiet_unit_test.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+const std::string multicast_address = "227.129.77.77";
+constexpr int events_per_update = 10;
+
+// Stands in for a RoutingManager publishing table updates on a multicast group
+class TablePublisher
+{
+public:
+	TablePublisher()
+	    : table_port_(static_cast<int>(seedAndRandom() % (32768 - 1024)) + 1024)
+	{
+		listen_fd_ = TCP_listen_fd(table_port_, 0);
+		BOOST_REQUIRE(listen_fd_ >= 0);
+
+		multicast_fd_ = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+		BOOST_REQUIRE(multicast_fd_ >= 0);
+		BOOST_REQUIRE(ResolveHost(multicast_address.c_str(), multicast_port(), multicast_addr_) != -1);
+		in_addr loopback;
+		inet_aton("127.0.0.1", &loopback);
+		BOOST_REQUIRE(setsockopt(multicast_fd_, IPPROTO_IP, IP_MULTICAST_IF, &loopback, sizeof(loopback)) == 0);
+	}
+
+	~TablePublisher()
+	{
+		if (table_fd_ != -1)
+		{
+			close(table_fd_);
+		}
+		close(multicast_fd_);
+		close(listen_fd_);
+	}
+
+	int table_port() const { return table_port_; }
+	int multicast_port() const { return table_port_ + 1; }
+
+	// Accepts the TableReceiver's table connection and reads its Connect request
+	void accept_table_receiver()
+	{
+		pollfd pfd{listen_fd_, POLLIN, 0};
+		BOOST_REQUIRE_EQUAL(poll(&pfd, 1, 5000), 1);
+		table_fd_ = accept(listen_fd_, nullptr, nullptr);
+		BOOST_REQUIRE(table_fd_ >= 0);
+		auto request = read_request();
+		BOOST_REQUIRE(request.mode == artdaq::detail::RoutingRequest::RequestMode::Connect);
+	}
+
+	artdaq::detail::RoutingRequest read_request() const
+	{
+		pollfd pfd{table_fd_, POLLIN, 0};
+		BOOST_REQUIRE_EQUAL(poll(&pfd, 1, 5000), 1);
+		artdaq::detail::RoutingRequest request;
+		BOOST_REQUIRE_EQUAL(recv(table_fd_, &request, sizeof(request), MSG_WAITALL), static_cast<ssize_t>(sizeof(request)));
+		BOOST_REQUIRE_EQUAL(request.header, ROUTING_MAGIC);
+		return request;
+	}
+
+	// Update n routes events_per_update events to rank n
+	std::vector<uint8_t> encode_update(uint64_t n) const
+	{
+		artdaq::detail::RoutingPacketHeader hdr(events_per_update, 1);
+		artdaq::detail::RoutingPacketRange range((n - 1) * events_per_update + 1, events_per_update, static_cast<int>(n));
+		std::vector<uint8_t> message(sizeof(hdr) + sizeof(range));
+		memcpy(message.data(), &hdr, sizeof(hdr));
+		memcpy(message.data() + sizeof(hdr), &range, sizeof(range));  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		return message;
+	}
+
+	void publish(uint64_t n)
+	{
+		artdaq::detail::RoutingTableUpdateHeader update_hdr(n);
+		auto message = encode_update(n);
+		std::vector<uint8_t> datagram(sizeof(update_hdr));
+		memcpy(datagram.data(), &update_hdr, sizeof(update_hdr));
+		datagram.insert(datagram.end(), message.begin(), message.end());
+		BOOST_REQUIRE_EQUAL(sendto(multicast_fd_, datagram.data(), datagram.size(), 0, reinterpret_cast<sockaddr*>(&multicast_addr_), sizeof(multicast_addr_)),  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+		                    static_cast<ssize_t>(datagram.size()));
+	}
+
+	void resend(uint64_t n)
+	{
+		auto message = encode_update(n);
+		BOOST_REQUIRE_EQUAL(write(table_fd_, message.data(), message.size()), static_cast<ssize_t>(message.size()));
+	}
+
+private:
+	TablePublisher(TablePublisher const&) = delete;
+	TablePublisher(TablePublisher&&) = delete;
+	TablePublisher& operator=(TablePublisher const&) = delete;
+	TablePublisher& operator=(TablePublisher&&) = delete;
+
+	int table_port_;
+	int listen_fd_{-1};
+	int table_fd_{-1};
+	int multicast_fd_{-1};
+	sockaddr_in multicast_addr_;
+};
+
+fhicl::ParameterSet make_pset(TablePublisher const& publisher)
+{
+	fhicl::ParameterSet pset;
+	pset.put("use_routing_manager", true);
+	pset.put("table_update_port", publisher.table_port());
+	pset.put("routing_manager_hostname", "localhost");
+	pset.put("routing_timeout_ms", 5000);
+	pset.put("table_update_multicast", true);
+	pset.put("table_update_multicast_address", multicast_address);
+	pset.put("table_update_multicast_port", publisher.multicast_port());
+	pset.put("multicast_interface_ip", "127.0.0.1");
+	return pset;
+}
+}  // namespace
+
+BOOST_AUTO_TEST_SUITE(TableReceiver_test)
+
+BOOST_AUTO_TEST_CASE(MulticastGapRecovery)
+{
+	TLOG(TLVL_INFO) << "MulticastGapRecovery Test Case BEGIN";
+	TablePublisher publisher;
+	artdaq::TableReceiver receiver(make_pset(publisher));
+	publisher.accept_table_receiver();
+
+	// Update 2 is lost; the receiver must ask for it again over its table connection when update 3 arrives
+	publisher.publish(1);
+	publisher.publish(3);
+	auto request = publisher.read_request();
+	BOOST_REQUIRE(request.mode == artdaq::detail::RoutingRequest::RequestMode::Resend);
+	BOOST_REQUIRE_EQUAL(request.sequence_id, 2u);
+	publisher.resend(2);
+
+	for (artdaq::Fragment::sequence_id_t seq = 1; seq <= 3 * events_per_update; ++seq)
+	{
+		BOOST_REQUIRE_EQUAL(receiver.GetRoutingTableEntry(seq), static_cast<int>((seq - 1) / events_per_update + 1));
+	}
+	BOOST_REQUIRE_EQUAL(receiver.GetMissedTableUpdateCount(), 1u);
+	BOOST_REQUIRE_EQUAL(receiver.GetRoutingTableEntryCount(), 3u * events_per_update);
+
+	// A late or duplicate update is applied without being counted as a gap
+	publisher.publish(2);
+	publisher.publish(4);
+	BOOST_REQUIRE_EQUAL(receiver.GetRoutingTableEntry(4 * events_per_update), 4);
+	BOOST_REQUIRE_EQUAL(receiver.GetMissedTableUpdateCount(), 1u);
+
+	receiver.StopTableReceiver();
+	TLOG(TLVL_INFO) << "MulticastGapRecovery Test Case END";
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -1,15 +1,22 @@
+#include "artdaq/DAQdata/Globals.hh"
 #define TRACE_NAME "TokenSender_t"
 
 #include "artdaq/DAQrate/detail/TokenSender.hh"
 
 #define BOOST_TEST_MODULE TokenSender_t
 #include <sys/poll.h>
+#include "artdaq-core/Utilities/TimeUtils.hh"
+#include "artdaq-core/Utilities/configureMessageFacility.hh"
 #include "artdaq/DAQdata/TCPConnect.hh"
 #include "artdaq/DAQdata/TCP_listen_fd.hh"
 #include "artdaq/DAQrate/detail/RoutingPacket.hh"
 #include "cetlib/quiet_unit_test.hpp"
 #include "cetlib_except/exception.h"
 
+#include <chrono>
+#include <map>
+#include <utility>
+
 BOOST_AUTO_TEST_SUITE(TokenSender_test)
 
 #define TRACE_REQUIRE_EQUAL(l, r)                                                                                                    \
@@ -47,11 +54,10 @@ BOOST_AUTO_TEST_CASE(Tokens)
 	TLOG(TLVL_DEBUG) << "Opening token listener socket";
 	auto token_socket = TCP_listen_fd(TOKEN_PORT, 3 * sizeof(artdaq::detail::RoutingToken));
 
-	fhicl::ParameterSet token_pset;
-	token_pset.put("routing_token_port", TOKEN_PORT);
-	token_pset.put("use_routing_manager", true);
+	// TokenSender is constructed with the contents of routing_token_config, see SharedMemoryEventManager::startRun
 	fhicl::ParameterSet pset;
-	pset.put("routing_token_config", token_pset);
+	pset.put("routing_token_port", TOKEN_PORT);
+	pset.put("use_routing_manager", true);
 	artdaq::TokenSender t(pset);
 
 	my_rank = 0;
@@ -96,4 +102,104 @@ BOOST_AUTO_TEST_CASE(Tokens)
 	TLOG(TLVL_INFO) << "Tokens Test Case END";
 }
 
+// Returns whether data arrives on fd within timeout_ms
+static bool data_ready(int fd, int timeout_ms)
+{
+	pollfd ufd{fd, POLLIN, 0};
+	return poll(&ufd, 1, timeout_ms) > 0 && (ufd.revents & POLLIN) != 0;
+}
+
+BOOST_AUTO_TEST_CASE(BatchCount)
+{
+	artdaq::configureMessageFacility("TokenSender_t", true, true);
+	TLOG(TLVL_INFO) << "BatchCount Test Case BEGIN";
+	const int TOKEN_PORT = (seedAndRandom() % (32768 - 1024)) + 1024;
+	auto token_socket = TCP_listen_fd(TOKEN_PORT, 3 * sizeof(artdaq::detail::RoutingToken));
+	BOOST_REQUIRE(token_socket != -1);
+
+	fhicl::ParameterSet pset;
+	pset.put("routing_token_port", TOKEN_PORT);
+	pset.put("use_routing_manager", true);
+	pset.put("routing_token_batch_count", 10);
+	pset.put("routing_token_batch_timeout_us", 10000000);
+	artdaq::TokenSender t(pset);
+
+	sockaddr_in addr;
+	socklen_t arglen = sizeof(addr);
+	auto conn_sock = accept(token_socket, reinterpret_cast<struct sockaddr*>(&addr), &arglen);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+
+	// Below the batch count, nothing is sent until the (long) timeout
+	t.SendRoutingToken(3, 5, 1);
+	t.SendRoutingToken(3, 5, 1);
+	t.SendRoutingToken(3, 5, 1);
+	BOOST_REQUIRE(!data_ready(conn_sock, 200));
+
+	// Reaching the batch count sends all pending slots as one token
+	t.SendRoutingToken(3, 5, 1);
+	BOOST_REQUIRE(data_ready(conn_sock, 2000));
+
+	artdaq::detail::RoutingToken buff;
+	auto sts = read(conn_sock, &buff, sizeof(artdaq::detail::RoutingToken));
+	TRACE_REQUIRE_EQUAL(sts, sizeof(artdaq::detail::RoutingToken));
+	TRACE_REQUIRE_EQUAL(buff.header, TOKEN_MAGIC);
+	TRACE_REQUIRE_EQUAL(buff.new_slots_free, 12);
+	TRACE_REQUIRE_EQUAL(buff.run_number, 5);
+	TRACE_REQUIRE_EQUAL(buff.rank, 1);
+	BOOST_REQUIRE_EQUAL(t.GetSentTokenCount(), 12);
+	BOOST_REQUIRE(!data_ready(conn_sock, 200));
+
+	close(conn_sock);
+	close(token_socket);
+	TLOG(TLVL_INFO) << "BatchCount Test Case END";
+}
+
+BOOST_AUTO_TEST_CASE(BatchTimeout)
+{
+	artdaq::configureMessageFacility("TokenSender_t", true, true);
+	TLOG(TLVL_INFO) << "BatchTimeout Test Case BEGIN";
+	const int TOKEN_PORT = (seedAndRandom() % (32768 - 1024)) + 1024;
+	auto token_socket = TCP_listen_fd(TOKEN_PORT, 3 * sizeof(artdaq::detail::RoutingToken));
+	BOOST_REQUIRE(token_socket != -1);
+
+	fhicl::ParameterSet pset;
+	pset.put("routing_token_port", TOKEN_PORT);
+	pset.put("use_routing_manager", true);
+	pset.put("routing_token_batch_count", 1000);
+	pset.put("routing_token_batch_timeout_us", 300000);
+	artdaq::TokenSender t(pset);
+
+	sockaddr_in addr;
+	socklen_t arglen = sizeof(addr);
+	auto conn_sock = accept(token_socket, reinterpret_cast<struct sockaddr*>(&addr), &arglen);  // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+
+	// Slots are coalesced per (run, rank) until the timeout expires
+	auto start = std::chrono::steady_clock::now();
+	t.SendRoutingToken(1, 7, 1);
+	t.SendRoutingToken(1, 7, 2);
+	t.SendRoutingToken(1, 7, 1);
+	t.SendRoutingToken(2, 8, 1);
+	t.SendRoutingToken(1, 7, 2);
+	BOOST_REQUIRE(data_ready(conn_sock, 5000));
+	BOOST_REQUIRE_GE(artdaq::TimeUtils::GetElapsedTime(start), 0.25);
+
+	std::map<std::pair<int, int>, unsigned> received;  // (run, rank) -> slots
+	for (int ii = 0; ii < 3; ++ii)
+	{
+		artdaq::detail::RoutingToken buff;
+		auto sts = read(conn_sock, &buff, sizeof(artdaq::detail::RoutingToken));
+		TRACE_REQUIRE_EQUAL(sts, sizeof(artdaq::detail::RoutingToken));
+		TRACE_REQUIRE_EQUAL(buff.header, TOKEN_MAGIC);
+		received[std::make_pair(static_cast<int>(buff.run_number), static_cast<int>(buff.rank))] += buff.new_slots_free;
+	}
+	BOOST_REQUIRE_EQUAL(received.size(), 3);
+	BOOST_REQUIRE_EQUAL((received[std::make_pair(7, 1)]), 2);
+	BOOST_REQUIRE_EQUAL((received[std::make_pair(7, 2)]), 2);
+	BOOST_REQUIRE_EQUAL((received[std::make_pair(8, 1)]), 2);
+	BOOST_REQUIRE(!data_ready(conn_sock, 200));
+
+	close(conn_sock);
+	close(token_socket);
+	TLOG(TLVL_INFO) << "BatchTimeout Test Case END";
+}
+
 BOOST_AUTO_TEST_SUITE_END()
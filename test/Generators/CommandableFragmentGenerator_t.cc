@@ -8,7 +8,10 @@
 #include "artdaq-core/Data/Fragment.hh"
 #include "artdaq-core/Utilities/configureMessageFacility.hh"
 #include "artdaq/DAQdata/Globals.hh"
+#include "artdaq/DAQdata/HostMap.hh"
+#include "artdaq/DAQrate/DataSenderManager.hh"
 #include "artdaq/Generators/CommandableFragmentGenerator.hh"
+#include "artdaq/TransferPlugins/TCPSocketTransfer.hh"
 
 #define TRACE_REQUIRE_EQUAL(l, r)                                                                                                    \
 	do                                                                                                                               \
@@ -67,7 +70,8 @@ protected:
 	 * \param frags FragmentPtrs list that new Fragments should be added to
 	 * \return True if data was generated
 	 *
-	 * CommandableFragmentGeneratorTest merely default-constructs Fragments, emplacing them on the frags list.
+	 * CommandableFragmentGeneratorTest merely allocates Fragments of payload_words words with AllocateFragment, emplacing
+	 * them on the frags list.
 	 */
 	bool getNext_(artdaq::FragmentPtrs& frags) override;
 
@@ -141,6 +145,7 @@ private:
 	artdaq::Fragment::timestamp_t ts_;
 	std::atomic<bool> hw_stop_;
 	std::atomic<uint64_t> enabled_ids_;
+	size_t payload_words_;
 };
 
 artdaqtest::CommandableFragmentGeneratorTest::CommandableFragmentGeneratorTest(const fhicl::ParameterSet& ps)
@@ -150,6 +155,7 @@ artdaqtest::CommandableFragmentGeneratorTest::CommandableFragmentGeneratorTest(c
     , ts_(0)
     , hw_stop_(false)
     , enabled_ids_(-1)
+    , payload_words_(ps.get<size_t>("payload_words", 0))
 {
 	metricMan->initialize(ps.get<fhicl::ParameterSet>("metrics", fhicl::ParameterSet()));
 	metricMan->do_start();
@@ -165,7 +171,7 @@ bool artdaqtest::CommandableFragmentGeneratorTest::getNext_(artdaq::FragmentPtrs
 			if (id < 64 && ((enabled_ids_ & (0x1 << id)) != 0))
 			{
 				TLOG(TLVL_DEBUG) << "Adding Fragment with ID " << id << ", SeqID " << ev_counter() << ", and timestamp " << ts_;
-				frags.emplace_back(new artdaq::Fragment(ev_counter(), id, artdaq::Fragment::FirstUserFragmentType, ts_));
+				frags.emplace_back(AllocateFragment(payload_words_, ev_counter(), id, artdaq::Fragment::FirstUserFragmentType, ts_));
 			}
 		}
 		fireCount_--;
@@ -438,4 +444,63 @@ BOOST_AUTO_TEST_CASE(HardwareFailure_Threaded)
 	TLOG(TLVL_INFO) << "HardwareFailure_Threaded test case END";
 }
 
+// Fragments sent the way BoardReaderCore sends them are recycled, and the generator's next Fragment reuses their memory
+BOOST_AUTO_TEST_CASE(FragmentPool)
+{
+	artdaq::configureMessageFacility("CommandableFragmentGenerator_t");
+	TLOG(TLVL_INFO) << "FragmentPool test case BEGIN";
+	my_rank = 0;
+	fhicl::ParameterSet transfer_pset;
+	transfer_pset.put("transferPluginType", "TCPSocket");
+	transfer_pset.put("source_rank", 0);
+	transfer_pset.put("destination_rank", 1);
+	transfer_pset.put("host_map", artdaq::MakeHostMapPset({{0, "localhost"}, {1, "localhost"}}));
+	artdaq::TCPSocketTransfer receiver(transfer_pset, artdaq::TransferInterface::Role::kReceive);
+
+	fhicl::ParameterSet destinations;
+	destinations.put("d1", transfer_pset);
+	fhicl::ParameterSet sender_pset;
+	sender_pset.put("destinations", destinations);
+	artdaq::DataSenderManager sender(sender_pset);
+
+	fhicl::ParameterSet ps;
+	ps.put<int>("board_id", 1);
+	ps.put<int>("fragment_id", 1);
+	ps.put<bool>("use_fragment_pool", true);
+	ps.put<size_t>("payload_words", 1000);
+	artdaqtest::CommandableFragmentGeneratorTest gen(ps);
+	gen.StartCmd(1, 1, 1);
+
+	artdaq::Fragment const* previous = nullptr;
+	for (artdaq::Fragment::sequence_id_t seq = 1; seq <= 5; ++seq)
+	{
+		gen.setFireCount(1);
+		artdaq::FragmentPtrs fps;
+		TRACE_REQUIRE(gen.getNext(fps));
+		TRACE_REQUIRE_EQUAL(fps.size(), 1u);
+		auto frag = std::move(fps.front());
+		TRACE_REQUIRE_EQUAL(frag->sequenceID(), seq);
+		TRACE_REQUIRE_EQUAL(frag->dataSize(), 1000u);
+		if (previous != nullptr)
+		{
+			TRACE_REQUIRE(frag.get() == previous);
+		}
+		previous = frag.get();
+
+		auto res = sender.sendFragment(std::move(*frag));
+		TRACE_REQUIRE_EQUAL(res.first, 1);
+		TRACE_REQUIRE(res.second == artdaq::TransferInterface::CopyStatus::kSuccess);
+		gen.RecycleFragment(std::move(frag));
+
+		artdaq::Fragment received;
+		TRACE_REQUIRE_EQUAL(receiver.receiveFragment(received, 1000000), 0);
+		TRACE_REQUIRE_EQUAL(received.sequenceID(), seq);
+		TRACE_REQUIRE_EQUAL(received.dataSize(), 1000u);
+	}
+
+	gen.StopCmd(0xFFFFFFFF, 1);
+	gen.joinThreads();
+	TLOG(TLVL_INFO) << "FragmentPool test case END";
+}
+
 BOOST_AUTO_TEST_SUITE_END()
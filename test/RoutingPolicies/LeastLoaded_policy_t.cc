@@ -0,0 +1,278 @@
+#define BOOST_TEST_MODULE LeastLoaded_policy_t
+#include <boost/test/unit_test.hpp>
+
+#include "artdaq/RoutingPolicies/RoutingManagerPolicy.hh"
+#include "artdaq/RoutingPolicies/makeRoutingManagerPolicy.hh"
+#include "fhiclcpp/ParameterSet.h"
+
+#include <algorithm>
+#include <deque>
+#include <limits>
+#include <map>
+#include <random>
+#include <vector>
+
+namespace {
+artdaq::detail::RoutingTokenLoad make_load(uint32_t free_buffers, uint32_t art_queue_depth, uint32_t build_latency_us = 1000)
+{
+	artdaq::detail::RoutingTokenLoad load;
+	load.free_buffers = free_buffers;
+	load.art_queue_depth = art_queue_depth;
+	load.build_latency_us = build_latency_us;
+	return load;
+}
+
+std::map<int, int> count_destinations(artdaq::detail::RoutingPacket const& table)
+{
+	std::map<int, int> output;
+	for (auto& entry : table)
+	{
+		output[entry.destination_rank]++;
+	}
+	return output;
+}
+
+// An EventBuilder in the simulation: a single art process working through complete events in order
+struct SimulatedEventBuilder
+{
+	int rank;
+	double mean_service_time_s;
+	std::deque<std::pair<double, double>> queue;  // (arrival time, service time) of each event in shared memory
+	double busy_until{std::numeric_limits<double>::infinity()};
+};
+
+/**
+ * Discrete-event model of a RoutingManager in front of heterogeneous EventBuilders.
+ * Events arrive as a Poisson process and are sent to the destination in the routing table, or wait for a route if
+ * they are ahead of it. Each EventBuilder frees a buffer, and sends its token and occupancy, when art finishes an event.
+ * Returns the 99th percentile of the time from arrival to the end of processing, in seconds.
+ */
+double simulate_p99_latency(std::string const& policy_name, fhicl::ParameterSet const& ps)
+{
+	const int fast_count = 4;
+	const int slow_count = 4;
+	const unsigned buffers = 20;
+	const double arrival_rate_hz = 1600;
+	const double table_interval_s = 0.001;
+	const size_t event_count = 20000;
+
+	auto policy = artdaq::makeRoutingManagerPolicy(policy_name, ps);
+	policy->Reset();
+
+	std::mt19937 engine(314159);
+	std::exponential_distribution<double> interarrival(arrival_rate_hz);
+	std::vector<SimulatedEventBuilder> ebs;
+	for (int ii = 0; ii < fast_count + slow_count; ++ii)
+	{
+		ebs.push_back(SimulatedEventBuilder{ii + 1, ii < fast_count ? 0.001 : 0.004, {}});
+		policy->UpdateReceiverLoad(ii + 1, make_load(buffers, 0, static_cast<uint32_t>(ebs.back().mean_service_time_s * 1000000)));
+		policy->AddReceiverToken(ii + 1, buffers);
+	}
+
+	std::vector<int> routes(event_count + 1, -1);
+	std::deque<std::pair<size_t, double>> unrouted;  // (sequence ID, arrival time) of events without a route yet
+	std::vector<double> latencies;
+
+	auto deliver = [&](size_t seq, double arrival, double now) {
+		auto& eb = ebs[routes[seq] - 1];
+		std::exponential_distribution<double> service(1.0 / eb.mean_service_time_s);
+		eb.queue.emplace_back(arrival, service(engine));
+		if (eb.queue.size() == 1)
+		{
+			eb.busy_until = now + eb.queue.front().second;
+		}
+	};
+
+	size_t next_arrival_seq = 1;
+	double next_arrival = interarrival(engine);
+	double next_table = 0.0;
+	while (latencies.size() < event_count)
+	{
+		auto next_completion = std::min_element(ebs.begin(), ebs.end(), [](auto const& lhs, auto const& rhs) { return lhs.busy_until < rhs.busy_until; });
+		auto arrival_time = next_arrival_seq <= event_count ? next_arrival : std::numeric_limits<double>::infinity();
+		auto now = std::min({arrival_time, next_table, next_completion->busy_until});
+
+		if (now == next_completion->busy_until)
+		{
+			auto& eb = *next_completion;
+			latencies.push_back(now - eb.queue.front().first);
+			eb.queue.pop_front();
+			eb.busy_until = eb.queue.empty() ? std::numeric_limits<double>::infinity() : now + eb.queue.front().second;
+			policy->UpdateReceiverLoad(eb.rank, make_load(buffers - eb.queue.size(), eb.queue.size(), static_cast<uint32_t>(eb.mean_service_time_s * 1000000)));
+			policy->AddReceiverToken(eb.rank, 1);
+		}
+		else if (now == next_table)
+		{
+			for (auto& entry : policy->GetCurrentTable())
+			{
+				if (entry.sequence_id <= event_count)
+				{
+					routes[entry.sequence_id] = entry.destination_rank;
+				}
+			}
+			while (!unrouted.empty() && routes[unrouted.front().first] != -1)
+			{
+				deliver(unrouted.front().first, unrouted.front().second, now);
+				unrouted.pop_front();
+			}
+			next_table += table_interval_s;
+		}
+		else
+		{
+			if (routes[next_arrival_seq] != -1 && unrouted.empty())
+			{
+				deliver(next_arrival_seq, now, now);
+			}
+			else
+			{
+				unrouted.emplace_back(next_arrival_seq, now);
+			}
+			++next_arrival_seq;
+			next_arrival += interarrival(engine);
+		}
+	}
+
+	std::sort(latencies.begin(), latencies.end());
+	return latencies[latencies.size() * 99 / 100];
+}
+}  // namespace
+
+BOOST_AUTO_TEST_SUITE(LeastLoaded_policy_t)
+
+BOOST_AUTO_TEST_CASE(Simple)
+{
+	TLOG(TLVL_INFO) << "LeastLoaded_policy_t Test Case Simple BEGIN";
+	fhicl::ParameterSet ps;
+	ps.put("choices", 0);
+
+	auto ll = artdaq::makeRoutingManagerPolicy("LeastLoaded", ps);
+
+	ll->Reset();
+	ll->UpdateReceiverLoad(1, make_load(10, 0, 1000));
+	ll->UpdateReceiverLoad(2, make_load(10, 0, 2500));
+	ll->AddReceiverToken(1, 4);
+	ll->AddReceiverToken(2, 4);
+	BOOST_REQUIRE_EQUAL(ll->GetReceiverCount(), 2);
+
+	// Each sequence ID goes to the receiver with the shortest expected delay, (outstanding + 1) * build latency
+	auto table = ll->GetCurrentTable();
+	std::vector<int> expected{1, 1, 2, 1, 1, 2, 2, 2};
+	BOOST_REQUIRE_EQUAL(table.size(), expected.size());
+	for (size_t ii = 0; ii < expected.size(); ++ii)
+	{
+		BOOST_REQUIRE_EQUAL(table[ii].destination_rank, expected[ii]);
+		BOOST_REQUIRE_EQUAL(table[ii].sequence_id, ii + 1);
+	}
+	BOOST_REQUIRE_EQUAL(ll->GetHeldTokenCount(), 0);
+
+	// Returned tokens complete outstanding sequence IDs: rank 1 now has 2 outstanding, rank 2 has 3
+	ll->AddReceiverToken(1, 2);
+	ll->AddReceiverToken(2, 1);
+	table = ll->GetCurrentTable();
+	BOOST_REQUIRE_EQUAL(table.size(), 3);
+	BOOST_REQUIRE_EQUAL(table[0].destination_rank, 1);
+	BOOST_REQUIRE_EQUAL(table[0].sequence_id, 9);
+	BOOST_REQUIRE_EQUAL(table[1].destination_rank, 1);
+	BOOST_REQUIRE_EQUAL(table[2].destination_rank, 2);
+
+	TLOG(TLVL_INFO) << "LeastLoaded_policy_t Test Case Simple END";
+}
+
+BOOST_AUTO_TEST_CASE(TieBreaking)
+{
+	TLOG(TLVL_INFO) << "LeastLoaded_policy_t Test Case TieBreaking BEGIN";
+	fhicl::ParameterSet ps;
+	ps.put("choices", 0);
+
+	auto ll = artdaq::makeRoutingManagerPolicy("LeastLoaded", ps);
+
+	ll->Reset();
+	ll->UpdateReceiverLoad(1, make_load(10, 3));
+	ll->UpdateReceiverLoad(2, make_load(10, 0));
+	ll->UpdateReceiverLoad(3, make_load(12, 3));
+	ll->AddReceiverToken(1, 1);
+	ll->AddReceiverToken(2, 1);
+	ll->AddReceiverToken(3, 1);
+
+	auto table = ll->GetCurrentTable();
+	BOOST_REQUIRE_EQUAL(table.size(), 3);
+	BOOST_REQUIRE_EQUAL(table[0].destination_rank, 3);
+	BOOST_REQUIRE_EQUAL(table[1].destination_rank, 2);
+	BOOST_REQUIRE_EQUAL(table[2].destination_rank, 1);
+
+	TLOG(TLVL_INFO) << "LeastLoaded_policy_t Test Case TieBreaking END";
+}
+
+BOOST_AUTO_TEST_CASE(MaxQueueDepth)
+{
+	TLOG(TLVL_INFO) << "LeastLoaded_policy_t Test Case MaxQueueDepth BEGIN";
+	fhicl::ParameterSet ps;
+	ps.put("max_queue_depth", 2);
+
+	auto ll = artdaq::makeRoutingManagerPolicy("LeastLoaded", ps);
+
+	ll->Reset();
+	ll->AddReceiverToken(1, 5);
+	ll->AddReceiverToken(2, 5);
+
+	// Each rank takes two sequence IDs; the other tokens are held
+	auto table = ll->GetCurrentTable();
+	BOOST_REQUIRE_EQUAL(table.size(), 4);
+	BOOST_REQUIRE_EQUAL(count_destinations(table)[1], 2);
+	BOOST_REQUIRE_EQUAL(count_destinations(table)[2], 2);
+	BOOST_REQUIRE_EQUAL(ll->GetHeldTokenCount(), 6);
+
+	auto route = ll->GetRouteForSequenceID(5, 0);
+	BOOST_REQUIRE_EQUAL(route.sequence_id, artdaq::Fragment::InvalidSequenceID);
+
+	// Rank 2 finishes an event
+	ll->AddReceiverToken(2, 1);
+	table = ll->GetCurrentTable();
+	BOOST_REQUIRE_EQUAL(table.size(), 1);
+	BOOST_REQUIRE_EQUAL(table[0].destination_rank, 2);
+	BOOST_REQUIRE_EQUAL(table[0].sequence_id, 5);
+	BOOST_REQUIRE_EQUAL(ll->GetHeldTokenCount(), 6);
+
+	TLOG(TLVL_INFO) << "LeastLoaded_policy_t Test Case MaxQueueDepth END";
+}
+
+BOOST_AUTO_TEST_CASE(WithoutLoadReports)
+{
+	TLOG(TLVL_INFO) << "LeastLoaded_policy_t Test Case WithoutLoadReports BEGIN";
+	fhicl::ParameterSet ps;
+	ps.put("choices", 0);
+
+	auto ll = artdaq::makeRoutingManagerPolicy("LeastLoaded", ps);
+
+	// Receivers which never report are balanced by the events routed to them
+	ll->Reset();
+	ll->AddReceiverToken(1, 6);
+	ll->AddReceiverToken(2, 2);
+	auto table = ll->GetCurrentTable();
+	BOOST_REQUIRE_EQUAL(table.size(), 8);
+	auto destinations = count_destinations(table);
+	BOOST_REQUIRE_EQUAL(destinations[1], 6);
+	BOOST_REQUIRE_EQUAL(destinations[2], 2);
+	BOOST_REQUIRE_EQUAL(count_destinations(artdaq::detail::RoutingPacket(table.begin(), table.begin() + 4))[2], 2);
+
+	TLOG(TLVL_INFO) << "LeastLoaded_policy_t Test Case WithoutLoadReports END";
+}
+
+BOOST_AUTO_TEST_CASE(HeterogeneousTailLatency)
+{
+	TLOG(TLVL_INFO) << "LeastLoaded_policy_t Test Case HeterogeneousTailLatency BEGIN";
+	fhicl::ParameterSet rr_ps;
+	auto rr_p99 = simulate_p99_latency("RoundRobin", rr_ps);
+
+	fhicl::ParameterSet ll_ps;
+	ll_ps.put("choices", 2);
+	ll_ps.put("max_queue_depth", 2);
+	auto ll_p99 = simulate_p99_latency("LeastLoaded", ll_ps);
+
+	BOOST_TEST_MESSAGE("99th percentile event latency with 4 fast and 4 slow EventBuilders: RoundRobin " << rr_p99 * 1000 << " ms, LeastLoaded " << ll_p99 * 1000 << " ms");
+	BOOST_REQUIRE_LT(ll_p99 * 1.5, rr_p99);
+
+	TLOG(TLVL_INFO) << "LeastLoaded_policy_t Test Case HeterogeneousTailLatency END";
+}
+
+BOOST_AUTO_TEST_SUITE_END()
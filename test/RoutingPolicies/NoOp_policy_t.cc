@@ -7,6 +7,9 @@
 #include "artdaq/RoutingPolicies/makeRoutingManagerPolicy.hh"
 #include "fhiclcpp/ParameterSet.h"
 
+#include <chrono>
+#include <map>
+
 BOOST_AUTO_TEST_SUITE(NoOp_policy_t)
 
 BOOST_AUTO_TEST_CASE(Simple)
@@ -184,4 +187,48 @@ BOOST_AUTO_TEST_CASE(RequestBasedEventBuilding)
 	TLOG(TLVL_INFO) << "NoOp_policy_t Test Case RequestBasedEventBuilding END";
 }
 
+BOOST_AUTO_TEST_CASE(Throughput)
+{
+	TLOG(TLVL_INFO) << "NoOp_policy_t Test Case Throughput BEGIN";
+	const int receivers = 32;
+	const size_t events = 1000000;
+	const size_t initial_tokens = 1000;
+
+	auto noop = artdaq::makeRoutingManagerPolicy("NoOp", fhicl::ParameterSet::make(""));
+	noop->Reset();
+
+	// Start of run: every receiver announces all of its buffers at once
+	auto start = std::chrono::steady_clock::now();
+	for (int rank = 0; rank < receivers; ++rank)
+	{
+		noop->AddReceiverToken(rank, initial_tokens);
+	}
+	auto firstTable = noop->GetCurrentTable();
+	BOOST_REQUIRE_EQUAL(firstTable.size(), receivers * initial_tokens);
+
+	// The initial tokens are interleaved, so every receiver is in the first part of the table
+	std::map<int, size_t> head;
+	for (size_t ii = 0; ii < firstTable.size() / 4; ++ii)
+	{
+		head[firstTable[ii].destination_rank]++;
+	}
+	BOOST_REQUIRE_EQUAL(head.size(), receivers);
+
+	size_t routed = firstTable.size();
+	for (size_t ii = routed; ii < events; ++ii)
+	{
+		noop->AddReceiverToken(ii % receivers, 1);
+		if (ii % 100 == 99)
+		{
+			routed += noop->GetCurrentTable().size();
+		}
+	}
+	routed += noop->GetCurrentTable().size();
+	double rate = events / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	BOOST_REQUIRE_EQUAL(routed, events);
+
+	BOOST_TEST_MESSAGE("NoOp with " << receivers << " receivers: " << rate / 1000000 << " M events/s in tables");
+	TLOG(TLVL_INFO) << "NoOp_policy_t Test Case Throughput END";
+}
+
 BOOST_AUTO_TEST_SUITE_END()
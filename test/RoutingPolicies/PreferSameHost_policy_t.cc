@@ -7,6 +7,9 @@
 #include "artdaq/RoutingPolicies/makeRoutingManagerPolicy.hh"
 #include "fhiclcpp/ParameterSet.h"
 
+#include <chrono>
+#include <string>
+
 BOOST_AUTO_TEST_SUITE(PreferSameHost_policy_t)
 
 BOOST_AUTO_TEST_CASE(Simple)
@@ -313,4 +316,39 @@ BOOST_AUTO_TEST_CASE(RequestBasedEventBuilding)
 	TLOG(TLVL_INFO) << "RoundRobin_policy_t Test Case RequestBasedEventBuilding END";
 }
 
+BOOST_AUTO_TEST_CASE(Throughput)
+{
+	const int receivers = 32;
+	const int senders = 32;
+	const size_t events = 1000000;
+
+	// Two receivers and two senders per host
+	std::string host_map = "host_map: [";
+	for (int rank = 0; rank < receivers + senders; ++rank)
+	{
+		host_map += "{rank: " + std::to_string(rank) + " host: \"testHost" + std::to_string(rank % (receivers / 2)) + "\"} ";
+	}
+	host_map += "]";
+	auto psh = artdaq::makeRoutingManagerPolicy("PreferSameHost", fhicl::ParameterSet::make("routing_manager_mode: RequestBasedEventBuilding " + host_map));
+	psh->Reset();
+
+	size_t routed = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (size_t ii = 0; ii < events; ++ii)
+	{
+		psh->AddReceiverToken(ii % receivers, 1);
+		auto route = psh->GetRouteForSequenceID(ii + 1, receivers + ii % senders);
+		BOOST_REQUIRE_NE(route.destination_rank, -1);
+		if (ii % 100 == 99)
+		{
+			routed += psh->GetCurrentTable().size();
+		}
+	}
+	double rate = events / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	BOOST_REQUIRE_EQUAL(routed, events);
+	BOOST_REQUIRE_LE(psh->GetCacheSize(), 1000);
+
+	BOOST_TEST_MESSAGE("PreferSameHost with " << receivers << " receivers: " << rate / 1000000 << " M events/s routed by sequence ID");
+}
+
 BOOST_AUTO_TEST_SUITE_END()
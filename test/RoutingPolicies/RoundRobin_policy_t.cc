@@ -5,6 +5,8 @@
 #include "artdaq/RoutingPolicies/makeRoutingManagerPolicy.hh"
 #include "fhiclcpp/ParameterSet.h"
 
+#include <chrono>
+
 BOOST_AUTO_TEST_SUITE(RoundRobin_policy_t)
 
 BOOST_AUTO_TEST_CASE(VerifyRMPSharedPtr)
@@ -323,4 +325,91 @@ BOOST_AUTO_TEST_CASE(RequestBasedEventBuilding)
 	TLOG(TLVL_INFO) << "RoundRobin_policy_t Test Case RequestBasedEventBuilding END";
 }
 
+BOOST_AUTO_TEST_CASE(EventBuildingTrimmedRoute)
+{
+	TLOG(TLVL_INFO) << "RoundRobin_policy_t Test Case EventBuildingTrimmedRoute BEGIN";
+	fhicl::ParameterSet ps = fhicl::ParameterSet::make("routing_cache_size: 2");
+
+	auto rr = artdaq::makeRoutingManagerPolicy("RoundRobin", ps);
+
+	rr->Reset();
+	rr->AddReceiverToken(1, 2);
+	rr->AddReceiverToken(2, 2);
+	auto table = rr->GetCurrentTable();
+	BOOST_REQUIRE_EQUAL(table.size(), 4);
+	BOOST_REQUIRE_EQUAL(rr->GetMaxNumberOfTokens(), 4);
+
+	// The cache keeps 4 times the largest number of tokens held, even though routing_cache_size is smaller
+	for (int ii = 0; ii < 10; ++ii)
+	{
+		rr->AddReceiverToken(1, 1);
+		rr->AddReceiverToken(2, 1);
+		table = rr->GetCurrentTable();
+		BOOST_REQUIRE_EQUAL(table.size(), 2);
+	}
+	BOOST_REQUIRE_EQUAL(table[1].sequence_id, 24);
+	BOOST_REQUIRE_EQUAL(rr->GetCacheSize(), 16);
+
+	// Sequence ID 9 is still cached
+	auto route = rr->GetRouteForSequenceID(9, 5);
+	BOOST_REQUIRE_EQUAL(route.sequence_id, 9);
+	BOOST_REQUIRE_EQUAL(route.destination_rank, 1);
+
+	// Sequence ID 8 was routed by a table and trimmed; it must not get a second route
+	rr->AddReceiverToken(1, 1);
+	rr->AddReceiverToken(2, 1);
+	route = rr->GetRouteForSequenceID(8, 5);
+	BOOST_REQUIRE_EQUAL(route.sequence_id, artdaq::Fragment::InvalidSequenceID);
+	BOOST_REQUIRE_EQUAL(route.destination_rank, -1);
+	BOOST_REQUIRE_EQUAL(rr->GetHeldTokenCount(), 2);
+	BOOST_REQUIRE(!rr->CacheHasRoute(8));
+
+	TLOG(TLVL_INFO) << "RoundRobin_policy_t Test Case EventBuildingTrimmedRoute END";
+}
+
+BOOST_AUTO_TEST_CASE(Throughput)
+{
+	TLOG(TLVL_INFO) << "RoundRobin_policy_t Test Case Throughput BEGIN";
+	const int receivers = 32;
+	const size_t events = 1000000;
+
+	// EventBuilding: one token per event, a table every 100 tokens
+	auto rr = artdaq::makeRoutingManagerPolicy("RoundRobin", fhicl::ParameterSet::make(""));
+	rr->Reset();
+	size_t routed = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (size_t ii = 0; ii < events; ++ii)
+	{
+		rr->AddReceiverToken(ii % receivers, 1);
+		if (ii % 100 == 99)
+		{
+			routed += rr->GetCurrentTable().size();
+		}
+	}
+	double table_rate = events / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	BOOST_REQUIRE_EQUAL(routed, events);
+
+	// DataFlow: two requests per sequence ID, the routing cache trimmed to its default size
+	rr = artdaq::makeRoutingManagerPolicy("RoundRobin", fhicl::ParameterSet::make("routing_manager_mode: DataFlow"));
+	rr->Reset();
+	for (int rank = 0; rank < receivers; ++rank)
+	{
+		rr->AddReceiverToken(rank, 2);  // A round needs a token from every receiver
+	}
+	routed = 0;
+	start = std::chrono::steady_clock::now();
+	for (size_t ii = 0; ii < events; ++ii)
+	{
+		rr->AddReceiverToken(ii % receivers, 2);
+		routed += rr->GetRouteForSequenceID(ii + 1, receivers).destination_rank != -1;
+		routed += rr->GetRouteForSequenceID(ii + 1, receivers + 1).destination_rank != -1;
+	}
+	double route_rate = events / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	BOOST_REQUIRE_EQUAL(routed, 2 * events);
+	BOOST_REQUIRE_LE(rr->GetCacheSize(), 1000);
+
+	BOOST_TEST_MESSAGE("RoundRobin with " << receivers << " receivers: " << table_rate / 1000000 << " M events/s in tables, " << route_rate / 1000000 << " M events/s routed by sequence ID");
+	TLOG(TLVL_INFO) << "RoundRobin_policy_t Test Case Throughput END";
+}
+
 BOOST_AUTO_TEST_SUITE_END()
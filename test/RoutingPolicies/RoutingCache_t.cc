@@ -0,0 +1,170 @@
+#define BOOST_TEST_MODULE RoutingCache_t
+#include <boost/test/unit_test.hpp>
+
+#include "artdaq/RoutingPolicies/RoutingCache.hh"
+
+BOOST_AUTO_TEST_SUITE(RoutingCache_t)
+
+// A cache trimmed to 4 sequence IDs has a ring of 16 slots
+BOOST_AUTO_TEST_CASE(SlideIntoOverflow)
+{
+	artdaq::RoutingCache cache(4);
+	for (artdaq::Fragment::sequence_id_t seq = 1; seq <= 10; ++seq)
+	{
+		cache.Insert(seq).emplace_back(seq, static_cast<int>(seq % 3), 100);
+	}
+	BOOST_REQUIRE_EQUAL(cache.Size(), 10);
+	BOOST_REQUIRE(cache.Find(11) == nullptr);
+	BOOST_REQUIRE(!cache.Contains(0));
+
+	// Sequence ID 30 moves the window to [15, 30]; 1 to 10 keep their routes below it
+	cache.Insert(30).emplace_back(30, 7, 100);
+	BOOST_REQUIRE_EQUAL(cache.Size(), 11);
+	for (artdaq::Fragment::sequence_id_t seq = 1; seq <= 10; ++seq)
+	{
+		BOOST_REQUIRE(cache.Contains(seq));
+		auto routes = cache.Find(seq);
+		BOOST_REQUIRE(routes != nullptr);
+		BOOST_REQUIRE_EQUAL(routes->size(), 1);
+		BOOST_REQUIRE_EQUAL(routes->front().sequence_id, seq);
+		BOOST_REQUIRE_EQUAL(routes->front().destination_rank, static_cast<int>(seq % 3));
+	}
+	BOOST_REQUIRE(cache.Contains(30));
+	BOOST_REQUIRE(!cache.Contains(14));
+	BOOST_REQUIRE(!cache.Contains(31));
+
+	// Inserting an existing sequence ID returns its routes
+	cache.Insert(5).emplace_back(5, 8, 101);
+	BOOST_REQUIRE_EQUAL(cache.Find(5)->size(), 2);
+	cache.Insert(30).emplace_back(30, 9, 101);
+	BOOST_REQUIRE_EQUAL(cache.Find(30)->size(), 2);
+	BOOST_REQUIRE_EQUAL(cache.Size(), 11);
+
+	// A jump far past the window moves everything below it
+	cache.Insert(1000);
+	BOOST_REQUIRE_EQUAL(cache.Size(), 12);
+	BOOST_REQUIRE_EQUAL(cache.Find(30)->size(), 2);
+	BOOST_REQUIRE(cache.Find(1000)->empty());
+}
+
+BOOST_AUTO_TEST_CASE(Trim)
+{
+	artdaq::RoutingCache cache(4);
+
+	// Sequential routes, trimmed after each one as RoutingManagerPolicy does, wrap around the ring
+	for (artdaq::Fragment::sequence_id_t seq = 1; seq <= 40; ++seq)
+	{
+		cache.Insert(seq).emplace_back(seq, 1, 100);
+		cache.Trim(4);
+		BOOST_REQUIRE_EQUAL(cache.Size(), std::min<size_t>(seq, 4));
+	}
+	for (artdaq::Fragment::sequence_id_t seq = 1; seq <= 40; ++seq)
+	{
+		BOOST_REQUIRE_EQUAL(cache.Contains(seq), seq > 36);
+	}
+
+	// The slots of trimmed sequence IDs are reused
+	cache.Insert(41).emplace_back(41, 2, 100);
+	cache.Trim(4);
+	BOOST_REQUIRE(!cache.Contains(37));
+	BOOST_REQUIRE(!cache.Contains(25));  // Same slot as 41
+	BOOST_REQUIRE_EQUAL(cache.Find(41)->size(), 1);
+
+	// Trimming removes overflow entries first, then continues into the ring
+	artdaq::RoutingCache mixed(4);
+	for (artdaq::Fragment::sequence_id_t seq = 1; seq <= 5; ++seq)
+	{
+		mixed.Insert(seq);
+	}
+	mixed.Insert(30);
+	mixed.Insert(28);
+	BOOST_REQUIRE_EQUAL(mixed.Size(), 7);
+	mixed.Trim(3);
+	BOOST_REQUIRE_EQUAL(mixed.Size(), 3);
+	BOOST_REQUIRE(!mixed.Contains(4));
+	BOOST_REQUIRE(mixed.Contains(5));
+	BOOST_REQUIRE(mixed.Contains(28));
+	mixed.Trim(1);
+	BOOST_REQUIRE_EQUAL(mixed.Size(), 1);
+	BOOST_REQUIRE(!mixed.Contains(5));
+	BOOST_REQUIRE(!mixed.Contains(28));
+	BOOST_REQUIRE(mixed.Contains(30));
+	mixed.Trim(0);
+	BOOST_REQUIRE_EQUAL(mixed.Size(), 0);
+	BOOST_REQUIRE(mixed.Find(30) == nullptr);
+
+	// The emptied cache can be refilled
+	mixed.Insert(31).emplace_back(31, 3, 100);
+	BOOST_REQUIRE_EQUAL(mixed.Size(), 1);
+	BOOST_REQUIRE_EQUAL(mixed.Find(31)->front().destination_rank, 3);
+}
+
+BOOST_AUTO_TEST_CASE(LateInserts)
+{
+	artdaq::RoutingCache cache(4);
+	for (artdaq::Fragment::sequence_id_t seq = 1; seq <= 40; ++seq)
+	{
+		cache.Insert(seq);
+		cache.Trim(4);
+	}
+
+	// Below the window: kept in the overflow map, and the first to be trimmed
+	cache.Insert(2).emplace_back(2, 5, 100);
+	BOOST_REQUIRE_EQUAL(cache.Size(), 5);
+	BOOST_REQUIRE_EQUAL(cache.Find(2)->front().destination_rank, 5);
+	cache.Trim(4);
+	BOOST_REQUIRE(!cache.Contains(2));
+	BOOST_REQUIRE(cache.Contains(37));
+
+	// Inside the window but below the lowest cached sequence ID: also the first to be trimmed
+	cache.Insert(30).emplace_back(30, 6, 100);
+	BOOST_REQUIRE_EQUAL(cache.Size(), 5);
+	BOOST_REQUIRE_EQUAL(cache.Find(30)->front().destination_rank, 6);
+	cache.Trim(4);
+	BOOST_REQUIRE(!cache.Contains(30));
+	for (artdaq::Fragment::sequence_id_t seq = 37; seq <= 40; ++seq)
+	{
+		BOOST_REQUIRE(cache.Contains(seq));
+	}
+
+	// Between cached sequence IDs
+	cache.Insert(45);
+	cache.Insert(43);
+	cache.Trim(4);
+	BOOST_REQUIRE_EQUAL(cache.Size(), 4);
+	BOOST_REQUIRE(!cache.Contains(38));
+	BOOST_REQUIRE(cache.Contains(39));
+	BOOST_REQUIRE(cache.Contains(40));
+	BOOST_REQUIRE(cache.Contains(43));
+	BOOST_REQUIRE(cache.Contains(45));
+	BOOST_REQUIRE(!cache.Contains(44));
+}
+
+BOOST_AUTO_TEST_CASE(Reserve)
+{
+	artdaq::RoutingCache cache(4);
+	for (artdaq::Fragment::sequence_id_t seq = 1; seq <= 12; ++seq)
+	{
+		cache.Insert(seq).emplace_back(seq, static_cast<int>(seq), 100);
+	}
+
+	// Growing the ring keeps every route, and a smaller size does not shrink it
+	cache.Reserve(20);
+	cache.Reserve(4);
+	for (artdaq::Fragment::sequence_id_t seq = 13; seq <= 40; ++seq)
+	{
+		cache.Insert(seq).emplace_back(seq, static_cast<int>(seq), 100);
+		cache.Trim(20);
+	}
+	BOOST_REQUIRE_EQUAL(cache.Size(), 20);
+	for (artdaq::Fragment::sequence_id_t seq = 1; seq <= 40; ++seq)
+	{
+		BOOST_REQUIRE_EQUAL(cache.Contains(seq), seq > 20);
+		if (seq > 20)
+		{
+			BOOST_REQUIRE_EQUAL(cache.Find(seq)->front().destination_rank, static_cast<int>(seq));
+		}
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
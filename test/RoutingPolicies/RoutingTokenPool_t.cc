@@ -0,0 +1,143 @@
+#define BOOST_TEST_MODULE RoutingTokenPool_t
+#include <boost/test/unit_test.hpp>
+
+#include "artdaq/RoutingPolicies/RoutingTokenPool.hh"
+
+#include <map>
+
+BOOST_AUTO_TEST_SUITE(RoutingTokenPool_t)
+
+BOOST_AUTO_TEST_CASE(Counts)
+{
+	artdaq::RoutingTokenPool pool;
+	BOOST_REQUIRE(pool.Empty());
+	BOOST_REQUIRE_EQUAL(pool.TakeNext(), -1);
+
+	pool.Add(3, 2);
+	pool.Add(1, 1);
+	pool.Add(2, 0);
+	pool.Add(3, 1);
+	BOOST_REQUIRE_EQUAL(pool.Size(), 4);
+	BOOST_REQUIRE_EQUAL(pool.Count(1), 1);
+	BOOST_REQUIRE_EQUAL(pool.Count(2), 0);
+	BOOST_REQUIRE_EQUAL(pool.Count(3), 3);
+	BOOST_REQUIRE_EQUAL(pool.Count(4), 0);
+	BOOST_REQUIRE_EQUAL(pool.Ranks().size(), 3);
+	BOOST_REQUIRE_EQUAL(pool.Ranks()[0], 1);
+	BOOST_REQUIRE_EQUAL(pool.Ranks()[1], 2);
+	BOOST_REQUIRE_EQUAL(pool.Ranks()[2], 3);
+
+	// Take removes at most the tokens held
+	pool.Take(3, 5);
+	pool.Take(4);
+	BOOST_REQUIRE_EQUAL(pool.Count(3), 0);
+	BOOST_REQUIRE_EQUAL(pool.Size(), 1);
+
+	pool.Clear();
+	BOOST_REQUIRE(pool.Empty());
+	BOOST_REQUIRE(pool.Ranks().empty());
+	BOOST_REQUIRE_EQUAL(pool.Count(1), 0);
+}
+
+BOOST_AUTO_TEST_CASE(TakeAndTakeNext)
+{
+	artdaq::RoutingTokenPool pool;
+	pool.Add(1, 2);
+	pool.Add(2, 1);
+	pool.Add(1, 1);
+	pool.Add(3, 2);
+
+	// Take removes a token of the rank, and TakeNext skips it: the arrival order 1 1 2 1 3 3 becomes 1 2 1 3
+	pool.Take(1);
+	pool.Take(3);
+	BOOST_REQUIRE_EQUAL(pool.Size(), 4);
+	BOOST_REQUIRE_EQUAL(pool.TakeNext(), 1);
+	BOOST_REQUIRE_EQUAL(pool.TakeNext(), 2);
+	BOOST_REQUIRE_EQUAL(pool.Count(1), 1);
+	BOOST_REQUIRE_EQUAL(pool.TakeNext(), 1);
+	BOOST_REQUIRE_EQUAL(pool.TakeNext(), 3);
+	BOOST_REQUIRE(pool.Empty());
+	BOOST_REQUIRE_EQUAL(pool.TakeNext(), -1);
+
+	// Tokens taken while the pool was emptied do not carry over
+	pool.Add(2, 1);
+	pool.Add(1, 1);
+	BOOST_REQUIRE_EQUAL(pool.TakeNext(), 2);
+	BOOST_REQUIRE_EQUAL(pool.TakeNext(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(Spread)
+{
+	artdaq::RoutingTokenPool pool;
+	pool.Add(5, 1);
+	pool.Add(1, 100, true);
+	pool.Add(2, 100, true);
+	pool.Add(3, 1);
+
+	// Spread tokens come first, and are interleaved
+	std::map<int, size_t> taken;
+	int switches = 0;
+	int last = -1;
+	for (int ii = 0; ii < 200; ++ii)
+	{
+		auto rank = pool.TakeNext();
+		BOOST_REQUIRE(rank == 1 || rank == 2);
+		taken[rank]++;
+		switches += last != -1 && rank != last;
+		last = rank;
+	}
+	BOOST_REQUIRE_EQUAL(taken[1], 100);
+	BOOST_REQUIRE_EQUAL(taken[2], 100);
+	BOOST_REQUIRE_GT(switches, 20);
+
+	// Then the others, in arrival order
+	BOOST_REQUIRE_EQUAL(pool.TakeNext(), 5);
+	BOOST_REQUIRE_EQUAL(pool.TakeNext(), 3);
+	BOOST_REQUIRE(pool.Empty());
+
+	// Take removes spread tokens before the others
+	pool.Add(1, 1);
+	pool.Add(1, 3, true);
+	pool.Add(2, 3, true);
+	pool.Take(1, 3);
+	BOOST_REQUIRE_EQUAL(pool.Count(1), 1);
+	for (int ii = 0; ii < 3; ++ii)
+	{
+		BOOST_REQUIRE_EQUAL(pool.TakeNext(), 2);
+	}
+	BOOST_REQUIRE_EQUAL(pool.TakeNext(), 1);
+	BOOST_REQUIRE(pool.Empty());
+}
+
+// Tokens removed by Take are compacted out of the arrival order without changing it
+BOOST_AUTO_TEST_CASE(Compaction)
+{
+	artdaq::RoutingTokenPool pool;
+	pool.Add(3, 1);
+	for (int ii = 0; ii < 100000; ++ii)
+	{
+		pool.Add(1, 1);
+		pool.Add(2, 1);
+		pool.Take(1);
+		pool.Take(2);
+		if (ii % 1000 == 0)
+		{
+			pool.Add(4, 1);
+		}
+	}
+	BOOST_REQUIRE_EQUAL(pool.Size(), 101);
+	BOOST_REQUIRE_EQUAL(pool.Count(4), 100);
+
+	pool.Add(2, 1);
+	pool.Add(1, 1);
+	BOOST_REQUIRE_EQUAL(pool.TakeNext(), 3);
+	for (int ii = 0; ii < 100; ++ii)
+	{
+		BOOST_REQUIRE_EQUAL(pool.TakeNext(), 4);
+	}
+	BOOST_REQUIRE_EQUAL(pool.TakeNext(), 2);
+	BOOST_REQUIRE_EQUAL(pool.TakeNext(), 1);
+	BOOST_REQUIRE(pool.Empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
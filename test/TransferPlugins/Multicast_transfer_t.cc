@@ -0,0 +1,248 @@
+#define TRACE_NAME "Multicast_transfer_t"
+#include "artdaq/DAQdata/Globals.hh"
+#include "artdaq/DAQdata/TCPConnect.hh"
+#include "artdaq/DAQdata/TCP_listen_fd.hh"
+#include "artdaq/TransferPlugins/MakeTransferPlugin.hh"
+
+#include "artdaq-core/Data/Fragment.hh"
+#include "fhiclcpp/ParameterSet.h"
+
+#define BOOST_TEST_MODULE Multicast_transfer_t
+#include <boost/test/unit_test.hpp>
+
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace {
+constexpr int receiver_count = 3;
+constexpr size_t receive_timeout_us = 1000000;
+
+fhicl::ParameterSet make_pset(double drop_fraction, size_t window_fragments)
+{
+	fhicl::ParameterSet transfer;
+	transfer.put("transferPluginType", "Multicast");
+	transfer.put("source_rank", 0);
+	transfer.put("destination_rank", 1);
+	transfer.put("subfragment_size", 8192);
+	transfer.put("subfragments_per_send", 10);
+	transfer.put("local_address", "127.0.0.1");
+	transfer.put("max_fragment_size_words", 1048576);
+	transfer.put("receive_buffer_size", 8388608);
+	transfer.put("debug_drop_fraction", drop_fraction);
+	transfer.put("retransmit_window_fragments", window_fragments);
+	transfer.put("reorder_window_fragments", window_fragments);
+	transfer.put("multicast_transfer_port_offset", 30000 + getpid() % 10000);
+
+	fhicl::ParameterSet ps;
+	ps.put("multicast", transfer);
+	return ps;
+}
+
+size_t payload_words(size_t seq) { return 1000 * (seq % 50) + 17; }
+
+artdaq::Fragment make_fragment(size_t seq)
+{
+	artdaq::Fragment frag(payload_words(seq));
+	frag.setSequenceID(seq);
+	frag.setFragmentID(0);
+	for (size_t ii = 0; ii < frag.dataSize(); ++ii)
+	{
+		*(frag.dataBegin() + ii) = seq * 1000003 + ii;  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	}
+	return frag;
+}
+
+bool check_fragment(artdaq::Fragment const& frag, size_t seq)
+{
+	if (frag.sequenceID() != seq || frag.dataSize() != payload_words(seq))
+	{
+		return false;
+	}
+	for (size_t ii = 0; ii < frag.dataSize(); ++ii)
+	{
+		if (*(frag.dataBegin() + ii) != seq * 1000003 + ii)  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// Sends count Fragments once, to receiver_count receivers. Each receiver collects the sequence IDs of the intact Fragments it got.
+double multicast_fanout(fhicl::ParameterSet const& ps, size_t count, std::vector<std::vector<size_t>>& received)
+{
+	std::vector<std::unique_ptr<artdaq::TransferInterface>> receivers;
+	for (int ii = 0; ii < receiver_count; ++ii)
+	{
+		receivers.push_back(artdaq::MakeTransferPlugin(ps, "multicast", artdaq::TransferInterface::Role::kReceive));
+	}
+	auto sender = artdaq::MakeTransferPlugin(ps, "multicast", artdaq::TransferInterface::Role::kSend);
+
+	received.assign(receiver_count, std::vector<size_t>());
+	std::vector<std::thread> threads;
+	for (int ii = 0; ii < receiver_count; ++ii)
+	{
+		threads.emplace_back([&, ii]() {
+			int timeouts = 0;
+			while (timeouts < 3 && (received[ii].empty() || received[ii].back() < count))
+			{
+				artdaq::Fragment frag;
+				if (receivers[ii]->receiveFragment(frag, receive_timeout_us) < 0)
+				{
+					++timeouts;
+					continue;
+				}
+				timeouts = 0;
+				received[ii].push_back(check_fragment(frag, frag.sequenceID()) ? frag.sequenceID() : 0);
+			}
+		});
+	}
+
+	size_t bytes = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (size_t seq = 1; seq <= count; ++seq)
+	{
+		auto frag = make_fragment(seq);
+		BOOST_REQUIRE(sender->transfer_fragment_min_blocking_mode(frag, receive_timeout_us) == artdaq::TransferInterface::CopyStatus::kSuccess);
+		bytes += frag.sizeBytes();
+	}
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+	return bytes / std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::steady_clock::now() - start).count();
+}
+
+// The same Fragments, copied over one TCP connection per receiver
+double tcp_fanout(size_t count)
+{
+	auto port = 40000 + getpid() % 10000;
+	auto listen_fd = TCP_listen_fd(port, 0);
+	BOOST_REQUIRE(listen_fd >= 0);
+
+	size_t total_bytes = 0;
+	for (size_t seq = 1; seq <= count; ++seq)
+	{
+		total_bytes += (artdaq::detail::RawFragmentHeader::num_words() + payload_words(seq)) * sizeof(artdaq::RawDataType);
+	}
+
+	std::vector<int> send_fds;
+	std::vector<std::thread> threads;
+	std::atomic<size_t> bytes_received(0);
+	for (int ii = 0; ii < receiver_count; ++ii)
+	{
+		send_fds.push_back(TCPConnect("127.0.0.1", port));
+		BOOST_REQUIRE(send_fds.back() >= 0);
+		auto fd = accept(listen_fd, nullptr, nullptr);
+		BOOST_REQUIRE(fd >= 0);
+		threads.emplace_back([fd, total_bytes, &bytes_received]() {
+			std::vector<uint8_t> buffer(65536);
+			size_t received = 0;
+			while (received < total_bytes)
+			{
+				auto sts = read(fd, buffer.data(), buffer.size());
+				if (sts <= 0)
+				{
+					break;
+				}
+				received += sts;
+			}
+			bytes_received += received;
+			close(fd);
+		});
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	for (size_t seq = 1; seq <= count; ++seq)
+	{
+		auto frag = make_fragment(seq);
+		for (auto fd : send_fds)
+		{
+			size_t offset = 0;
+			while (offset < frag.sizeBytes())
+			{
+				auto sts = write(fd, frag.headerBeginBytes() + offset, frag.sizeBytes() - offset);  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+				BOOST_REQUIRE(sts > 0);
+				offset += sts;
+			}
+		}
+	}
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+	auto rate = total_bytes / std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::steady_clock::now() - start).count();
+
+	for (auto fd : send_fds)
+	{
+		close(fd);
+	}
+	close(listen_fd);
+	BOOST_REQUIRE_EQUAL(bytes_received.load(), total_bytes * receiver_count);
+	return rate;
+}
+}  // namespace
+
+BOOST_AUTO_TEST_SUITE(Multicast_transfer_test)
+
+BOOST_AUTO_TEST_CASE(DeliveryWithDrops)
+{
+	// 5% of the datagrams are not sent the first time (retransmissions always are); every receiver must still get
+	// every Fragment, in order.
+	// The windows hold the whole run, so that a slow receiver cannot fall out of them.
+	const size_t count = 300;
+	std::vector<std::vector<size_t>> received;
+	multicast_fanout(make_pset(0.05, count), count, received);
+
+	for (auto& frags : received)
+	{
+		BOOST_REQUIRE_EQUAL(frags.size(), count);
+		for (size_t ii = 0; ii < count; ++ii)
+		{
+			BOOST_REQUIRE_EQUAL(frags[ii], ii + 1);
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(WindowOverrun)
+{
+	// With a retransmit window of one Fragment, heavy loss cannot always be repaired: a NAK which arrives after the
+	// sender has moved on to the next Fragment is answered "unavailable". Receivers must give up on those Fragments
+	// and keep delivering the rest intact and in order, instead of stalling.
+	const size_t count = 100;
+	std::vector<std::vector<size_t>> received;
+	multicast_fanout(make_pset(0.3, 1), count, received);
+
+	for (auto& frags : received)
+	{
+		BOOST_REQUIRE(!frags.empty());
+		for (size_t ii = 0; ii < frags.size(); ++ii)
+		{
+			BOOST_REQUIRE(frags[ii] != 0);
+			if (ii > 0)
+			{
+				BOOST_REQUIRE_GT(frags[ii], frags[ii - 1]);
+			}
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(ThroughputVersusTCP)
+{
+	const size_t count = 500;
+	std::vector<std::vector<size_t>> received;
+	auto multicast_rate = multicast_fanout(make_pset(0.0, count), count, received);
+	for (auto& frags : received)
+	{
+		BOOST_REQUIRE_EQUAL(frags.size(), count);
+	}
+	auto tcp_rate = tcp_fanout(count);
+
+	BOOST_TEST_MESSAGE("Fan-out to " << receiver_count << " receivers: Multicast " << multicast_rate / 1000000 << " MB/s sent once, TCP " << tcp_rate / 1000000 << " MB/s sent " << receiver_count << " times");
+}
+
+BOOST_AUTO_TEST_SUITE_END()